@@ -13,22 +13,29 @@ EcsHandle ecs_new_w_family(
     EcsStage *stage,
     EcsFamily family_id);
 
-/* Merge entity with stage */
-void ecs_merge_entity(
+/* Commit components to add and remove to entity that is not staged */
+void ecs_commit_w_family(
     EcsWorld *world,
     EcsStage *stage,
     EcsHandle entity,
-    EcsRow *staged_row);
+    EcsFamily to_add,
+    EcsFamily to_remove);
 
-/* Notify row system of entity (identified by row_index) */
+/* Copy rows of staged entities to destination table (runs in worker threads) */
+void ecs_merge_table(
+    EcsWorld *world,
+    EcsMergeTable *merge_table);
+
+/* Notify row systems of a range of rows in a table */
 bool ecs_notify(
     EcsWorld *world,
     EcsStage *stage,
-    EcsMap *systems,
+    EcsSystemKind kind,
     EcsFamily family_id,
     EcsTable *table,
     EcsArray *rows,
-    int32_t row_index);
+    uint32_t row_index,
+    uint32_t count);
 
 /* -- World API -- */
 
@@ -38,6 +45,25 @@ EcsTable* ecs_world_get_table(
     EcsStage *stage,
     EcsFamily family_id);
 
+/* Add table to table_db, reuses slots of collected tables */
+EcsTable* ecs_world_add_table(
+    EcsWorld *world);
+
+/* Get table by index in table_db */
+EcsTable* ecs_world_table(
+    EcsWorld *world,
+    uint32_t index);
+
+/* Get new change version for table data (thread safe) */
+uint64_t ecs_world_next_version(
+    EcsWorld *world);
+
+/* Register table with systems that match the table */
+void ecs_world_notify_create_table(
+    EcsWorld *world,
+    EcsStage *stage,
+    EcsTable *table);
+
 /* Activate system (move from inactive array to on_frame array or vice versa) */
 void ecs_world_activate_system(
     EcsWorld *world,
@@ -59,11 +85,53 @@ void ecs_stage_init(
 void ecs_stage_deinit(
     EcsStage *stage);
 
+/* Test if stage has no data to merge */
+bool ecs_stage_is_empty(
+    EcsStage *stage);
+
 /* Merge stage with main stage */
 void ecs_stage_merge(
     EcsWorld *world,
     EcsStage *stage);
 
+/* Test if stage has changes to components read by system */
+bool ecs_stage_intersects(
+    EcsWorld *world,
+    EcsStage *stage,
+    EcsSystem *system_data);
+
+/* Test if operations on entity are recorded in the command log of stage */
+bool ecs_stage_logs(
+    EcsStage *stage,
+    EcsHandle entity);
+
+/* Append record to command log of stage */
+EcsCommand* ecs_stage_append(
+    EcsStage *stage,
+    EcsCommandKind kind,
+    EcsHandle entity,
+    uint64_t value,
+    uint32_t size);
+
+/* Get record at offset in command log and advance offset (NULL if none) */
+EcsCommand* ecs_stage_next_command(
+    EcsCommandBlock **block,
+    uint32_t *offset);
+
+/* Get last record for entity in command log of stage (NULL if none) */
+EcsCommand* ecs_stage_last_command(
+    EcsStage *stage,
+    EcsHandle entity);
+
+/* Coalesce records of entity into components to add and remove */
+bool ecs_stage_coalesce(
+    EcsWorld *world,
+    EcsStage *stage,
+    EcsCommand *last,
+    EcsFamily family_id,
+    EcsFamily *to_add_out,
+    EcsFamily *to_remove_out);
+
 /* -- Family utility API -- */
 
 /* Get family from entity handle (component, family, prefab) */
@@ -146,6 +214,18 @@ uint32_t ecs_table_insert(
     EcsArray **rows,
     EcsHandle entity);
 
+/* Append uninitialized rows to table, returns index of first new row */
+uint32_t ecs_table_grow(
+    EcsWorld *world,
+    EcsTable *table,
+    uint32_t count);
+
+/* Preallocate rows in table, moves table to huge pages if it is large enough */
+void ecs_table_dim(
+    EcsWorld *world,
+    EcsTable *table,
+    uint32_t count);
+
 /* Delete row from table */
 void ecs_table_delete(
     EcsWorld *world,
@@ -163,6 +243,77 @@ uint32_t ecs_table_column_offset(
     EcsTable *table,
     EcsHandle component);
 
+/* Get index of component column in table (-1 if table has no component) */
+int32_t ecs_table_column_index(
+    EcsTable *table,
+    EcsHandle component);
+
+/* Mark column of component in table as changed */
+void ecs_table_touch_column(
+    EcsWorld *world,
+    EcsTable *table,
+    EcsHandle component);
+
+/* Allocate dirty bitmap for column of table */
+void ecs_table_track_dirty(
+    EcsTable *table,
+    uint32_t column);
+
+/* Mark range of rows dirty for column (ignored if column is not tracked) */
+void ecs_table_set_dirty(
+    EcsTable *table,
+    int32_t column,
+    uint32_t first,
+    uint32_t count);
+
+/* Reorder rows of table, where order[i] is the current index of the row that
+ * is moved to index i. Updates the entity index and dirty bitmaps. */
+void ecs_table_reorder(
+    EcsWorld *world,
+    EcsTable *table,
+    const uint32_t *order);
+
+/* Sort rows of table by key (EcsSortKey, one for each row in order of the
+ * rows). Rows with equal keys keep their order. Returns false if the rows
+ * were already sorted. */
+bool ecs_table_sort(
+    EcsWorld *world,
+    EcsTable *table,
+    EcsArray *keys);
+
+/* Enable or disable row of table */
+void ecs_table_set_enabled(
+    EcsTable *table,
+    uint32_t index,
+    bool enabled);
+
+/* Test if row of table is enabled */
+bool ecs_table_is_enabled(
+    EcsTable *table,
+    uint32_t index);
+
+/* Find the first run of enabled rows in [first, last). Sets first to the start
+ * of the run, and returns the number of rows in the run (0 if none). */
+uint32_t ecs_table_enabled_run(
+    EcsTable *table,
+    uint32_t *first,
+    uint32_t last);
+
+/* Get row systems of kind triggered by family for table (cached by table).
+ * If must_free is set, the result is not cached and must be freed with
+ * ecs_table_free_notify. */
+EcsArray* ecs_table_get_notify(
+    EcsWorld *world,
+    EcsStage *stage,
+    EcsTable *table,
+    EcsSystemKind kind,
+    EcsFamily family_id,
+    bool *must_free);
+
+/* Free row systems obtained with ecs_table_get_notify */
+void ecs_table_free_notify(
+    EcsArray *notify);
+
 /* Test if table has component */
 bool ecs_table_has_components(
     EcsTable *table,
@@ -195,13 +346,47 @@ EcsResult ecs_system_notify_create_table(
     EcsHandle system,
     EcsTable *table);
 
+/* Notify query of a new table, which initiates query-table matching */
+void ecs_query_notify_create_table(
+    EcsWorld *world,
+    EcsStage *stage,
+    EcsQuery *query,
+    EcsTable *table);
+
+/* Mark tables that a system writes as changed before running on workers */
+bool* ecs_system_prepare_tables(
+    EcsWorld *world,
+    EcsTableSystem *system_data,
+    bool *filtered,
+    uint64_t seen);
+
 /* Activate table for system (happens if table goes from empty to not empty) */
 void ecs_system_activate_table(
     EcsWorld *world,
-    EcsHandle system,
     EcsTable *table,
+    uint32_t match_index,
     bool active);
 
+/* Remove table from system (happens when table is garbage collected) */
+void ecs_system_remove_table(
+    EcsWorld *world,
+    EcsTable *table,
+    uint32_t match_index);
+
+/* Free the tables cached for the filters of a system */
+void ecs_system_free_filters(
+    EcsTableSystem *system_data);
+
+/* Free resources allocated by a table system */
+void ecs_system_deinit(
+    EcsTableSystem *system_data);
+
+/* Test if period of system has passed, and compute delta_time for system */
+bool ecs_system_period_passed(
+    EcsTableSystem *system_data,
+    float delta_time,
+    float *system_delta_time);
+
 /* Run a job (from a worker thread) */
 void ecs_run_job(
     EcsWorld *world,
@@ -223,6 +408,7 @@ void ecs_row_notify(
     EcsArray *rows,
     EcsArrayParams *row_params,
     uint32_t row_index,
+    uint32_t count,
     int32_t *columns);
 
 /* Callback for parse_component_expr that stores result as EcsSystemColumn's */
@@ -230,6 +416,7 @@ EcsResult ecs_parse_component_action(
     EcsWorld *world,
     EcsSystemExprElemKind elem_kind,
     EcsSystemExprOperKind oper_kind,
+    EcsSystemExprInOutKind inout_kind,
     const char *component_id,
     void *data);
 
@@ -238,17 +425,64 @@ EcsResult ecs_parse_component_action(
 /* Compute schedule based on current number of entities matching system */
 void ecs_schedule_jobs(
     EcsWorld *world,
-    EcsHandle system);
+    EcsHandle system,
+    bool *filtered,
+    uint32_t first_thread);
+
+/* Assign scheduled jobs of system to worker threads */
+void ecs_assign_jobs(
+    EcsWorld *world,
+    EcsTableSystem *system_data,
+    float delta_time,
+    void *param);
 
 /* Prepare jobs */
 void ecs_prepare_jobs(
     EcsWorld *world,
-    EcsHandle system);
+    EcsHandle system,
+    float delta_time,
+    uint64_t seen);
+
+/* Distribute tasks over worker threads */
+void ecs_prepare_tasks(
+    EcsWorld *world,
+    EcsArray *tasks,
+    float delta_time);
+
+/* Distribute merge tables over worker threads */
+void ecs_prepare_merge_jobs(
+    EcsWorld *world,
+    EcsArray *merge_tables);
+
+/* Adjust number of active threads based on thread utilization */
+void ecs_tune_threads(
+    EcsWorld *world);
+
+/* Signal workers and run jobs of main thread */
+void ecs_start_jobs(
+    EcsWorld *world);
+
+/* Wait until workers have finished their jobs */
+void ecs_wait_jobs(
+    EcsWorld *world);
 
 /* Run jobs */
 void ecs_run_jobs(
     EcsWorld *world);
 
+/* -- Hierarchy API -- */
+
+/* Remove deleted entity from its parent, and orphan its children */
+void ecs_hierarchy_delete(
+    EcsWorld *world,
+    EcsHandle entity);
+
+/* -- Sort API -- */
+
+/* Sort tables that changed since they were last sorted by ecs_set_sort */
+void ecs_sort_tables(
+    EcsWorld *world);
+
 /* -- Private utilities -- */
 
 /* Compute hash */
@@ -17,10 +17,34 @@
 #define ECS_WORLD_INITIAL_DEINIT_SYSTEM_COUNT (0)
 #define ECS_WORLD_INITIAL_SET_SYSTEM_COUNT (0)
 #define ECS_WORLD_INITIAL_PREFAB_COUNT (0)
+#define ECS_WORLD_INITIAL_HIERARCHY_COUNT (0)
 #define ECS_MAP_INITIAL_NODE_COUNT (4)
 #define ECS_TABLE_INITIAL_ROW_COUNT (0)
+#define ECS_TABLE_INITIAL_NOTIFY_COUNT (4)
+#define ECS_COMPONENT_CACHE_SIZE (65536)
 #define ECS_SYSTEM_INITIAL_TABLE_COUNT (0)
+#define ECS_SYSTEM_INITIAL_FILTER_COUNT (4)
 #define ECS_MAX_JOBS_PER_WORKER (16)
+#define ECS_MIN_PARALLEL_MERGE_COUNT (64)
+#define ECS_HANDLE_BLOCK_SIZE (4096)
+#define ECS_AUTOTUNE_INTERVAL (16)
+#define ECS_AUTOTUNE_LOW_UTILIZATION (0.5f)
+#define ECS_AUTOTUNE_HIGH_UTILIZATION (0.85f)
+#define ECS_CACHE_LINE_SIZE (64)
+#define ECS_HUGE_PAGE_SIZE (2 * 1024 * 1024)
+#define ECS_POOL_GRANULARITY (16)
+#define ECS_POOL_CLASS_COUNT (16)
+#define ECS_POOL_CACHE_SIZE (64)
+#define ECS_TABLE_PAGE_SIZE (64)
+#define ECS_COMMAND_BLOCK_SIZE (16384)
+
+/* Round size up to a multiple of the cache line size */
+#define ECS_CACHE_LINE_ROUND(size)\
+    (((size) + ECS_CACHE_LINE_SIZE - 1) / ECS_CACHE_LINE_SIZE * ECS_CACHE_LINE_SIZE)
+
+/* Round size up to a multiple of alignment */
+#define ECS_ALIGN(size, alignment)\
+    (((size) + (alignment) - 1) / (alignment) * (alignment))
 
 #define ECS_WORLD_MAGIC (0x65637377)
 #define ECS_THREAD_MAGIC (0x65637374)
@@ -54,16 +78,24 @@ typedef enum EcsSystemExprOperKind {
     EcsOperLast = 4
 } EcsSystemExprOperKind;
 
+typedef enum EcsSystemExprInOutKind {
+    EcsInOut = 0,
+    EcsIn = 1,
+    EcsOut = 2
+} EcsSystemExprInOutKind;
+
 typedef EcsResult (*ecs_parse_action)(
     EcsWorld *world,
     EcsSystemExprElemKind elem_kind,
     EcsSystemExprOperKind oper_kind,
+    EcsSystemExprInOutKind inout_kind,
     const char *component,
     void *ctx);
 
 typedef struct EcsSystemColumn {
     EcsSystemExprElemKind kind;       /* Element kind (Entity, Component) */
     EcsSystemExprOperKind oper_kind;  /* Operator kind (AND, OR, NOT) */
+    EcsSystemExprInOutKind inout_kind; /* Access kind (in, out, inout) */
     union {
         EcsFamily family;             /* Used for OR operator */
         EcsHandle component;          /* Used for AND operator */
@@ -75,6 +107,12 @@ typedef struct EcsSystemRef {
     EcsHandle component;
 } EcsSystemRef;
 
+typedef struct EcsMatchedSystem {
+    EcsHandle system;          /* Table system matched with table */
+    struct EcsTableSystem *query; /* Query matched with table (system is 0) */
+    uint32_t index;            /* Index of table in (inactive_)tables array */
+} EcsMatchedSystem;
+
 typedef struct EcsSystem {
     EcsSystemAction action;    /* Callback to be invoked for matching rows */
     const char *signature;     /* Signature with which system was created */
@@ -85,6 +123,7 @@ typedef struct EcsSystem {
     EcsSystemKind kind;        /* Kind of system */
     float time_spent;          /* Time spent on running system */
     bool enabled;              /* Is system enabled or not */
+    bool sync;                 /* Merge stages before system if needed */
 } EcsSystem;
 
 typedef struct EcsTableSystem {
@@ -92,8 +131,10 @@ typedef struct EcsTableSystem {
     EcsArray *components;      /* Computed component list per matched table */
     EcsArray *inactive_tables; /* Inactive tables */
     EcsArray *jobs;            /* Jobs for this system */
+    EcsArray *filtered;        /* Tables that match filter of parallel run */
     EcsArray *tables;          /* Table index + refs index + column offsets */
     EcsArray *refs;            /* Columns that point to other entities */
+    EcsMap *filters;           /* Cached tables per filter (EcsSystemFilter) */
     EcsArrayParams table_params; /* Parameters for tables array */
     EcsArrayParams component_params; /* Parameters for components array */
     EcsArrayParams ref_params; /* Parameters for tables array */
@@ -101,6 +142,7 @@ typedef struct EcsTableSystem {
     EcsFamily and_from_system; /* Used to auto-add components to system */
     float period;              /* Minimum period inbetween system invocations */
     float time_passed;         /* Time passed since last invocation */
+    bool skip_unchanged;       /* Skip tables of which inputs did not change */
 } EcsTableSystem;
 
 typedef struct EcsRowSystem {
@@ -108,22 +150,89 @@ typedef struct EcsRowSystem {
     EcsArray *components;       /* Components in order of signature */
 } EcsRowSystem;
 
+/** A query matches tables in the same way as an on demand table system, but
+ * is not stored as an entity. The query owns a copy of its signature. */
+struct EcsQuery {
+    EcsTableSystem system_data; /* Matched tables (system has no action) */
+};
+
 /* -- Private types -- */
 
 typedef struct EcsTable {
     EcsArray *family;             /* Reference to family_index entry */
     EcsArray *rows;               /* Rows of the table */
-    EcsArray *frame_systems;      /* Frame systems matched with table */
+    EcsArray *frame_systems;      /* Frame systems matched (EcsMatchedSystem) */
     EcsArrayParams row_params;    /* Parameters for rows array */
     EcsFamily family_id;          /* Identifies a family in family_index */
     uint16_t *columns;            /* Column (component) sizes */
+    uint64_t *column_versions;    /* Change version of each column */
+    uint64_t rows_version;        /* Change version of inserted/deleted rows */
+    EcsArray **dirty;             /* Dirty bitmap per column (NULL if none) */
+    EcsArray *disabled;           /* Bitmap of disabled rows (NULL if none) */
+    uint32_t disabled_count;      /* Number of disabled rows */
+    uint64_t sort_version;        /* Change version at last sort */
+    EcsMap *notify_index;         /* Row systems triggered per notified family */
+    uint32_t notify_version;      /* World notify_version of notify_index */
+    uint32_t empty_since;         /* Frame at which table became empty */
+    uint32_t index;               /* Index of table in table_db */
 } EcsTable;
 
+/** Sort key of a row, used to reorder the rows of a table */
+typedef struct EcsSortKey {
+    uint64_t key;              /* Key by which rows are ordered */
+    uint32_t index;            /* Current index of the row */
+} EcsSortKey;
+
+/** Active table of a system that matches a cached filter */
+typedef struct EcsFilterTable {
+    EcsTable *table;           /* Matched table */
+    uint32_t match_index;      /* Index in frame_systems array of table */
+} EcsFilterTable;
+
+/** Active tables of a system that match a filter passed to ecs_run_system */
+typedef struct EcsSystemFilter {
+    EcsFamily filter_id;       /* Family of the filter */
+    EcsArray *tables;          /* Matching tables (EcsFilterTable) */
+} EcsSystemFilter;
+
+/** Table matched with a table system. Column offsets (or negative ref indexes)
+ * follow the record, one for each column in the system signature. These are
+ * followed by the index of each column in the table (-1 if the column is not
+ * stored in the table), which is used to track changes. */
+typedef struct EcsSystemTable {
+    EcsTable *table;              /* Matched table */
+    uint64_t version;             /* Change version seen by last run */
+    int32_t refs_index;           /* Index in refs array (0 = no refs) */
+    int32_t components_index;     /* Index in components array */
+    int32_t match_index;          /* Index in frame_systems array of table */
+    int32_t columns[];            /* Offsets of columns in table rows */
+} EcsSystemTable;
+
+/** Row system triggered for the rows of a table, with the offsets of its
+ * columns in the table rows. Offsets are 0 for columns not stored in the
+ * table. */
+typedef struct EcsTableNotify {
+    EcsHandle system;             /* Row system to invoke */
+    int32_t *columns;             /* Offsets of system columns in table rows */
+} EcsTableNotify;
+
+/** Data of a component that is needed by ecs_set, cached by component handle */
+typedef struct EcsComponentCache {
+    uint32_t size;                /* Size of component (0 if not cached) */
+    bool on_set;                  /* Is an OnSet system registered */
+} EcsComponentCache;
+
 typedef struct EcsRow {
     EcsFamily family_id;          /* Identifies a family (and table) in world */
     uint32_t index;               /* Index of the entity in its table */
 } EcsRow;
 
+/* Component set on a staged entity, which is marked dirty after merging */
+typedef struct EcsDirtyRef {
+    EcsHandle entity;             /* Entity on which component was set */
+    EcsHandle component;          /* Component that was set */
+} EcsDirtyRef;
+
 typedef struct EcsEntityInfo {
     EcsHandle entity;
     EcsFamily family_id;
@@ -132,35 +241,123 @@ typedef struct EcsEntityInfo {
     EcsArray *rows;
 } EcsEntityInfo;
 
+/* Operation on an entity that is recorded in the command log of a stage */
+typedef enum EcsCommandKind {
+    EcsCommandAdd,
+    EcsCommandRemove,
+    EcsCommandSet,
+    EcsCommandDelete
+} EcsCommandKind;
+
+/* Command log record. The value of a set command is stored after the record */
+typedef struct EcsCommand {
+    struct EcsCommand *prev;      /* Previous command for entity (if indexed) */
+    EcsHandle entity;             /* Entity to modify */
+    uint64_t value;               /* Family (add, remove) or component (set) */
+    uint32_t size;                /* Size of the value of a set command */
+    EcsCommandKind kind;          /* Operation */
+} EcsCommand;
+
+/* Block of command log records. Blocks are not reallocated, so that pointers
+ * to records remain valid until the stage is merged. */
+typedef struct EcsCommandBlock {
+    struct EcsCommandBlock *next; /* Next block in log */
+    uint32_t size;                /* Bytes available for records */
+    uint32_t used;                /* Bytes used by records */
+} EcsCommandBlock;
+
+/* Size of a command log record with a value of the specified size */
+#define ECS_COMMAND_SIZE(size)\
+    (sizeof(EcsCommand) + ECS_ALIGN(size, sizeof(uint64_t)))
+
+/* Append-only log of operations on entities that are not staged */
+typedef struct EcsCommandLog {
+    EcsCommandBlock *first;       /* First block of log */
+    EcsCommandBlock *current;     /* Block that records are appended to */
+    EcsCommandBlock *index_block; /* Block of first record that is not indexed */
+    uint32_t index_offset;        /* Offset of first record that is not indexed */
+    uint32_t count;               /* Number of records */
+    uint32_t index_count;         /* Number of indexed records */
+    EcsMap *index;                /* Last record for entity (built on demand) */
+} EcsCommandLog;
+
 typedef struct EcsStage {
     EcsMap *add_stage;            /* Entities with components to add */
     EcsMap *remove_stage;         /* Entities with components to remove */
-    EcsMap *remove_merge;         /* All removed components before merge */
-    EcsArray *delete_stage;       /* Deleted entities while in progress */
-    EcsMap *entity_stage;         /* Entities committed while in progress */
+    EcsCommandLog commands;       /* Operations on entities that are not staged */
+    EcsMap *entity_stage;         /* Entities created while in progress */
     EcsMap *data_stage;           /* Arrays with staged component values */
     EcsMap *family_stage;         /* Families created while >1 threads running*/
     EcsArray *table_db_stage;     /* Tables created while >1 threads running */
     EcsMap *table_stage;          /* Index for table stage */
+    EcsArray *dirty_stage;        /* Tracked components set while in progress */
 } EcsStage;
 
+/* Range of component data that is copied between rows of two tables */
+typedef struct EcsCopySegment {
+    uint32_t src_offset;          /* Offset of data in source row */
+    uint32_t dst_offset;          /* Offset of data in destination row */
+    uint32_t size;                /* Number of bytes to copy */
+} EcsCopySegment;
+
+typedef struct EcsMergeRow {
+    EcsHandle entity;             /* Entity to merge */
+    uint64_t *index_ptr;          /* Entity index entry (NULL if new entity) */
+    EcsTable *old_table;          /* Table that currently stores entity */
+    EcsTable *staged_table;       /* Table of staged data */
+    EcsArray *staged_rows;        /* Staged rows */
+    EcsFamily old_family_id;      /* Family of the current table */
+    EcsFamily staged_family_id;   /* Family of the staged data */
+    uint32_t old_index;           /* Index of entity in current table */
+    uint32_t staged_index;        /* Index of entity in staged rows */
+    uint32_t new_index;           /* Index of entity in destination table */
+} EcsMergeRow;
+
+typedef struct EcsMergeTable {
+    EcsTable *table;              /* Destination table (NULL if family is 0) */
+    EcsFamily family_id;          /* Family of destination table */
+    EcsArray *rows;               /* Staged entities (EcsMergeRow) to merge */
+} EcsMergeTable;
+
 typedef struct EcsJob {
     EcsHandle system;             /* System handle */
-    EcsTableSystem *system_data;  /* System to run */
+    EcsTableSystem *system_data;  /* System to run (NULL if job runs a task) */
+    EcsMergeTable *merge_table;   /* Table to merge (NULL if not merging) */
     uint32_t table_index;         /* Current SystemTable */
     uint32_t start_index;         /* Start index in row chunk */
     uint32_t row_count;           /* Total number of rows to process */
+    float delta_time;             /* Delta time passed to system */
+    bool *filtered;               /* Tables matching filter (NULL if none) */
+    void *param;                  /* User parameter passed to system */
+    EcsHandle interrupted_by;     /* Set if system interrupted the job */
 } EcsJob;
 
+/* Threads are allocated individually and padded to a multiple of the cache
+ * line size, so that threads do not write to each other's cache lines. */
 typedef struct EcsThread {
     uint32_t magic;               /* Magic number to verify thread pointer */
     uint32_t job_count;           /* Number of jobs scheduled for thread */
+    uint32_t index;               /* Index of thread in worker_threads */
     EcsWorld *world;              /* Reference to world */
     EcsJob *jobs[ECS_MAX_JOBS_PER_WORKER]; /* Array with jobs */
-    EcsStage *stage;              /* Stage for thread */
+    EcsStage *stage;              /* Stage for thread (allocated by thread) */
+    EcsHandle next_handle;        /* Next free handle in reserved block */
+    uint32_t handles_left;        /* Free handles left in reserved block */
+    uint32_t job_generation;      /* Last batch of jobs processed by thread */
+    float busy_time;              /* Time spent running jobs (autotune) */
+    bool quit;                    /* Signals thread to quit */
     pthread_t thread;             /* Thread handle */
 } EcsThread;
 
+/* A system run that is executed asynchronously by worker threads */
+struct EcsSystemRun {
+    EcsWorld *world;              /* Reference to world */
+    EcsHandle system;             /* System that is running (0 if none) */
+    EcsTableSystem *system_data;  /* System data */
+    EcsHandle interrupted_by;     /* Result of run if not using jobs */
+    struct timespec start;        /* Start of run (if measuring time) */
+};
+
 struct EcsWorld {
     uint32_t magic;               /* Magic number to verify world pointer */
 
@@ -168,37 +365,64 @@ struct EcsWorld {
 
     void *context;                /* Application context */
 
-    EcsArray *table_db;           /* All tables in the world */
+    EcsArray *table_db;           /* Pages with tables (stable addresses) */
+    EcsArray *table_free;         /* Slots of collected tables in table_db */
+    uint32_t table_count;         /* Number of table slots in table_db */
     EcsArray *frame_systems;      /* Frame systems */
     EcsArray *pre_frame_systems;  /* Systems executed before frame systems */
     EcsArray *post_frame_systems; /* Systems executed after frame systems */
     EcsArray *inactive_systems;   /* Frame systems with empty tables */
     EcsArray *on_demand_systems;  /* On demand systems */
+    EcsArray *queries;            /* Queries (EcsQuery*) */
 
     EcsMap *add_systems;          /* Systems invoked on ecs_stage_add */
     EcsMap *remove_systems;       /* Systems invoked on ecs_stage_remove */
     EcsMap *set_systems;          /* Systems invoked on ecs_set */
     EcsArray *tasks;              /* Periodic actions not invoked on entities */
     EcsArray *fini_tasks;         /* Tasks to execute on ecs_fini */
+    EcsArray *task_jobs;          /* Jobs for running tasks in worker threads */
+    EcsArray *merge_jobs;         /* Jobs for merging in worker threads */
+    EcsArray *merge_tables;       /* Staged entities bucketed by table */
+    EcsMap *merge_index;          /* Maps family to merge_tables index */
+    EcsArray *merge_removed;      /* Rows (EcsRow) to remove after merge */
 
     EcsMap *entity_index;         /* Maps entity handle to EcsRow  */
     EcsMap *table_index;          /* Identifies a table by family_id */
     EcsMap *family_index;         /* References to component families */
     EcsMap *family_handles;       /* Index to explicitly created families */
     EcsMap *prefab_index;         /* Index for finding prefabs in families */
+    EcsMap *parent_index;         /* Maps child entity to parent entity */
+    EcsMap *child_index;          /* Maps parent to children (EcsArray) */
 
     EcsStage stage;              /* Stage of main thread */
 
-    EcsArray *worker_threads;     /* Worker threads */
-    EcsArray *stage_db;           /* Stage storage (one for each worker) */
+    EcsArray *worker_threads;     /* Worker threads (EcsThread*) */
     pthread_cond_t thread_cond;   /* Signal that worker threads can start */
+    pthread_cond_t park_cond;     /* Signal that active threads changed */
     pthread_mutex_t thread_mutex; /* Mutex for thread condition */
     pthread_cond_t job_cond;      /* Signal that worker thread job is done */
     pthread_mutex_t job_mutex;    /* Mutex for protecting job counter */
     uint32_t jobs_finished;       /* Number of jobs finished */
     uint32_t threads_running;     /* Number of threads running */
+    uint32_t active_threads;      /* Number of threads receiving jobs */
+    uint32_t job_generation;      /* Incremented for each batch of jobs */
+    uint32_t tune_frames;         /* Frames since last autotune evaluation */
+    float jobs_time;              /* Time spent waiting for jobs (autotune) */
+    struct timespec jobs_start;   /* Time at which current jobs started */
+    bool jobs_pending;            /* Are workers running jobs */
+    EcsSystemRun system_run;      /* Asynchronous system run */
 
     EcsHandle last_handle;        /* Last issued handle */
+    uint32_t handle_block_count;  /* Handle blocks reserved by threads */
+    uint32_t sync_count;          /* Merges performed at sync points */
+    size_t huge_page_threshold;   /* Table size at which huge pages are used */
+    uint32_t gc_frames;           /* Frames after which empty tables are freed */
+    uint64_t change_version;      /* Last version assigned to a table change */
+    EcsFamily dirty_family;       /* Components with dirty bitmaps */
+    uint32_t notify_version;      /* Invalidates row systems cached by tables */
+    EcsArray *component_cache;    /* EcsComponentCache, indexed by handle */
+    EcsHandle sort_component;     /* Component by which tables are sorted */
+    EcsSortKeyAction sort_action; /* Computes sort key from component */
     EcsHandle deinit_table_system; /* Handle to internal deinit system */
     EcsHandle deinit_row_system;  /* Handle to internal deinit system */
 
@@ -209,6 +433,7 @@ struct EcsWorld {
     EcsFamily prefab_family;      /* EcsPrefab, EcsId */
 
     uint32_t tick;                /* Number of computed frames by world */
+    uint32_t frame_count;         /* Frames processed since world creation */
     struct timespec frame_start;  /* Starting timestamp of frame */
     float frame_time;             /* Time spent processing a frame */
     float system_time;            /* Time spent processing systems */
@@ -225,14 +450,55 @@ struct EcsWorld {
     bool measure_frame_time;      /* Time spent on each frame */
     bool measure_system_time;     /* Time spent by each system */
     bool should_quit;             /* Did a system signal that app should quit */
+    bool pin_threads;             /* Pin worker threads to CPU cores */
+    bool autotune_threads;        /* Adjust number of active threads */
+    bool phase_sync;              /* Merge stages between phases if needed */
 };
 
 extern const EcsArrayParams handle_arr_params;
-extern const EcsArrayParams stage_arr_params;
 extern const EcsArrayParams table_arr_params;
+extern const EcsArrayParams table_page_arr_params;
 extern const EcsArrayParams thread_arr_params;
 extern const EcsArrayParams job_arr_params;
 extern const EcsArrayParams column_arr_params;
+extern const EcsArrayParams matched_system_arr_params;
+extern const EcsArrayParams query_arr_params;
+extern const EcsArrayParams index_arr_params;
+extern const EcsArrayParams dirty_arr_params;
+extern const EcsArrayParams dirty_ref_arr_params;
+extern const EcsArrayParams notify_arr_params;
+extern const EcsArrayParams component_cache_arr_params;
+extern const EcsArrayParams filter_table_arr_params;
+extern const EcsArrayParams sort_key_arr_params;
+
+/* -- Memory allocation (dispatches to the hooks set by ecs_set_allocator) -- */
+
+void* ecs_os_malloc(
+    size_t size);
+
+void* ecs_os_calloc(
+    size_t size);
+
+void* ecs_os_realloc(
+    void *ptr,
+    size_t size);
+
+void ecs_os_free(
+    void *ptr);
+
+void* ecs_os_alloc_aligned(
+    size_t alignment,
+    size_t size);
+
+void ecs_os_free_aligned(
+    void *ptr);
+
+void* ecs_os_alloc_fixed(
+    size_t size);
+
+void ecs_os_free_fixed(
+    void *ptr,
+    size_t size);
 
 
 #endif
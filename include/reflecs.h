@@ -50,6 +50,12 @@ typedef const char *EcsId;
 
 typedef struct EcsWorld EcsWorld;
 
+/** Handle to a system run that executes asynchronously */
+typedef struct EcsSystemRun EcsSystemRun;
+
+/** Query that caches the tables that match a signature */
+typedef struct EcsQuery EcsQuery;
+
 /** A handle identifies an entity */
 typedef uint64_t EcsHandle;
 
@@ -217,11 +223,19 @@ void ecs_import(
  * - ecs_commit
  * - ecs_set
  *
+ * Changes to entities that were not created while in progress are recorded in
+ * a per-thread log, and applied when the stage is merged. Operations on the
+ * same entity are coalesced, so that for example setting a component twice
+ * copies the last value, and adding and then removing a component has no
+ * effect. OnAdd and OnSet systems for these changes run when merging.
+ *
  * By default, staged data is merged each time ecs_progress has evaluated all
  * systems. An application may choose to manually merge instead, by setting
  * auto-merging to false with ecs_set_automerge and invoking ecs_merge when a
  * merge is required. In applications with relatively lots of data to merge,
- * this can significantly boost performance.
+ * this can significantly boost performance. Applications can also merge
+ * earlier in a frame, by declaring sync points with ecs_set_sync_point and
+ * ecs_set_phase_sync.
  *
  * It should be noted that delaying a merge in a multithreaded application
  * causes temporary inconsistencies between threads. A thread will be able to
@@ -248,6 +262,15 @@ void ecs_import(
  * time management, it should pass a non-zero value for delta_time (1.0 is
  * recommended). That way, no time will be wasted measuring the time.
  *
+ * Systems are evaluated in phases: first EcsPreFrame systems, then EcsOnFrame
+ * systems, then tasks and finally EcsPostFrame systems. When worker threads
+ * are configured, the systems of each phase are distributed as jobs across
+ * the threads, and a phase does not start before all jobs of the previous
+ * phase have finished. Tasks are spread out over the threads as well, so
+ * tasks should not depend on each other. Unless auto-merging is disabled,
+ * changes staged by EcsPreFrame systems are merged before EcsOnFrame systems
+ * run, so that they are visible to the rest of the frame.
+ *
  * @time-complexity: O(s * t)
  * @param world The world to progress.
  * @param delta_time The time passed since the last frame.
@@ -297,11 +320,56 @@ void ecs_set_automerge(
     EcsWorld *world,
     bool auto_merge);
 
+/** Declare a sync point before a system.
+ * Changes made by systems are normally merged after all systems have ran. A
+ * system that needs to see changes made by systems that ran before it in the
+ * same frame, such as entities spawned by an earlier system, can declare a sync
+ * point. Before the system runs, the stages are merged if they contain changes
+ * to entities with components that the system reads. If no such changes were
+ * staged, the sync point does not merge.
+ *
+ * When worker threads are used, the systems that ran before the sync point in
+ * the same phase finish their jobs before the stages are merged.
+ *
+ * Sync points are ignored when auto-merging is disabled.
+ *
+ * @param world The world.
+ * @param system The system before which to merge.
+ * @param sync True to declare a sync point, false to remove it.
+ */
+REFLECS_EXPORT
+void ecs_set_sync_point(
+    EcsWorld *world,
+    EcsHandle system,
+    bool sync);
+
+/** Declare sync points between phases.
+ * When enabled, stages are merged before the systems of a phase (EcsPreFrame,
+ * EcsOnFrame, EcsPostFrame) run, if any of those systems read components of
+ * entities that were changed in an earlier phase. This limits how much data
+ * accumulates in the stages, and lets systems of a phase see the changes of
+ * the phases before it in the same frame.
+ *
+ * Sync points are ignored when auto-merging is disabled.
+ *
+ * @param world The world.
+ * @param sync True to merge between phases, false to merge only at the end of
+ * a frame.
+ */
+REFLECS_EXPORT
+void ecs_set_phase_sync(
+    EcsWorld *world,
+    bool sync);
+
 /** Set number of worker threads.
  * This operation sets the number of worker threads to which to distribute the
  * processing load. If this function is called multiple times, the total number
  * of threads running will reflect the number specified in the last call.
  *
+ * When worker threads are already running, the pool is resized without
+ * restarting the existing threads. Data staged by threads that are removed is
+ * merged before the threads are deleted.
+ *
  * This function should not be called while processing an iteration, but should
  * only be called before or after calling ecs_progress.
  *
@@ -318,6 +386,44 @@ EcsResult ecs_set_threads(
     EcsWorld *world,
     uint32_t threads);
 
+/** Pin worker threads to CPU cores.
+ * When enabled, each worker thread is pinned to a CPU core, which prevents the
+ * operating system from migrating threads across cores and NUMA nodes. This
+ * keeps the memory of a worker thread, which is allocated by the thread itself,
+ * local to the core that uses it. Threads are pinned in order to the cores
+ * that the process is allowed to run on.
+ *
+ * This setting takes effect the next time worker threads are started with
+ * ecs_set_threads. Thread pinning is only supported on Linux. On other
+ * platforms this setting is ignored.
+ *
+ * @param world The world.
+ * @param pin_threads When true, worker threads are pinned to CPU cores.
+ */
+REFLECS_EXPORT
+void ecs_set_pin_threads(
+    EcsWorld *world,
+    bool pin_threads);
+
+/** Automatically tune the number of active worker threads.
+ * When enabled, ecs_progress periodically measures how much of the time spent
+ * in jobs worker threads were busy, versus waiting for other threads to finish.
+ * If threads are mostly waiting, a thread is parked. If all threads are mostly
+ * busy, a parked thread is activated again. The number of active threads never
+ * exceeds the number of threads set with ecs_set_threads.
+ *
+ * Parked threads do not consume CPU time, which reduces contention with other
+ * processes on the same machine when the workload does not benefit from more
+ * threads. When auto-tuning is disabled, all threads are activated.
+ *
+ * @param world The world.
+ * @param autotune When true, the number of active threads is tuned.
+ */
+REFLECS_EXPORT
+void ecs_set_autotune_threads(
+    EcsWorld *world,
+    bool autotune);
+
 /** Set target frames per second (FPS) for application.
  * Setting the target FPS ensures that ecs_progress is not invoked faster than
  * the specified FPS. When enabled, ecs_progress tracks the time passed since
@@ -424,6 +530,71 @@ void ecs_dim_family(
     EcsHandle family,
     uint32_t entity_count);
 
+/** Store large tables in huge page memory.
+ * Tables whose row storage reaches the specified number of bytes are moved to
+ * memory regions that are aligned to 2MB, and which on Linux are advised to be
+ * backed by transparent huge pages. This reduces TLB misses when systems scan
+ * large tables. The check happens when a table grows, and when a table is
+ * dimensioned with ecs_dim_family, which makes it possible to move a table to
+ * huge pages before any entities are added to it.
+ *
+ * When many entities are removed from a table in huge page memory, the pages
+ * that are no longer used are returned to the system.
+ *
+ * The number of bytes that is stored in huge page memory is reported by the
+ * huge_pages member of EcsMemoryStats.
+ *
+ * @time-complexity: O(t) where t is the number of tables
+ * @param world The world.
+ * @param size The minimum size in bytes of a table in huge page memory, or 0
+ *             to disable huge pages (default).
+ */
+REFLECS_EXPORT
+void ecs_set_huge_page_threshold(
+    EcsWorld *world,
+    size_t size);
+
+/** Enable garbage collection of empty tables.
+ * Each combination of components that is used by an entity creates a table,
+ * which is kept when the last entity is removed from it. Tables that are no
+ * longer used cost memory, and they have to be evaluated by every new system.
+ * When garbage collection is enabled, ecs_progress collects tables that have
+ * been empty for at least the specified number of frames. Collected tables are
+ * removed from the systems they matched with, and their storage is freed.
+ * Families that are no longer used by any table or system are freed as well.
+ *
+ * Tables of families created with ecs_new_family are never collected. If an
+ * entity is added to a family of which the table was collected, the table is
+ * created again.
+ *
+ * @time-complexity: O(1)
+ * @param world The world.
+ * @param frames The number of frames a table has to be empty before it is
+ *               collected, or 0 to disable automatic collection (default).
+ */
+REFLECS_EXPORT
+void ecs_set_table_gc(
+    EcsWorld *world,
+    uint32_t frames);
+
+/** Collect empty tables and unused families.
+ * This function collects the tables that have been empty for the number of
+ * frames set with ecs_set_table_gc. If no number of frames is set, all empty
+ * tables are collected. This function is called automatically by
+ * ecs_progress when ecs_set_table_gc is set, but it can be called explicitly by
+ * the application, for example after removing a large number of entities.
+ *
+ * This function must not be called while the world is in progress.
+ *
+ * @time-complexity: O(t + f) where t is the number of tables and f the number
+ *                   of families
+ * @param world The world.
+ * @return The number of collected tables.
+ */
+REFLECS_EXPORT
+uint32_t ecs_gc(
+    EcsWorld *world);
+
 
 /* -- Entity API -- */
 
@@ -446,6 +617,11 @@ void ecs_dim_family(
  * operations may move an entity in memory. Handles provide a safe mechanism for
  * addressing entities. The average lookup complexity for a handle is O(1).
  *
+ * Entities may be created from systems that run in worker threads. Each worker
+ * thread reserves a block of handles at a time from the world, and issues new
+ * handles from that block. As a result, handles created in the same frame by
+ * different threads are not necessarily consecutive.
+ *
  * @time-complexity: O(1)
  * @param world The world to which to add the entity.
  * @param type Zero if no type, or handle to a component, family or prefab.
@@ -709,6 +885,119 @@ EcsHandle ecs_set_ptr(
 #define ecs_set(world, entity, component, ...)\
     ecs_set_ptr(world, entity, component##_h, &(component)__VA_ARGS__);
 
+/** Set the value of a component for multiple entities.
+ * This operation copies the values in a packed buffer to the component of each
+ * of the specified entities, where the value at index i of the buffer is
+ * copied to entities[i]. It is equivalent to calling ecs_set_ptr for each
+ * entity, but it looks up the component and table once for consecutive
+ * entities that are stored in the same table. OnSet systems are invoked once
+ * for each range of consecutive rows, so the operation is fastest when
+ * entities are ordered by table and row, as returned by ecs_new_w_count.
+ *
+ * Entities that do not yet have the component are added to the component, as
+ * with ecs_set_ptr.
+ *
+ * @time-complexity: O(n)
+ * @param world The world.
+ * @param component The component to set.
+ * @param entities Array with the entities on which to set the component.
+ * @param count The number of entities.
+ * @param src Buffer with count values of the component.
+ */
+REFLECS_EXPORT
+void ecs_scatter(
+    EcsWorld *world,
+    EcsHandle component,
+    const EcsHandle *entities,
+    uint32_t count,
+    const void *src);
+
+/** Get the value of a component for multiple entities.
+ * This operation copies the component of each of the specified entities to a
+ * packed buffer, where the value of entities[i] is copied to index i of the
+ * buffer. Components that are shared through a prefab are copied from the
+ * prefab. The buffer elements of entities that do not have the component are
+ * set to zero.
+ *
+ * @time-complexity: O(n)
+ * @param world The world.
+ * @param component The component to get.
+ * @param entities Array with the entities from which to get the component.
+ * @param count The number of entities.
+ * @param dst Buffer that can store count values of the component.
+ * @returns The number of entities that have the component.
+ */
+REFLECS_EXPORT
+uint32_t ecs_gather(
+    EcsWorld *world,
+    EcsHandle component,
+    const EcsHandle *entities,
+    uint32_t count,
+    void *dst);
+
+/** Copy a component of all matching entities into a buffer.
+ * This operation copies the component of every entity that has the component
+ * and matches the filter into a packed buffer, one table at a time. The
+ * entity of each copied value is optionally stored at the same index in
+ * entities_out. Components that are shared through a prefab are not copied.
+ *
+ * If dst is NULL, the operation returns the number of matching entities, which
+ * can be used to allocate a buffer of the right size.
+ *
+ * @time-complexity: O(t + n)
+ * @param world The world.
+ * @param component The component to copy.
+ * @param filter A component, family or prefab handle that matching entities
+ *   must have (0 to match all entities with the component).
+ * @param dst Buffer that can store capacity values of the component.
+ * @param capacity The maximum number of values to copy.
+ * @param entities_out Optional buffer that can store capacity handles.
+ * @returns The number of copied values.
+ */
+REFLECS_EXPORT
+uint32_t ecs_copy_column(
+    EcsWorld *world,
+    EcsHandle component,
+    EcsHandle filter,
+    void *dst,
+    uint32_t capacity,
+    EcsHandle *entities_out);
+
+/** Enable or disable an entity.
+ * Disabled entities are skipped by systems and queries, but keep their
+ * components. Unlike adding a tag to exclude an entity from systems, this
+ * does not move the entity to another table: it flips a bit in a bitmap of
+ * the table. Systems are invoked for each range of consecutive enabled
+ * entities in a table. Entities are enabled by default, and stay disabled
+ * when components are added or removed.
+ *
+ * Row systems (EcsOnAdd, EcsOnRemove, EcsOnSet) are still invoked for
+ * disabled entities. This operation must not be invoked while worker threads
+ * are running.
+ *
+ * @time-complexity: O(1)
+ * @param world The world.
+ * @param entity The entity to enable or disable.
+ * @param enabled true to enable the entity, false to disable it.
+ */
+REFLECS_EXPORT
+void ecs_enable_entity(
+    EcsWorld *world,
+    EcsHandle entity,
+    bool enabled);
+
+/** Test if an entity is enabled.
+ *
+ * @time-complexity: O(1)
+ * @param world The world.
+ * @param entity The entity to test.
+ * @returns false if the entity is disabled, true otherwise.
+ */
+REFLECS_EXPORT
+bool ecs_is_entity_enabled(
+    EcsWorld *world,
+    EcsHandle entity);
+
 /** Check if entity has the specified type.
  * This operation checks if the entity has the components associated with the
  * specified type. It accepts component handles, families and prefabs.
@@ -872,10 +1161,15 @@ EcsHandle ecs_new_family(
  * - EcsOnRemove: the system is invoked when a component is removed from memory.
  * - EcsOnDemand: the system is only invoked on demand (ecs_run)
  *
+ * EcsOnAdd, EcsOnRemove and EcsOnSet systems receive a contiguous range of
+ * rows, which for operations like ecs_new_w_count and ecs_fini contains all the
+ * rows that were added to or removed from a table.
+ *
  * The signature of the system is a string formatted as a comma separated list
  * of component identifiers. For example, a system that wants to receive the
  * Location and Speed components, should provide "Location, Speed" as its
- * signature.
+ * signature. A component can be prefixed with [in], [out] or [inout] to
+ * specify how the system accesses it (see ecs_set_skip_unchanged).
  *
  * The action is a function that is invoked for every entity that has the
  * components the system is interested in. The action has three parameters:
@@ -952,6 +1246,45 @@ void ecs_set_period(
     EcsHandle system,
     float period);
 
+/** Skip tables of which the inputs of a system did not change.
+ * This operation lets an application specify that a system should only be
+ * invoked for tables of which the data that the system reads has changed since
+ * the last time the system processed the table. This is useful for systems
+ * that operate on data that rarely changes.
+ *
+ * Changes are tracked per table, per column. A column changes when it is
+ * written by ecs_set, when a system with write access to the column processes
+ * the table, or when staged values are merged into the column. Inserting or
+ * deleting rows changes all columns of a table.
+ *
+ * By default a system has read and write access to all of its columns. A
+ * column can be prefixed in the signature with [in] for read-only access or
+ * with [out] for write-only access. Only [in] and [inout] columns are inputs,
+ * and a system should not write to an [in] column, as this change would not be
+ * detected by other systems. For example, a system with the signature
+ * "[in] Position, [out] Path" is only invoked for tables in which Position
+ * changed, and marks the Path column as changed when it is invoked.
+ *
+ * Changes to components that are not stored in the table (such as components
+ * of prefabs, components or systems) are not tracked. When systems are ran on
+ * worker threads, writes to [inout] columns also count as a change for the
+ * system itself, as the system cannot tell them apart from writes by systems
+ * that ran at the same time.
+ *
+ * This operation is only valid on table systems. If it is invoked on other
+ * handles it will be ignored.
+ *
+ * @time-complexity: O(1)
+ * @param world The world.
+ * @param system The system for which to skip unchanged tables.
+ * @param skip_unchanged true to skip unchanged tables, false to run all tables.
+ */
+REFLECS_EXPORT
+void ecs_set_skip_unchanged(
+    EcsWorld *world,
+    EcsHandle system,
+    bool skip_unchanged);
+
 /** Returns the enabled status for a system / entity.
  * This operation will return whether a system is enabled or disabled. Currently
  * only systems can be enabled or disabled, but this operation does not fail
@@ -985,7 +1318,10 @@ bool ecs_is_enabled(
  *
  * Because the filter is evaluated not on a per-entity basis, but on a per table
  * basis, filter evaluation is still very cheap, especially when compared to
- * tables with large numbers of entities.
+ * tables with large numbers of entities. The tables that match a filter are
+ * cached by the system the first time the filter is used, and the cache is
+ * updated when tables are created, activated or deactivated. Subsequent runs
+ * with the same filter only visit the matching tables.
  *
  * An application may pass custom data to a system through the param parameter.
  * This data can be accessed by the system through the param member in the
@@ -1014,6 +1350,85 @@ EcsHandle ecs_run_system(
     EcsHandle filter,
     void *param);
 
+/** Run a specific system manually on the worker threads.
+ * This operation is equivalent to ecs_run_system, except that when worker
+ * threads are configured with ecs_set_threads, the rows of the matched (and
+ * filtered) tables are divided over the active threads. The operation returns
+ * when all threads have finished.
+ *
+ * While the system is running, changes made by the system are staged in the
+ * stage of the thread that made them. If auto merging is enabled, the stages
+ * are merged before this operation returns, otherwise the application needs
+ * to call ecs_merge.
+ *
+ * If no worker threads are configured, or if this operation is invoked while
+ * the world is being progressed (for example from another system), the system
+ * is ran on the calling thread as with ecs_run_system.
+ *
+ * If the system is interrupted, the interrupted_by value of the first job (in
+ * table order) that was interrupted is returned. Note that jobs on other
+ * threads may still have evaluated entities after the interrupting entity.
+ *
+ * @time-complexity: O(t)
+ * @param world The world.
+ * @param system The system to run.
+ * @param delta_time: The time passed since the last system invocation.
+ * @param filter A component or family to filter matched entities.
+ * @param param A user-defined parameter to pass to the system.
+ * @returns handle to last evaluated entity if system was interrupted.
+ */
+REFLECS_EXPORT
+EcsHandle ecs_run_system_parallel(
+    EcsWorld *world,
+    EcsHandle system,
+    float delta_time,
+    EcsHandle filter,
+    void *param);
+
+/** Start running a system on the worker threads without waiting for it.
+ * This operation divides the rows of the matched (and filtered) tables over
+ * the active worker threads, and returns while the threads are processing
+ * them. This lets the main thread do its own work while the system runs. The
+ * returned handle must be passed to ecs_wait_system before the world is
+ * progressed, merged or before another system is ran on the worker threads.
+ *
+ * The main thread does not run any part of the system. If no worker threads
+ * are available, the system is ran on the calling thread before this operation
+ * returns, and ecs_wait_system will return immediately.
+ *
+ * Until ecs_wait_system is called, the world is in progress, which means that
+ * changes made by the main thread are staged, as they are when made from a
+ * system.
+ *
+ * @time-complexity: O(t)
+ * @param world The world.
+ * @param system The system to run.
+ * @param delta_time: The time passed since the last system invocation.
+ * @param filter A component or family to filter matched entities.
+ * @param param A user-defined parameter to pass to the system.
+ * @returns handle to the run, to pass to ecs_wait_system.
+ */
+REFLECS_EXPORT
+EcsSystemRun* ecs_run_system_async(
+    EcsWorld *world,
+    EcsHandle system,
+    float delta_time,
+    EcsHandle filter,
+    void *param);
+
+/** Wait for a system run started by ecs_run_system_async.
+ * This operation blocks until all worker threads have finished running the
+ * system. If auto merging is enabled, the stages are merged before this
+ * operation returns. The handle is invalid after this operation returns.
+ *
+ * @time-complexity: O(1)
+ * @param run The handle returned by ecs_run_system_async.
+ * @returns handle to last evaluated entity if system was interrupted.
+ */
+REFLECS_EXPORT
+EcsHandle ecs_wait_system(
+    EcsSystemRun *run);
+
 /** Set component on system for user-defined context */
 REFLECS_EXPORT
 void* ecs_set_system_context_ptr(
@@ -1032,6 +1447,380 @@ void* ecs_get_system_context(
   { component __v = __VA_ARGS__; ecs_set_system_context_ptr(world, system, component##_h, &__v); }
 
 
+/* -- Query API -- */
+
+/** Maximum number of columns in the signature of a query */
+#define ECS_QUERY_MAX_COLUMNS (16)
+
+/** Iterator over the tables that match a query.
+ * The rows member describes the rows of the current table in the same way as
+ * the EcsRows value that is passed to a system, and can be used with the
+ * ecs_column, ecs_next, ecs_entity and ecs_handle macros. The other members
+ * are private to the iterator.
+ */
+typedef struct EcsQueryIter {
+    EcsRows rows;                 /* Rows of the current table */
+    uint32_t count;               /* Number of rows in the current range */
+
+    /* Private */
+    void *system_data;
+    void *filter;
+    uint32_t filter_id;
+    uint32_t index;
+    uint32_t row;
+    uint32_t table_count;
+    uint64_t version;
+    void *refs_data[ECS_QUERY_MAX_COLUMNS];
+    EcsHandle refs_entity[ECS_QUERY_MAX_COLUMNS];
+} EcsQueryIter;
+
+/** Create a new query.
+ * A query matches the same entities as an on demand system with the same
+ * signature, but instead of invoking a callback, the application iterates the
+ * matching tables with ecs_query_iter and ecs_query_next. This lets an
+ * application write the loop over the entities inline.
+ *
+ * The tables that match the query are cached when the query is created, and
+ * the cache is updated as tables are created or become (non) empty, so that
+ * iterating a query only visits tables with matching entities.
+ *
+ * Queries are not entities, and are not visible to operations on systems. The
+ * query stores a copy of the signature, so the signature does not need to
+ * outlive this call. A query lives until it is freed with ecs_free_query, or
+ * until the world is deleted. Signatures with SYSTEM columns are not valid for
+ * queries.
+ *
+ * @time-complexity: O(t)
+ * @param world The world.
+ * @param signature The signature that describes the components.
+ * @returns The new query.
+ */
+REFLECS_EXPORT
+EcsQuery* ecs_new_query(
+    EcsWorld *world,
+    const char *signature);
+
+/** Free a query.
+ * This operation unregisters the query from the tables that it matched and
+ * frees its resources. The query must not be used after this operation, and
+ * must not be freed while it is iterated.
+ *
+ * @time-complexity: O(t)
+ * @param world The world.
+ * @param query The query to free.
+ */
+REFLECS_EXPORT
+void ecs_free_query(
+    EcsWorld *world,
+    EcsQuery *query);
+
+/** Skip tables of which the inputs of a query did not change.
+ * This operation is the equivalent of ecs_set_skip_unchanged for queries. When
+ * enabled, ecs_query_next skips tables in which no column that the query reads
+ * changed since the query last visited the table.
+ *
+ * @time-complexity: O(1)
+ * @param world The world.
+ * @param query The query for which to skip unchanged tables.
+ * @param skip_unchanged true to skip unchanged tables, false to visit all tables.
+ */
+REFLECS_EXPORT
+void ecs_set_query_skip_unchanged(
+    EcsWorld *world,
+    EcsQuery *query,
+    bool skip_unchanged);
+
+/** Start iterating a query.
+ * This operation returns an iterator over the tables that match the query, and
+ * the optional filter. The iterator does not point to a table until
+ * ecs_query_next is called. A query can be iterated like this:
+ *
+ * EcsQueryIter it = ecs_query_iter(world, query, 0);
+ * while (ecs_query_next(&it)) {
+ *     void *row;
+ *     for (row = it.rows.first; row < it.rows.last; row = ecs_next(&it.rows, row)) {
+ *         Position *p = ecs_column(&it.rows, row, 0);
+ *     }
+ * }
+ *
+ * Operations that add tables to the query, such as committing an entity to a
+ * new family or making an empty table non-empty, must not be invoked while the
+ * query is iterated, unless the world is in progress.
+ *
+ * @time-complexity: O(1)
+ * @param world The world.
+ * @param query The query to iterate.
+ * @param filter A component or family to filter matched entities.
+ * @returns An iterator over the query.
+ */
+REFLECS_EXPORT
+EcsQueryIter ecs_query_iter(
+    EcsWorld *world,
+    EcsQuery *query,
+    EcsHandle filter);
+
+/** Move the iterator to the next table or range of enabled entities.
+ * This operation moves the iterator to the next table that matches the query,
+ * and updates the rows and count members of the iterator. Columns of the table
+ * that the query does not access with [in] are marked as changed.
+ *
+ * If a table has disabled entities (see ecs_enable_entity), the iterator
+ * visits the table once for each range of consecutive enabled entities.
+ *
+ * @time-complexity: O(1)
+ * @param it The iterator.
+ * @returns true if the iterator points to a table, false if there are no more
+ *   tables.
+ */
+REFLECS_EXPORT
+bool ecs_query_next(
+    EcsQueryIter *it);
+
+
+/* -- Hierarchy API -- */
+
+/** Set the parent of an entity.
+ * This operation stores a parent/child relationship in an index that is
+ * separate from the tables. Unlike adding the parent entity as a component
+ * (see examples/23_dag), adopting an entity does not move it to another table,
+ * so the children of many parents can share a single table.
+ *
+ * An entity has at most one parent. Adopting an entity that already has a
+ * parent replaces the parent. Passing 0 as parent removes the parent. When an
+ * entity is deleted it is removed from its parent, and its children are
+ * orphaned.
+ *
+ * This operation must not be invoked while worker threads are running.
+ *
+ * @time-complexity: O(c) where c is the number of children of the old parent
+ * @param world The world.
+ * @param entity The child entity.
+ * @param parent The parent entity, or 0 to remove the parent.
+ */
+REFLECS_EXPORT
+void ecs_adopt(
+    EcsWorld *world,
+    EcsHandle entity,
+    EcsHandle parent);
+
+/** Get the parent of an entity.
+ *
+ * @time-complexity: O(1)
+ * @param world The world.
+ * @param entity The child entity.
+ * @returns The parent of the entity, or 0 if the entity has no parent.
+ */
+REFLECS_EXPORT
+EcsHandle ecs_get_parent(
+    EcsWorld *world,
+    EcsHandle entity);
+
+/** Get the children of a parent.
+ * This operation copies at most capacity children of the parent to the
+ * provided buffer. If the buffer is NULL, the operation returns the number of
+ * children, which can be used to allocate a buffer.
+ *
+ * @time-complexity: O(c)
+ * @param world The world.
+ * @param parent The parent entity.
+ * @param children_out Buffer that receives the children (can be NULL).
+ * @param capacity The number of elements in the buffer.
+ * @returns The number of children copied, or the number of children if the
+ *   buffer is NULL.
+ */
+REFLECS_EXPORT
+uint32_t ecs_get_children(
+    EcsWorld *world,
+    EcsHandle parent,
+    EcsHandle *children_out,
+    uint32_t capacity);
+
+/** Make the children of a parent contiguous in their tables.
+ * This operation reorders the rows of tables so that entities with the same
+ * parent are stored next to each other. This is not required for correctness,
+ * but lets ecs_run_system_w_parent invoke a system once per table instead of
+ * once per range of consecutive children. Entities created or adopted after
+ * this operation are not grouped until the operation is invoked again.
+ *
+ * Reordering rows changes the row of entities, which invalidates pointers
+ * obtained with ecs_get_ptr. Tables that are already grouped are not modified.
+ *
+ * This operation must not be invoked while the world is in progress.
+ *
+ * @time-complexity: O(n log n) where n is the number of rows in a table
+ * @param world The world.
+ */
+REFLECS_EXPORT
+void ecs_group_children(
+    EcsWorld *world);
+
+/** Run a system on the children of a parent.
+ * This operation is similar to ecs_run_system, but only passes the children
+ * of the specified parent (see ecs_adopt) to the system. The system is invoked
+ * for each range of consecutive children in a table that matches the system.
+ * After ecs_group_children this is a single invocation per table.
+ *
+ * This makes it possible to iterate the children of one parent without
+ * creating a table per parent.
+ *
+ * @time-complexity: O(c log c) where c is the number of children
+ * @param world The world.
+ * @param system The system to run.
+ * @param delta_time The time passed since the last system invocation.
+ * @param parent The parent of which to run the children.
+ * @param param A user-defined parameter to pass to the system.
+ * @returns handle to last evaluated entity if system was interrupted.
+ */
+REFLECS_EXPORT
+EcsHandle ecs_run_system_w_parent(
+    EcsWorld *world,
+    EcsHandle system,
+    float delta_time,
+    EcsHandle parent,
+    void *param);
+
+/* -- Sort API -- */
+
+/** Callback that computes the key by which an entity is sorted.
+ * The component parameter points to the value of the sorted component of the
+ * entity. Entities are sorted in ascending order of their keys.
+ */
+typedef uint64_t (*EcsSortKeyAction)(
+    EcsHandle entity,
+    const void *component);
+
+/** Sort the entities in tables by a component.
+ * This operation reorders the rows of each table that stores the component, so
+ * that entities are stored in ascending order of the key that is computed by
+ * key_action. Entities with equal keys keep their relative order. Sorting
+ * makes entities that are related by the key, for example entities that are
+ * close to each other in space, neighbours in memory.
+ *
+ * Tables that are already sorted are not modified. Reordering rows changes
+ * the row of entities, which invalidates pointers obtained with ecs_get_ptr.
+ *
+ * Tables are sorted once. To keep tables sorted, use ecs_set_sort. This
+ * operation must not be invoked while the world is in progress.
+ *
+ * @time-complexity: O(n log n) where n is the number of rows in a table
+ * @param world The world.
+ * @param component The component from which keys are computed.
+ * @param key_action The callback that computes the key of an entity.
+ */
+REFLECS_EXPORT
+void ecs_sort(
+    EcsWorld *world,
+    EcsHandle component,
+    EcsSortKeyAction key_action);
+
+/** Keep the entities in tables sorted by a component.
+ * This operation sorts tables like ecs_sort, and then re-sorts tables at the
+ * start of each ecs_progress if entities were added to or removed from the
+ * table, or if the column of the component changed since the table was last
+ * sorted. Keys are recomputed for changed tables, and tables of which the
+ * rows are still in order are not modified. A world has at most one sort
+ * order. Passing NULL for key_action disables sorting.
+ *
+ * Note that ecs_group_children also reorders rows, and should not be combined
+ * with a sort order.
+ *
+ * @time-complexity: O(n log n) where n is the number of rows in a table
+ * @param world The world.
+ * @param component The component from which keys are computed.
+ * @param key_action The callback that computes the key of an entity.
+ */
+REFLECS_EXPORT
+void ecs_set_sort(
+    EcsWorld *world,
+    EcsHandle component,
+    EcsSortKeyAction key_action);
+
+/** Compute the Morton code (Z-order curve) of a 2D coordinate.
+ * This interleaves the bits of x and y. Points that are close to each other in
+ * 2D space are likely to have Morton codes that are close to each other, which
+ * makes the Morton code a good sort key for spatial locality. Coordinates must
+ * first be mapped to unsigned integers, for example by offsetting and
+ * quantizing them to a grid.
+ *
+ * @time-complexity: O(1)
+ * @param x The x coordinate.
+ * @param y The y coordinate.
+ * @returns The Morton code of the coordinate.
+ */
+REFLECS_EXPORT
+uint64_t ecs_morton_code(
+    uint32_t x,
+    uint32_t y);
+
+/* -- Memory allocation API -- */
+
+/** Allocator hooks.
+ * An allocator provides the functions that reflecs uses to allocate memory.
+ * The alloc, realloc and free hooks are required. The other hooks are
+ * optional, and if they are not provided, reflecs implements them on top of
+ * the required hooks.
+ *
+ * The alloc_fixed and free_fixed hooks are invoked for small objects of
+ * which the size is known when they are freed, like map headers. The size
+ * passed to free_fixed is the same as the one passed to alloc_fixed, which
+ * lets an allocator serve these objects from size classes.
+ *
+ * The ctx member is passed to every hook.
+ */
+typedef struct EcsAllocator {
+    void* (*alloc)(size_t size, void *ctx);
+    void* (*realloc)(void *ptr, size_t size, void *ctx);
+    void (*free)(void *ptr, void *ctx);
+    void* (*alloc_aligned)(size_t alignment, size_t size, void *ctx);
+    void (*free_aligned)(void *ptr, void *ctx);
+    void* (*alloc_fixed)(size_t size, void *ctx);
+    void (*free_fixed)(void *ptr, size_t size, void *ctx);
+    void *ctx;
+} EcsAllocator;
+
+/** Set the allocator used by reflecs.
+ * All memory that reflecs allocates, including the memory for worlds, tables,
+ * stages, arrays and maps, is allocated with the hooks of this allocator. The
+ * allocator is global, and not specific to a world, as the array and map
+ * utilities are not associated with a world.
+ *
+ * The allocator must be set before any world is created, and may not be
+ * changed while a world exists, as memory allocated by one allocator cannot
+ * be freed by another. Passing NULL restores the default allocator, which
+ * uses the functions of the C standard library.
+ *
+ * @param allocator The allocator hooks, or NULL for the default allocator.
+ */
+REFLECS_EXPORT
+void ecs_set_allocator(
+    const EcsAllocator *allocator);
+
+/** Get the allocator used by reflecs.
+ *
+ * @returns The current allocator hooks.
+ */
+REFLECS_EXPORT
+const EcsAllocator* ecs_get_allocator(void);
+
+/** Get the builtin pool allocator.
+ * The pool allocator implements the alloc_fixed and free_fixed hooks with
+ * free lists for a number of size classes. Each thread keeps a small cache of
+ * free objects per size class, so that threads can allocate and free objects
+ * without synchronizing. When a cache overflows, or when a thread exits, its
+ * objects are returned to a shared pool. Memory in the pools is not returned
+ * to the system, which makes allocation behavior predictable after warmup.
+ *
+ * Objects are allocated from the general purpose hooks of the current
+ * allocator. An application can copy the returned allocator and replace the
+ * alloc, realloc and free hooks with its own, and then pass the result to
+ * ecs_set_allocator.
+ *
+ * @returns The pool allocator hooks.
+ */
+REFLECS_EXPORT
+const EcsAllocator* ecs_pool_allocator(void);
+
+
 /* -- Error handling & error codes -- */
 
 /** Throw an error */
@@ -1097,6 +1886,110 @@ void ecs_iter_release(
     EcsIter* iter);
 
 
+/* -- Dirty tracking API -- */
+
+/** Track which entities changed a component.
+ * This operation enables dirty tracking for a component. Tables keep a bitmap
+ * for each tracked component, with one bit per row. A bit is set when:
+ *
+ * - the component is set with ecs_set
+ * - an entity is added to the table (it is new or its components changed)
+ * - a system marks the rows it processes with ecs_set_dirty
+ *
+ * Bits remain set until they are cleared with ecs_clear_dirty, which is
+ * typically done after the changes have been processed, like at the end of a
+ * frame. Values set while the world is in progress are marked when the stage
+ * is merged. Deleted entities are not tracked.
+ *
+ * Dirty tracking is opt-in, as maintaining the bitmaps costs time when rows
+ * are added, moved or removed. This operation may not be called while the
+ * world is in progress.
+ *
+ * @time-complexity: O(t)
+ * @param world The world.
+ * @param component The component to track.
+ */
+REFLECS_EXPORT
+void ecs_track_dirty(
+    EcsWorld *world,
+    EcsHandle component);
+
+/** Mark the rows passed to a system as dirty.
+ * Systems that write to a tracked component with ecs_column do not mark the
+ * rows as dirty. With this operation a system can mark all rows it received
+ * as dirty for a column with a single call. The operation is ignored if the
+ * column is not a tracked component stored in the table.
+ *
+ * This operation may be called from worker threads.
+ *
+ * @time-complexity: O(r)
+ * @param rows The rows passed to the system.
+ * @param column The column to mark dirty.
+ */
+REFLECS_EXPORT
+void ecs_set_dirty(
+    EcsRows *rows,
+    uint32_t column);
+
+/** Count the dirty entities for a component.
+ * This operation counts the entities that have a dirty bit set for the
+ * specified component. An optional filter with a component or family only
+ * counts the entities that have the filter components.
+ *
+ * @time-complexity: O(t + r / 64)
+ * @param world The world.
+ * @param component The tracked component.
+ * @param filter A component or family to filter entities (0 for none).
+ * @returns The number of dirty entities.
+ */
+REFLECS_EXPORT
+uint32_t ecs_dirty_count(
+    EcsWorld *world,
+    EcsHandle component,
+    EcsHandle filter);
+
+/** Iterate the dirty entities for a component.
+ * This operation returns an iterator over the entities that have a dirty bit
+ * set for the specified component. An optional filter with a component or
+ * family only iterates the entities that have the filter components.
+ * ecs_iter_next returns a pointer to the handle of the entity:
+ *
+ * EcsIter it = ecs_dirty_iter(world, Position_h, 0);
+ * while (ecs_iter_hasnext(&it)) {
+ *     EcsHandle e = *(EcsHandle*)ecs_iter_next(&it);
+ * }
+ *
+ * Bitmaps are scanned a word at a time, so clean rows are skipped cheaply.
+ * Entities may not be added, removed or deleted while iterating. If the
+ * application stops iterating before ecs_iter_hasnext returns false, it must
+ * call ecs_iter_release.
+ *
+ * @param world The world.
+ * @param component The tracked component.
+ * @param filter A component or family to filter entities (0 for none).
+ * @returns An iterator over the handles of dirty entities.
+ */
+REFLECS_EXPORT
+EcsIter ecs_dirty_iter(
+    EcsWorld *world,
+    EcsHandle component,
+    EcsHandle filter);
+
+/** Clear dirty bits.
+ * This operation clears the dirty bits for a component, or for all tracked
+ * components if component is 0. This operation may not be called while the
+ * world is in progress.
+ *
+ * @time-complexity: O(t + r / 64)
+ * @param world The world.
+ * @param component The tracked component (0 for all).
+ */
+REFLECS_EXPORT
+void ecs_clear_dirty(
+    EcsWorld *world,
+    EcsHandle component);
+
+
 /* -- Convenience macro's -- */
 
 /** Wrapper around ecs_new_component.
@@ -1194,16 +2087,16 @@ void ecs_iter_release(
     ? ECS_OFFSET(row, (data)->columns[column]) \
     : ((data)->columns[column] == 0) \
       ? NULL \
-      : data->refs_data[-((data)->columns[column]) - 1])
+      : (data)->refs_data[-((data)->columns[column]) - 1])
 
 /* Obtain the entity handle from a row */
 #define ecs_entity(row) *(EcsHandle*)row
 
 /* Obtain a reference handle from a column */
-#define ecs_source(rows, column) (rows->refs_entity[column])
+#define ecs_source(rows, column) ((rows)->refs_entity[column])
 
 /* Obtain the component handle from a row */
-#define ecs_handle(rows, column) (rows->components[column])
+#define ecs_handle(rows, column) ((rows)->components[column])
 
 /** Utility macro's */
 #define ECS_OFFSET(o, offset) (void*)(((uintptr_t)(o)) + ((uintptr_t)(offset)))
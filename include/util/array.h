@@ -116,6 +116,15 @@ uint32_t ecs_array_set_count(
     const EcsArrayParams *params,
     uint32_t size);
 
+REFLECS_EXPORT
+void ecs_array_use_huge_pages(
+    EcsArray **array_inout,
+    const EcsArrayParams *params);
+
+REFLECS_EXPORT
+size_t ecs_array_huge_size(
+    EcsArray *array);
+
 REFLECS_EXPORT
 uint32_t ecs_array_count(
     EcsArray *array);
@@ -62,6 +62,11 @@ uint64_t ecs_map_get64(
 #define ecs_map_get(map, key_hash) \
     (void*)(uintptr_t)ecs_map_get64(map, key_hash)
 
+REFLECS_EXPORT
+uint64_t* ecs_map_get_ptr64(
+    EcsMap *map,
+    uint64_t key_hash);
+
 REFLECS_EXPORT
 bool ecs_map_has(
     EcsMap *map,
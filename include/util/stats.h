@@ -51,6 +51,7 @@ typedef struct EcsMemoryStats {
     EcsMemoryStat tables;
     EcsMemoryStat stage;
     EcsMemoryStat world;
+    EcsMemoryStat huge_pages;   /* Table memory in huge pages, not in total */
 } EcsMemoryStats;
 
 typedef struct EcsWorldStats {
@@ -58,7 +59,11 @@ typedef struct EcsWorldStats {
     uint32_t table_count;
     uint32_t entity_count;
     uint32_t thread_count;
+    uint32_t active_thread_count;
     uint32_t tick_count;
+    uint32_t handle_block_size;
+    uint32_t handle_block_count;
+    uint32_t sync_count;
     float system_time;
     float frame_time;
     EcsMemoryStats memory;
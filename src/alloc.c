@@ -0,0 +1,376 @@
+#include <string.h>
+#include <assert.h>
+#include "include/private/types.h"
+
+/** Free object in a pool or thread cache */
+typedef struct EcsPoolBlock {
+    struct EcsPoolBlock *next;
+} EcsPoolBlock;
+
+/** Thread-specific cache with free objects for each size class */
+typedef struct EcsPoolCache {
+    EcsPoolBlock *blocks[ECS_POOL_CLASS_COUNT];
+    uint32_t count[ECS_POOL_CLASS_COUNT];
+} EcsPoolCache;
+
+static EcsPoolBlock *pool_blocks[ECS_POOL_CLASS_COUNT];
+static pthread_mutex_t pool_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_once_t pool_once = PTHREAD_ONCE_INIT;
+static pthread_key_t pool_key;
+
+/* -- Default allocator -- */
+
+static
+void* default_alloc(
+    size_t size,
+    void *ctx)
+{
+    return malloc(size);
+}
+
+static
+void* default_realloc(
+    void *ptr,
+    size_t size,
+    void *ctx)
+{
+    return realloc(ptr, size);
+}
+
+static
+void default_free(
+    void *ptr,
+    void *ctx)
+{
+    free(ptr);
+}
+
+static
+void* default_alloc_aligned(
+    size_t alignment,
+    size_t size,
+    void *ctx)
+{
+    void *result = NULL;
+    if (posix_memalign(&result, alignment, size)) {
+        return NULL;
+    }
+    return result;
+}
+
+static const EcsAllocator default_allocator = {
+    .alloc = default_alloc,
+    .realloc = default_realloc,
+    .free = default_free,
+    .alloc_aligned = default_alloc_aligned,
+    .free_aligned = default_free
+};
+
+static EcsAllocator allocator = {
+    .alloc = default_alloc,
+    .realloc = default_realloc,
+    .free = default_free,
+    .alloc_aligned = default_alloc_aligned,
+    .free_aligned = default_free
+};
+
+/* -- Pool allocator -- */
+
+/** Return objects in a list to the shared pool. Must be called with the pool
+ * mutex locked. */
+static
+void pool_return(
+    uint32_t size_class,
+    EcsPoolBlock *first,
+    EcsPoolBlock *last)
+{
+    last->next = pool_blocks[size_class];
+    pool_blocks[size_class] = first;
+}
+
+/** Return all objects in a thread cache to the shared pool when a thread
+ * exits */
+static
+void pool_free_cache(
+    void *ptr)
+{
+    EcsPoolCache *cache = ptr;
+    int i;
+
+    pthread_mutex_lock(&pool_mutex);
+    for (i = 0; i < ECS_POOL_CLASS_COUNT; i ++) {
+        EcsPoolBlock *first = cache->blocks[i];
+        if (first) {
+            EcsPoolBlock *last = first;
+            while (last->next) {
+                last = last->next;
+            }
+            pool_return(i, first, last);
+        }
+    }
+    pthread_mutex_unlock(&pool_mutex);
+
+    ecs_os_free(cache);
+}
+
+static
+void pool_init(void)
+{
+    pthread_key_create(&pool_key, pool_free_cache);
+}
+
+/** Get cache of the current thread, create it if it does not exist yet */
+static
+EcsPoolCache* pool_get_cache(void)
+{
+    pthread_once(&pool_once, pool_init);
+
+    EcsPoolCache *cache = pthread_getspecific(pool_key);
+    if (!cache) {
+        cache = ecs_os_calloc(sizeof(EcsPoolCache));
+        if (cache) {
+            pthread_setspecific(pool_key, cache);
+        }
+    }
+
+    return cache;
+}
+
+/** Move half a cache worth of objects from the shared pool to a cache */
+static
+void pool_refill(
+    EcsPoolCache *cache,
+    uint32_t size_class)
+{
+    pthread_mutex_lock(&pool_mutex);
+    EcsPoolBlock *block = pool_blocks[size_class];
+    uint32_t count = 0;
+
+    if (block) {
+        EcsPoolBlock *last = block;
+        count = 1;
+        while (last->next && count < ECS_POOL_CACHE_SIZE / 2) {
+            last = last->next;
+            count ++;
+        }
+
+        pool_blocks[size_class] = last->next;
+        last->next = cache->blocks[size_class];
+        cache->blocks[size_class] = block;
+        cache->count[size_class] += count;
+    }
+    pthread_mutex_unlock(&pool_mutex);
+}
+
+/** Move half of the objects in a cache to the shared pool */
+static
+void pool_spill(
+    EcsPoolCache *cache,
+    uint32_t size_class)
+{
+    EcsPoolBlock *first = cache->blocks[size_class];
+    EcsPoolBlock *last = first;
+    uint32_t i;
+
+    for (i = 1; i < ECS_POOL_CACHE_SIZE / 2; i ++) {
+        last = last->next;
+    }
+
+    cache->blocks[size_class] = last->next;
+    cache->count[size_class] -= ECS_POOL_CACHE_SIZE / 2;
+
+    pthread_mutex_lock(&pool_mutex);
+    pool_return(size_class, first, last);
+    pthread_mutex_unlock(&pool_mutex);
+}
+
+static
+void* pool_alloc(
+    size_t size,
+    void *ctx)
+{
+    uint32_t size_class = size ? (size - 1) / ECS_POOL_GRANULARITY : 0;
+    if (size_class >= ECS_POOL_CLASS_COUNT) {
+        return ecs_os_malloc(size);
+    }
+
+    EcsPoolCache *cache = pool_get_cache();
+    if (cache) {
+        if (!cache->blocks[size_class]) {
+            pool_refill(cache, size_class);
+        }
+
+        EcsPoolBlock *block = cache->blocks[size_class];
+        if (block) {
+            cache->blocks[size_class] = block->next;
+            cache->count[size_class] --;
+            return block;
+        }
+    }
+
+    return ecs_os_malloc((size_class + 1) * ECS_POOL_GRANULARITY);
+}
+
+static
+void pool_free(
+    void *ptr,
+    size_t size,
+    void *ctx)
+{
+    uint32_t size_class = size ? (size - 1) / ECS_POOL_GRANULARITY : 0;
+    if (size_class >= ECS_POOL_CLASS_COUNT) {
+        ecs_os_free(ptr);
+        return;
+    }
+
+    EcsPoolCache *cache = pool_get_cache();
+    if (!cache) {
+        ecs_os_free(ptr);
+        return;
+    }
+
+    EcsPoolBlock *block = ptr;
+    block->next = cache->blocks[size_class];
+    cache->blocks[size_class] = block;
+    cache->count[size_class] ++;
+
+    if (cache->count[size_class] > ECS_POOL_CACHE_SIZE) {
+        pool_spill(cache, size_class);
+    }
+}
+
+static const EcsAllocator pool_allocator = {
+    .alloc = default_alloc,
+    .realloc = default_realloc,
+    .free = default_free,
+    .alloc_aligned = default_alloc_aligned,
+    .free_aligned = default_free,
+    .alloc_fixed = pool_alloc,
+    .free_fixed = pool_free
+};
+
+/* -- Private functions -- */
+
+void* ecs_os_malloc(
+    size_t size)
+{
+    return allocator.alloc(size, allocator.ctx);
+}
+
+void* ecs_os_calloc(
+    size_t size)
+{
+    void *result = allocator.alloc(size, allocator.ctx);
+    if (result) {
+        memset(result, 0, size);
+    }
+    return result;
+}
+
+void* ecs_os_realloc(
+    void *ptr,
+    size_t size)
+{
+    return allocator.realloc(ptr, size, allocator.ctx);
+}
+
+void ecs_os_free(
+    void *ptr)
+{
+    if (ptr) {
+        allocator.free(ptr, allocator.ctx);
+    }
+}
+
+/** Allocate aligned memory. If the allocator has no hook for aligned memory,
+ * the memory is over-allocated with the alloc hook, and the original pointer
+ * is stored right before the aligned pointer. */
+void* ecs_os_alloc_aligned(
+    size_t alignment,
+    size_t size)
+{
+    if (allocator.alloc_aligned) {
+        return allocator.alloc_aligned(alignment, size, allocator.ctx);
+    }
+
+    void *ptr = allocator.alloc(
+        size + alignment + sizeof(void*), allocator.ctx);
+    if (!ptr) {
+        return NULL;
+    }
+
+    uintptr_t addr = (uintptr_t)ptr + sizeof(void*);
+    addr = (addr + alignment - 1) / alignment * alignment;
+    ((void**)addr)[-1] = ptr;
+
+    return (void*)addr;
+}
+
+void ecs_os_free_aligned(
+    void *ptr)
+{
+    if (!ptr) {
+        return;
+    }
+
+    if (allocator.alloc_aligned) {
+        if (allocator.free_aligned) {
+            allocator.free_aligned(ptr, allocator.ctx);
+        } else {
+            allocator.free(ptr, allocator.ctx);
+        }
+    } else {
+        allocator.free(((void**)ptr)[-1], allocator.ctx);
+    }
+}
+
+void* ecs_os_alloc_fixed(
+    size_t size)
+{
+    if (allocator.alloc_fixed) {
+        return allocator.alloc_fixed(size, allocator.ctx);
+    } else {
+        return allocator.alloc(size, allocator.ctx);
+    }
+}
+
+void ecs_os_free_fixed(
+    void *ptr,
+    size_t size)
+{
+    if (!ptr) {
+        return;
+    }
+
+    if (allocator.free_fixed) {
+        allocator.free_fixed(ptr, size, allocator.ctx);
+    } else {
+        allocator.free(ptr, allocator.ctx);
+    }
+}
+
+/* -- Public functions -- */
+
+void ecs_set_allocator(
+    const EcsAllocator *hooks)
+{
+    if (hooks) {
+        assert(hooks->alloc != NULL);
+        assert(hooks->realloc != NULL);
+        assert(hooks->free != NULL);
+        assert((hooks->alloc_fixed == NULL) == (hooks->free_fixed == NULL));
+        allocator = *hooks;
+    } else {
+        allocator = default_allocator;
+    }
+}
+
+const EcsAllocator* ecs_get_allocator(void)
+{
+    return &allocator;
+}
+
+const EcsAllocator* ecs_pool_allocator(void)
+{
+    return &pool_allocator;
+}
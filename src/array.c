@@ -1,20 +1,94 @@
+#ifdef __linux__
+#include <sys/mman.h>
+#endif
 #include <string.h>
 #include "include/private/types.h"
 
 struct EcsArray {
     uint32_t count;
     uint32_t size;
+    size_t huge_size;   /* Bytes in huge page region, 0 if not huge */
 };
 
 #define ARRAY_BUFFER(array) ECS_OFFSET(array, sizeof(EcsArray))
 
-/** Resize the array buffer */
+/** Round size up to a multiple of the huge page size */
+#define HUGE_PAGE_ROUND(size)\
+    (((size) + ECS_HUGE_PAGE_SIZE - 1) / ECS_HUGE_PAGE_SIZE * ECS_HUGE_PAGE_SIZE)
+
+/** Allocate a region that is aligned to, and a multiple of, the huge page
+ * size, and advise the kernel to back it with transparent huge pages */
+static
+EcsArray* huge_alloc(
+    size_t size)
+{
+    EcsArray *result = ecs_os_alloc_aligned(ECS_HUGE_PAGE_SIZE, size);
+    assert(result != NULL);
+#if defined(__linux__) && defined(MADV_HUGEPAGE)
+    madvise(result, size, MADV_HUGEPAGE);
+#endif
+    result->huge_size = size;
+    return result;
+}
+
+/** Resize an array that is stored in a huge page region. If the region is
+ * large enough the array stays where it is, and huge pages that are no longer
+ * used are returned to the system. Otherwise the array is moved to a new
+ * region. */
+static
+EcsArray* huge_resize(
+    EcsArray *array,
+    size_t size,
+    size_t used)
+{
+    size_t total = sizeof(EcsArray) + size;
+
+    if (total <= array->huge_size) {
+#if defined(__linux__) && defined(MADV_DONTNEED)
+        size_t keep = HUGE_PAGE_ROUND(total);
+        if (keep < array->huge_size) {
+            madvise(ECS_OFFSET(array, keep), array->huge_size - keep,
+                MADV_DONTNEED);
+        }
+#endif
+        return array;
+    }
+
+    EcsArray *result = huge_alloc(HUGE_PAGE_ROUND(total));
+    result->count = array->count;
+    result->size = array->size;
+    memcpy(ARRAY_BUFFER(result), ARRAY_BUFFER(array), used);
+    ecs_os_free_aligned(array);
+
+    return result;
+}
+
+/** Resize the array buffer. Used is the number of bytes in the buffer that
+ * contain elements, which have to be preserved. */
 static
 EcsArray* resize(
     EcsArray *array,
-    uint32_t size)
+    uint32_t size,
+    uint32_t used)
 {
-    return realloc(array, sizeof(EcsArray) + size);
+    if (array->huge_size) {
+        return huge_resize(array, size, used);
+    } else {
+        return ecs_os_realloc(array, sizeof(EcsArray) + size);
+    }
+}
+
+/** Number of bytes in array buffer that contain elements */
+static
+uint32_t used_size(
+    EcsArray *array,
+    uint32_t element_size)
+{
+    uint32_t count = array->count;
+    if (count > array->size) {
+        count = array->size;
+    }
+    return count * element_size;
 }
 
 /** Iterator hasnext callback */
@@ -51,9 +125,11 @@ EcsArray* ecs_array_new(
     const EcsArrayParams *params,
     uint32_t size)
 {
-    EcsArray *result = malloc(sizeof(EcsArray) + size * params->element_size);
+    EcsArray *result = ecs_os_malloc(
+        sizeof(EcsArray) + size * params->element_size);
     result->count = 0;
     result->size = size;
+    result->huge_size = 0;
     return result;
 }
 
@@ -72,7 +148,11 @@ EcsArray* ecs_array_new_from_buffer(
 void ecs_array_free(
     EcsArray *array)
 {
-    free(array);
+    if (array && array->huge_size) {
+        ecs_os_free_aligned(array);
+    } else {
+        ecs_os_free(array);
+    }
 }
 
 void ecs_array_clear(
@@ -106,7 +186,8 @@ void* ecs_array_addn(
             }
         }
 
-        array = resize(array, size * element_size);
+        array = resize(
+            array, size * element_size, used_size(array, element_size));
         array->size = size;
         *array_inout = array;
     }
@@ -204,12 +285,47 @@ void ecs_array_reclaim(
 
     if (count < size) {
         size = count;
-        array = resize(array, size * element_size);
+        array = resize(
+            array, size * element_size, used_size(array, element_size));
         array->size = size;
         *array_inout = array;
     }
 }
 
+/** Move array to a huge page region. The array stays in huge page memory when
+ * it is resized. */
+void ecs_array_use_huge_pages(
+    EcsArray **array_inout,
+    const EcsArrayParams *params)
+{
+    EcsArray *array = *array_inout;
+    if (!array) {
+        array = ecs_array_new(params, 0);
+    }
+
+    if (!array->huge_size) {
+        size_t total = sizeof(EcsArray) + array->size * params->element_size;
+        EcsArray *result = huge_alloc(HUGE_PAGE_ROUND(total));
+        result->count = array->count;
+        result->size = array->size;
+        memcpy(ARRAY_BUFFER(result), ARRAY_BUFFER(array),
+            used_size(array, params->element_size));
+        ecs_os_free(array);
+        array = result;
+    }
+
+    *array_inout = array;
+}
+
+size_t ecs_array_huge_size(
+    EcsArray *array)
+{
+    if (!array) {
+        return 0;
+    }
+    return array->huge_size;
+}
+
 uint32_t ecs_array_count(
     EcsArray *array)
 {
@@ -245,7 +361,8 @@ uint32_t ecs_array_set_size(
         }
 
         if (result < size) {
-            array = resize(array, size * params->element_size);
+            array = resize(array, size * params->element_size,
+                used_size(array, params->element_size));
             array->size = size;
             *array_inout = array;
             result = size;
@@ -0,0 +1,270 @@
+#include <string.h>
+#include <assert.h>
+#include "include/private/reflecs.h"
+
+/** State of an iterator over dirty rows */
+typedef struct EcsDirtyIter {
+    EcsWorld *world;
+    EcsHandle component;   /* Component for which to find dirty rows */
+    EcsFamily filter;      /* Only iterate tables that match filter */
+    uint32_t table_index;  /* Index of next table in table_db */
+    EcsTable *table;       /* Current table */
+    uint64_t *words;       /* Dirty bitmap of current table */
+    uint32_t word_count;   /* Number of words in bitmap */
+    uint32_t word_index;   /* Index of current word */
+    uint64_t word;         /* Bits of current word not yet returned */
+} EcsDirtyIter;
+
+/** Get dirty bitmap for component in table, NULL if table does not match */
+static
+EcsArray* get_bitmap(
+    EcsWorld *world,
+    EcsTable *table,
+    EcsHandle component,
+    EcsFamily filter)
+{
+    if (!table->family_id || !table->dirty) {
+        return NULL;
+    }
+
+    int32_t column = ecs_table_column_index(table, component);
+    if (column == -1 || !table->dirty[column]) {
+        return NULL;
+    }
+
+    if (filter && !ecs_family_contains(
+        world, NULL, table->family_id, filter, true, true))
+    {
+        return NULL;
+    }
+
+    return table->dirty[column];
+}
+
+/** Get the bits of a word that correspond with rows in the table */
+static
+uint64_t get_word(
+    EcsDirtyIter *iter)
+{
+    uint64_t word = iter->words[iter->word_index];
+    uint32_t row_count = ecs_array_count(iter->table->rows);
+    uint32_t first = iter->word_index * 64;
+
+    if (row_count - first < 64) {
+        word &= ((uint64_t)1 << (row_count - first)) - 1;
+    }
+
+    return word;
+}
+
+static
+bool dirty_hasnext(
+    EcsIter *it)
+{
+    EcsDirtyIter *iter = it->ctx;
+    EcsWorld *world = iter->world;
+
+    while (!iter->word) {
+        if (iter->table && ++ iter->word_index < iter->word_count) {
+            iter->word = get_word(iter);
+            continue;
+        }
+
+        /* Find next table with a dirty bitmap for the component */
+        iter->table = NULL;
+        while (iter->table_index < world->table_count) {
+            EcsTable *table = ecs_world_table(world, iter->table_index ++);
+            EcsArray *bitmap = get_bitmap(
+                world, table, iter->component, iter->filter);
+            uint32_t row_count = ecs_array_count(table->rows);
+
+            if (bitmap && row_count) {
+                iter->table = table;
+                iter->words = ecs_array_buffer(bitmap);
+                iter->word_count = (row_count + 63) / 64;
+                iter->word_index = 0;
+                iter->word = get_word(iter);
+                break;
+            }
+        }
+
+        if (!iter->table) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static
+void* dirty_next(
+    EcsIter *it)
+{
+    EcsDirtyIter *iter = it->ctx;
+    uint32_t bit = __builtin_ctzll(iter->word);
+    iter->word &= iter->word - 1;
+
+    EcsTable *table = iter->table;
+    return ecs_table_get(table, table->rows, iter->word_index * 64 + bit);
+}
+
+static
+void dirty_release(
+    EcsIter *it)
+{
+    ecs_os_free(it->ctx);
+}
+
+/* -- Public API -- */
+
+void ecs_track_dirty(
+    EcsWorld *world,
+    EcsHandle component)
+{
+    assert(world->magic == ECS_WORLD_MAGIC);
+    assert(!world->in_progress);
+
+    if (world->dirty_family && ecs_family_contains_component(
+        world, NULL, world->dirty_family, component))
+    {
+        return;
+    }
+
+    world->dirty_family = ecs_family_add(
+        world, NULL, world->dirty_family, component);
+
+    uint32_t i, count = world->table_count;
+    for (i = 0; i < count; i ++) {
+        EcsTable *table = ecs_world_table(world, i);
+        if (!table->family_id) {
+            continue;
+        }
+
+        int32_t column = ecs_table_column_index(table, component);
+        if (column != -1) {
+            ecs_table_track_dirty(table, column);
+        }
+    }
+}
+
+void ecs_set_dirty(
+    EcsRows *rows,
+    uint32_t column)
+{
+    EcsWorld *world = rows->world;
+    EcsStage *stage = ecs_get_stage(&world);
+    void *first = rows->first;
+
+    if (first == rows->last || rows->columns[column] <= 0) {
+        return;
+    }
+
+    EcsHandle entity = *(EcsHandle*)first;
+    uint64_t row_64 = ecs_map_get64(world->entity_index, entity);
+    if (!row_64) {
+        return;
+    }
+
+    EcsRow row = ecs_to_row(row_64);
+    EcsTable *table = ecs_world_get_table(world, stage, row.family_id);
+    if (!table->dirty) {
+        return;
+    }
+
+    /* Rows of a row system can be staged, in which case they are marked dirty
+     * when they are merged */
+    if (ecs_table_get(table, table->rows, row.index) != first) {
+        return;
+    }
+
+    uint32_t count = ((char*)rows->last - (char*)first) / rows->element_size;
+    int32_t index = ecs_table_column_index(table, rows->components[column]);
+    ecs_table_set_dirty(table, index, row.index, count);
+}
+
+uint32_t ecs_dirty_count(
+    EcsWorld *world,
+    EcsHandle component,
+    EcsHandle filter)
+{
+    assert(world->magic == ECS_WORLD_MAGIC);
+
+    EcsFamily filter_id = 0;
+    if (filter) {
+        filter_id = ecs_family_from_handle(world, NULL, filter, NULL);
+    }
+
+    uint32_t i, count = world->table_count, result = 0;
+    for (i = 0; i < count; i ++) {
+        EcsTable *table = ecs_world_table(world, i);
+        EcsArray *bitmap = get_bitmap(world, table, component, filter_id);
+        if (!bitmap) {
+            continue;
+        }
+
+        uint64_t *words = ecs_array_buffer(bitmap);
+        uint32_t w, word_count = (ecs_array_count(table->rows) + 63) / 64;
+        for (w = 0; w < word_count; w ++) {
+            result += __builtin_popcountll(words[w]);
+        }
+    }
+
+    return result;
+}
+
+EcsIter ecs_dirty_iter(
+    EcsWorld *world,
+    EcsHandle component,
+    EcsHandle filter)
+{
+    assert(world->magic == ECS_WORLD_MAGIC);
+
+    EcsDirtyIter *iter = ecs_os_calloc(sizeof(EcsDirtyIter));
+    iter->world = world;
+    iter->component = component;
+
+    if (filter) {
+        iter->filter = ecs_family_from_handle(world, NULL, filter, NULL);
+    }
+
+    return (EcsIter){
+        .ctx = iter,
+        .hasnext = dirty_hasnext,
+        .next = dirty_next,
+        .release = dirty_release
+    };
+}
+
+void ecs_clear_dirty(
+    EcsWorld *world,
+    EcsHandle component)
+{
+    assert(world->magic == ECS_WORLD_MAGIC);
+    assert(!world->in_progress);
+
+    uint32_t i, count = world->table_count;
+    for (i = 0; i < count; i ++) {
+        EcsTable *table = ecs_world_table(world, i);
+        if (!table->family_id || !table->dirty) {
+            continue;
+        }
+
+        uint32_t c, column_count = ecs_array_count(table->family);
+        for (c = 0; c < column_count; c ++) {
+            EcsArray *bitmap = table->dirty[c];
+            if (!bitmap) {
+                continue;
+            }
+
+            if (component) {
+                EcsHandle *buffer = ecs_array_buffer(table->family);
+                if (buffer[c] != component) {
+                    continue;
+                }
+            }
+
+            memset(ecs_array_buffer(bitmap), 0,
+                sizeof(uint64_t) * ecs_array_count(bitmap));
+        }
+    }
+}
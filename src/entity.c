@@ -3,84 +3,113 @@
 #include <stdarg.h>
 #include "include/private/reflecs.h"
 
+/** Compute which ranges of component data must be copied when moving a row
+ * from one table to another. Components that are stored next to each other in
+ * both tables are copied as a single range. The plan must be able to hold as
+ * many segments as there are columns in the new table. */
 static
-void copy_row(
+uint32_t plan_copy(
     EcsTable *new_table,
-    EcsArray *new_rows,
-    uint32_t new_index,
     EcsTable *old_table,
-    EcsArray *old_rows,
-    uint32_t old_index)
+    EcsCopySegment *plan)
 {
-    EcsArray *old_family = old_table->family;
-    void *old_row = ecs_table_get(old_table, old_rows, old_index);
-    EcsArray *new_family = new_table->family;
-    void *new_row = ecs_table_get(new_table, new_rows, new_index);
-    uint16_t *new_offsets = new_table->columns;
-    uint16_t *old_offsets = old_table->columns;
-
-    assert(old_row != NULL);
-    assert(new_row != NULL);
-
+    EcsHandle *new_components = ecs_array_buffer(new_table->family);
+    EcsHandle *old_components = ecs_array_buffer(old_table->family);
+    uint32_t new_count = ecs_array_count(new_table->family);
+    uint32_t old_count = ecs_array_count(old_table->family);
+    uint16_t *new_sizes = new_table->columns;
+    uint16_t *old_sizes = old_table->columns;
     uint32_t new_offset = sizeof(EcsHandle);
     uint32_t old_offset = sizeof(EcsHandle);
-    uint32_t bytes_to_copy = 0;
-    uint32_t count_new = ecs_array_count(new_family);
-    int i_new = 0, i_old = 0;
-
-    EcsHandle *old_ptr = ecs_array_get(old_family, &handle_arr_params, i_old);
-
-    for (; i_new < count_new; ) {
-        EcsHandle new = *(EcsHandle*)ecs_array_get(
-            new_family, &handle_arr_params, i_new);
+    uint32_t i_new = 0, i_old = 0, count = 0;
+    EcsCopySegment *segment = NULL;
 
-        EcsHandle old = 0;
-
-        if (old_ptr) {
-            old = *old_ptr;
-        }
+    while (i_new < new_count && i_old < old_count) {
+        EcsHandle new = new_components[i_new];
+        EcsHandle old = old_components[i_old];
 
         if (new == old) {
-            bytes_to_copy += new_offsets[i_new];
+            uint32_t size = new_sizes[i_new];
+
+            if (segment &&
+                segment->src_offset + segment->size == old_offset &&
+                segment->dst_offset + segment->size == new_offset)
+            {
+                segment->size += size;
+            } else if (size) {
+                segment = &plan[count ++];
+                segment->src_offset = old_offset;
+                segment->dst_offset = new_offset;
+                segment->size = size;
+            }
+
+            new_offset += size;
+            old_offset += size;
             i_new ++;
             i_old ++;
-            old_ptr = ecs_array_get(
-               old_family, &handle_arr_params, i_old);
+        } else if (new < old) {
+            new_offset += new_sizes[i_new];
+            i_new ++;
         } else {
-            if (bytes_to_copy) {
-                void *dst = ECS_OFFSET(new_row, new_offset);
-                void *src = ECS_OFFSET(old_row, old_offset);
-                memcpy(dst, src, bytes_to_copy);
-                new_offset += bytes_to_copy;
-                old_offset += bytes_to_copy;
-                bytes_to_copy = 0;
-            }
-
-            if (old) {
-                if (new < old) {
-                    new_offset += new_offsets[i_new];
-                    i_new ++;
-                } else if (old < new) {
-                    old_offset += old_offsets[i_old];
-                    i_old ++;
-                    old_ptr = ecs_array_get(
-                       old_family, &handle_arr_params, i_old);
-                }
-            }
+            old_offset += old_sizes[i_old];
+            i_old ++;
         }
+    }
 
-        if (!old || !old_ptr) {
-            break;
-        }
+    return count;
+}
+
+/** Copy component data between rows according to a plan */
+static
+void copy_w_plan(
+    void *new_row,
+    void *old_row,
+    EcsCopySegment *plan,
+    uint32_t count)
+{
+    uint32_t i;
+    for (i = 0; i < count; i ++) {
+        memcpy(ECS_OFFSET(new_row, plan[i].dst_offset),
+               ECS_OFFSET(old_row, plan[i].src_offset),
+               plan[i].size);
     }
+}
 
-    if (bytes_to_copy) {
-        void *dst = ECS_OFFSET(new_row, new_offset);
-        void *src = ECS_OFFSET(old_row, old_offset);
-        memcpy(dst, src, bytes_to_copy);
+/** Mark the columns of a table that receive staged data as changed */
+static
+void touch_columns(
+    EcsWorld *world,
+    EcsTable *table,
+    EcsTable *staged_table)
+{
+    EcsHandle *buffer = ecs_array_buffer(staged_table->family);
+    uint32_t i, count = ecs_array_count(staged_table->family);
+
+    for (i = 0; i < count; i ++) {
+        ecs_table_touch_column(world, table, buffer[i]);
     }
 }
 
+static
+void copy_row(
+    EcsTable *new_table,
+    EcsArray *new_rows,
+    uint32_t new_index,
+    EcsTable *old_table,
+    EcsArray *old_rows,
+    uint32_t old_index)
+{
+    void *old_row = ecs_table_get(old_table, old_rows, old_index);
+    void *new_row = ecs_table_get(new_table, new_rows, new_index);
+    EcsCopySegment plan[ecs_array_count(new_table->family)];
+
+    assert(old_row != NULL);
+    assert(new_row != NULL);
+
+    uint32_t count = plan_copy(new_table, old_table, plan);
+    copy_w_plan(new_row, old_row, plan, count);
+}
+
 static
 bool has_type(
     EcsWorld *world,
@@ -93,10 +122,25 @@ bool has_type(
     EcsFamily family_id = row.family_id;
 
     if (world->in_progress) {
-        row = ecs_to_row(ecs_map_get64(stage->entity_stage, entity));
-        EcsFamily to_remove = ecs_map_get64(stage->remove_merge, entity);
-        family_id = ecs_family_merge(
-            world, stage, family_id, row.family_id, to_remove);
+        /* Only consult the stage if entities have been committed to it */
+        if (ecs_map_count(stage->entity_stage)) {
+            row = ecs_to_row(ecs_map_get64(stage->entity_stage, entity));
+            family_id = ecs_family_merge(
+                world, stage, family_id, row.family_id, 0);
+        }
+
+        EcsCommand *cmd = ecs_stage_last_command(stage, entity);
+        if (cmd) {
+            EcsFamily to_add, to_remove;
+            if (ecs_stage_coalesce(
+                world, stage, cmd, family_id, &to_add, &to_remove))
+            {
+                family_id = 0;
+            }
+
+            family_id = ecs_family_merge(
+                world, stage, family_id, to_add, to_remove);
+        }
     }
 
     if (!family_id) {
@@ -157,6 +201,7 @@ void* get_row_ptr(
 static
 void* get_ptr(
     EcsWorld *world,
+    EcsStage *stage,
     EcsHandle entity,
     EcsHandle component,
     bool staged_only,
@@ -166,9 +211,31 @@ void* get_ptr(
     uint64_t row_64;
     EcsFamily family_id = 0, staged_id = 0;
     void *ptr = NULL;
-    EcsStage *stage = ecs_get_stage(&world);
 
+    /* Values in the command log are more recent than values in tables. The
+     * records of the entity are walked from last to first. A component that
+     * is added but not set has no value until the stage is merged. */
     if (world->in_progress) {
+        EcsCommand *cmd = ecs_stage_last_command(stage, entity);
+        for (; cmd; cmd = cmd->prev) {
+            if (cmd->kind == EcsCommandSet) {
+                if (cmd->value == component) {
+                    return ECS_OFFSET(cmd, sizeof(EcsCommand));
+                }
+            } else if (cmd->kind == EcsCommandDelete) {
+                return NULL;
+            } else if (ecs_family_contains_component(
+                world, stage, cmd->value, component))
+            {
+                if (cmd->kind == EcsCommandRemove) {
+                    return NULL;
+                }
+                break;
+            }
+        }
+    }
+
+    if (world->in_progress && ecs_map_count(stage->entity_stage)) {
         row_64 = ecs_map_get64(stage->entity_stage, entity);
         if (row_64) {
             EcsRow row = ecs_to_row(row_64);
@@ -217,12 +284,66 @@ void* get_ptr(
     }
 
     if (prefab) {
-        return get_ptr(world, prefab, component, staged_only, true, info);
+        return get_ptr(
+            world, stage, prefab, component, staged_only, true, info);
     } else {
         return NULL;
     }
 }
 
+/** Get the size of a component, and whether an OnSet system is registered for
+ * it. The result is cached by component handle, so that ecs_set does not need
+ * to look up the component entity and the OnSet systems every time. */
+static
+EcsComponentCache get_component_cache(
+    EcsWorld *world,
+    EcsStage *stage,
+    EcsHandle component)
+{
+    EcsArray *cache = world->component_cache;
+    if (component < ecs_array_count(cache)) {
+        EcsComponentCache *elem = ecs_array_get(
+            cache, &component_cache_arr_params, component);
+        if (elem->size) {
+            return *elem;
+        }
+    }
+
+    EcsEntityInfo cinfo = {0};
+    EcsComponent *c = get_ptr(
+        world, stage, component, EcsComponent_h, false, false, &cinfo);
+    assert(c != NULL);
+
+    EcsFamily family_id = ecs_family_from_handle(
+        world, stage, component, &cinfo);
+
+    EcsComponentCache result = {
+        .size = c->size,
+        .on_set = ecs_map_has(world->set_systems, family_id, NULL)
+    };
+
+    /* Worker threads may read the cache, so it can only be updated when no
+     * other threads are running */
+    if (component < ECS_COMPONENT_CACHE_SIZE &&
+        !(world->in_progress && world->threads_running))
+    {
+        uint32_t old_count = ecs_array_count(cache);
+        if (component >= old_count) {
+            ecs_array_set_count(&world->component_cache,
+                &component_cache_arr_params, component + 1);
+            memset(ecs_array_get(world->component_cache,
+                &component_cache_arr_params, old_count), 0,
+                sizeof(EcsComponentCache) * (component + 1 - old_count));
+        }
+
+        EcsComponentCache *elem = ecs_array_get(
+            world->component_cache, &component_cache_arr_params, component);
+        *elem = result;
+    }
+
+    return result;
+}
+
 /** Copy default values from base (and base of base) prefabs */
 static
 void copy_from_prefab(
@@ -290,22 +411,29 @@ bool notify_pre_merge(
     EcsTable *table,
     EcsArray *rows,
     uint32_t row,
+    uint32_t count,
     EcsFamily to_init,
-    EcsMap *systems)
+    EcsSystemKind kind)
 {
     if (world->is_merging) {
         return false;
     }
 
+    /* Worker threads only run while the world is in progress, so the flag is
+     * only written when the world is not, which prevents racing writes */
     bool in_progress = world->in_progress;
-    world->in_progress = true;
+    if (!in_progress) {
+        world->in_progress = true;
+    }
 
     bool result = ecs_notify(
-        world, stage, systems, to_init, table, rows, row);
+        world, stage, kind, to_init, table, rows, row, count);
 
-    world->in_progress = in_progress;
-    if (result && !in_progress) {
-        ecs_merge(world);
+    if (!in_progress) {
+        world->in_progress = false;
+        if (result) {
+            ecs_merge(world);
+        }
     }
 
     return result;
@@ -325,7 +453,45 @@ bool notify_post_merge(
     }
 
     return ecs_notify(
-      world, stage, world->remove_systems, to_deinit, table, rows, row);
+      world, stage, EcsOnRemove, to_deinit, table, rows, row, 1);
+}
+
+/** Obtain a range of new entity handles, and return the first handle of the
+ * range. Worker threads reserve handles from the world in blocks, so that
+ * threads do not contend on the world for every new entity. */
+static
+EcsHandle new_handles(
+    EcsWorld *world,
+    uint32_t count)
+{
+    if (world->magic == ECS_THREAD_MAGIC) {
+        EcsThread *thread = (EcsThread*)world;
+        world = thread->world;
+
+        if (count > thread->handles_left) {
+            /* Ranges that do not fit in a block are reserved directly */
+            if (count > ECS_HANDLE_BLOCK_SIZE) {
+                return __atomic_add_fetch(
+                    &world->last_handle, count, __ATOMIC_RELAXED) - count + 1;
+            }
+
+            thread->next_handle = __atomic_add_fetch(&world->last_handle,
+                ECS_HANDLE_BLOCK_SIZE, __ATOMIC_RELAXED) -
+                ECS_HANDLE_BLOCK_SIZE + 1;
+            thread->handles_left = ECS_HANDLE_BLOCK_SIZE;
+
+            __atomic_add_fetch(
+                &world->handle_block_count, 1, __ATOMIC_RELAXED);
+        }
+
+        EcsHandle result = thread->next_handle;
+        thread->next_handle += count;
+        thread->handles_left -= count;
+        return result;
+    } else {
+        return __atomic_add_fetch(
+            &world->last_handle, count, __ATOMIC_RELAXED) - count + 1;
+    }
 }
 
 /** Commit an entity with a specified family to memory */
@@ -398,6 +564,11 @@ uint32_t commit_w_family(
         if (family_id) {
             copy_row(
                 new_table, new_rows, new_index, old_table, old_rows, old_index);
+
+            /* Disabled entities stay disabled when their family changes */
+            if (!in_progress && !ecs_table_is_enabled(old_table, old_index)) {
+                ecs_table_set_enabled(new_table, new_index, false);
+            }
         }
         if (to_remove) {
             notify_post_merge(world, stage, old_table, old_rows, old_index, to_remove);
@@ -410,8 +581,8 @@ uint32_t commit_w_family(
         uint64_t row_64 = ecs_from_row(new_row);
         ecs_map_set64(entity_index, entity, row_64);
         if (to_add) {
-            notify_pre_merge
-              (world, stage, new_table, new_rows, new_index, to_add, world->add_systems);
+            notify_pre_merge(world, stage, new_table, new_rows, new_index, 1,
+                to_add, EcsOnAdd);
             copy_from_prefab(
                 world, stage, new_table, entity, new_index, family_id, to_add);
         }
@@ -423,7 +594,10 @@ uint32_t commit_w_family(
         }
     }
 
-    world->valid_schedule = false;
+    /* Staged changes invalidate the schedule when they are merged */
+    if (!in_progress) {
+        world->valid_schedule = false;
+    }
 
     return new_index;
 }
@@ -433,93 +607,65 @@ uint32_t commit_w_family(
 bool ecs_notify(
     EcsWorld *world,
     EcsStage *stage,
-    EcsMap *systems,
+    EcsSystemKind kind,
     EcsFamily family_id,
     EcsTable *table,
     EcsArray *rows,
-    int32_t row_index)
+    uint32_t row_index,
+    uint32_t count)
 {
-    EcsHandle system = ecs_map_get64(systems, family_id);
+    bool must_free;
+    EcsArray *notify = ecs_table_get_notify(
+        world, stage, table, kind, family_id, &must_free);
+    EcsTableNotify *buffer = ecs_array_buffer(notify);
+    uint32_t i, notify_count = ecs_array_count(notify);
     bool notified = false;
 
-    if (system) {
+    for (i = 0; i < notify_count; i ++) {
+        EcsHandle system = buffer[i].system;
         EcsRowSystem *system_data = ecs_get_ptr(world, system, EcsRowSystem_h);
         assert(system_data != NULL);
 
         if (!system_data->base.enabled) {
-            return false;
+            continue;
         }
 
-        EcsArray *family = ecs_family_get(world, stage, family_id);
-        uint32_t i, column_count = ecs_array_count(family);
-        EcsHandle *buffer = ecs_array_buffer(system_data->components);
-        int32_t columns[column_count];
-
-        for (i = 0; i < column_count; i ++) {
-            columns[i] = ecs_table_column_offset(table, buffer[i]);
-        }
-
-        int32_t row = row_index;
-        if (row_index == -1) {
-            row = ecs_array_count(rows) - 1;
-            row_index = 0;
-        }
-
-        for (; row >= row_index; row --) {
-            ecs_row_notify(
-                world,
-                stage,
-                system,
-                system_data,
-                rows,
-                &table->row_params,
-                row,
-                columns);
-        }
+        ecs_row_notify(
+            world,
+            stage,
+            system,
+            system_data,
+            rows,
+            &table->row_params,
+            row_index,
+            count,
+            buffer[i].columns);
 
         notified = true;
-    } else {
-        EcsArray *family = ecs_family_get(world, stage, family_id);
-        uint32_t i, count = ecs_array_count(family);
-        EcsHandle *buffer = ecs_array_buffer(family);
-        int32_t offset = sizeof(EcsHandle);
-
-        for (i = 0; i < count; i ++) {
-            EcsFamily fid = ecs_family_from_handle(
-                world, stage, buffer[i], NULL);
-
-            system = ecs_map_get64(systems, fid);
-            if (system) {
-                EcsRowSystem *system_data = ecs_get_ptr(
-                    world, system, EcsRowSystem_h);
+    }
 
-                assert(system_data != NULL);
+    if (must_free) {
+        ecs_table_free_notify(notify);
+    }
 
-                int32_t row = row_index;
-                if (row_index == -1) {
-                    row = ecs_array_count(rows) - 1;
-                    row_index = 0;
-                }
+    return notified;
+}
 
-                for (; row >= row_index; row --) {
-                    ecs_row_notify(
-                        world,
-                        stage,
-                        system,
-                        system_data,
-                        rows,
-                        &table->row_params,
-                        row,
-                        &offset);
-                }
+void ecs_commit_w_family(
+    EcsWorld *world,
+    EcsStage *stage,
+    EcsHandle entity,
+    EcsFamily to_add,
+    EcsFamily to_remove)
+{
+    uint64_t row_64 = ecs_map_get64(world->entity_index, entity);
+    EcsRow row = ecs_to_row(row_64);
 
-                notified = true;
-            }
-            offset += table->columns[i];
-        }
-    }
+    EcsFamily family_id = ecs_family_merge(
+        world, stage, row.family_id, to_add, to_remove);
 
-    return notified;
+    commit_w_family(
+        world, stage, entity, row_64, family_id, to_add, to_remove);
 }
 
 EcsHandle ecs_new_w_family(
@@ -527,43 +673,78 @@ EcsHandle ecs_new_w_family(
     EcsStage *stage,
     EcsFamily family_id)
 {
-    EcsHandle entity = ++ world->last_handle;
+    EcsHandle entity = new_handles(world, 1);
     commit_w_family(world, stage, entity, 0, family_id, family_id, 0);
     return entity;
 }
 
-void ecs_merge_entity(
+void ecs_merge_table(
     EcsWorld *world,
-    EcsStage *stage,
-    EcsHandle entity,
-    EcsRow *staged_row)
+    EcsMergeTable *merge_table)
 {
-    uint64_t old_row_64 = ecs_map_get64(world->entity_index, entity);
-    EcsRow old_row = ecs_to_row(old_row_64);
-    EcsFamily to_remove = ecs_map_get64(stage->remove_merge, entity);
+    EcsTable *table = merge_table->table;
+    if (!table) {
+        return;
+    }
 
-    EcsFamily staged_id = staged_row->family_id;
-    EcsFamily family_id = ecs_family_merge(
-        world, stage, old_row.family_id, staged_row->family_id, to_remove);
+    EcsArray *rows = table->rows;
+    EcsMergeRow *buffer = ecs_array_buffer(merge_table->rows);
+    uint32_t i, count = ecs_array_count(merge_table->rows);
+    uint32_t column_count = ecs_array_count(table->family);
+
+    /* Rows are sorted by source table, so copy plans are only computed when
+     * the source table changes */
+    EcsTable *old_table = NULL, *staged_table = NULL;
+    EcsCopySegment old_plan[column_count], staged_plan[column_count];
+    uint32_t old_plan_count = 0, staged_plan_count = 0;
+
+    for (i = 0; i < count; i ++) {
+        EcsMergeRow *row = &buffer[i];
+        uint32_t new_index = row->new_index;
+        void *new_row = ecs_table_get(table, rows, new_index);
+
+        /* Row was reserved by the main thread, move entity to new row */
+        if (row->old_table != table) {
+            *(EcsHandle*)new_row = row->entity;
+
+            if (row->old_table) {
+                if (row->old_table != old_table) {
+                    old_table = row->old_table;
+                    old_plan_count = plan_copy(table, old_table, old_plan);
+                }
 
-    uint32_t new_index = commit_w_family(
-        world, stage, entity, old_row_64, family_id, 0, to_remove);
+                void *old_row = ecs_table_get(
+                    old_table, old_table->rows, row->old_index);
+                copy_w_plan(new_row, old_row, old_plan, old_plan_count);
 
-    if (family_id && staged_id) {
-        EcsTable *new_table = ecs_world_get_table(world, stage, family_id);
-        assert(new_table != NULL);
+                if (!ecs_table_is_enabled(old_table, row->old_index)) {
+                    ecs_table_set_enabled(table, new_index, false);
+                }
+            }
 
-        EcsTable *staged_table = ecs_world_get_table(world, stage, staged_id);
-        EcsArray *staged_rows = ecs_map_get(
-            stage->data_stage, staged_row->family_id);
+            /* Entity index entries of existing entities can be updated in
+             * place, as no keys are added to the index while merging */
+            if (row->index_ptr) {
+                EcsRow new_entry = {
+                    .family_id = merge_table->family_id,
+                    .index = new_index
+                };
+                *row->index_ptr = ecs_from_row(new_entry);
+            }
+        }
+
+        if (row->staged_table) {
+            if (row->staged_table != staged_table) {
+                staged_table = row->staged_table;
+                staged_plan_count = plan_copy(
+                    table, staged_table, staged_plan);
+                touch_columns(world, table, staged_table);
+            }
 
-        copy_row(
-            new_table,
-            new_table->rows,
-            new_index,
-            staged_table,
-            staged_rows,
-            staged_row->index);
+            void *staged_row = ecs_table_get(
+                staged_table, row->staged_rows, row->staged_index);
+            copy_w_plan(new_row, staged_row, staged_plan, staged_plan_count);
+        }
     }
 }
 
@@ -584,11 +765,6 @@ EcsResult ecs_commit(
 
     EcsFamily to_add = ecs_map_get64(stage->add_stage, entity);
     EcsFamily to_remove = ecs_map_get64(stage->remove_stage, entity);
-    uint64_t row_64 = ecs_map_get64(entity_index, entity);
-    EcsRow row = ecs_to_row(row_64);
-
-    EcsFamily family_id = ecs_family_merge(
-        world, stage, row.family_id, to_add, to_remove);
 
     if (to_add) {
         ecs_map_remove(stage->add_stage, entity);
@@ -596,15 +772,28 @@ EcsResult ecs_commit(
 
     if (to_remove) {
         ecs_map_remove(stage->remove_stage, entity);
-        if (world->in_progress) {
-            EcsFamily remove_merge = ecs_map_get64(
-                stage->remove_merge, entity);
-            remove_merge = ecs_family_merge(
-                world, stage, remove_merge, to_remove, 0);
-            ecs_map_set64(stage->remove_merge, entity, remove_merge);
+    }
+
+    /* Entities that were not created while in progress have no staged row,
+     * and their changes are recorded in the command log */
+    if (world->in_progress && ecs_stage_logs(stage, entity)) {
+        if (to_add) {
+            ecs_stage_append(stage, EcsCommandAdd, entity, to_add, 0);
         }
+
+        if (to_remove) {
+            ecs_stage_append(stage, EcsCommandRemove, entity, to_remove, 0);
+        }
+
+        return EcsOk;
     }
 
+    uint64_t row_64 = ecs_map_get64(entity_index, entity);
+    EcsRow row = ecs_to_row(row_64);
+
+    EcsFamily family_id = ecs_family_merge(
+        world, stage, row.family_id, to_add, to_remove);
+
     return commit_w_family(
         world, stage, entity, row_64, family_id, to_add, to_remove);
 }
@@ -613,8 +802,8 @@ EcsHandle ecs_new(
     EcsWorld *world,
     EcsHandle type)
 {
+    EcsHandle entity = new_handles(world, 1);
     EcsStage *stage = ecs_get_stage(&world);
-    EcsHandle entity = ++ world->last_handle;
     if (type) {
         EcsFamily family_id = ecs_family_from_handle(world, stage, type, NULL);
         commit_w_family(world, stage, entity, 0, family_id, family_id, 0);
@@ -628,8 +817,8 @@ EcsHandle ecs_clone(
     EcsHandle entity,
     bool copy_value)
 {
+    EcsHandle result = new_handles(world, 1);
     EcsStage *stage = ecs_get_stage(&world);
-    EcsHandle result = ++ world->last_handle;
     if (entity) {
         int64_t row64 = ecs_map_get64(world->entity_index, entity);
         if (row64) {
@@ -669,24 +858,50 @@ EcsHandle ecs_new_w_count(
     uint32_t count,
     EcsHandle *handles_out)
 {
+    EcsHandle result = new_handles(world, count);
     EcsStage *stage = ecs_get_stage(&world);
-    EcsHandle result = world->last_handle + 1;
-    world->last_handle += count;
 
-    if (type) {
+    if (type && count) {
         EcsFamily family_id = ecs_family_from_handle(world, stage, type, NULL);
+
         EcsTable *table = ecs_world_get_table(world, stage, family_id);
-        uint32_t row_count = ecs_array_count(table->rows);
-        row_count += count;
-        ecs_array_set_size(&table->rows, &table->row_params, row_count);
+        EcsArray *rows;
+
+        /* Preallocate rows. While in progress, new rows are added to the stage
+         * so the table may not be modified */
+        if (!world->in_progress) {
+            uint32_t row_count = ecs_array_count(table->rows);
+            ecs_table_dim(world, table, row_count + count);
+        }
 
-        int i;
+        /* Entities are committed without notifying systems, so that OnAdd
+         * systems are invoked once for the range of new rows */
+        EcsHandle i;
+        uint32_t first_index = 0;
         for (i = result; i < (result + count); i ++) {
-            commit_w_family(world, stage, i, 0, family_id, family_id, 0);
+            uint32_t index = commit_w_family(
+                world, stage, i, 0, family_id, 0, 0);
+            if (i == result) {
+                first_index = index;
+            }
             if (handles_out) {
                 handles_out[i - result] = i;
             }
         }
+
+        if (world->in_progress) {
+            rows = ecs_map_get(stage->data_stage, family_id);
+        } else {
+            rows = table->rows;
+        }
+
+        notify_pre_merge(world, stage, table, rows, first_index, count,
+            family_id, EcsOnAdd);
+
+        for (i = 0; i < count; i ++) {
+            copy_from_prefab(world, stage, table, result + i, first_index + i,
+                family_id, family_id);
+        }
     }
 
     return result;
@@ -700,6 +915,8 @@ void ecs_delete(
     bool in_progress = world->in_progress;
 
     if (!in_progress) {
+        ecs_hierarchy_delete(world, entity);
+
         uint64_t row64;
         if (ecs_map_has(world->entity_index, entity, &row64)) {
             EcsRow row = ecs_to_row(row64);
@@ -707,8 +924,7 @@ void ecs_delete(
             ecs_map_remove(world->entity_index, entity);
         }
     } else {
-        EcsHandle *h = ecs_array_add(&stage->delete_stage, &handle_arr_params);
-        *h = entity;
+        ecs_stage_append(stage, EcsCommandDelete, entity, 0, 0);
     }
 }
 
@@ -718,7 +934,8 @@ void* ecs_get_ptr(
     EcsHandle component)
 {
     EcsEntityInfo info;
-    return get_ptr(world, entity, component, false, true, &info);
+    EcsStage *stage = ecs_get_stage(&world);
+    return get_ptr(world, stage, entity, component, false, true, &info);
 }
 
 EcsHandle ecs_set_ptr(
@@ -727,7 +944,7 @@ EcsHandle ecs_set_ptr(
     EcsHandle component,
     void *src)
 {
-    EcsEntityInfo info = {0}, cinfo = {0};
+    EcsEntityInfo info = {0};
     assert(src != NULL);
     assert(world != NULL);
     assert(component != 0);
@@ -736,33 +953,311 @@ EcsHandle ecs_set_ptr(
         entity = ecs_new(world, component);
     }
 
-    int *dst = get_ptr(world, entity, component, true, false, &info);
+    EcsWorld *real_world = world;
+    EcsStage *stage = ecs_get_stage(&real_world);
+
+    /* Values set on entities that were not created while in progress are
+     * copied to the command log, and set when the stage is merged */
+    if (real_world->in_progress && ecs_stage_logs(stage, entity)) {
+        EcsComponentCache cdata = get_component_cache(
+            real_world, stage, component);
+        EcsCommand *cmd = ecs_stage_append(
+            stage, EcsCommandSet, entity, component, cdata.size);
+        memcpy(ECS_OFFSET(cmd, sizeof(EcsCommand)), src, cdata.size);
+        return entity;
+    }
+
+    int *dst = get_ptr(
+        real_world, stage, entity, component, true, false, &info);
     if (!dst) {
         ecs_stage_add(world, entity, component);
         ecs_commit(world, entity);
 
-        dst = get_ptr(world, entity, component, true, false, &info);
+        dst = get_ptr(
+            real_world, stage, entity, component, true, false, &info);
         assert(dst != NULL);
     }
 
-    EcsComponent *c = get_ptr(world, component, EcsComponent_h, false, false, &cinfo);
-    assert(c != NULL);
-    memcpy(dst, src, c->size);
+    EcsComponentCache cdata = get_component_cache(
+        real_world, stage, component);
+    memcpy(dst, src, cdata.size);
 
-    EcsStage *stage = ecs_get_stage(&world);
-    EcsFamily to_set = ecs_family_from_handle(world, stage, component, &cinfo);
-    notify_pre_merge(
-        world,
-        stage,
-        info.table,
-        info.rows,
-        info.index,
-        to_set,
-        world->set_systems);
+    /* Staged values mark the column as changed when they are merged */
+    if (info.rows == info.table->rows) {
+        ecs_table_touch_column(real_world, info.table, component);
+
+        if (info.table->dirty) {
+            int32_t column = ecs_table_column_index(info.table, component);
+            ecs_table_set_dirty(info.table, column, info.index, 1);
+        }
+    } else if (real_world->dirty_family && ecs_family_contains_component(
+        real_world, stage, real_world->dirty_family, component))
+    {
+        EcsDirtyRef *ref = ecs_array_add(
+            &stage->dirty_stage, &dirty_ref_arr_params);
+        ref->entity = entity;
+        ref->component = component;
+    }
+
+    if (cdata.on_set) {
+        EcsFamily to_set = ecs_family_from_handle(
+            real_world, stage, component, NULL);
+        notify_pre_merge(
+            real_world,
+            stage,
+            info.table,
+            info.rows,
+            info.index,
+            1,
+            to_set,
+            EcsOnSet);
+    }
 
     return entity;
 }
 
+void ecs_scatter(
+    EcsWorld *world,
+    EcsHandle component,
+    const EcsHandle *entities,
+    uint32_t count,
+    const void *src)
+{
+    EcsWorld *real_world = world;
+    EcsStage *stage = ecs_get_stage(&real_world);
+    EcsComponentCache cdata = get_component_cache(real_world, stage, component);
+    uint32_t i;
+
+    /* While in progress, values are set in the stage */
+    if (real_world->in_progress) {
+        for (i = 0; i < count; i ++) {
+            ecs_set_ptr(world, entities[i], component,
+                ECS_OFFSET(src, i * cdata.size));
+        }
+        return;
+    }
+
+    world = real_world;
+
+    EcsTable *table = NULL;
+    EcsFamily family_id = 0;
+    int32_t offset = -1, column = -1;
+    uint32_t run_first = 0, run_count = 0;
+
+    for (i = 0; i <= count; i ++) {
+        EcsRow row = {0};
+        if (i < count) {
+            row = ecs_to_row(ecs_map_get64(world->entity_index, entities[i]));
+        }
+
+        /* Rows are marked and notified in ranges of consecutive rows */
+        bool in_run = run_count && row.family_id == family_id &&
+            row.index == run_first + run_count;
+
+        if (run_count && !in_run) {
+            ecs_table_set_dirty(table, column, run_first, run_count);
+            if (cdata.on_set) {
+                notify_pre_merge(world, stage, table, table->rows, run_first,
+                    run_count, ecs_family_from_handle(
+                        world, stage, component, NULL), EcsOnSet);
+            }
+            run_count = 0;
+        }
+
+        if (i == count) {
+            break;
+        }
+
+        if (!row.family_id || row.family_id != family_id) {
+            family_id = row.family_id;
+            offset = -1;
+            if (family_id) {
+                table = ecs_world_get_table(world, stage, family_id);
+                offset = ecs_table_column_offset(table, component);
+                column = ecs_table_column_index(table, component);
+            }
+            if (offset != -1) {
+                ecs_table_touch_column(world, table, component);
+            }
+        }
+
+        const void *ptr = ECS_OFFSET(src, i * cdata.size);
+
+        /* Entities without the component are moved to another table */
+        if (offset == -1) {
+            ecs_set_ptr(world, entities[i], component, (void*)ptr);
+            family_id = 0;
+            continue;
+        }
+
+        void *dst = ecs_table_get(table, table->rows, row.index);
+        memcpy(ECS_OFFSET(dst, offset), ptr, cdata.size);
+
+        if (!run_count) {
+            run_first = row.index;
+        }
+        run_count ++;
+    }
+}
+
+uint32_t ecs_gather(
+    EcsWorld *world,
+    EcsHandle component,
+    const EcsHandle *entities,
+    uint32_t count,
+    void *dst)
+{
+    EcsWorld *real_world = world;
+    EcsStage *stage = ecs_get_stage(&real_world);
+    EcsComponentCache cdata = get_component_cache(real_world, stage, component);
+    EcsTable *table = NULL;
+    EcsFamily family_id = 0;
+    int32_t offset = -1;
+    uint32_t i, result = 0;
+
+    for (i = 0; i < count; i ++) {
+        void *elem = ECS_OFFSET(dst, i * cdata.size);
+        void *ptr = NULL;
+
+        /* While in progress, values may be stored in the stage */
+        if (!real_world->in_progress) {
+            EcsRow row = ecs_to_row(
+                ecs_map_get64(real_world->entity_index, entities[i]));
+
+            if (row.family_id != family_id) {
+                family_id = row.family_id;
+                offset = -1;
+                if (family_id) {
+                    table = ecs_world_get_table(real_world, stage, family_id);
+                    offset = ecs_table_column_offset(table, component);
+                }
+            }
+
+            if (offset != -1) {
+                ptr = ECS_OFFSET(
+                    ecs_table_get(table, table->rows, row.index), offset);
+            }
+        }
+
+        /* Component may be stored in the stage or in a prefab */
+        if (!ptr) {
+            ptr = ecs_get_ptr(world, entities[i], component);
+        }
+
+        if (ptr) {
+            memcpy(elem, ptr, cdata.size);
+            result ++;
+        } else {
+            memset(elem, 0, cdata.size);
+        }
+    }
+
+    return result;
+}
+
+uint32_t ecs_copy_column(
+    EcsWorld *world,
+    EcsHandle component,
+    EcsHandle filter,
+    void *dst,
+    uint32_t capacity,
+    EcsHandle *entities_out)
+{
+    assert(world->magic == ECS_WORLD_MAGIC);
+
+    EcsComponentCache cdata = get_component_cache(world, NULL, component);
+    EcsFamily filter_id = 0;
+    if (filter) {
+        filter_id = ecs_family_from_handle(world, NULL, filter, NULL);
+    }
+
+    uint32_t i, table_count = world->table_count, result = 0;
+    for (i = 0; i < table_count; i ++) {
+        EcsTable *table = ecs_world_table(world, i);
+        if (!table->family_id) {
+            continue;
+        }
+
+        int32_t offset = ecs_table_column_offset(table, component);
+        if (offset == -1) {
+            continue;
+        }
+
+        if (filter_id && !ecs_family_contains(
+            world, NULL, table->family_id, filter_id, true, true))
+        {
+            continue;
+        }
+
+        uint32_t row_count = ecs_array_count(table->rows);
+        if (!dst) {
+            result += row_count;
+            continue;
+        }
+
+        if (row_count > capacity - result) {
+            row_count = capacity - result;
+        }
+
+        uint32_t element_size = table->row_params.element_size;
+        char *row = ecs_array_buffer(table->rows);
+        char *elem = ECS_OFFSET(dst, result * cdata.size);
+        uint32_t r;
+
+        for (r = 0; r < row_count; r ++) {
+            memcpy(elem, row + offset, cdata.size);
+            if (entities_out) {
+                entities_out[result + r] = *(EcsHandle*)row;
+            }
+            row += element_size;
+            elem += cdata.size;
+        }
+
+        result += row_count;
+        if (result == capacity) {
+            break;
+        }
+    }
+
+    return result;
+}
+
+void ecs_enable_entity(
+    EcsWorld *world,
+    EcsHandle entity,
+    bool enabled)
+{
+    EcsStage *stage = ecs_get_stage(&world);
+    assert(world->magic == ECS_WORLD_MAGIC);
+    assert(!world->in_progress || !world->threads_running);
+
+    uint64_t row_64 = ecs_map_get64(world->entity_index, entity);
+    if (!row_64) {
+        return;
+    }
+
+    EcsRow row = ecs_to_row(row_64);
+    EcsTable *table = ecs_world_get_table(world, stage, row.family_id);
+    ecs_table_set_enabled(table, row.index, enabled);
+}
+
+bool ecs_is_entity_enabled(
+    EcsWorld *world,
+    EcsHandle entity)
+{
+    EcsStage *stage = ecs_get_stage(&world);
+    assert(world->magic == ECS_WORLD_MAGIC);
+
+    uint64_t row_64 = ecs_map_get64(world->entity_index, entity);
+    if (!row_64) {
+        return true;
+    }
+
+    EcsRow row = ecs_to_row(row_64);
+    EcsTable *table = ecs_world_get_table(world, stage, row.family_id);
+    return ecs_table_is_enabled(table, row.index);
+}
+
 bool ecs_has(
     EcsWorld *world,
     EcsHandle entity,
@@ -8,6 +8,7 @@ EcsResult add_family(
     EcsWorld *world,
     EcsSystemExprElemKind elem_kind,
     EcsSystemExprOperKind oper_kind,
+    EcsSystemExprInOutKind inout_kind,
     const char *entity_id,
     void *data)
 {
@@ -0,0 +1,335 @@
+#include <string.h>
+#include <assert.h>
+#include "include/private/reflecs.h"
+
+/** Mark a family as in use */
+static
+void mark_family(
+    EcsMap *marked,
+    EcsFamily family)
+{
+    if (family) {
+        ecs_map_set64(marked, family, true);
+    }
+}
+
+/** Mark all families that are used as keys in a map */
+static
+void mark_map_keys(
+    EcsMap *marked,
+    EcsMap *map)
+{
+    EcsIter it = ecs_map_iter(map);
+    while (ecs_iter_hasnext(&it)) {
+        uint64_t key;
+        ecs_map_next(&it, &key);
+        mark_family(marked, key);
+    }
+}
+
+/** Mark all families that are stored as values in a map */
+static
+void mark_map_values(
+    EcsMap *marked,
+    EcsMap *map)
+{
+    EcsIter it = ecs_map_iter(map);
+    while (ecs_iter_hasnext(&it)) {
+        mark_family(marked, ecs_map_next(&it, NULL));
+    }
+}
+
+/** Mark the families of components that are staged for entities, which are
+ * used when the entities are committed or merged */
+static
+void mark_stage(
+    EcsMap *marked,
+    EcsStage *stage)
+{
+    mark_map_values(marked, stage->add_stage);
+    mark_map_values(marked, stage->remove_stage);
+
+    EcsCommandBlock *block = stage->commands.first;
+    uint32_t offset = 0;
+    EcsCommand *cmd;
+
+    while ((cmd = ecs_stage_next_command(&block, &offset))) {
+        if (cmd->kind == EcsCommandAdd || cmd->kind == EcsCommandRemove) {
+            mark_family(marked, cmd->value);
+        }
+    }
+}
+
+/** Mark the families stored in the columns of a system */
+static
+void mark_system(
+    EcsMap *marked,
+    EcsSystem *system_data)
+{
+    mark_family(marked, system_data->not_from_entity);
+    mark_family(marked, system_data->not_from_component);
+
+    EcsIter it = ecs_array_iter(system_data->columns, &column_arr_params);
+    while (ecs_iter_hasnext(&it)) {
+        EcsSystemColumn *column = ecs_iter_next(&it);
+        if (column->oper_kind == EcsOperOr) {
+            mark_family(marked, column->is.family);
+        }
+    }
+}
+
+/** Mark the families of the filters cached by a table system */
+static
+void mark_filters(
+    EcsMap *marked,
+    EcsTableSystem *system_data)
+{
+    if (!system_data->filters) {
+        return;
+    }
+
+    EcsIter it = ecs_map_iter(system_data->filters);
+    while (ecs_iter_hasnext(&it)) {
+        EcsSystemFilter *filter = ecs_iter_next(&it);
+        mark_family(marked, filter->filter_id);
+    }
+}
+
+/** Mark the families stored by a table system or query */
+static
+void mark_table_system(
+    EcsMap *marked,
+    EcsTableSystem *system_data)
+{
+    mark_system(marked, &system_data->base);
+    mark_family(marked, system_data->and_from_entity);
+    mark_family(marked, system_data->and_from_system);
+    mark_filters(marked, system_data);
+}
+
+/** Mark the families stored in the component data of the rows of a table */
+static
+void mark_table(
+    EcsMap *marked,
+    EcsTable *table)
+{
+    int32_t family_offset = ecs_table_column_offset(
+        table, EcsFamilyComponent_h);
+    int32_t table_system_offset = ecs_table_column_offset(
+        table, EcsTableSystem_h);
+    int32_t row_system_offset = ecs_table_column_offset(
+        table, EcsRowSystem_h);
+
+    mark_family(marked, table->family_id);
+
+    if (family_offset == -1 && table_system_offset == -1 &&
+        row_system_offset == -1)
+    {
+        return;
+    }
+
+    EcsIter it = ecs_array_iter(table->rows, &table->row_params);
+    while (ecs_iter_hasnext(&it)) {
+        void *row = ecs_iter_next(&it);
+
+        if (family_offset != -1) {
+            EcsFamilyComponent *data = ECS_OFFSET(row, family_offset);
+            mark_family(marked, data->family);
+            mark_family(marked, data->resolved);
+        }
+
+        if (table_system_offset != -1) {
+            mark_table_system(marked, ECS_OFFSET(row, table_system_offset));
+        }
+
+        if (row_system_offset != -1) {
+            EcsRowSystem *data = ECS_OFFSET(row, row_system_offset);
+            mark_system(marked, &data->base);
+        }
+    }
+}
+
+/** Test if an empty table can be collected */
+static
+bool table_is_garbage(
+    EcsWorld *world,
+    EcsTable *table)
+{
+    /* Skip slots of tables that were already collected */
+    if (!table->family_id) {
+        return false;
+    }
+
+    if (ecs_array_count(table->rows)) {
+        return false;
+    }
+
+    if (world->frame_count - table->empty_since < world->gc_frames) {
+        return false;
+    }
+
+    /* Tables of explicitly created families are kept, as the application is
+     * likely to add entities to them again */
+    if (ecs_map_has(world->family_handles, table->family_id, NULL)) {
+        return false;
+    }
+
+    return true;
+}
+
+/** Unregister a table from its systems and free its storage. Tables do not
+ * move in table_db, so the slot of the table is added to a free list, and is
+ * reused by the next table. */
+static
+void collect_table(
+    EcsWorld *world,
+    EcsTable *table)
+{
+    uint32_t index = table->index;
+
+    uint32_t i, count = ecs_array_count(table->frame_systems);
+    for (i = 0; i < count; i ++) {
+        ecs_system_remove_table(world, table, i);
+    }
+
+    ecs_map_remove(world->prefab_index, table->family_id);
+    ecs_map_remove(world->table_index, table->family_id);
+
+    ecs_table_free(world, table);
+    memset(table, 0, sizeof(EcsTable));
+
+    uint32_t *slot = ecs_array_add(&world->table_free, &index_arr_params);
+    *slot = index;
+}
+
+/** Free merge buckets, as they store pointers to tables that may have been
+ * collected. Buckets are recreated by the next merge. */
+static
+void clear_merge_tables(
+    EcsWorld *world)
+{
+    if (!world->merge_tables) {
+        return;
+    }
+
+    EcsMergeTable *buffer = ecs_array_buffer(world->merge_tables);
+    uint32_t i, count = ecs_array_count(world->merge_tables);
+    for (i = 0; i < count; i ++) {
+        ecs_array_free(buffer[i].rows);
+    }
+
+    ecs_array_clear(world->merge_tables);
+    ecs_map_clear(world->merge_index);
+}
+
+/** Free families that are no longer referenced by a table, system, query,
+ * prefab, staged entity or explicitly created family. Family identifiers are
+ * copied into many places, which is why families are collected by marking the
+ * ones that are in use rather than with reference counts. */
+static
+void collect_families(
+    EcsWorld *world)
+{
+    EcsMap *marked = ecs_map_new(ecs_map_count(world->family_index));
+
+    mark_family(marked, world->component_family);
+    mark_family(marked, world->table_system_family);
+    mark_family(marked, world->row_system_family);
+    mark_family(marked, world->family_family);
+    mark_family(marked, world->prefab_family);
+    mark_family(marked, world->dirty_family);
+
+    mark_map_keys(marked, world->family_handles);
+    mark_map_keys(marked, world->prefab_index);
+    mark_map_keys(marked, world->add_systems);
+    mark_map_keys(marked, world->remove_systems);
+    mark_map_keys(marked, world->set_systems);
+
+    mark_stage(marked, &world->stage);
+
+    EcsThread **threads = ecs_array_buffer(world->worker_threads);
+    uint32_t i, count = ecs_array_count(world->worker_threads);
+    for (i = 1; i < count; i ++) {
+        mark_stage(marked, threads[i]->stage);
+    }
+
+    EcsQuery **queries = ecs_array_buffer(world->queries);
+    count = ecs_array_count(world->queries);
+    for (i = 0; i < count; i ++) {
+        mark_table_system(marked, &queries[i]->system_data);
+    }
+
+    count = world->table_count;
+    for (i = 0; i < count; i ++) {
+        EcsTable *table = ecs_world_table(world, i);
+        if (table->family_id) {
+            mark_table(marked, table);
+        }
+    }
+
+    EcsArray *garbage = ecs_array_new(&index_arr_params, 0);
+
+    EcsIter it = ecs_map_iter(world->family_index);
+    while (ecs_iter_hasnext(&it)) {
+        uint64_t key;
+        ecs_map_next(&it, &key);
+        if (!ecs_map_has(marked, key, NULL)) {
+            uint32_t *elem = ecs_array_add(&garbage, &index_arr_params);
+            *elem = key;
+        }
+    }
+
+    it = ecs_array_iter(garbage, &index_arr_params);
+    while (ecs_iter_hasnext(&it)) {
+        EcsFamily family_id = *(uint32_t*)ecs_iter_next(&it);
+        EcsArray *family = ecs_map_get(world->family_index, family_id);
+        ecs_map_remove(world->family_index, family_id);
+        ecs_array_free(family);
+    }
+
+    /* Tables cache row systems by family, and family ids can be reused */
+    if (ecs_array_count(garbage)) {
+        world->notify_version ++;
+    }
+
+    ecs_array_free(garbage);
+    ecs_map_free(marked);
+}
+
+/* -- Public API -- */
+
+void ecs_set_table_gc(
+    EcsWorld *world,
+    uint32_t frames)
+{
+    assert(world->magic == ECS_WORLD_MAGIC);
+    world->gc_frames = frames;
+}
+
+uint32_t ecs_gc(
+    EcsWorld *world)
+{
+    assert(world->magic == ECS_WORLD_MAGIC);
+    assert(!world->in_progress);
+    assert(!world->system_run.system);
+
+    uint32_t i, count = world->table_count, collected = 0;
+
+    for (i = 0; i < count; i ++) {
+        EcsTable *table = ecs_world_table(world, i);
+        if (table_is_garbage(world, table)) {
+            collect_table(world, table);
+            collected ++;
+        }
+    }
+
+    if (collected) {
+        /* Jobs store indexes into the table arrays of systems */
+        world->valid_schedule = false;
+        clear_merge_tables(world);
+    }
+
+    collect_families(world);
+
+    return collected;
+}
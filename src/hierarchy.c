@@ -0,0 +1,179 @@
+#include <assert.h>
+#include "include/private/reflecs.h"
+
+/** Remove entity from the children of its parent */
+static
+void remove_child(
+    EcsWorld *world,
+    EcsHandle parent,
+    EcsHandle child)
+{
+    EcsArray *children = ecs_map_get(world->child_index, parent);
+    EcsHandle *buffer = ecs_array_buffer(children);
+    uint32_t i, count = ecs_array_count(children);
+
+    for (i = 0; i < count; i ++) {
+        if (buffer[i] == child) {
+            count = ecs_array_remove(children, &handle_arr_params, &buffer[i]);
+            break;
+        }
+    }
+
+    if (!count) {
+        ecs_array_free(children);
+        ecs_map_remove(world->child_index, parent);
+    }
+}
+
+/** Reorder rows of table so that the children of a parent are contiguous */
+static
+void group_table(
+    EcsWorld *world,
+    EcsTable *table,
+    EcsArray **keys)
+{
+    uint32_t i, count = ecs_array_count(table->rows);
+    if (count < 2) {
+        return;
+    }
+
+    ecs_array_set_count(keys, &sort_key_arr_params, count);
+    EcsSortKey *buffer = ecs_array_buffer(*keys);
+
+    for (i = 0; i < count; i ++) {
+        EcsHandle entity = *(EcsHandle*)ecs_table_get(table, table->rows, i);
+        buffer[i].key = ecs_map_get64(world->parent_index, entity);
+        buffer[i].index = i;
+    }
+
+    ecs_table_sort(world, table, *keys);
+}
+
+void ecs_hierarchy_delete(
+    EcsWorld *world,
+    EcsHandle entity)
+{
+    if (!ecs_map_count(world->parent_index)) {
+        return;
+    }
+
+    EcsHandle parent = ecs_map_get64(world->parent_index, entity);
+    if (parent) {
+        remove_child(world, parent, entity);
+        ecs_map_remove(world->parent_index, entity);
+    }
+
+    EcsArray *children = ecs_map_get(world->child_index, entity);
+    if (children) {
+        EcsHandle *buffer = ecs_array_buffer(children);
+        uint32_t i, count = ecs_array_count(children);
+        for (i = 0; i < count; i ++) {
+            ecs_map_remove(world->parent_index, buffer[i]);
+        }
+
+        ecs_array_free(children);
+        ecs_map_remove(world->child_index, entity);
+    }
+}
+
+/* -- Public API -- */
+
+void ecs_adopt(
+    EcsWorld *world,
+    EcsHandle entity,
+    EcsHandle parent)
+{
+    EcsWorld *real_world = world;
+    ecs_get_stage(&real_world);
+    assert(real_world->magic == ECS_WORLD_MAGIC);
+    assert(!real_world->in_progress || !real_world->threads_running);
+    assert(entity != 0);
+    assert(entity != parent);
+
+    EcsHandle old_parent = ecs_map_get64(real_world->parent_index, entity);
+    if (old_parent == parent) {
+        return;
+    }
+
+    if (old_parent) {
+        remove_child(real_world, old_parent, entity);
+    }
+
+    if (!parent) {
+        ecs_map_remove(real_world->parent_index, entity);
+        return;
+    }
+
+    ecs_map_set64(real_world->parent_index, entity, parent);
+
+    EcsArray *children = ecs_map_get(real_world->child_index, parent);
+    if (!children) {
+        children = ecs_array_new(&handle_arr_params, 1);
+    }
+
+    EcsHandle *elem = ecs_array_add(&children, &handle_arr_params);
+    *elem = entity;
+
+    /* Array may have been reallocated */
+    ecs_map_set(real_world->child_index, parent, children);
+}
+
+EcsHandle ecs_get_parent(
+    EcsWorld *world,
+    EcsHandle entity)
+{
+    ecs_get_stage(&world);
+    assert(world->magic == ECS_WORLD_MAGIC);
+    return ecs_map_get64(world->parent_index, entity);
+}
+
+uint32_t ecs_get_children(
+    EcsWorld *world,
+    EcsHandle parent,
+    EcsHandle *children_out,
+    uint32_t capacity)
+{
+    ecs_get_stage(&world);
+    assert(world->magic == ECS_WORLD_MAGIC);
+
+    EcsArray *children = ecs_map_get(world->child_index, parent);
+    uint32_t i, count = ecs_array_count(children);
+
+    if (!children_out || !count) {
+        return count;
+    }
+
+    if (count > capacity) {
+        count = capacity;
+    }
+
+    EcsHandle *buffer = ecs_array_buffer(children);
+    for (i = 0; i < count; i ++) {
+        children_out[i] = buffer[i];
+    }
+
+    return count;
+}
+
+void ecs_group_children(
+    EcsWorld *world)
+{
+    assert(world->magic == ECS_WORLD_MAGIC);
+    assert(!world->in_progress);
+
+    if (!ecs_map_count(world->parent_index)) {
+        return;
+    }
+
+    EcsArray *keys = ecs_array_new(&sort_key_arr_params, 0);
+
+    uint32_t i, count = world->table_count;
+    for (i = 0; i < count; i ++) {
+        EcsTable *table = ecs_world_table(world, i);
+        if (table->family_id) {
+            group_table(world, table, &keys);
+        }
+    }
+
+    ecs_array_free(keys);
+}
@@ -86,7 +86,7 @@ void alloc_buffer(
     uint32_t bucket_count)
 {
     if (bucket_count) {
-        map->buckets = calloc(bucket_count * sizeof(uint32_t), 1);
+        map->buckets = ecs_os_calloc(bucket_count * sizeof(uint32_t));
     } else {
         map->buckets = NULL;
     }
@@ -99,7 +99,7 @@ static
 EcsMap *alloc_map(
     uint32_t bucket_count)
 {
-    EcsMap *result = malloc(sizeof(EcsMap));
+    EcsMap *result = ecs_os_alloc_fixed(sizeof(EcsMap));
     alloc_buffer(result, bucket_count);
     result->count = 0;
     result->min = bucket_count;
@@ -284,7 +284,7 @@ void resize_map(
         }
     }
 
-    free(old_buckets);
+    ecs_os_free(old_buckets);
 }
 
 
@@ -306,7 +306,7 @@ void ecs_map_clear(
     }
 
     if (target_size < (float)map->bucket_count * 0.75) {
-        free(map->buckets);
+        ecs_os_free(map->buckets);
         alloc_buffer(map, target_size);
     } else {
         int i;
@@ -325,8 +325,8 @@ void ecs_map_free(
     EcsMap *map)
 {
     ecs_array_free(map->nodes);
-    free(map->buckets);
-    free(map);
+    ecs_os_free(map->buckets);
+    ecs_os_free_fixed(map, sizeof(EcsMap));
 }
 
 void ecs_map_set64(
@@ -418,6 +418,25 @@ uint64_t ecs_map_get64(
     return 0;
 }
 
+uint64_t* ecs_map_get_ptr64(
+    EcsMap *map,
+    uint64_t key)
+{
+    if (!map->count) {
+        return NULL;
+    }
+
+    uint32_t *bucket = get_bucket(map, key);
+    if (*bucket) {
+        EcsMapNode *elem = get_node(map, bucket, key);
+        if (elem) {
+            return &elem->data;
+        }
+    }
+
+    return NULL;
+}
+
 bool ecs_map_has(
     EcsMap *map,
     uint64_t key_hash,
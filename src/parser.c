@@ -13,13 +13,40 @@ const char *skip_space(
     return ptr;
 }
 
-/** Parse element with a dot-separated qualifier ('COMPONENT.Foo') */
+/** Parse element with an access modifier ('[in] Foo'), an operator ('!Foo')
+ * or a dot-separated qualifier ('COMPONENT.Foo') */
 static
 char* parse_complex_elem(
     char *bptr,
     EcsSystemExprElemKind *elem_kind,
-    EcsSystemExprOperKind *oper_kind)
+    EcsSystemExprOperKind *oper_kind,
+    EcsSystemExprInOutKind *inout_kind)
 {
+    if (bptr[0] == '[') {
+        char *end = strchr(bptr, ']');
+        if (!end) {
+            ecs_abort(ECS_INVALID_COMPONENT_EXPRESSION, bptr);
+        }
+
+        *end = '\0';
+        bptr ++;
+
+        if (!strcmp(bptr, "inout")) {
+            *inout_kind = EcsInOut;
+        } else if (!strcmp(bptr, "in")) {
+            *inout_kind = EcsIn;
+        } else if (!strcmp(bptr, "out")) {
+            *inout_kind = EcsOut;
+        } else {
+            ecs_abort(ECS_INVALID_COMPONENT_EXPRESSION, bptr);
+        }
+
+        bptr = end + 1;
+        if (!bptr[0]) {
+            ecs_abort(ECS_INVALID_COMPONENT_EXPRESSION, bptr);
+        }
+    }
+
     if (bptr[0] == '!') {
         *oper_kind = EcsOperNot;
         if (!bptr[1]) {
@@ -62,6 +89,7 @@ EcsResult has_tables(
     EcsWorld *world,
     EcsSystemExprElemKind elem_kind,
     EcsSystemExprOperKind oper_kind,
+    EcsSystemExprInOutKind inout_kind,
     const char *component_id,
     void *data)
 {
@@ -108,10 +136,11 @@ EcsResult ecs_parse_component_expr(
 {
     size_t len = strlen(sig);
     const char *ptr;
-    char ch, *bptr, *buffer = malloc(len + 1);
+    char ch, *bptr, *buffer = ecs_os_malloc(len + 1);
     bool complex_expr = false;
     EcsSystemExprElemKind elem_kind = EcsFromEntity;
     EcsSystemExprOperKind oper_kind = EcsOperAnd;
+    EcsSystemExprInOutKind inout_kind = EcsInOut;
 
     for (bptr = buffer, ch = sig[0], ptr = sig; ch; ptr++) {
         ptr = skip_space(ptr);
@@ -126,7 +155,8 @@ EcsResult ecs_parse_component_expr(
             bptr = buffer;
 
             if (complex_expr) {
-                bptr = parse_complex_elem(bptr, &elem_kind, &oper_kind);
+                bptr = parse_complex_elem(
+                    bptr, &elem_kind, &oper_kind, &inout_kind);
                 if (!bptr) {
                     ecs_abort(ECS_INVALID_COMPONENT_EXPRESSION, sig);
                 }
@@ -151,12 +181,15 @@ EcsResult ecs_parse_component_expr(
                 elem_kind = EcsFromHandle;
             }
 
-            if (action(world, elem_kind, oper_kind, bptr, ctx) != EcsOk) {
+            if (action(world, elem_kind, oper_kind, inout_kind, bptr, ctx)
+                != EcsOk)
+            {
                 ecs_abort(ECS_INVALID_COMPONENT_EXPRESSION, sig);
             }
 
             complex_expr = false;
             elem_kind = EcsFromEntity;
+            inout_kind = EcsInOut;
 
             if (ch == '|') {
                 if (elem_kind == EcsFromHandle) {
@@ -173,12 +206,12 @@ EcsResult ecs_parse_component_expr(
             *bptr = ch;
             bptr ++;
 
-            if (ch == '.' || ch == '!' || ch == '?') {
+            if (ch == '.' || ch == '!' || ch == '?' || ch == '[') {
                 complex_expr = true;
             }
         }
     }
 
-    free(buffer);
+    ecs_os_free(buffer);
     return EcsOk;
 }
@@ -0,0 +1,135 @@
+#include <assert.h>
+#include "include/private/reflecs.h"
+
+/** Spread the bits of a 32 bit value over the even bits of a 64 bit value */
+static
+uint64_t spread_bits(
+    uint32_t value)
+{
+    uint64_t result = value;
+    result = (result | (result << 16)) & 0x0000FFFF0000FFFFull;
+    result = (result | (result << 8)) & 0x00FF00FF00FF00FFull;
+    result = (result | (result << 4)) & 0x0F0F0F0F0F0F0F0Full;
+    result = (result | (result << 2)) & 0x3333333333333333ull;
+    result = (result | (result << 1)) & 0x5555555555555555ull;
+    return result;
+}
+
+/** Test if the rows or sorted column of a table changed since the last sort */
+static
+bool table_changed(
+    EcsTable *table,
+    int32_t column)
+{
+    uint64_t version = table->sort_version;
+    return table->rows_version > version ||
+        table->column_versions[column] > version;
+}
+
+/** Sort the rows of a table by the keys computed from a component */
+static
+void sort_table(
+    EcsWorld *world,
+    EcsTable *table,
+    EcsHandle component,
+    EcsSortKeyAction key_action,
+    EcsArray **keys)
+{
+    uint32_t i, count = ecs_array_count(table->rows);
+    if (count < 2) {
+        return;
+    }
+
+    uint32_t offset = ecs_table_column_offset(table, component);
+    ecs_array_set_count(keys, &sort_key_arr_params, count);
+    EcsSortKey *buffer = ecs_array_buffer(*keys);
+
+    for (i = 0; i < count; i ++) {
+        void *row = ecs_table_get(table, table->rows, i);
+        buffer[i].key = key_action(*(EcsHandle*)row, ECS_OFFSET(row, offset));
+        buffer[i].index = i;
+    }
+
+    ecs_table_sort(world, table, *keys);
+}
+
+/** Sort all tables that store the component. If only_changed is set, tables
+ * that did not change since they were last sorted are skipped. */
+static
+void sort_tables(
+    EcsWorld *world,
+    EcsHandle component,
+    EcsSortKeyAction key_action,
+    bool only_changed)
+{
+    EcsArray *keys = ecs_array_new(&sort_key_arr_params, 0);
+
+    uint32_t i, count = world->table_count;
+    for (i = 0; i < count; i ++) {
+        EcsTable *table = ecs_world_table(world, i);
+        if (!table->family_id) {
+            continue;
+        }
+
+        int32_t column = ecs_table_column_index(table, component);
+        if (column == -1) {
+            continue;
+        }
+
+        if (only_changed && !table_changed(table, column)) {
+            continue;
+        }
+
+        sort_table(world, table, component, key_action, &keys);
+
+        /* Changes made by sorting do not require sorting again */
+        table->sort_version = ecs_world_next_version(world);
+    }
+
+    ecs_array_free(keys);
+}
+
+void ecs_sort_tables(
+    EcsWorld *world)
+{
+    if (world->sort_action) {
+        sort_tables(world, world->sort_component, world->sort_action, true);
+    }
+}
+
+/* -- Public API -- */
+
+void ecs_sort(
+    EcsWorld *world,
+    EcsHandle component,
+    EcsSortKeyAction key_action)
+{
+    assert(world->magic == ECS_WORLD_MAGIC);
+    assert(!world->in_progress);
+    assert(key_action != NULL);
+
+    sort_tables(world, component, key_action, false);
+}
+
+void ecs_set_sort(
+    EcsWorld *world,
+    EcsHandle component,
+    EcsSortKeyAction key_action)
+{
+    assert(world->magic == ECS_WORLD_MAGIC);
+    assert(!world->in_progress);
+
+    world->sort_component = component;
+    world->sort_action = key_action;
+
+    if (key_action) {
+        sort_tables(world, component, key_action, false);
+    }
+}
+
+uint64_t ecs_morton_code(
+    uint32_t x,
+    uint32_t y)
+{
+    return spread_bits(x) | (spread_bits(y) << 1);
+}
@@ -1,4 +1,4 @@
-
+#include <string.h>
 #include "include/private/reflecs.h"
 
 static
@@ -13,6 +13,9 @@ void process_families(
 
         if (!ecs_map_has(world->family_index, family_id, NULL)) {
             ecs_map_set(world->family_index, family_id, family);
+        } else {
+            /* Family was also registered by the world or another stage */
+            ecs_array_free(family);
         }
     }
 
@@ -30,20 +33,24 @@ void process_tables(
         EcsTable *table = &buffer[i];
         EcsFamily family_id = table->family_id;
         if (!ecs_map_has(world->table_index, family_id, NULL)) {
-            ecs_array_move_index(
-                &world->table_db,
-                stage->table_db_stage,
-                &table_arr_params,
-                i);
+            EcsTable *dst = ecs_world_add_table(world);
+            uint32_t index = dst->index;
+            *dst = *table;
+            dst->index = index;
 
-            uint32_t index = ecs_array_count(world->table_db) - 1;
             ecs_map_set(world->table_index, family_id, index + 1);
 
             /* Table might still refer to family in stage */
-            table = ecs_array_get(world->table_db, &table_arr_params, index);
+            table = dst;
             table->family = ecs_family_get(world, NULL, family_id);
+            table->row_params.move_ctx = table;
+
+            ecs_world_notify_create_table(world, stage, table);
         } else {
+            /* Family in stage may have been freed by process_families */
+            table->family = ecs_family_get(world, NULL, family_id);
             ecs_table_deinit(world, table);
+            ecs_table_free(world, table);
         }
     }
 
@@ -51,53 +58,582 @@ void process_tables(
     ecs_map_clear(stage->table_stage);
 }
 
+const EcsArrayParams merge_table_arr_params = {
+    .element_size = sizeof(EcsMergeTable)
+};
+
+const EcsArrayParams merge_row_arr_params = {
+    .element_size = sizeof(EcsMergeRow)
+};
+
+const EcsArrayParams dirty_ref_arr_params = {
+    .element_size = sizeof(EcsDirtyRef)
+};
+
+const EcsArrayParams row_arr_params = {
+    .element_size = sizeof(EcsRow)
+};
+
+/** Sort rows by family, and by descending index within a family. Removing rows
+ * in this order ensures that a row to be removed is never moved by the removal
+ * of another row. */
+static
+int compare_removed(
+    const void *p1,
+    const void *p2)
+{
+    const EcsRow *r1 = p1, *r2 = p2;
+
+    if (r1->family_id != r2->family_id) {
+        return r1->family_id < r2->family_id ? -1 : 1;
+    }
+
+    return (r1->index < r2->index) - (r1->index > r2->index);
+}
+
+/** Sort merge rows by the table that currently stores the entity, and by the
+ * table with staged data. This groups entities that move between the same
+ * tables, so they are inserted in adjacent rows and share a copy plan. */
+static
+int compare_merge_rows(
+    const void *p1,
+    const void *p2)
+{
+    const EcsMergeRow *r1 = p1, *r2 = p2;
+
+    if (r1->old_family_id != r2->old_family_id) {
+        return r1->old_family_id < r2->old_family_id ? -1 : 1;
+    }
+
+    if (r1->staged_family_id != r2->staged_family_id) {
+        return r1->staged_family_id < r2->staged_family_id ? -1 : 1;
+    }
+
+    return 0;
+}
+
+/** Get (or create) the bucket for entities that are merged into a family */
 static
-void process_to_delete(
+EcsMergeTable* get_merge_table(
     EcsWorld *world,
-    EcsStage *stage)
+    EcsStage *stage,
+    EcsFamily family_id)
 {
-    EcsHandle *buffer = ecs_array_buffer(stage->delete_stage);
-    uint32_t i, count = ecs_array_count(stage->delete_stage);
-    for (i = 0; i < count; i ++) {
-        ecs_delete(world, buffer[i]);
+    EcsMergeTable *result;
+    uint32_t index = ecs_map_get64(world->merge_index, family_id);
+
+    if (index) {
+        result = ecs_array_get(
+            world->merge_tables, &merge_table_arr_params, index - 1);
+    } else {
+        result = ecs_array_add(&world->merge_tables, &merge_table_arr_params);
+        result->family_id = family_id;
+        result->rows = ecs_array_new(&merge_row_arr_params, 0);
+        index = ecs_array_count(world->merge_tables);
+        ecs_map_set64(world->merge_index, family_id, index);
+    }
+
+    /* Make sure table exists before pointers to tables are resolved */
+    if (family_id) {
+        ecs_world_get_table(world, stage, family_id);
     }
-    ecs_array_clear(stage->delete_stage);
+
+    return result;
 }
 
+/** Bucket staged entities by the table they will be stored in */
 static
-void process_to_commit(
+uint32_t plan_merge(
     EcsWorld *world,
     EcsStage *stage)
 {
+    uint32_t count = 0;
+
     EcsIter it = ecs_map_iter(stage->entity_stage);
     while (ecs_iter_hasnext(&it)) {
         EcsHandle entity;
         uint64_t row64 = ecs_map_next(&it, &entity);
         EcsRow staged_row = ecs_to_row(row64);
-        ecs_merge_entity(world, stage, entity, &staged_row);
+        uint64_t old_row_64 = ecs_map_get64(world->entity_index, entity);
+        EcsRow old_row = ecs_to_row(old_row_64);
+
+        EcsFamily family_id = ecs_family_merge(
+            world, stage, old_row.family_id, staged_row.family_id, 0);
+
+        if (!family_id && !old_row_64) {
+            continue;
+        }
+
+        EcsMergeTable *merge_table = get_merge_table(world, stage, family_id);
+        EcsMergeRow *row = ecs_array_add(
+            &merge_table->rows, &merge_row_arr_params);
+
+        row->entity = entity;
+        row->old_family_id = old_row.family_id;
+        row->old_index = old_row.index;
+        row->staged_family_id = staged_row.family_id;
+        row->staged_index = staged_row.index;
+        count ++;
+    }
+
+    return count;
+}
+
+/** Resolve tables and reserve rows in destination tables. Rows are sorted so
+ * that entities coming from the same table are inserted as one range. After
+ * this function is called, tables can no longer be created until the merge is
+ * finished, as this could reallocate the tables that merge rows point to. */
+static
+void reserve_rows(
+    EcsWorld *world,
+    EcsStage *stage,
+    EcsMergeTable *merge_table)
+{
+    EcsFamily family_id = merge_table->family_id;
+    uint32_t i, count = ecs_array_count(merge_table->rows);
+    uint32_t to_insert = 0, new_index = 0;
+    EcsTable *table = NULL;
+
+    if (count > 1) {
+        ecs_array_sort(
+            merge_table->rows, &merge_row_arr_params, compare_merge_rows);
+    }
+
+    EcsMergeRow *buffer = ecs_array_buffer(merge_table->rows);
+
+    if (family_id) {
+        table = ecs_world_get_table(world, stage, family_id);
+    }
+
+    merge_table->table = table;
+
+    for (i = 0; i < count; i ++) {
+        if (buffer[i].old_family_id != family_id) {
+            to_insert ++;
+        }
+    }
+
+    if (table && to_insert) {
+        new_index = ecs_table_grow(world, table, to_insert);
+    }
+
+    for (i = 0; i < count; i ++) {
+        EcsMergeRow *row = &buffer[i];
+        EcsFamily old_family_id = row->old_family_id;
+        EcsFamily staged_family_id = row->staged_family_id;
+
+        row->old_table = NULL;
+        row->index_ptr = NULL;
+        row->staged_table = NULL;
+        row->staged_rows = NULL;
+
+        if (old_family_id) {
+            row->old_table = ecs_world_get_table(world, stage, old_family_id);
+        }
+
+        if (old_family_id == family_id) {
+            row->new_index = row->old_index;
+        } else {
+            row->new_index = new_index ++;
+
+            if (old_family_id) {
+                row->index_ptr = ecs_map_get_ptr64(
+                    world->entity_index, row->entity);
+
+                EcsRow *removed = ecs_array_add(
+                    &world->merge_removed, &row_arr_params);
+                removed->family_id = old_family_id;
+                removed->index = row->old_index;
+            }
+        }
+
+        if (table && staged_family_id) {
+            row->staged_table = ecs_world_get_table(
+                world, stage, staged_family_id);
+            row->staged_rows = ecs_map_get(
+                stage->data_stage, staged_family_id);
+        }
+    }
+}
+
+/** Register new entities with the entity index, and remove entities that no
+ * longer have any components */
+static
+void update_entity_index(
+    EcsWorld *world,
+    EcsMergeTable *merge_table)
+{
+    EcsFamily family_id = merge_table->family_id;
+    EcsMergeRow *buffer = ecs_array_buffer(merge_table->rows);
+    uint32_t i, count = ecs_array_count(merge_table->rows);
+
+    for (i = 0; i < count; i ++) {
+        EcsMergeRow *row = &buffer[i];
+        if (!family_id) {
+            ecs_map_remove(world->entity_index, row->entity);
+        } else if (!row->old_family_id) {
+            EcsRow new_row = {.family_id = family_id, .index = row->new_index};
+            ecs_map_set64(world->entity_index, row->entity, ecs_from_row(new_row));
+        }
+    }
+}
+
+/** Remove rows of entities that moved to a different table */
+static
+void remove_rows(
+    EcsWorld *world,
+    EcsStage *stage)
+{
+    EcsArray *removed = world->merge_removed;
+    uint32_t i, count = ecs_array_count(removed);
+    if (!count) {
+        return;
+    }
+
+    ecs_array_sort(removed, &row_arr_params, compare_removed);
+
+    EcsRow *buffer = ecs_array_buffer(removed);
+    EcsFamily family_id = 0;
+    EcsTable *table = NULL;
+
+    for (i = 0; i < count; i ++) {
+        if (buffer[i].family_id != family_id) {
+            family_id = buffer[i].family_id;
+            table = ecs_world_get_table(world, stage, family_id);
+        }
+
+        ecs_table_delete(world, table, buffer[i].index);
+    }
+
+    ecs_array_clear(removed);
+}
+
+/** Merge staged entities. Entities are first bucketed by destination table, and
+ * rows are reserved in the destination tables. Then the rows are copied to the
+ * destination tables, which happens in parallel if worker threads are
+ * available, as every bucket writes to a different table. Finally, the entity
+ * index is updated and old rows are removed. */
+static
+void process_to_commit(
+    EcsWorld *world,
+    EcsStage *stage)
+{
+    if (!ecs_map_count(stage->entity_stage)) {
+        return;
+    }
+
+    if (!world->merge_tables) {
+        world->merge_tables = ecs_array_new(&merge_table_arr_params, 0);
+        world->merge_index = ecs_map_new(0);
+        world->merge_removed = ecs_array_new(&row_arr_params, 0);
+    }
+
+    uint32_t row_count = plan_merge(world, stage);
+
+    EcsMergeTable *buffer = ecs_array_buffer(world->merge_tables);
+    uint32_t i, count = ecs_array_count(world->merge_tables);
+
+    for (i = 0; i < count; i ++) {
+        if (ecs_array_count(buffer[i].rows)) {
+            reserve_rows(world, stage, &buffer[i]);
+        }
+    }
+
+    if (ecs_array_count(world->worker_threads) &&
+        row_count >= ECS_MIN_PARALLEL_MERGE_COUNT)
+    {
+        ecs_prepare_merge_jobs(world, world->merge_tables);
+        ecs_run_jobs(world);
+    } else {
+        for (i = 0; i < count; i ++) {
+            if (ecs_array_count(buffer[i].rows)) {
+                ecs_merge_table(world, &buffer[i]);
+            }
+        }
+    }
+
+    for (i = 0; i < count; i ++) {
+        if (ecs_array_count(buffer[i].rows)) {
+            update_entity_index(world, &buffer[i]);
+            ecs_array_clear(buffer[i].rows);
+        }
+    }
+
+    remove_rows(world, stage);
+
+    world->valid_schedule = false;
+}
+
+/** Mark rows dirty for tracked components that were set while in progress.
+ * Staged rows contain all components of an entity, so the set components are
+ * recorded separately, and marked once entities are in their final rows. */
+static
+void process_dirty(
+    EcsWorld *world,
+    EcsStage *stage)
+{
+    EcsDirtyRef *buffer = ecs_array_buffer(stage->dirty_stage);
+    uint32_t i, count = ecs_array_count(stage->dirty_stage);
+
+    for (i = 0; i < count; i ++) {
+        uint64_t row_64 = ecs_map_get64(world->entity_index, buffer[i].entity);
+        if (!row_64) {
+            /* Entity was deleted */
+            continue;
+        }
+
+        EcsRow row = ecs_to_row(row_64);
+        EcsTable *table = ecs_world_get_table(world, stage, row.family_id);
+        int32_t column = ecs_table_column_index(table, buffer[i].component);
+        ecs_table_set_dirty(table, column, row.index, 1);
+    }
+
+    ecs_array_clear(stage->dirty_stage);
+}
+
+/** Add a block to the command log, after the block that records are currently
+ * appended to. Blocks of previous frames are reused if they are large enough. */
+static
+EcsCommandBlock* add_command_block(
+    EcsCommandLog *log,
+    uint32_t record_size)
+{
+    EcsCommandBlock *current = log->current;
+    EcsCommandBlock *block = current ? current->next : NULL;
+
+    if (!block || block->size < record_size) {
+        uint32_t size = ECS_COMMAND_BLOCK_SIZE;
+        if (record_size > size) {
+            size = record_size;
+        }
+
+        block = ecs_os_malloc(sizeof(EcsCommandBlock) + size);
+        block->size = size;
+        block->used = 0;
+
+        if (current) {
+            block->next = current->next;
+            current->next = block;
+        } else {
+            block->next = log->first;
+            log->first = block;
+        }
+    }
+
+    log->current = block;
+    return block;
+}
+
+/** Add records that were appended since the log was last indexed to the index.
+ * Appending a record does not update the index, so that staging an operation
+ * only writes the record. Records of an entity are linked in reverse order. */
+static
+void index_commands(
+    EcsCommandLog *log)
+{
+    EcsCommandBlock *block = log->index_block;
+    uint32_t offset = log->index_offset;
+    EcsCommand *cmd;
+
+    if (!block) {
+        block = log->first;
+    }
+
+    while ((cmd = ecs_stage_next_command(&block, &offset))) {
+        cmd->prev = (EcsCommand*)(uintptr_t)ecs_map_get64(
+            log->index, cmd->entity);
+        ecs_map_set64(log->index, cmd->entity, (uintptr_t)cmd);
+    }
+
+    log->index_block = block;
+    log->index_offset = offset;
+    log->index_count = log->count;
+}
+
+/** Apply the command log of a stage. Records are coalesced per entity, so that
+ * an entity is moved to its final table at most once, and only the last value
+ * that was set for a component is copied. OnAdd and OnSet systems are invoked
+ * once per entity, after its components are added and set. */
+static
+void process_commands(
+    EcsWorld *world,
+    EcsStage *stage)
+{
+    EcsCommandLog *log = &stage->commands;
+    if (!log->count) {
+        return;
+    }
+
+    if (log->index_count != log->count) {
+        index_commands(log);
     }
 
-    it = ecs_map_iter(stage->data_stage);
+    EcsIter it = ecs_map_iter(log->index);
     while (ecs_iter_hasnext(&it)) {
-        EcsArray *stage = ecs_iter_next(&it);
-        ecs_array_free(stage);
+        EcsHandle entity;
+        EcsCommand *last = (EcsCommand*)(uintptr_t)ecs_map_next(&it, &entity);
+        EcsRow row = ecs_to_row(ecs_map_get64(world->entity_index, entity));
+        EcsFamily to_add, to_remove;
+
+        if (ecs_stage_coalesce(
+            world, stage, last, row.family_id, &to_add, &to_remove))
+        {
+            ecs_delete(world, entity);
+        }
+
+        if (to_add || to_remove) {
+            ecs_commit_w_family(world, stage, entity, to_add, to_remove);
+        }
+
+        uint64_t row_64 = ecs_map_get64(world->entity_index, entity);
+        if (!row_64) {
+            continue;
+        }
+
+        if (to_add) {
+            row = ecs_to_row(row_64);
+            EcsTable *table = ecs_world_get_table(world, stage, row.family_id);
+            ecs_notify(world, stage, EcsOnAdd, to_add, table, table->rows,
+                row.index, 1);
+        }
+
+        /* OnAdd systems may have moved the entity */
+        row = ecs_to_row(ecs_map_get64(world->entity_index, entity));
+        EcsTable *table = ecs_world_get_table(world, stage, row.family_id);
+        EcsFamily done = 0, to_set = 0;
+        EcsCommand *cmd;
+
+        /* Copy the last value of each component that was not removed after it
+         * was set. Records are walked from last to first. */
+        for (cmd = last; cmd && cmd->kind != EcsCommandDelete; cmd = cmd->prev) {
+            if (cmd->kind == EcsCommandRemove) {
+                done = ecs_family_merge(world, stage, done, cmd->value, 0);
+                continue;
+            }
+
+            EcsHandle component = cmd->value;
+            if (cmd->kind != EcsCommandSet ||
+                ecs_family_contains_component(world, stage, done, component))
+            {
+                continue;
+            }
+
+            EcsFamily family_id = ecs_family_from_handle(
+                world, stage, component, NULL);
+            done = ecs_family_merge(world, stage, done, family_id, 0);
+
+            int32_t column = ecs_table_column_index(table, component);
+            if (column == -1) {
+                continue;
+            }
+
+            void *dst = ecs_get_ptr(world, entity, component);
+            memcpy(dst, ECS_OFFSET(cmd, sizeof(EcsCommand)), cmd->size);
+            ecs_table_touch_column(world, table, component);
+            if (table->dirty) {
+                ecs_table_set_dirty(table, column, row.index, 1);
+            }
+
+            to_set = ecs_family_merge(world, stage, to_set, family_id, 0);
+        }
+
+        if (to_set) {
+            ecs_notify(world, stage, EcsOnSet, to_set, table, table->rows,
+                row.index, 1);
+        }
+    }
+}
+
+/** Clear the command log after it has been merged. Blocks that were used this
+ * frame are kept for the next frame, unused blocks are freed. */
+static
+void clear_commands(
+    EcsCommandLog *log)
+{
+    EcsCommandBlock *block = log->first;
+    while (block) {
+        block->used = 0;
+        if (block == log->current) {
+            break;
+        }
+        block = block->next;
+    }
+
+    if (block) {
+        EcsCommandBlock *unused = block->next;
+        while (unused) {
+            EcsCommandBlock *next = unused->next;
+            ecs_os_free(unused);
+            unused = next;
+        }
+
+        block->next = NULL;
+    }
+
+    log->current = log->first;
+    log->index_block = NULL;
+    log->index_offset = 0;
+    log->count = 0;
+    log->index_count = 0;
+    ecs_map_clear(log->index);
+}
+
+/** Clear a stage after it has been merged. Staged row arrays are kept across
+ * frames, so that the next frame can stage rows for the same family without
+ * allocating. An array that was used this frame keeps its capacity, which is
+ * the high-water mark for the next frame. Arrays that were not used for a
+ * whole frame are freed and removed from data_stage. */
+static
+void clear_stage(
+    EcsStage *stage)
+{
+    EcsArray *unused = NULL;
+
+    EcsIter it = ecs_map_iter(stage->data_stage);
+    while (ecs_iter_hasnext(&it)) {
+        uint64_t family_id;
+        EcsArray *rows = (EcsArray*)(uintptr_t)ecs_map_next(&it, &family_id);
+
+        if (ecs_array_count(rows)) {
+            ecs_array_clear(rows);
+        } else {
+            ecs_array_free(rows);
+
+            /* Entries cannot be removed while iterating the map */
+            if (!unused) {
+                unused = ecs_array_new(&handle_arr_params, 1);
+            }
+            *(uint64_t*)ecs_array_add(&unused, &handle_arr_params) = family_id;
+        }
+    }
+
+    if (unused) {
+        it = ecs_array_iter(unused, &handle_arr_params);
+        while (ecs_iter_hasnext(&it)) {
+            ecs_map_remove(stage->data_stage, *(uint64_t*)ecs_iter_next(&it));
+        }
+
+        ecs_array_free(unused);
     }
 
     ecs_map_clear(stage->entity_stage);
     ecs_map_clear(stage->add_stage);
     ecs_map_clear(stage->remove_stage);
-    ecs_map_clear(stage->remove_merge);
-    ecs_map_clear(stage->data_stage);
+    clear_commands(&stage->commands);
 }
 
-/** Stage components for adding or removing from an entity */
+/** Stage components for adding or removing from an entity. Staging a component
+ * cancels a pending operation for the same component in the opposite stage,
+ * so that for example adding and then removing a component before committing
+ * results in the component being removed. */
 static
 EcsResult stage_components(
     EcsWorld *world,
     EcsStage *stage,
     EcsHandle entity,
     EcsHandle component,
-    EcsMap *stage_index)
+    EcsMap *stage_index,
+    EcsMap *cancel_index)
 {
     EcsFamily family_id;
 
@@ -120,9 +656,82 @@ EcsResult stage_components(
         ecs_map_set64(stage_index, entity, new_family_id);
     }
 
+    EcsFamily cancel_id = ecs_map_get64(cancel_index, entity);
+    if (cancel_id) {
+        EcsFamily new_cancel_id = ecs_family_merge(
+            world, stage, cancel_id, 0, resolved_family);
+
+        if (!new_cancel_id) {
+            ecs_map_remove(cancel_index, entity);
+        } else if (new_cancel_id != cancel_id) {
+            ecs_map_set64(cancel_index, entity, new_cancel_id);
+        }
+    }
+
     return EcsOk;
 }
 
+/** Test if a family has any of the components of a system signature */
+static
+bool family_reads(
+    EcsWorld *world,
+    EcsStage *stage,
+    EcsFamily family_id,
+    EcsArray *columns)
+{
+    EcsSystemColumn *buffer = ecs_array_buffer(columns);
+    uint32_t i, count = ecs_array_count(columns);
+
+    for (i = 0; i < count; i ++) {
+        EcsSystemColumn *column = &buffer[i];
+
+        if (column->oper_kind == EcsOperOr) {
+            EcsArray *family = ecs_family_get(world, stage, column->is.family);
+            EcsHandle *handles = ecs_array_buffer(family);
+            uint32_t h, h_count = ecs_array_count(family);
+            for (h = 0; h < h_count; h ++) {
+                if (ecs_family_contains_component(
+                    world, stage, family_id, handles[h]))
+                {
+                    return true;
+                }
+            }
+        } else if (ecs_family_contains_component(
+            world, stage, family_id, column->is.component))
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/** Record adding or removing a component in the command log while in progress.
+ * Components that are staged but not yet committed must be committed together
+ * with the component, in which case the operation is not logged directly. */
+static
+bool log_command(
+    EcsWorld *world,
+    EcsHandle entity,
+    EcsHandle component,
+    EcsCommandKind kind)
+{
+    EcsStage *stage = ecs_get_stage(&world);
+
+    if (!world->in_progress ||
+        ecs_map_count(stage->add_stage) ||
+        ecs_map_count(stage->remove_stage) ||
+        !ecs_stage_logs(stage, entity))
+    {
+        return false;
+    }
+
+    EcsFamily family_id = ecs_family_from_handle(world, stage, component, NULL);
+    ecs_stage_append(stage, kind, entity, family_id, 0);
+
+    return true;
+}
+
 /* -- Private functions -- */
 
 void ecs_stage_init(
@@ -130,35 +739,248 @@ void ecs_stage_init(
 {
     stage->add_stage = ecs_map_new(ECS_WORLD_INITIAL_STAGING_COUNT);
     stage->remove_stage = ecs_map_new(ECS_WORLD_INITIAL_STAGING_COUNT);
-    stage->remove_merge = ecs_map_new(ECS_WORLD_INITIAL_STAGING_COUNT);
     stage->entity_stage = ecs_map_new(ECS_WORLD_INITIAL_STAGING_COUNT);
-    stage->delete_stage = ecs_array_new(&handle_arr_params, 0);
     stage->data_stage = ecs_map_new(ECS_WORLD_INITIAL_STAGING_COUNT);
     stage->family_stage = ecs_map_new(ECS_WORLD_INITIAL_STAGING_COUNT);
     stage->table_db_stage = ecs_array_new(&table_arr_params, 0);
     stage->table_stage = ecs_map_new(ECS_WORLD_INITIAL_STAGING_COUNT);
+    stage->dirty_stage = ecs_array_new(&dirty_ref_arr_params, 0);
+    stage->commands = (EcsCommandLog){
+        .index = ecs_map_new(ECS_WORLD_INITIAL_STAGING_COUNT)
+    };
 }
 
 void ecs_stage_deinit(
     EcsStage *stage)
 {
+    EcsIter it = ecs_map_iter(stage->data_stage);
+    while (ecs_iter_hasnext(&it)) {
+        ecs_array_free(ecs_iter_next(&it));
+    }
+
     ecs_map_free(stage->add_stage);
     ecs_map_free(stage->remove_stage);
-    ecs_map_free(stage->remove_merge);
     ecs_map_free(stage->entity_stage);
-    ecs_array_free(stage->delete_stage);
     ecs_map_free(stage->data_stage);
     ecs_map_free(stage->family_stage);
+    ecs_array_free(stage->table_db_stage);
+    ecs_map_free(stage->table_stage);
+    ecs_array_free(stage->dirty_stage);
+
+    EcsCommandBlock *block = stage->commands.first;
+    while (block) {
+        EcsCommandBlock *next = block->next;
+        ecs_os_free(block);
+        block = next;
+    }
+
+    ecs_map_free(stage->commands.index);
+}
+
+bool ecs_stage_is_empty(
+    EcsStage *stage)
+{
+    return !ecs_map_count(stage->entity_stage) &&
+           !stage->commands.count &&
+           !ecs_map_count(stage->family_stage) &&
+           !ecs_array_count(stage->table_db_stage);
 }
 
 void ecs_stage_merge(
     EcsWorld *world,
     EcsStage *stage)
 {
+    /* Skip stages without staged data, like the stages of threads that only
+     * ran systems that did not modify the world */
+    if (ecs_stage_is_empty(stage)) {
+        return;
+    }
+
     process_families(world, stage);
     process_tables(world, stage);
-    process_to_delete(world, stage);
     process_to_commit(world, stage);
+    process_dirty(world, stage);
+    process_commands(world, stage);
+    clear_stage(stage);
+}
+
+bool ecs_stage_logs(
+    EcsStage *stage,
+    EcsHandle entity)
+{
+    return !ecs_map_count(stage->entity_stage) ||
+           !ecs_map_has(stage->entity_stage, entity, NULL);
+}
+
+EcsCommand* ecs_stage_append(
+    EcsStage *stage,
+    EcsCommandKind kind,
+    EcsHandle entity,
+    uint64_t value,
+    uint32_t size)
+{
+    EcsCommandLog *log = &stage->commands;
+    EcsCommandBlock *block = log->current;
+    uint32_t record_size = ECS_COMMAND_SIZE(size);
+
+    if (!block || block->size - block->used < record_size) {
+        block = add_command_block(log, record_size);
+    }
+
+    EcsCommand *cmd = ECS_OFFSET(block, sizeof(EcsCommandBlock) + block->used);
+    block->used += record_size;
+    log->count ++;
+
+    cmd->prev = NULL;
+    cmd->entity = entity;
+    cmd->value = value;
+    cmd->size = size;
+    cmd->kind = kind;
+
+    return cmd;
+}
+
+EcsCommand* ecs_stage_next_command(
+    EcsCommandBlock **block_ptr,
+    uint32_t *offset_ptr)
+{
+    EcsCommandBlock *block = *block_ptr;
+    uint32_t offset = *offset_ptr;
+
+    if (!block) {
+        return NULL;
+    }
+
+    /* Blocks after the current block of the log are empty */
+    while (offset >= block->used) {
+        if (!block->next || !block->next->used) {
+            return NULL;
+        }
+
+        block = block->next;
+        offset = 0;
+    }
+
+    EcsCommand *cmd = ECS_OFFSET(block, sizeof(EcsCommandBlock) + offset);
+    *block_ptr = block;
+    *offset_ptr = offset + ECS_COMMAND_SIZE(cmd->size);
+
+    return cmd;
+}
+
+EcsCommand* ecs_stage_last_command(
+    EcsStage *stage,
+    EcsHandle entity)
+{
+    EcsCommandLog *log = &stage->commands;
+    if (!log->count) {
+        return NULL;
+    }
+
+    if (log->index_count != log->count) {
+        index_commands(log);
+    }
+
+    return (EcsCommand*)(uintptr_t)ecs_map_get64(log->index, entity);
+}
+
+/** Coalesce the records of an entity into the components to add and remove.
+ * Records are walked from last to first, so an operation on a component only
+ * takes effect if no later operation on the same component was recorded. A
+ * delete discards all records before it. Components the entity already has are
+ * not added and components it does not have are not removed, so adding and
+ * then removing a component the entity did not have cancels out. */
+bool ecs_stage_coalesce(
+    EcsWorld *world,
+    EcsStage *stage,
+    EcsCommand *last,
+    EcsFamily family_id,
+    EcsFamily *to_add_out,
+    EcsFamily *to_remove_out)
+{
+    EcsFamily to_add = 0, to_remove = 0;
+    bool deleted = false;
+    EcsCommand *cmd;
+
+    for (cmd = last; cmd; cmd = cmd->prev) {
+        if (cmd->kind == EcsCommandDelete) {
+            deleted = true;
+            break;
+        }
+
+        EcsFamily cmd_family = cmd->value;
+        if (cmd->kind == EcsCommandSet) {
+            cmd_family = ecs_family_from_handle(world, stage, cmd->value, NULL);
+        }
+
+        if (cmd->kind == EcsCommandRemove) {
+            cmd_family = ecs_family_merge(world, stage, cmd_family, 0, to_add);
+            to_remove = ecs_family_merge(world, stage, to_remove, cmd_family, 0);
+        } else {
+            cmd_family = ecs_family_merge(world, stage, cmd_family, 0, to_remove);
+            to_add = ecs_family_merge(world, stage, to_add, cmd_family, 0);
+        }
+    }
+
+    if (deleted) {
+        family_id = 0;
+    }
+
+    EcsFamily not_present = ecs_family_merge(
+        world, stage, to_remove, 0, family_id);
+
+    *to_add_out = ecs_family_merge(world, stage, to_add, 0, family_id);
+    *to_remove_out = ecs_family_merge(world, stage, to_remove, 0, not_present);
+
+    return deleted;
+}
+
+/** Test if the stage has changes to entities with components read by a system.
+ * Staged rows are matched per family, which is cheap as there are typically
+ * far fewer staged families than staged entities. */
+bool ecs_stage_intersects(
+    EcsWorld *world,
+    EcsStage *stage,
+    EcsSystem *system_data)
+{
+    if (ecs_stage_is_empty(stage)) {
+        return false;
+    }
+
+    EcsIter it = ecs_map_iter(stage->data_stage);
+    while (ecs_iter_hasnext(&it)) {
+        uint64_t family_id;
+        EcsArray *rows = (EcsArray*)(uintptr_t)ecs_map_next(&it, &family_id);
+        if (!ecs_array_count(rows)) {
+            continue;
+        }
+
+        if (family_reads(world, stage, family_id, system_data->columns)) {
+            return true;
+        }
+    }
+
+    EcsCommandBlock *block = stage->commands.first;
+    uint32_t offset = 0;
+    EcsCommand *cmd;
+
+    while ((cmd = ecs_stage_next_command(&block, &offset))) {
+        /* Entities are not removed from tables until merged */
+        if (cmd->kind == EcsCommandDelete) {
+            return true;
+        }
+
+        EcsFamily family_id = cmd->value;
+        if (cmd->kind == EcsCommandSet) {
+            family_id = ecs_family_from_handle(world, stage, cmd->value, NULL);
+        }
+
+        if (family_reads(world, stage, family_id, system_data->columns)) {
+            return true;
+        }
+    }
+
+    return false;
 }
 
 /* -- Public API -- */
@@ -169,7 +991,8 @@ EcsResult ecs_stage_add(
     EcsHandle component)
 {
     EcsStage *stage = ecs_get_stage(&world);
-    return stage_components(world, stage, entity, component, stage->add_stage);
+    return stage_components(world, stage, entity, component,
+        stage->add_stage, stage->remove_stage);
 }
 
 EcsResult ecs_stage_remove(
@@ -178,8 +1001,8 @@ EcsResult ecs_stage_remove(
     EcsHandle component)
 {
     EcsStage *stage = ecs_get_stage(&world);
-    return stage_components(
-        world, stage, entity, component, stage->remove_stage);
+    return stage_components(world, stage, entity, component,
+        stage->remove_stage, stage->add_stage);
 }
 
 EcsResult ecs_add(
@@ -187,6 +1010,10 @@ EcsResult ecs_add(
     EcsHandle entity,
     EcsHandle component)
 {
+    if (log_command(world, entity, component, EcsCommandAdd)) {
+        return EcsOk;
+    }
+
     if (ecs_stage_add(world, entity, component)) {
         return EcsError;
     }
@@ -203,6 +1030,10 @@ EcsResult ecs_remove(
     EcsHandle entity,
     EcsHandle component)
 {
+    if (log_command(world, entity, component, EcsCommandRemove)) {
+        return EcsOk;
+    }
+
     if (ecs_stage_remove(world, entity, component)) {
         return EcsError;
     }
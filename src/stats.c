@@ -53,13 +53,39 @@ void calculate_table_stats(
     uint32_t *allocd,
     uint32_t *used)
 {
-    EcsTable *buffer = ecs_array_buffer(world->table_db);
-    uint32_t i, count = ecs_array_count(world->table_db);
+    uint32_t i, count = world->table_count;
     for (i = 0; i < count; i ++) {
-        EcsTable *table = &buffer[i];
-        ecs_array_memory(table->frame_systems, &handle_arr_params, allocd, used);
-        *allocd += ecs_array_count(table->family) * sizeof(uint16_t);
-        *used += ecs_array_count(table->family) * sizeof(uint16_t);
+        EcsTable *table = ecs_world_table(world, i);
+        if (!table->family_id) {
+            continue;
+        }
+
+        ecs_array_memory(
+            table->frame_systems, &matched_system_arr_params, allocd, used);
+        *allocd += ecs_array_count(table->family) *
+            (sizeof(uint16_t) + sizeof(uint64_t));
+        *used += ecs_array_count(table->family) *
+            (sizeof(uint16_t) + sizeof(uint64_t));
+
+        if (table->dirty) {
+            uint32_t c, column_count = ecs_array_count(table->family);
+            for (c = 0; c < column_count; c ++) {
+                ecs_array_memory(
+                    table->dirty[c], &dirty_arr_params, allocd, used);
+            }
+        }
+
+        ecs_array_memory(table->disabled, &dirty_arr_params, allocd, used);
+
+        if (table->notify_index) {
+            ecs_map_memory(table->notify_index, allocd, used);
+
+            EcsIter it = ecs_map_iter(table->notify_index);
+            while (ecs_iter_hasnext(&it)) {
+                EcsArray *notify = ecs_iter_next(&it);
+                ecs_array_memory(notify, &notify_arr_params, allocd, used);
+            }
+        }
     }
 }
 
@@ -71,13 +97,22 @@ void calculate_stage_stats(
 {
     ecs_map_memory(stage->add_stage, allocd, used);
     ecs_map_memory(stage->remove_stage, allocd, used);
-    ecs_map_memory(stage->remove_merge, allocd, used);
-    ecs_array_memory(stage->delete_stage, &handle_arr_params, allocd, used);
+    ecs_map_memory(stage->commands.index, allocd, used);
     ecs_map_memory(stage->entity_stage, allocd, used);
     ecs_map_memory(stage->data_stage, allocd, used);
     ecs_map_memory(stage->family_stage, allocd, used);
     ecs_array_memory(stage->table_db_stage, &table_arr_params, allocd, used);
     ecs_map_memory(stage->table_stage, allocd, used);
+
+    EcsCommandBlock *block = stage->commands.first;
+    for (; block; block = block->next) {
+        if (allocd) {
+            *allocd += sizeof(EcsCommandBlock) + block->size;
+        }
+        if (used) {
+            *used += sizeof(EcsCommandBlock) + block->used;
+        }
+    }
 }
 
 static
@@ -86,14 +121,29 @@ void calculate_stages_stats(
     uint32_t *allocd,
     uint32_t *used)
 {
-    EcsStage *buffer = ecs_array_buffer(world->stage_db);
-    uint32_t i, count = ecs_array_count(world->stage_db);
-    for (i = 0; i < count; i ++) {
-        EcsStage *stage = &buffer[i];
+    EcsThread **buffer = ecs_array_buffer(world->worker_threads);
+    uint32_t i, count = ecs_array_count(world->worker_threads);
+    for (i = 1; i < count; i ++) {
+        EcsStage *stage = buffer[i]->stage;
+        *allocd += ECS_CACHE_LINE_ROUND(sizeof(EcsStage));
+        *used += sizeof(EcsStage);
         calculate_stage_stats(stage, allocd, used);
     }
 }
 
+static
+void calculate_children_stats(
+    EcsWorld *world,
+    uint32_t *allocd,
+    uint32_t *used)
+{
+    EcsIter it = ecs_map_iter(world->child_index);
+    while (ecs_iter_hasnext(&it)) {
+        EcsArray *children = ecs_iter_next(&it);
+        ecs_array_memory(children, &handle_arr_params, allocd, used);
+    }
+}
+
 static
 void get_memory_stats(
     EcsWorld *world,
@@ -102,6 +152,9 @@ void get_memory_stats(
     EcsMemoryStats *memory = &stats->memory;
 
     ecs_map_memory(world->entity_index, &memory->entities.allocd, &memory->entities.used);
+    ecs_map_memory(world->parent_index, &memory->entities.allocd, &memory->entities.used);
+    ecs_map_memory(world->child_index, &memory->entities.allocd, &memory->entities.used);
+    calculate_children_stats(world, &memory->entities.allocd, &memory->entities.used);
 
     ecs_map_memory(world->add_systems, &memory->systems.allocd, &memory->systems.used);
     ecs_map_memory(world->set_systems, &memory->systems.allocd, &memory->systems.used);
@@ -122,19 +175,24 @@ void get_memory_stats(
     ecs_map_memory(world->family_index, &memory->families.allocd, &memory->families.used);
     ecs_map_memory(world->family_handles, &memory->families.allocd, &memory->families.used);
     ecs_map_memory(world->prefab_index, &memory->families.allocd, &memory->families.used);
+    ecs_array_memory(world->component_cache, &component_cache_arr_params, &memory->families.allocd, &memory->families.used);
     calculate_family_stats(world, &memory->families.allocd, &memory->families.used);
 
     ecs_map_memory(world->table_index, &stats->memory.tables.allocd, &stats->memory.tables.used);
-    ecs_array_memory(world->table_db, &table_arr_params, &memory->tables.allocd, &memory->tables.used);
+    ecs_array_memory(world->table_db, &table_page_arr_params, &memory->tables.allocd, &memory->tables.used);
+    memory->tables.allocd += ecs_array_count(world->table_db) * ECS_TABLE_PAGE_SIZE * sizeof(EcsTable);
+    memory->tables.used += world->table_count * sizeof(EcsTable);
     calculate_table_stats(world, &memory->tables.allocd, &memory->tables.used);
 
-    ecs_array_memory(world->stage_db, &table_arr_params, &memory->stage.allocd, &memory->stage.used);
     memory->stage.allocd += sizeof(EcsStage);
     memory->stage.used += sizeof(EcsStage);
     calculate_stage_stats(&world->stage, &memory->stage.allocd, &memory->stage.used);
     calculate_stages_stats(world, &memory->stage.allocd, &memory->stage.used);
 
-    ecs_array_memory(world->worker_threads, &table_arr_params, &memory->world.allocd, &memory->world.used);
+    ecs_array_memory(world->worker_threads, &thread_arr_params, &memory->world.allocd, &memory->world.used);
+    uint32_t thread_count = ecs_array_count(world->worker_threads);
+    memory->world.allocd += thread_count * ECS_CACHE_LINE_ROUND(sizeof(EcsThread));
+    memory->world.used += thread_count * sizeof(EcsThread);
     stats->memory.world.allocd += sizeof(EcsWorld) - sizeof(EcsStage);
     stats->memory.world.used += sizeof(EcsWorld) - sizeof(EcsStage);
 
@@ -182,9 +240,9 @@ void set_system_stats(
 
         sstats->entities_matched = 0;
         for (i = 0; i < count; i ++) {
-            int32_t *index = ecs_array_get(tables, &table_system->table_params, i);
-            EcsTable *table = ecs_array_get(
-                world->table_db, &table_arr_params, *index);
+            EcsSystemTable *table_data = ecs_array_get(
+                tables, &table_system->table_params, i);
+            EcsTable *table = table_data->table;
             sstats->entities_matched += ecs_array_count(table->rows);
         }
 
@@ -267,7 +325,8 @@ void ecs_get_stats(
     EcsWorldStats *stats)
 {
     uint32_t mem_used = 0, mem_allocd = 0;
-    stats->table_count = ecs_array_count(world->table_db);
+    stats->table_count = world->table_count -
+        ecs_array_count(world->table_free);
 
     if (!stats->tables) {
         stats->tables = ecs_array_new(&tablestats_arr_params, stats->table_count);
@@ -275,16 +334,26 @@ void ecs_get_stats(
         ecs_array_clear(stats->tables);
     }
 
-    EcsTable *tables = ecs_array_buffer(world->table_db);
-    uint32_t i, count = ecs_array_count(world->table_db);
+    uint32_t i, count = world->table_count;
     for (i = 0; i < count; i ++) {
-        EcsTable *table = &tables[i];
+        EcsTable *table = ecs_world_table(world, i);
+        if (!table->family_id) {
+            continue;
+        }
+
         EcsTableStats *tstats = ecs_array_add(
             &stats->tables, &tablestats_arr_params);
         uint32_t row_size = table->row_params.element_size;
         tstats->row_count = ecs_array_count(table->rows);
         tstats->memory_used = tstats->row_count * row_size;
         tstats->memory_allocd = ecs_array_size(table->rows) * row_size;
+
+        size_t huge_size = ecs_array_huge_size(table->rows);
+        if (huge_size) {
+            stats->memory.huge_pages.allocd += huge_size;
+            stats->memory.huge_pages.used += tstats->memory_used;
+        }
+
         tstats->columns = ecs_family_tostr(world, NULL, table->family_id);
 
         EcsHandle family_handle = ecs_map_get64(
@@ -386,6 +455,11 @@ void ecs_get_stats(
 
     stats->entity_count = ecs_map_count(world->entity_index);
     stats->tick_count = world->tick;
+    stats->thread_count = ecs_array_count(world->worker_threads);
+    stats->active_thread_count = world->active_threads;
+    stats->handle_block_size = ECS_HANDLE_BLOCK_SIZE;
+    stats->handle_block_count = world->handle_block_count;
+    stats->sync_count = world->sync_count;
 
     if (world->tick) {
         stats->frame_time = world->frame_time;
@@ -410,13 +484,13 @@ void ecs_free_stats(
     uint32_t i, count = ecs_array_count(stats->tables);
     EcsTableStats *tables = ecs_array_buffer(stats->tables);
     for (i = 0; i < count; i ++) {
-        free(tables[i].columns);
+        ecs_os_free(tables[i].columns);
     }
 
     EcsFeatureStats *entities = ecs_array_buffer(stats->features);
     count = ecs_array_count(stats->features);
     for (i = 0; i < count; i ++) {
-        free(entities[i].entities);
+        ecs_os_free(entities[i].entities);
     }
 
     ecs_array_free(stats->tables);
@@ -65,6 +65,9 @@ EcsHandle new_row_system(
         }
     } else if (kind == EcsOnSet) {
         index = world->set_systems;
+
+        /* Components cache whether an OnSet system is registered */
+        ecs_array_clear(world->component_cache);
     }
 
     if (index) {
@@ -73,6 +76,9 @@ EcsHandle new_row_system(
         }
         assert(!ecs_map_has(index, family_id, NULL));
         ecs_map_set64(index, family_id, result);
+
+        /* Row systems triggered by tables are cached by the tables */
+        world->notify_version ++;
     } else {
         if (kind == EcsOnRemove) {
             EcsHandle *system = ecs_array_add(
@@ -97,6 +103,7 @@ EcsResult ecs_parse_component_action(
     EcsWorld *world,
     EcsSystemExprElemKind elem_kind,
     EcsSystemExprOperKind oper_kind,
+    EcsSystemExprInOutKind inout_kind,
     const char *component_id,
     void *data)
 {
@@ -125,6 +132,7 @@ EcsResult ecs_parse_component_action(
         elem = ecs_array_add(&system_data->columns, &column_arr_params);
         elem->kind = elem_kind;
         elem->oper_kind = oper_kind;
+        elem->inout_kind = inout_kind;
         elem->is.component = component;
 
     /* OR columns store a family id instead of a single component */
@@ -166,7 +174,7 @@ error:
     return EcsError;
 }
 
-/** Run system on a single row */
+/** Run system on a range of rows in a table */
 void ecs_row_notify(
     EcsWorld *world,
     EcsStage *stage,
@@ -175,6 +183,7 @@ void ecs_row_notify(
     EcsArray *rows,
     EcsArrayParams *row_params,
     uint32_t row_index,
+    uint32_t count,
     int32_t *columns)
 {
     EcsSystemAction action = system_data->base.action;
@@ -188,7 +197,7 @@ void ecs_row_notify(
 
     info.element_size = row_params->element_size;
     info.first = ecs_array_get(rows, row_params, row_index);
-    info.last = ECS_OFFSET(info.first, info.element_size);
+    info.last = ECS_OFFSET(info.first, info.element_size * count);
     info.components = ecs_array_buffer(system_data->components);
 
     action(&info);
@@ -196,12 +205,16 @@ void ecs_row_notify(
 
 /** Run a task. A task is a system that contains no columns that can be matched
  * against a table. Examples of such columns are EcsFromSystem or EcsFromHandle.
- * Tasks are ran once every frame. */
+ * Tasks are ran once every frame. The world parameter may be a worker thread,
+ * in which case the task stages its changes in the thread stage. */
 void ecs_run_task(
     EcsWorld *world,
     EcsHandle system,
     float delta_time)
 {
+    EcsWorld *real_world = world;
+    ecs_get_stage(&real_world);
+
     EcsRowSystem *system_data = ecs_get_ptr(world, system, EcsRowSystem_h);
     assert(system_data != NULL);
 
@@ -209,7 +222,7 @@ void ecs_run_task(
         return;
     }
 
-    bool measure_time = world->measure_system_time;
+    bool measure_time = real_world->measure_system_time;
     struct timespec time_start;
     if (measure_time) {
         ut_time_get(&time_start);
@@ -387,3 +400,18 @@ void ecs_set_period(
         system_data->period = period;
     }
 }
+
+void ecs_set_skip_unchanged(
+    EcsWorld *world,
+    EcsHandle system,
+    bool skip_unchanged)
+{
+    assert(world->magic == ECS_WORLD_MAGIC);
+    EcsTableSystem *system_data = ecs_get_ptr(world, system, EcsTableSystem_h);
+    if (system_data) {
+        system_data->skip_unchanged = skip_unchanged;
+
+        /* Jobs of a system that skips tables are scheduled every frame */
+        world->valid_schedule = false;
+    }
+}
@@ -1,6 +1,140 @@
+#include <string.h>
 #include <assert.h>
 #include "include/private/reflecs.h"
 
+const EcsArrayParams dirty_arr_params = {
+    .element_size = sizeof(uint64_t)
+};
+
+const EcsArrayParams notify_arr_params = {
+    .element_size = sizeof(EcsTableNotify)
+};
+
+const EcsArrayParams sort_key_arr_params = {
+    .element_size = sizeof(EcsSortKey)
+};
+
+#define DIRTY_WORD(index) ((index) / 64)
+#define DIRTY_BIT(index) ((uint64_t)1 << ((index) % 64))
+
+/** Grow bitmap so that it has a bit for each row. New bits are cleared. */
+static
+void grow_bitmap(
+    EcsArray **bitmap,
+    uint32_t row_count)
+{
+    uint32_t word_count = DIRTY_WORD(row_count + 63);
+    uint32_t old_count = ecs_array_count(*bitmap);
+    if (old_count < word_count) {
+        ecs_array_set_count(bitmap, &dirty_arr_params, word_count);
+        memset(ecs_array_get(*bitmap, &dirty_arr_params, old_count),
+            0, sizeof(uint64_t) * (word_count - old_count));
+    }
+}
+
+/** Copy the bit of a row to another row */
+static
+void move_bit(
+    uint64_t *words,
+    uint32_t to,
+    uint32_t from)
+{
+    if (words[DIRTY_WORD(from)] & DIRTY_BIT(from)) {
+        words[DIRTY_WORD(to)] |= DIRTY_BIT(to);
+    } else {
+        words[DIRTY_WORD(to)] &= ~DIRTY_BIT(to);
+    }
+}
+
+/** Reorder the bits of a bitmap in the same way as the rows of a table */
+static
+void reorder_bitmap(
+    EcsArray *bitmap,
+    const uint32_t *order,
+    uint32_t count,
+    uint64_t *scratch)
+{
+    uint64_t *words = ecs_array_buffer(bitmap);
+    uint32_t i;
+
+    memcpy(scratch, words, sizeof(uint64_t) * DIRTY_WORD(count + 63));
+    for (i = 0; i < count; i ++) {
+        uint32_t from = order[i];
+        if (scratch[DIRTY_WORD(from)] & DIRTY_BIT(from)) {
+            words[DIRTY_WORD(i)] |= DIRTY_BIT(i);
+        } else {
+            words[DIRTY_WORD(i)] &= ~DIRTY_BIT(i);
+        }
+    }
+}
+
+/** Order sort keys by key, and by index for equal keys */
+static
+int compare_sort_key(
+    const void *p1,
+    const void *p2)
+{
+    const EcsSortKey *k1 = p1, *k2 = p2;
+
+    if (k1->key != k2->key) {
+        return k1->key < k2->key ? -1 : 1;
+    }
+
+    return (k1->index > k2->index) - (k1->index < k2->index);
+}
+
+/** Copy the dirty bits of a row that is moved to another row */
+static
+void move_dirty(
+    EcsTable *table,
+    uint32_t to,
+    uint32_t from)
+{
+    uint32_t i, count = ecs_array_count(table->family);
+    for (i = 0; i < count; i ++) {
+        EcsArray *bitmap = table->dirty[i];
+        if (!bitmap) {
+            continue;
+        }
+
+        move_bit(ecs_array_buffer(bitmap), to, from);
+    }
+}
+
+/** Clear the dirty bits of a row that no longer exists */
+static
+void clear_dirty(
+    EcsTable *table,
+    uint32_t index)
+{
+    uint32_t i, count = ecs_array_count(table->family);
+    for (i = 0; i < count; i ++) {
+        EcsArray *bitmap = table->dirty[i];
+        if (bitmap) {
+            uint64_t *words = ecs_array_buffer(bitmap);
+            words[DIRTY_WORD(index)] &= ~DIRTY_BIT(index);
+        }
+    }
+}
+
+/** Mark inserted rows as dirty for all tracked columns. Bitmaps are grown
+ * when rows are inserted, so that systems can mark rows without allocating. */
+static
+void insert_dirty(
+    EcsTable *table,
+    uint32_t first,
+    uint32_t count)
+{
+    uint32_t i, column_count = ecs_array_count(table->family);
+
+    for (i = 0; i < column_count; i ++) {
+        if (table->dirty[i]) {
+            grow_bitmap(&table->dirty[i], first + count);
+            ecs_table_set_dirty(table, i, first, count);
+        }
+    }
+}
+
 /** Callback that is invoked when a row is moved in the table->rows array */
 static
 void move_row(
@@ -11,13 +145,21 @@ void move_row(
     void *ctx)
 {
     EcsWorld *world = params->ctx;
-    uint32_t table_index = (uintptr_t)ctx;
-    EcsTable *table = ecs_array_get(
-        world->table_db, &table_arr_params, table_index);
+    EcsTable *table = ctx;
     uint32_t new_index = ecs_array_get_index(array, params, to);
     EcsHandle handle = *(EcsHandle*)to;
     EcsRow row = {.family_id = table->family_id, .index = new_index};
     ecs_map_set64(world->entity_index, handle, ecs_from_row(row));
+
+    uint32_t old_index = ecs_array_get_index(array, params, from);
+
+    if (table->dirty) {
+        move_dirty(table, new_index, old_index);
+    }
+
+    if (table->disabled) {
+        move_bit(ecs_array_buffer(table->disabled), new_index, old_index);
+    }
 }
 
 /** Notify systems that a table has changed its active state */
@@ -27,16 +169,164 @@ void activate_table(
     EcsTable *table,
     bool activate)
 {
-    EcsArray *systems = table->frame_systems;
-    if (systems) {
-        EcsIter it = ecs_array_iter(systems, &handle_arr_params);
-        while (ecs_iter_hasnext(&it)) {
-            EcsHandle system = *(EcsHandle*)ecs_iter_next(&it);
-            ecs_system_activate_table(world, system, table, activate);
+    uint32_t i, count = ecs_array_count(table->frame_systems);
+    for (i = 0; i < count; i ++) {
+        ecs_system_activate_table(world, table, i, activate);
+    }
+}
+
+/** Get the committed row of an entity. Worker threads cannot use the staged
+ * data of the main stage, as the main thread may modify it from its own job,
+ * whereas the entity index of the world is not modified while threads run. */
+static
+EcsRow committed_row(
+    EcsWorld *world,
+    EcsHandle entity)
+{
+    return ecs_to_row(ecs_map_get64(world->entity_index, entity));
+}
+
+/** Get a component of an entity that describes a column of a new table */
+static
+void* get_column_ptr(
+    EcsWorld *world,
+    EcsStage *stage,
+    EcsHandle entity,
+    EcsHandle component)
+{
+    if (!world->in_progress || !world->threads_running) {
+        return ecs_get_ptr(world, entity, component);
+    }
+
+    EcsRow row = committed_row(world, entity);
+    if (!row.family_id) {
+        return NULL;
+    }
+
+    EcsTable *table = ecs_world_get_table(world, stage, row.family_id);
+    uint32_t offset = ecs_table_column_offset(table, component);
+    if (offset == -1) {
+        return NULL;
+    }
+
+    return ECS_OFFSET(ecs_table_get(table, table->rows, row.index), offset);
+}
+
+/** Test if an entity that describes a column of a new table has a component */
+static
+bool column_has(
+    EcsWorld *world,
+    EcsStage *stage,
+    EcsHandle entity,
+    EcsHandle component)
+{
+    if (!world->in_progress || !world->threads_running) {
+        return ecs_has(world, entity, component);
+    }
+
+    EcsFamily family_id = committed_row(world, entity).family_id;
+    return family_id && ecs_family_contains_component(
+        world, stage, family_id, component);
+}
+
+/** Get the map with row systems for a kind, indexed by family */
+static
+EcsMap* notify_systems(
+    EcsWorld *world,
+    EcsSystemKind kind)
+{
+    if (kind == EcsOnAdd) {
+        return world->add_systems;
+    } else if (kind == EcsOnRemove) {
+        return world->remove_systems;
+    } else if (kind == EcsOnSet) {
+        return world->set_systems;
+    } else {
+        ecs_abort(ECS_INTERNAL_ERROR, 0);
+    }
+
+    return NULL;
+}
+
+/** Add row system to the systems notified for a table, and compute the
+ * offsets of its columns in the table rows */
+static
+void add_notify(
+    EcsWorld *world,
+    EcsTable *table,
+    EcsArray **notify,
+    EcsHandle system)
+{
+    EcsRowSystem *system_data = ecs_get_ptr(world, system, EcsRowSystem_h);
+    assert(system_data != NULL);
+
+    EcsSystemColumn *columns = ecs_array_buffer(system_data->base.columns);
+    EcsHandle *components = ecs_array_buffer(system_data->components);
+    uint32_t i, count = ecs_array_count(system_data->components);
+
+    EcsTableNotify *elem = ecs_array_add(notify, &notify_arr_params);
+    elem->system = system;
+    elem->columns = ecs_os_malloc(sizeof(int32_t) * count);
+
+    for (i = 0; i < count; i ++) {
+        int32_t offset = 0;
+        if (columns[i].kind != EcsFromHandle) {
+            offset = ecs_table_column_offset(table, components[i]);
+            if (offset == -1) {
+                offset = 0;
+            }
         }
+        elem->columns[i] = offset;
     }
 }
 
+/** Find row systems triggered by a family. A system that matches the family
+ * as a whole takes precedence over systems that match single components. */
+static
+EcsArray* new_notify(
+    EcsWorld *world,
+    EcsStage *stage,
+    EcsTable *table,
+    EcsMap *systems,
+    EcsFamily family_id)
+{
+    EcsArray *result = ecs_array_new(&notify_arr_params, 0);
+
+    EcsHandle system = ecs_map_get64(systems, family_id);
+    if (system) {
+        add_notify(world, table, &result, system);
+    } else {
+        EcsArray *family = ecs_family_get(world, stage, family_id);
+        EcsHandle *buffer = ecs_array_buffer(family);
+        uint32_t i, count = ecs_array_count(family);
+
+        for (i = 0; i < count; i ++) {
+            EcsFamily component_family = ecs_family_from_handle(
+                world, stage, buffer[i], NULL);
+
+            system = ecs_map_get64(systems, component_family);
+            if (system) {
+                add_notify(world, table, &result, system);
+            }
+        }
+    }
+
+    return result;
+}
+
+/** Free cached row systems, for example after a new row system is created */
+static
+void clear_notify_index(
+    EcsTable *table)
+{
+    EcsIter it = ecs_map_iter(table->notify_index);
+    while (ecs_iter_hasnext(&it)) {
+        ecs_table_free_notify(ecs_iter_next(&it));
+    }
+
+    ecs_map_clear(table->notify_index);
+}
+
 /* -- Private functions -- */
 
 EcsResult ecs_table_init_w_size(
@@ -47,10 +337,19 @@ EcsResult ecs_table_init_w_size(
 {
     table->family = family;
     table->frame_systems = NULL;
+    table->column_versions = ecs_os_calloc(
+        sizeof(uint64_t) * ecs_array_count(family));
+    table->rows_version = 0;
+    table->dirty = NULL;
+    table->disabled = NULL;
+    table->disabled_count = 0;
+    table->sort_version = 0;
+    table->notify_index = NULL;
+    table->notify_version = 0;
+    table->empty_since = world->frame_count;
     table->row_params.element_size = size + sizeof(EcsHandle);
     table->row_params.move_action = move_row;
-    table->row_params.move_ctx = (void*)(uintptr_t)ecs_array_get_index(
-        world->table_db, &table_arr_params, table);
+    table->row_params.move_ctx = table;
     table->row_params.ctx = world;
 
     table->rows = ecs_array_new(
@@ -72,22 +371,22 @@ EcsResult ecs_table_init(
     EcsIter it = ecs_array_iter(family, &handle_arr_params);
     uint32_t column = 0;
     uint32_t total_size = 0;
-    table->columns = malloc(sizeof(uint16_t) * ecs_array_count(family));
+    table->columns = ecs_os_malloc(sizeof(uint16_t) * ecs_array_count(family));
 
     while (ecs_iter_hasnext(&it)) {
         EcsHandle h = *(EcsHandle*)ecs_iter_next(&it);
-        EcsComponent *type = ecs_get_ptr(world, h, EcsComponent_h);
+        EcsComponent *type = get_column_ptr(world, stage, h, EcsComponent_h);
         uint32_t size = 0;
 
         if (type) {
             size = type->size;
         } else {
-            if (ecs_get_ptr(world, h, EcsPrefab_h)) {
+            if (get_column_ptr(world, stage, h, EcsPrefab_h)) {
                 assert_func(prefab_set == false);
                 ecs_map_set(world->prefab_index, table->family_id, h);
                 prefab_set = true;
                 size = 0;
-            } else if (ecs_has(world, h, EcsContainer_h)) {
+            } else if (column_has(world, stage, h, EcsContainer_h)) {
                 size = 0;
             } else {
                 /* Invalid entity handle in family */
@@ -103,9 +402,37 @@ EcsResult ecs_table_init(
 
     ecs_table_init_w_size(world, table, family, total_size);
 
+    if (world->dirty_family) {
+        EcsHandle *buffer = ecs_array_buffer(family);
+        uint32_t i, count = ecs_array_count(family);
+        for (i = 0; i < count; i ++) {
+            if (ecs_family_contains_component(
+                world, stage, world->dirty_family, buffer[i]))
+            {
+                ecs_table_track_dirty(table, i);
+            }
+        }
+    }
+
     return EcsOk;
 }
 
+/** Move rows of table to huge page memory if they exceed the threshold */
+static
+void check_huge_pages(
+    EcsWorld *world,
+    EcsTable *table)
+{
+    size_t threshold = world->huge_page_threshold;
+    if (threshold && !ecs_array_huge_size(table->rows)) {
+        size_t size = (size_t)ecs_array_size(table->rows) *
+            table->row_params.element_size;
+        if (size >= threshold) {
+            ecs_array_use_huge_pages(&table->rows, &table->row_params);
+        }
+    }
+}
+
 uint32_t ecs_table_insert(
     EcsWorld *world,
     EcsTable *table,
@@ -116,26 +443,184 @@ uint32_t ecs_table_insert(
     *(EcsHandle*)row = handle;
     uint32_t index = ecs_array_count(*rows) - 1;
 
-    if (!index && *rows == table->rows) {
+    if (*rows == table->rows) {
+        if (!index) {
+            activate_table(world, table, true);
+        }
+        check_huge_pages(world, table);
+        table->rows_version = ecs_world_next_version(world);
+
+        if (table->dirty) {
+            insert_dirty(table, index, 1);
+        }
+
+        if (table->disabled) {
+            grow_bitmap(&table->disabled, index + 1);
+        }
+    }
+
+    return index;
+}
+
+uint32_t ecs_table_grow(
+    EcsWorld *world,
+    EcsTable *table,
+    uint32_t count)
+{
+    uint32_t index = ecs_array_count(table->rows);
+    ecs_array_addn(&table->rows, &table->row_params, count);
+
+    if (!index && count) {
         activate_table(world, table, true);
     }
 
+    check_huge_pages(world, table);
+    table->rows_version = ecs_world_next_version(world);
+
+    if (table->dirty) {
+        insert_dirty(table, index, count);
+    }
+
+    if (table->disabled) {
+        grow_bitmap(&table->disabled, index + count);
+    }
+
     return index;
 }
 
+void ecs_table_dim(
+    EcsWorld *world,
+    EcsTable *table,
+    uint32_t count)
+{
+    ecs_array_set_size(&table->rows, &table->row_params, count);
+    check_huge_pages(world, table);
+}
+
 void ecs_table_delete(
     EcsWorld *world,
     EcsTable *table,
     uint32_t index)
 {
     if (!world->in_progress) {
+        if (!ecs_table_is_enabled(table, index)) {
+            table->disabled_count --;
+        }
+
         uint32_t count = ecs_array_remove_index(
             table->rows, &table->row_params, index);
 
         if (!count) {
             activate_table(world, table, false);
+            table->empty_since = world->frame_count;
+        }
+
+        table->rows_version = ecs_world_next_version(world);
+
+        /* The last row was moved to the deleted row, or was deleted */
+        if (table->dirty) {
+            clear_dirty(table, count);
+        }
+
+        if (table->disabled) {
+            uint64_t *words = ecs_array_buffer(table->disabled);
+            words[DIRTY_WORD(count)] &= ~DIRTY_BIT(count);
+        }
+
+        /* Return unused huge pages when table has shrunk significantly */
+        if (ecs_array_huge_size(table->rows) &&
+            count < ecs_array_size(table->rows) / 4)
+        {
+            ecs_array_reclaim(&table->rows, &table->row_params);
+        }
+    }
+}
+
+void ecs_table_reorder(
+    EcsWorld *world,
+    EcsTable *table,
+    const uint32_t *order)
+{
+    uint32_t i, count = ecs_array_count(table->rows);
+    uint32_t element_size = table->row_params.element_size;
+    char *buffer = ecs_array_buffer(table->rows);
+
+    if (!count) {
+        return;
+    }
+
+    char *copy = ecs_os_malloc(element_size * count);
+    memcpy(copy, buffer, element_size * count);
+
+    for (i = 0; i < count; i ++) {
+        if (order[i] == i) {
+            continue;
+        }
+
+        void *row = ECS_OFFSET(buffer, element_size * i);
+        memcpy(row, ECS_OFFSET(copy, element_size * order[i]), element_size);
+
+        EcsRow row_index = {.family_id = table->family_id, .index = i};
+        ecs_map_set64(
+            world->entity_index, *(EcsHandle*)row, ecs_from_row(row_index));
+    }
+
+    ecs_os_free(copy);
+
+    if (table->dirty || table->disabled) {
+        uint64_t *scratch = ecs_os_malloc(
+            sizeof(uint64_t) * DIRTY_WORD(count + 63));
+
+        if (table->dirty) {
+            uint32_t c, column_count = ecs_array_count(table->family);
+            for (c = 0; c < column_count; c ++) {
+                if (table->dirty[c]) {
+                    reorder_bitmap(table->dirty[c], order, count, scratch);
+                }
+            }
+        }
+
+        if (table->disabled) {
+            reorder_bitmap(table->disabled, order, count, scratch);
+        }
+
+        ecs_os_free(scratch);
+    }
+
+    table->rows_version = ecs_world_next_version(world);
+}
+
+bool ecs_table_sort(
+    EcsWorld *world,
+    EcsTable *table,
+    EcsArray *keys)
+{
+    EcsSortKey *buffer = ecs_array_buffer(keys);
+    uint32_t i, count = ecs_array_count(keys);
+    assert(count == ecs_array_count(table->rows));
+
+    for (i = 1; i < count; i ++) {
+        if (buffer[i - 1].key > buffer[i].key) {
+            break;
         }
     }
+
+    /* Tables that are already sorted are not written to */
+    if (i >= count) {
+        return false;
+    }
+
+    ecs_array_sort(keys, &sort_key_arr_params, compare_sort_key);
+
+    uint32_t *order = ecs_os_malloc(sizeof(uint32_t) * count);
+    for (i = 0; i < count; i ++) {
+        order[i] = buffer[i].index;
+    }
+
+    ecs_table_reorder(world, table, order);
+    ecs_os_free(order);
+
+    return true;
 }
 
 void* ecs_table_get(
@@ -165,12 +650,237 @@ uint32_t ecs_table_column_offset(
     return -1;
 }
 
+int32_t ecs_table_column_index(
+    EcsTable *table,
+    EcsHandle component)
+{
+    EcsHandle *buffer = ecs_array_buffer(table->family);
+    uint32_t i, count = ecs_array_count(table->family);
+
+    for (i = 0; i < count; i ++) {
+        if (buffer[i] == component) {
+            return i;
+        }
+    }
+
+    return -1;
+}
+
+void ecs_table_touch_column(
+    EcsWorld *world,
+    EcsTable *table,
+    EcsHandle component)
+{
+    int32_t column = ecs_table_column_index(table, component);
+    if (column != -1) {
+        table->column_versions[column] = ecs_world_next_version(world);
+    }
+}
+
+void ecs_table_track_dirty(
+    EcsTable *table,
+    uint32_t column)
+{
+    if (!table->dirty) {
+        table->dirty = ecs_os_calloc(
+            sizeof(EcsArray*) * ecs_array_count(table->family));
+    }
+
+    if (!table->dirty[column]) {
+        uint32_t word_count = DIRTY_WORD(ecs_array_count(table->rows) + 63);
+        table->dirty[column] = ecs_array_new(&dirty_arr_params, word_count);
+        ecs_array_set_count(&table->dirty[column], &dirty_arr_params, word_count);
+        memset(ecs_array_buffer(table->dirty[column]), 0,
+            sizeof(uint64_t) * word_count);
+    }
+}
+
+/** Rows can be marked by multiple worker threads that process different rows
+ * of the same table, so bits are set atomically */
+void ecs_table_set_dirty(
+    EcsTable *table,
+    int32_t column,
+    uint32_t first,
+    uint32_t count)
+{
+    if (column == -1 || !table->dirty || !table->dirty[column] || !count) {
+        return;
+    }
+
+    uint64_t *words = ecs_array_buffer(table->dirty[column]);
+    uint32_t index = first, last = first + count;
+
+    while (index < last) {
+        uint32_t word = DIRTY_WORD(index);
+        uint32_t word_last = (word + 1) * 64;
+        if (word_last > last) {
+            word_last = last;
+        }
+
+        uint64_t mask;
+        if (word_last - index == 64) {
+            mask = UINT64_MAX;
+        } else {
+            mask = (DIRTY_BIT(word_last - index) - 1) << (index % 64);
+        }
+
+        __atomic_or_fetch(&words[word], mask, __ATOMIC_RELAXED);
+        index = word_last;
+    }
+}
+
+/** Rows can be enabled or disabled by worker threads that merge entities into
+ * different tables, so bits and counts are updated atomically */
+void ecs_table_set_enabled(
+    EcsTable *table,
+    uint32_t index,
+    bool enabled)
+{
+    if (!table->disabled) {
+        if (enabled) {
+            return;
+        }
+
+        EcsArray *bitmap = ecs_array_new(&dirty_arr_params, 0);
+        grow_bitmap(&bitmap, ecs_array_count(table->rows));
+        __atomic_store_n(&table->disabled, bitmap, __ATOMIC_RELEASE);
+    }
+
+    uint64_t *words = ecs_array_buffer(table->disabled);
+    uint64_t bit = DIRTY_BIT(index);
+
+    if (enabled) {
+        uint64_t old = __atomic_fetch_and(
+            &words[DIRTY_WORD(index)], ~bit, __ATOMIC_RELAXED);
+        if (old & bit) {
+            __atomic_sub_fetch(&table->disabled_count, 1, __ATOMIC_RELEASE);
+        }
+    } else {
+        uint64_t old = __atomic_fetch_or(
+            &words[DIRTY_WORD(index)], bit, __ATOMIC_RELAXED);
+        if (!(old & bit)) {
+            __atomic_add_fetch(&table->disabled_count, 1, __ATOMIC_RELEASE);
+        }
+    }
+}
+
+bool ecs_table_is_enabled(
+    EcsTable *table,
+    uint32_t index)
+{
+    if (!__atomic_load_n(&table->disabled_count, __ATOMIC_ACQUIRE)) {
+        return true;
+    }
+
+    uint64_t *words = ecs_array_buffer(table->disabled);
+    uint64_t word = __atomic_load_n(
+        &words[DIRTY_WORD(index)], __ATOMIC_RELAXED);
+
+    return !(word & DIRTY_BIT(index));
+}
+
+uint32_t ecs_table_enabled_run(
+    EcsTable *table,
+    uint32_t *first,
+    uint32_t last)
+{
+    uint32_t index = *first;
+
+    if (!table->disabled_count) {
+        return index < last ? last - index : 0;
+    }
+
+    uint64_t *words = ecs_array_buffer(table->disabled);
+
+    while (index < last && (words[DIRTY_WORD(index)] & DIRTY_BIT(index))) {
+        index ++;
+    }
+
+    *first = index;
+
+    /* Words without disabled rows are skipped at once */
+    while (index < last) {
+        uint64_t word = words[DIRTY_WORD(index)];
+        if (!(index % 64) && !word) {
+            index += 64;
+        } else if (word & DIRTY_BIT(index)) {
+            break;
+        } else {
+            index ++;
+        }
+    }
+
+    if (index > last) {
+        index = last;
+    }
+
+    return index - *first;
+}
+
+EcsArray* ecs_table_get_notify(
+    EcsWorld *world,
+    EcsStage *stage,
+    EcsTable *table,
+    EcsSystemKind kind,
+    EcsFamily family_id,
+    bool *must_free)
+{
+    uint64_t key = ((uint64_t)kind << 32) | family_id;
+    bool is_valid = table->notify_index &&
+        table->notify_version == world->notify_version;
+
+    if (is_valid) {
+        EcsArray *notify = ecs_map_get(table->notify_index, key);
+        if (notify) {
+            *must_free = false;
+            return notify;
+        }
+    }
+
+    EcsArray *notify = new_notify(
+        world, stage, table, notify_systems(world, kind), family_id);
+
+    /* Worker threads may notify the same table, so only cache the result when
+     * no other threads can access the table */
+    if (world->in_progress && world->threads_running) {
+        *must_free = true;
+        return notify;
+    }
+
+    if (!table->notify_index) {
+        table->notify_index = ecs_map_new(ECS_TABLE_INITIAL_NOTIFY_COUNT);
+    } else if (!is_valid) {
+        clear_notify_index(table);
+    }
+
+    table->notify_version = world->notify_version;
+    ecs_map_set(table->notify_index, key, notify);
+    *must_free = false;
+
+    return notify;
+}
+
+void ecs_table_free_notify(
+    EcsArray *notify)
+{
+    EcsTableNotify *buffer = ecs_array_buffer(notify);
+    uint32_t i, count = ecs_array_count(notify);
+    for (i = 0; i < count; i ++) {
+        ecs_os_free(buffer[i].columns);
+    }
+
+    ecs_array_free(notify);
+}
+
 void ecs_table_deinit(
     EcsWorld *world,
     EcsTable *table)
 {
-    ecs_notify(world, NULL,
-        world->remove_systems, table->family_id, table, table->rows, -1);
+    uint32_t count = ecs_array_count(table->rows);
+    if (count) {
+        ecs_notify(world, NULL, EcsOnRemove, table->family_id, table,
+            table->rows, 0, count);
+    }
 }
 
 void ecs_table_free(
@@ -179,5 +889,21 @@ void ecs_table_free(
 {
     ecs_array_free(table->rows);
     if (table->frame_systems) ecs_array_free(table->frame_systems);
-    free(table->columns);
+    ecs_os_free(table->columns);
+    ecs_os_free(table->column_versions);
+
+    if (table->dirty) {
+        uint32_t i, count = ecs_array_count(table->family);
+        for (i = 0; i < count; i ++) {
+            ecs_array_free(table->dirty[i]);
+        }
+        ecs_os_free(table->dirty);
+    }
+
+    ecs_array_free(table->disabled);
+
+    if (table->notify_index) {
+        clear_notify_index(table);
+        ecs_map_free(table->notify_index);
+    }
 }
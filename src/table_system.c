@@ -1,4 +1,6 @@
+#include <stdlib.h>
 #include <string.h>
+#include <stddef.h>
 #include <assert.h>
 #include "include/private/reflecs.h"
 #include "include/util/time.h"
@@ -7,6 +9,18 @@ const EcsArrayParams column_arr_params = {
     .element_size = sizeof(EcsSystemColumn)
 };
 
+const EcsArrayParams matched_system_arr_params = {
+    .element_size = sizeof(EcsMatchedSystem)
+};
+
+const EcsArrayParams filter_table_arr_params = {
+    .element_size = sizeof(EcsFilterTable)
+};
+
+const EcsArrayParams query_arr_params = {
+    .element_size = sizeof(EcsQuery*)
+};
+
 static
 void compute_and_families(
     EcsWorld *world,
@@ -97,18 +111,201 @@ bool components_contains_component(
     return false;
 }
 
-/* Special indexes in table_data array */
-#define TABLE_INDEX (0)
-#define REFS_INDEX (1)
-#define HANDLES_INDEX (2)
-#define OFFSETS_INDEX (3)
+/** Callback that is invoked when a record is moved in the tables or
+ * inactive_tables array of a system. Updates the index of the record that is
+ * stored by the table, so tables can be (de)activated without a lookup. */
+static
+void move_table_data(
+    EcsArray *array,
+    const EcsArrayParams *params,
+    void *to,
+    void *from,
+    void *ctx)
+{
+    EcsSystemTable *table_data = to;
+    EcsMatchedSystem *match = ecs_array_get(
+        table_data->table->frame_systems, &matched_system_arr_params,
+        table_data->match_index);
+    match->index = ecs_array_get_index(array, params, to);
+}
+
+/** Get the data of the table system or query of a table match */
+static
+EcsTableSystem* get_match_data(
+    EcsWorld *world,
+    EcsMatchedSystem *match)
+{
+    if (match->query) {
+        return match->query;
+    } else {
+        return ecs_get_ptr(world, match->system, EcsTableSystem_h);
+    }
+}
+
+/** Remove a match from the frame_systems array of a table. The last match is
+ * moved into its slot, so the records of the system of the moved match are
+ * updated to point to the new slot. */
+static
+void remove_match(
+    EcsWorld *world,
+    EcsTable *table,
+    uint32_t match_index)
+{
+    EcsMatchedSystem *buffer = ecs_array_buffer(table->frame_systems);
+    uint32_t last = ecs_array_count(table->frame_systems) - 1;
+
+    if (match_index != last) {
+        EcsMatchedSystem *match = &buffer[last];
+        EcsTableSystem *system_data = get_match_data(world, match);
+        EcsArray *array = ecs_array_count(table->rows)
+            ? system_data->tables
+            : system_data->inactive_tables;
+
+        EcsSystemTable *table_data = ecs_array_get(
+            array, &system_data->table_params, match->index);
+        table_data->match_index = match_index;
+
+        if (system_data->filters) {
+            EcsIter it = ecs_map_iter(system_data->filters);
+            while (ecs_iter_hasnext(&it)) {
+                EcsSystemFilter *filter = ecs_iter_next(&it);
+                EcsFilterTable *elem = ecs_array_buffer(filter->tables);
+                uint32_t i, count = ecs_array_count(filter->tables);
+                for (i = 0; i < count; i ++) {
+                    if (elem[i].table == table) {
+                        elem[i].match_index = match_index;
+                    }
+                }
+            }
+        }
+    }
+
+    ecs_array_remove_index(
+        table->frame_systems, &matched_system_arr_params, match_index);
+}
+
+/** Add an active table to the cached filters that it matches */
+static
+void filter_add_table(
+    EcsWorld *world,
+    EcsTableSystem *system_data,
+    EcsTable *table,
+    uint32_t match_index)
+{
+    if (!system_data->filters) {
+        return;
+    }
+
+    EcsIter it = ecs_map_iter(system_data->filters);
+    while (ecs_iter_hasnext(&it)) {
+        EcsSystemFilter *filter = ecs_iter_next(&it);
+        if (ecs_family_contains(
+            world, NULL, table->family_id, filter->filter_id, true, true))
+        {
+            EcsFilterTable *elem = ecs_array_add(
+                &filter->tables, &filter_table_arr_params);
+            elem->table = table;
+            elem->match_index = match_index;
+        }
+    }
+}
+
+/** Remove a table that is no longer active from the cached filters */
+static
+void filter_remove_table(
+    EcsTableSystem *system_data,
+    EcsTable *table)
+{
+    if (!system_data->filters) {
+        return;
+    }
+
+    EcsIter it = ecs_map_iter(system_data->filters);
+    while (ecs_iter_hasnext(&it)) {
+        EcsSystemFilter *filter = ecs_iter_next(&it);
+        EcsFilterTable *buffer = ecs_array_buffer(filter->tables);
+        uint32_t i, count = ecs_array_count(filter->tables);
+        for (i = 0; i < count; i ++) {
+            if (buffer[i].table == table) {
+                ecs_array_remove_index(
+                    filter->tables, &filter_table_arr_params, i);
+                break;
+            }
+        }
+    }
+}
+
+/** Get the active tables of a system that match a filter. The tables are
+ * cached per filter, and are updated when tables are (de)activated, so that
+ * a filtered run does not need to evaluate the filter for every table. Returns
+ * NULL if the filter is not cached and worker threads are running, as the
+ * cache cannot be modified while other threads may read it. */
+static
+EcsSystemFilter* get_filter(
+    EcsWorld *world,
+    EcsTableSystem *system_data,
+    EcsHandle filter)
+{
+    if (system_data->filters) {
+        EcsSystemFilter *result = ecs_map_get(system_data->filters, filter);
+        if (result) {
+            return result;
+        }
+    } else if (!(world->in_progress && world->threads_running)) {
+        system_data->filters = ecs_map_new(ECS_SYSTEM_INITIAL_FILTER_COUNT);
+    }
+
+    if (world->in_progress && world->threads_running) {
+        return NULL;
+    }
+
+    EcsSystemFilter *result = ecs_os_malloc(sizeof(EcsSystemFilter));
+    result->filter_id = ecs_family_from_handle(world, NULL, filter, NULL);
+    result->tables = ecs_array_new(&filter_table_arr_params, 0);
+
+    EcsSystemTable *table_buffer = ecs_array_buffer(system_data->tables);
+    uint32_t element_size = system_data->table_params.element_size;
+    uint32_t i, count = ecs_array_count(system_data->tables);
+
+    for (i = 0; i < count; i ++) {
+        EcsTable *table = table_buffer->table;
+        if (ecs_family_contains(
+            world, NULL, table->family_id, result->filter_id, true, true))
+        {
+            EcsFilterTable *elem = ecs_array_add(
+                &result->tables, &filter_table_arr_params);
+            elem->table = table;
+            elem->match_index = table_buffer->match_index;
+        }
+        table_buffer = ECS_OFFSET(table_buffer, element_size);
+    }
+
+    ecs_map_set(system_data->filters, filter, result);
+
+    return result;
+}
+
+/** Get the record of a system for a table in a cached filter */
+static
+EcsSystemTable* get_filter_table_data(
+    EcsTableSystem *system_data,
+    EcsSystemFilter *filter,
+    uint32_t index)
+{
+    EcsFilterTable *elem = ecs_array_get(
+        filter->tables, &filter_table_arr_params, index);
+    EcsMatchedSystem *match = ecs_array_get(elem->table->frame_systems,
+        &matched_system_arr_params, elem->match_index);
+    return ecs_array_get(
+        system_data->tables, &system_data->table_params, match->index);
+}
 
 /* Get ref array for system table */
 static
 EcsSystemRef* get_ref_data(
     EcsWorld *world,
     EcsTableSystem *system_data,
-    int32_t *table_data)
+    EcsSystemTable *table_data)
 {
     EcsSystemRef *ref_data = NULL;
 
@@ -116,13 +313,13 @@ EcsSystemRef* get_ref_data(
         system_data->refs = ecs_array_new(&system_data->ref_params, 1);
     }
 
-    if (!table_data[REFS_INDEX]) {
+    if (!table_data->refs_index) {
         ref_data = ecs_array_add(
             &system_data->refs, &system_data->ref_params);
-        table_data[REFS_INDEX] = ecs_array_count(system_data->refs);
+        table_data->refs_index = ecs_array_count(system_data->refs);
     } else {
-        ref_data = ecs_array_get(
-            system_data->refs, &system_data->ref_params, table_data[1] - 1);
+        ref_data = ecs_array_get(system_data->refs, &system_data->ref_params,
+            table_data->refs_index - 1);
     }
 
     return ref_data;
@@ -174,21 +371,25 @@ void add_table(
     EcsTableSystem *system_data,
     EcsTable *table)
 {
-    int32_t *table_data;
+    EcsSystemTable *table_data;
     EcsSystemRef *ref_data = NULL;
     EcsFamily table_family = table->family_id;
-    uint32_t i = OFFSETS_INDEX;
+    uint32_t i = 0;
     uint32_t ref = 0;
     uint32_t column_count = ecs_array_count(system_data->base.columns);
 
+    EcsArray *array;
+
     /* If the table is empty, add it to the inactive array, so it is skipped
      * when the system is evaluated */
     if (ecs_array_count(table->rows)) {
         table_data = ecs_array_add(
             &system_data->tables, &system_data->table_params);
+        array = system_data->tables;
     } else {
         table_data = ecs_array_add(
             &system_data->inactive_tables, &system_data->table_params);
+        array = system_data->inactive_tables;
     }
 
     /* Add element to array that contains components for this table. Tables
@@ -198,15 +399,24 @@ void add_table(
     EcsHandle *component_data = ecs_array_add(
         &system_data->components, &system_data->component_params);
 
-    /* Table index is at element 0 */
-    table_data[TABLE_INDEX] = ecs_array_get_index(
-        world->table_db, &table_arr_params, table);
+    /* Tables are address-stable, so the system can store a pointer */
+    table_data->table = table;
+
+    /* Index in ref array (0 means no refs) */
+    table_data->refs_index = 0;
 
-    /* Index in ref array is at element 1 (0 means no refs) */
-    table_data[REFS_INDEX] = 0;
+    /* Index in components array */
+    table_data->components_index =
+        ecs_array_count(system_data->components) - 1;
 
-    /* Index in components array is at element 2 */
-    table_data[HANDLES_INDEX] = ecs_array_count(system_data->components) - 1;
+    /* Index in frame_systems array of table */
+    table_data->match_index = ecs_array_count(table->frame_systems);
+
+    /* Table has not been processed by system */
+    table_data->version = 0;
+
+    /* Indexes of columns in table follow the column offsets */
+    int32_t *column_indexes = &table_data->columns[column_count];
 
     /* Walk columns parsed from the system signature */
     EcsIter it = ecs_array_iter(system_data->base.columns, &column_arr_params);
@@ -234,7 +444,7 @@ void add_table(
         /* Column that just passes a handle to the system (no data) */
         } else if (column->kind == EcsFromHandle) {
             component = column->is.component;
-            table_data[i] = 0;
+            table_data->columns[i] = 0;
 
         /* Column that retrieves data from a component */
         } else if (column->kind == EcsFromComponent) {
@@ -269,20 +479,20 @@ void add_table(
         if (!entity && column->kind != EcsFromHandle) {
             if (component) {
                 /* Retrieve offset for component */
-                table_data[i] = ecs_table_column_offset(table, component);
+                table_data->columns[i] = ecs_table_column_offset(table, component);
 
                 /* ecs_table_column_offset may return -1 if the component comes
                  * from a prefab. If so, the component will be resolved as a
                  * reference (see below) */
             } else {
                 /* Columns with a NOT expression have no data */
-                table_data[i] = 0;
+                table_data->columns[i] = 0;
             }
         }
 
         /* If entity is set, or component is not found in table, add it as a ref
          * to data of a specific entity. */
-        if (entity || table_data[i] == -1) {
+        if (entity || table_data->columns[i] == -1) {
             if (!ref_data) {
                 ref_data = get_ref_data(world, system_data, table_data);
             }
@@ -295,11 +505,18 @@ void add_table(
             ref ++;
 
             /* Negative number indicates ref instead of offset to ecs_column */
-            table_data[i] = -ref;
+            table_data->columns[i] = -ref;
+        }
+
+        /* Only columns stored in the table have a change version */
+        if (table_data->columns[i] > 0) {
+            column_indexes[i] = ecs_table_column_index(table, component);
+        } else {
+            column_indexes[i] = -1;
         }
 
         /* component_data index is not offset by anything */
-        component_data[i - OFFSETS_INDEX] = component;
+        component_data[i] = component;
 
         i ++;
     }
@@ -309,8 +526,17 @@ void add_table(
     }
 
     /* Register system with the table */
-    EcsHandle *h = ecs_array_add(&table->frame_systems, &handle_arr_params);;
-    if (h) *h = system;
+    EcsMatchedSystem *match = ecs_array_add(
+        &table->frame_systems, &matched_system_arr_params);
+    match->system = system;
+    match->query = system ? NULL : system_data;
+    match->index = ecs_array_get_index(
+        array, &system_data->table_params, table_data);
+
+    if (array == system_data->tables) {
+        filter_add_table(
+            world, system_data, table, table_data->match_index);
+    }
 }
 
 /* Match table with system */
@@ -399,9 +625,15 @@ void match_tables(
     EcsHandle system,
     EcsTableSystem *system_data)
 {
-    EcsIter it = ecs_array_iter(world->table_db, &table_arr_params);
-    while (ecs_iter_hasnext(&it)) {
-        EcsTable *table = ecs_iter_next(&it);
+    uint32_t i, count = world->table_count;
+    for (i = 0; i < count; i ++) {
+        EcsTable *table = ecs_world_table(world, i);
+
+        /* Skip slots of tables that were collected */
+        if (!table->family_id) {
+            continue;
+        }
+
         if (match_table(world, stage, table, system, system_data)) {
             add_table(world, stage, system, system_data, table);
         }
@@ -434,8 +666,296 @@ void resolve_refs(
 }
 
 
+/** Test if the inputs of a system changed since the system last processed a
+ * table. Inserted or deleted rows count as a change of every column. */
+static
+bool table_changed(
+    EcsTableSystem *system_data,
+    EcsSystemTable *table_data,
+    uint32_t column_count)
+{
+    EcsTable *table = table_data->table;
+    uint64_t version = table_data->version;
+
+    if (table->rows_version > version) {
+        return true;
+    }
+
+    EcsSystemColumn *columns = ecs_array_buffer(system_data->base.columns);
+    int32_t *column_indexes = &table_data->columns[column_count];
+    uint32_t i;
+
+    for (i = 0; i < column_count; i ++) {
+        int32_t index = column_indexes[i];
+        if (index != -1 && columns[i].inout_kind != EcsOut) {
+            if (table->column_versions[index] > version) {
+                return true;
+            }
+        }
+    }
+
+    return false;
+}
+
+/** Mark the columns a system can write to as changed for a processed table */
+static
+void touch_columns(
+    EcsTableSystem *system_data,
+    EcsSystemTable *table_data,
+    uint32_t column_count,
+    uint64_t version)
+{
+    EcsTable *table = table_data->table;
+    EcsSystemColumn *columns = ecs_array_buffer(system_data->base.columns);
+    int32_t *column_indexes = &table_data->columns[column_count];
+    uint32_t i;
+
+    for (i = 0; i < column_count; i ++) {
+        int32_t index = column_indexes[i];
+        if (index != -1 && columns[i].inout_kind != EcsIn) {
+            table->column_versions[index] = version;
+        }
+    }
+}
+
+/** Get array that marks tables of system to run, initialized to value */
+/** Invoke system action for rows [first, first + count) of a table. If the
+ * table has disabled rows, the action is invoked for each run of enabled
+ * rows. */
+static
+void run_rows(
+    EcsTable *table,
+    EcsRows *info,
+    EcsSystemAction action,
+    uint32_t first,
+    uint32_t count)
+{
+    uint32_t element_size = table->row_params.element_size;
+
+    if (!table->disabled_count) {
+        info->first = ecs_table_get(table, table->rows, first);
+        info->last = ECS_OFFSET(info->first, element_size * count);
+        action(info);
+        return;
+    }
+
+    uint32_t run, last = first + count;
+    while ((run = ecs_table_enabled_run(table, &first, last))) {
+        info->first = ecs_table_get(table, table->rows, first);
+        info->last = ECS_OFFSET(info->first, element_size * run);
+        action(info);
+
+        if (info->interrupted_by) {
+            break;
+        }
+
+        /* The action may have deleted rows */
+        first += run;
+        if (last > ecs_array_count(table->rows)) {
+            last = ecs_array_count(table->rows);
+        }
+    }
+}
+
+static
+bool* get_filtered(
+    EcsTableSystem *system_data,
+    bool value)
+{
+    EcsArrayParams params = {.element_size = sizeof(bool)};
+    uint32_t count = ecs_array_count(system_data->tables);
+
+    if (!system_data->filtered) {
+        system_data->filtered = ecs_array_new(&params, count);
+    }
+
+    ecs_array_set_count(&system_data->filtered, &params, count);
+    bool *filtered = ecs_array_buffer(system_data->filtered);
+    memset(filtered, value, sizeof(bool) * count);
+
+    return filtered;
+}
+
+/** Mark the tables of a system that match a filter. The result is passed to
+ * the jobs of a parallel run, so that worker threads do not have to evaluate
+ * the filter. */
+static
+bool* filter_tables(
+    EcsWorld *world,
+    EcsTableSystem *system_data,
+    EcsHandle filter)
+{
+    if (!filter) {
+        return NULL;
+    }
+
+    EcsSystemFilter *cached = get_filter(world, system_data, filter);
+    assert(cached != NULL);
+
+    bool *filtered = get_filtered(system_data, false);
+    uint32_t i, count = ecs_array_count(cached->tables);
+
+    for (i = 0; i < count; i ++) {
+        EcsFilterTable *elem = ecs_array_get(
+            cached->tables, &filter_table_arr_params, i);
+        EcsMatchedSystem *match = ecs_array_get(elem->table->frame_systems,
+            &matched_system_arr_params, elem->match_index);
+        filtered[match->index] = true;
+    }
+
+    return filtered;
+}
+
+/** Start running a system on the worker threads. Returns false if the system
+ * could not be ran on the worker threads, in which case the run must be
+ * executed on the calling thread. */
+static
+bool start_run(
+    EcsWorld *world,
+    EcsHandle system,
+    float delta_time,
+    EcsHandle filter,
+    void *param,
+    uint32_t first_thread)
+{
+    if (world->magic != ECS_WORLD_MAGIC || world->in_progress ||
+        world->active_threads <= first_thread)
+    {
+        return false;
+    }
+
+    EcsSystemRun *run = &world->system_run;
+    EcsTableSystem *system_data = ecs_get_ptr(world, system, EcsTableSystem_h);
+    assert(system_data != NULL);
+    assert(!run->system);
+
+    run->world = world;
+    run->system = system;
+    run->system_data = NULL;
+    run->interrupted_by = 0;
+
+    if (!system_data->base.enabled) {
+        return true;
+    }
+
+    float system_delta_time;
+    if (!ecs_system_period_passed(system_data, delta_time, &system_delta_time)) {
+        return true;
+    }
+
+    if (world->measure_system_time) {
+        ut_time_get(&run->start);
+    }
+
+    bool *filtered = filter_tables(world, system_data, filter);
+    filtered = ecs_system_prepare_tables(world, system_data, filtered, 0);
+
+    run->system_data = system_data;
+    world->in_progress = true;
+    ecs_schedule_jobs(world, system, filtered, first_thread);
+    ecs_assign_jobs(world, system_data, system_delta_time, param);
+    ecs_start_jobs(world);
+
+    /* The jobs of the system replace the jobs scheduled for the frame */
+    world->valid_schedule = false;
+
+    return true;
+}
+
+/** Wait for the worker threads to finish a run, and merge the stages */
+static
+EcsHandle wait_run(
+    EcsSystemRun *run)
+{
+    EcsWorld *world = run->world;
+    EcsTableSystem *system_data = run->system_data;
+    EcsHandle interrupted_by = run->interrupted_by;
+
+    run->system = 0;
+
+    /* System was not ran because it was disabled or its period had not
+     * passed, or it was ran on the calling thread */
+    if (!system_data) {
+        return interrupted_by;
+    }
+
+    ecs_wait_jobs(world);
+
+    EcsJob *jobs = ecs_array_buffer(system_data->jobs);
+    uint32_t i, count = ecs_array_count(system_data->jobs);
+    for (i = 0; i < count; i ++) {
+        if (jobs[i].interrupted_by) {
+            interrupted_by = jobs[i].interrupted_by;
+            break;
+        }
+    }
+
+    if (world->measure_system_time) {
+        system_data->base.time_spent += ut_time_measure(&run->start);
+    }
+
+    world->in_progress = false;
+
+    if (world->auto_merge) {
+        ecs_merge(world);
+    }
+
+    return interrupted_by;
+}
+
 /* -- Private functions -- */
 
+/** Prepare the tables of a system for a run on worker threads. Worker threads
+ * do not update change versions, so the tables that will be processed are
+ * marked as changed before the run. If the system skips unchanged tables, they
+ * are removed from filtered, which is allocated if it was NULL.
+ *
+ * The seen version is stored for processed tables. When other systems run at
+ * the same time, it must be lower than the versions these systems write, so
+ * that their writes are detected. If it is 0, the version written by this
+ * system is used, so that the system does not detect its own writes. */
+bool* ecs_system_prepare_tables(
+    EcsWorld *world,
+    EcsTableSystem *system_data,
+    bool *filtered,
+    uint64_t seen)
+{
+    uint32_t element_size = system_data->table_params.element_size;
+    uint32_t column_count = ecs_array_count(system_data->base.columns);
+    uint32_t i, count = ecs_array_count(system_data->tables);
+    EcsSystemTable *table_buffer = ecs_array_buffer(system_data->tables);
+    bool skip_unchanged = system_data->skip_unchanged;
+    uint64_t version = ecs_world_next_version(world);
+
+    if (!seen) {
+        seen = version;
+    }
+
+    if (skip_unchanged && !filtered) {
+        filtered = get_filtered(system_data, true);
+    }
+
+    for (i = 0; i < count; i ++) {
+        EcsSystemTable *table_data = ECS_OFFSET(table_buffer, element_size * i);
+
+        if (filtered && !filtered[i]) {
+            continue;
+        }
+
+        if (skip_unchanged) {
+            if (!table_changed(system_data, table_data, column_count)) {
+                filtered[i] = false;
+                continue;
+            }
+        }
+
+        touch_columns(system_data, table_data, column_count, version);
+        table_data->version = seen;
+    }
+
+    return filtered;
+}
+
 /** Match new table against system (table is created after system) */
 EcsResult ecs_system_notify_create_table(
     EcsWorld *world,
@@ -455,21 +975,34 @@ EcsResult ecs_system_notify_create_table(
     return EcsOk;
 }
 
+/** Match new table against query (table is created after query) */
+void ecs_query_notify_create_table(
+    EcsWorld *world,
+    EcsStage *stage,
+    EcsQuery *query,
+    EcsTable *table)
+{
+    EcsTableSystem *system_data = &query->system_data;
+    if (match_table(world, stage, table, 0, system_data)) {
+        add_table(world, stage, 0, system_data, table);
+    }
+}
+
 /** Table activation happens when a table was or becomes empty. Deactivated
  * tables are not considered by the system in the main loop. */
 void ecs_system_activate_table(
     EcsWorld *world,
-    EcsHandle system,
     EcsTable *table,
+    uint32_t match_index,
     bool active)
 {
     EcsArray *src_array, *dst_array;
-    EcsTableSystem *system_data = ecs_get_ptr(world, system, EcsTableSystem_h);
+    EcsMatchedSystem *match = ecs_array_get(
+        table->frame_systems, &matched_system_arr_params, match_index);
+    EcsHandle system = match->system;
+    EcsTableSystem *system_data = get_match_data(world, match);
     EcsSystemKind kind = system_data->base.kind;
 
-    uint32_t table_index = ecs_array_get_index(
-        world->table_db, &table_arr_params, table);
-
     if (active) {
         src_array = system_data->inactive_tables;
         dst_array = system_data->tables;
@@ -478,20 +1011,18 @@ void ecs_system_activate_table(
         dst_array = system_data->inactive_tables;
     }
 
-    uint32_t count = ecs_array_count(src_array);
-    int i;
-    for (i = 0; i < count; i ++) {
-        uint32_t *index = ecs_array_get(
-            src_array, &system_data->table_params, i);
-        if (*index == table_index) {
-            break;
-        }
+    if (!active) {
+        filter_remove_table(system_data, table);
     }
 
-    assert(i != count);
-
     uint32_t src_count = ecs_array_move_index(
-        &dst_array, src_array, &system_data->table_params, i);
+        &dst_array, src_array, &system_data->table_params, match->index);
+
+    match->index = ecs_array_count(dst_array) - 1;
+
+    if (active) {
+        filter_add_table(world, system_data, table, match_index);
+    }
 
     if (active) {
         uint32_t dst_count = ecs_array_count(dst_array);
@@ -513,82 +1044,252 @@ void ecs_system_activate_table(
     }
 }
 
-/** Run subset of the matching entities for a system (used in worker threads) */
-void ecs_run_job(
-    EcsWorld *world,
-    EcsThread *thread,
-    EcsJob *job)
+/** Find record in a table array of a system for which the member at the
+ * specified offset has the specified value. */
+static
+int32_t* find_table_data(
+    EcsArray *array,
+    EcsArrayParams *params,
+    size_t member,
+    int32_t value)
 {
-    EcsHandle system = job->system;
-    EcsTableSystem *system_data = job->system_data;
-    EcsSystemAction action = system_data->base.action;
-    uint32_t table_element_size = system_data->table_params.element_size;
-    uint32_t component_element_size =
-      system_data->component_params.element_size;
-    uint32_t table_index = job->table_index;
-    uint32_t start_index = job->start_index;
-    uint32_t remaining = job->row_count;
-    uint32_t column_count = ecs_array_count(system_data->base.columns);
-    void *refs_data[column_count];
+    EcsIter it = ecs_array_iter(array, params);
+    while (ecs_iter_hasnext(&it)) {
+        int32_t *ptr = ECS_OFFSET(ecs_iter_next(&it), member);
+        if (*ptr == value) {
+            return ptr;
+        }
+    }
+
+    return NULL;
+}
+
+/** Remove element from the components or refs array of a system by moving the
+ * last element into its slot. The record that pointed to the last element is
+ * updated to point to the new slot. */
+static
+void remove_table_element(
+    EcsTableSystem *system_data,
+    EcsArray *array,
+    EcsArrayParams *params,
+    size_t member,
+    int32_t index,
+    int32_t base)
+{
+    int32_t last = ecs_array_count(array) - 1 + base;
+
+    if (index != last) {
+        int32_t *ptr = find_table_data(
+            system_data->tables, &system_data->table_params, member, last);
+        if (!ptr) {
+            ptr = find_table_data(system_data->inactive_tables,
+                &system_data->table_params, member, last);
+        }
+
+        assert(ptr != NULL);
+        *ptr = index;
+    }
+
+    ecs_array_remove_index(array, params, index - base);
+}
+
+/** Remove a table from a system. This happens when a table is collected by the
+ * garbage collector. The table is typically inactive, as only empty tables are
+ * collected. */
+void ecs_system_remove_table(
+    EcsWorld *world,
+    EcsTable *table,
+    uint32_t match_index)
+{
+    EcsMatchedSystem *match = ecs_array_get(
+        table->frame_systems, &matched_system_arr_params, match_index);
+    EcsHandle system = match->system;
+    EcsTableSystem *system_data = get_match_data(world, match);
+    if (!system_data) {
+        return;
+    }
+
+    EcsSystemKind kind = system_data->base.kind;
+    EcsArray *array;
+
+    if (ecs_array_count(table->rows)) {
+        array = system_data->tables;
+        filter_remove_table(system_data, table);
+    } else {
+        array = system_data->inactive_tables;
+    }
+
+    EcsSystemTable *table_data = ecs_array_get(
+        array, &system_data->table_params, match->index);
+
+    int32_t refs_index = table_data->refs_index;
+    int32_t components_index = table_data->components_index;
+
+    ecs_array_remove(array, &system_data->table_params, table_data);
+
+    if (array == system_data->tables && !ecs_array_count(array)) {
+        if (kind != EcsOnDemand) {
+            ecs_world_activate_system(world, system, kind, false);
+        }
+    }
+
+    remove_table_element(system_data, system_data->components,
+        &system_data->component_params,
+        offsetof(EcsSystemTable, components_index), components_index, 0);
+
+    if (refs_index) {
+        remove_table_element(system_data, system_data->refs,
+            &system_data->ref_params,
+            offsetof(EcsSystemTable, refs_index), refs_index, 1);
+    }
+}
+
+void ecs_system_free_filters(
+    EcsTableSystem *system_data)
+{
+    if (!system_data->filters) {
+        return;
+    }
+
+    EcsIter it = ecs_map_iter(system_data->filters);
+    while (ecs_iter_hasnext(&it)) {
+        EcsSystemFilter *filter = ecs_iter_next(&it);
+        ecs_array_free(filter->tables);
+        ecs_os_free(filter);
+    }
+
+    ecs_map_free(system_data->filters);
+    system_data->filters = NULL;
+}
+
+void ecs_system_deinit(
+    EcsTableSystem *system_data)
+{
+    ecs_array_free(system_data->base.columns);
+    ecs_array_free(system_data->components);
+    ecs_array_free(system_data->tables);
+    ecs_array_free(system_data->inactive_tables);
+    if (system_data->jobs) ecs_array_free(system_data->jobs);
+    if (system_data->filtered) ecs_array_free(system_data->filtered);
+    if (system_data->refs) ecs_array_free(system_data->refs);
+    ecs_system_free_filters(system_data);
+    system_data->base.enabled = false;
+}
+
+/** Test if the period of a system has passed. If a system has no period, this
+ * function always returns true. The delta_time for the system includes the
+ * time that passed during skipped invocations. */
+bool ecs_system_period_passed(
+    EcsTableSystem *system_data,
+    float delta_time,
+    float *system_delta_time)
+{
+    float period = system_data->period;
+
+    *system_delta_time = delta_time + system_data->time_passed;
+
+    if (period) {
+        float time_passed = system_data->time_passed + delta_time;
+
+        if (time_passed >= period) {
+            time_passed -= period;
+            if (time_passed > period) {
+                time_passed = 0;
+            }
+
+            system_data->time_passed = time_passed;
+        } else {
+            system_data->time_passed = time_passed;
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/** Run subset of the matching entities for a system (used in worker threads) */
+void ecs_run_job(
+    EcsWorld *world,
+    EcsThread *thread,
+    EcsJob *job)
+{
+    EcsHandle system = job->system;
+    EcsTableSystem *system_data = job->system_data;
+    EcsSystemAction action = system_data->base.action;
+    uint32_t table_element_size = system_data->table_params.element_size;
+    uint32_t component_element_size =
+      system_data->component_params.element_size;
+    uint32_t table_index = job->table_index;
+    uint32_t start_index = job->start_index;
+    uint32_t remaining = job->row_count;
+    uint32_t column_count = ecs_array_count(system_data->base.columns);
+    bool *filtered = job->filtered;
+    void *refs_data[column_count];
     EcsHandle refs_entity[column_count];
-    int32_t *table_buffer = ecs_array_get(
+    EcsSystemTable *table_buffer = ecs_array_get(
         system_data->tables, &system_data->table_params, table_index);
     char *component_buffer = ecs_array_buffer(system_data->components);
-    void *component_buffer_el = ECS_OFFSET(component_buffer,
-        component_element_size * table_buffer[HANDLES_INDEX]);;
 
     EcsRows info = {
         .world = thread ? (EcsWorld*)thread : world,
         .system = system,
+        .param = job->param,
         .refs_data = refs_data,
         .refs_entity = refs_entity,
-        .column_count = column_count
+        .column_count = column_count,
+        .delta_time = job->delta_time
     };
 
     do {
-        EcsTable *table = ecs_array_get(
-            world->table_db, &table_arr_params, table_buffer[TABLE_INDEX]);
+        /* Skip tables that do not match the filter of the run */
+        if (filtered && !filtered[table_index]) {
+            table_buffer = ECS_OFFSET(table_buffer, table_element_size);
+            table_index ++;
+            continue;
+        }
+
+        EcsTable *table = table_buffer->table;
         EcsArray *rows = table->rows;
-        void *start = ecs_array_get(rows, &table->row_params, start_index);
-        uint32_t count = ecs_array_count(rows);
+        uint32_t count = ecs_array_count(rows) - start_index;
         uint32_t element_size = table->row_params.element_size;
-        uint32_t refs_index = table_buffer[REFS_INDEX];
+        uint32_t refs_index = table_buffer->refs_index;
 
-        component_buffer_el = ECS_OFFSET(component_buffer,
-            component_element_size * table_buffer[HANDLES_INDEX]);
+        uint32_t first = start_index;
 
         info.element_size = element_size;
-        info.columns = ECS_OFFSET(table_buffer, sizeof(uint32_t) * OFFSETS_INDEX);
-        info.components = component_buffer_el;
-        info.first = start;
+        info.columns = table_buffer->columns;
+        info.components = ECS_OFFSET(component_buffer,
+            component_element_size * table_buffer->components_index);
 
         if (refs_index) {
             resolve_refs(world, system_data, refs_index, &info);
         }
 
-        if (remaining >= count) {
-            info.last = ECS_OFFSET(info.first, element_size * count);
+        if (remaining > count) {
+            /* Job continues in the next table */
             table_buffer = ECS_OFFSET(table_buffer, table_element_size);
-            component_buffer_el = ECS_OFFSET(component_buffer,
-                table_buffer[HANDLES_INDEX] * component_element_size);
+            table_index ++;
             start_index = 0;
             remaining -= count;
         } else {
-            info.last = ECS_OFFSET(info.first, element_size * remaining);
+            count = remaining;
             remaining = 0;
         }
 
-        action(&info);
-        if (info.interrupted_by) break;
+        run_rows(table, &info, action, first, count);
+        if (info.interrupted_by) {
+            job->interrupted_by = info.interrupted_by;
+            break;
+        }
     } while (remaining);
 }
 
-
-/* -- Private API -- */
-
-EcsHandle ecs_new_table_system(
+/** Initialize the data of a table system from its signature. Tables are not
+ * matched yet, so that the caller can validate the parsed signature first. */
+static
+void init_table_system(
     EcsWorld *world,
-    const char *id,
+    EcsTableSystem *system_data,
     EcsSystemKind kind,
     const char *sig,
     EcsSystemAction action)
@@ -598,13 +1299,6 @@ EcsHandle ecs_new_table_system(
         assert(0);
     }
 
-    EcsHandle result = ecs_new_w_family(
-        world, NULL, world->table_system_family);
-
-    EcsId *id_data = ecs_get_ptr(world, result, EcsId_h);
-    *id_data = id;
-
-    EcsTableSystem *system_data = ecs_get_ptr(world, result, EcsTableSystem_h);
     memset(system_data, 0, sizeof(EcsTableSystem));
     system_data->base.action = action;
     system_data->base.enabled = true;
@@ -612,7 +1306,10 @@ EcsHandle ecs_new_table_system(
     system_data->base.time_spent = 0;
     system_data->base.columns = ecs_array_new(&column_arr_params, count);
     system_data->base.kind = kind;
-    system_data->table_params.element_size = sizeof(int32_t) * (count + 3);
+    system_data->table_params.element_size = ECS_ALIGN(
+        sizeof(EcsSystemTable) + sizeof(int32_t) * count * 2, sizeof(void*));
+    system_data->table_params.move_action = move_table_data;
+    system_data->table_params.ctx = world;
     system_data->ref_params.element_size = sizeof(EcsSystemRef) * count;
     system_data->component_params.element_size = sizeof(EcsHandle) * count;
     system_data->period = 0;
@@ -631,6 +1328,25 @@ EcsHandle ecs_new_table_system(
     }
 
     compute_and_families(world, system_data);
+}
+
+/* -- Private API -- */
+
+EcsHandle ecs_new_table_system(
+    EcsWorld *world,
+    const char *id,
+    EcsSystemKind kind,
+    const char *sig,
+    EcsSystemAction action)
+{
+    EcsHandle result = ecs_new_w_family(
+        world, NULL, world->table_system_family);
+
+    EcsId *id_data = ecs_get_ptr(world, result, EcsId_h);
+    *id_data = id;
+
+    EcsTableSystem *system_data = ecs_get_ptr(world, result, EcsTableSystem_h);
+    init_table_system(world, system_data, kind, sig, action);
     match_tables(world, NULL, result, system_data);
 
     if (kind == EcsOnFrame) {
@@ -668,6 +1384,42 @@ EcsHandle ecs_new_table_system(
     return result;
 }
 
+/** Order rows by table, and by index within a table */
+static
+int compare_row(
+    const void *p1,
+    const void *p2)
+{
+    const EcsRow *r1 = p1, *r2 = p2;
+
+    if (r1->family_id != r2->family_id) {
+        return r1->family_id < r2->family_id ? -1 : 1;
+    }
+
+    return (r1->index > r2->index) - (r1->index < r2->index);
+}
+
+/** Get the record of an active table matched with a system (NULL if the table
+ * does not match the system) */
+static
+EcsSystemTable* find_matched_table(
+    EcsHandle system,
+    EcsTableSystem *system_data,
+    EcsTable *table)
+{
+    EcsMatchedSystem *buffer = ecs_array_buffer(table->frame_systems);
+    uint32_t i, count = ecs_array_count(table->frame_systems);
+
+    for (i = 0; i < count; i ++) {
+        if (buffer[i].system == system) {
+            return ecs_array_get(system_data->tables,
+                &system_data->table_params, buffer[i].index);
+        }
+    }
+
+    return NULL;
+}
+
 /* -- Public API -- */
 
 EcsHandle ecs_run_system(
@@ -684,25 +1436,9 @@ EcsHandle ecs_run_system(
         return 0;
     }
 
-    float system_delta_time = delta_time + system_data->time_passed;
-    float period = system_data->period;
-
-    if (period) {
-        float time_passed = system_data->time_passed + delta_time;
-
-        delta_time = time_passed;
-
-        if (time_passed >= period) {
-            time_passed -= period;
-            if (time_passed > period) {
-                time_passed = 0;
-            }
-
-            system_data->time_passed = time_passed;
-        } else {
-            system_data->time_passed = time_passed;
-            return 0;
-        }
+    float system_delta_time;
+    if (!ecs_system_period_passed(system_data, delta_time, &system_delta_time)) {
+        return 0;
     }
 
     EcsWorld *real_world = world;
@@ -715,14 +1451,12 @@ EcsHandle ecs_run_system(
 
     EcsSystemAction action = system_data->base.action;
     EcsArray *tables = system_data->tables;
-    EcsArray *table_db = real_world->table_db;
     uint32_t table_count = ecs_array_count(tables);
     uint32_t column_count = ecs_array_count(system_data->base.columns);
     uint32_t element_size = system_data->table_params.element_size;
     uint32_t component_el_size = system_data->component_params.element_size;
-    int32_t *table_buffer = ecs_array_buffer(tables);
+    EcsSystemTable *table_start = ecs_array_buffer(tables);
     char *component_buffer = ecs_array_buffer(system_data->components);
-    int32_t *last = ECS_OFFSET(table_buffer, element_size * table_count);
     void *refs_data[column_count];
     EcsHandle refs_entity[column_count];
     EcsFamily filter_id = 0;
@@ -738,13 +1472,30 @@ EcsHandle ecs_run_system(
         .delta_time = system_delta_time
     };
 
+    bool skip_unchanged = system_data->skip_unchanged;
+    uint64_t version = ecs_world_next_version(real_world);
+
+    /* Filtered runs only visit the tables that match the filter */
+    EcsSystemFilter *cached = NULL;
     if (filter) {
-        filter_id = ecs_family_from_handle(world, stage, filter, NULL);
+        cached = get_filter(real_world, system_data, filter);
+        if (cached) {
+            table_count = ecs_array_count(cached->tables);
+        } else {
+            filter_id = ecs_family_from_handle(world, stage, filter, NULL);
+        }
     }
 
-    for (; table_buffer < last; table_buffer = ECS_OFFSET(table_buffer, element_size)) {
-        int32_t table_index = table_buffer[TABLE_INDEX];
-        EcsTable *table = ecs_array_get(table_db,&table_arr_params,table_index);
+    uint32_t i;
+    for (i = 0; i < table_count; i ++) {
+        EcsSystemTable *table_buffer;
+        if (cached) {
+            table_buffer = get_filter_table_data(system_data, cached, i);
+        } else {
+            table_buffer = ECS_OFFSET(table_start, element_size * i);
+        }
+
+        EcsTable *table = table_buffer->table;
 
         if (filter_id) {
             if (!ecs_family_contains(
@@ -754,23 +1505,143 @@ EcsHandle ecs_run_system(
             }
         }
 
-        EcsArray *rows = table->rows;
-        void *buffer = ecs_array_buffer(rows);
-        uint32_t count = ecs_array_count(rows);
+        if (skip_unchanged) {
+            if (!table_changed(system_data, table_buffer, column_count)) {
+                continue;
+            }
+        }
+
+        uint32_t count = ecs_array_count(table->rows);
 
-        int32_t refs_index = table_buffer[REFS_INDEX];
+        int32_t refs_index = table_buffer->refs_index;
         if (refs_index) {
             resolve_refs(world, system_data, refs_index, &info);
         }
 
         info.element_size = table->row_params.element_size;
-        info.first = buffer;
-        info.last = ECS_OFFSET(info.first, info.element_size * count);
-        info.columns = ECS_OFFSET(table_buffer, sizeof(uint32_t) * OFFSETS_INDEX);
+        info.columns = table_buffer->columns;
+        info.components = ECS_OFFSET(component_buffer,
+            component_el_size * table_buffer->components_index);
+
+        run_rows(table, &info, action, 0, count);
+
+        /* Changes made by the system itself are not detected by the system */
+        touch_columns(system_data, table_buffer, column_count, version);
+        table_buffer->version = version;
+
+        if (info.interrupted_by) {
+            interrupted_by = info.interrupted_by;
+            break;
+        }
+    }
+
+    if (measure_time) {
+        system_data->base.time_spent += ut_time_measure(&time_start);
+    }
+
+    return interrupted_by;
+}
+
+EcsHandle ecs_run_system_w_parent(
+    EcsWorld *world,
+    EcsHandle system,
+    float delta_time,
+    EcsHandle parent,
+    void *param)
+{
+    EcsTableSystem *system_data = ecs_get_ptr(world, system, EcsTableSystem_h);
+    assert(system_data != NULL);
+
+    if (!system_data->base.enabled || !system_data->base.action) {
+        return 0;
+    }
+
+    float system_delta_time;
+    if (!ecs_system_period_passed(system_data, delta_time, &system_delta_time)) {
+        return 0;
+    }
+
+    EcsWorld *real_world = world;
+    EcsStage *stage = ecs_get_stage(&real_world);
+
+    EcsArray *children = ecs_map_get(real_world->child_index, parent);
+    uint32_t child_count = ecs_array_count(children);
+    if (!child_count) {
+        return 0;
+    }
+
+    bool measure_time = real_world->measure_system_time;
+    struct timespec time_start;
+    if (measure_time) {
+        ut_time_get(&time_start);
+    }
+
+    /* Sort rows of children so that consecutive rows are passed to the system
+     * in one invocation. If children are grouped (see ecs_group_children) this
+     * results in one invocation per table. */
+    EcsHandle *child_buffer = ecs_array_buffer(children);
+    EcsRow *rows = ecs_os_malloc(sizeof(EcsRow) * child_count);
+    uint32_t i, row_count = 0;
+    for (i = 0; i < child_count; i ++) {
+        uint64_t row_64 = ecs_map_get64(real_world->entity_index, child_buffer[i]);
+        if (row_64) {
+            rows[row_count ++] = ecs_to_row(row_64);
+        }
+    }
+
+    qsort(rows, row_count, sizeof(EcsRow), compare_row);
+
+    EcsSystemAction action = system_data->base.action;
+    uint32_t column_count = ecs_array_count(system_data->base.columns);
+    uint32_t component_el_size = system_data->component_params.element_size;
+    char *component_buffer = ecs_array_buffer(system_data->components);
+    void *refs_data[column_count];
+    EcsHandle refs_entity[column_count];
+    EcsHandle interrupted_by = 0;
+    uint64_t version = ecs_world_next_version(real_world);
+
+    EcsRows info = {
+        .world = world,
+        .system = system,
+        .param = param,
+        .refs_entity = refs_entity,
+        .refs_data = refs_data,
+        .column_count = column_count,
+        .delta_time = system_delta_time
+    };
+
+    i = 0;
+    while (i < row_count) {
+        EcsRow first = rows[i];
+        uint32_t count = 1;
+        while (i + count < row_count &&
+            rows[i + count].family_id == first.family_id &&
+            rows[i + count].index == first.index + count)
+        {
+            count ++;
+        }
+
+        i += count;
+
+        EcsTable *table = ecs_world_get_table(world, stage, first.family_id);
+        EcsSystemTable *table_data = find_matched_table(
+            system, system_data, table);
+        if (!table_data) {
+            continue;
+        }
+
+        if (table_data->refs_index) {
+            resolve_refs(world, system_data, table_data->refs_index, &info);
+        }
+
+        info.element_size = table->row_params.element_size;
+        info.columns = table_data->columns;
         info.components = ECS_OFFSET(component_buffer,
-            component_el_size * table_buffer[HANDLES_INDEX]);
+            component_el_size * table_data->components_index);
+
+        run_rows(table, &info, action, first.index, count);
 
-        action(&info);
+        touch_columns(system_data, table_data, column_count, version);
 
         if (info.interrupted_by) {
             interrupted_by = info.interrupted_by;
@@ -778,9 +1649,287 @@ EcsHandle ecs_run_system(
         }
     }
 
+    ecs_os_free(rows);
+
     if (measure_time) {
         system_data->base.time_spent += ut_time_measure(&time_start);
     }
 
     return interrupted_by;
 }
+
+EcsHandle ecs_run_system_parallel(
+    EcsWorld *world,
+    EcsHandle system,
+    float delta_time,
+    EcsHandle filter,
+    void *param)
+{
+    if (!start_run(world, system, delta_time, filter, param, 0)) {
+        return ecs_run_system(world, system, delta_time, filter, param);
+    }
+
+    return wait_run(&world->system_run);
+}
+
+EcsSystemRun* ecs_run_system_async(
+    EcsWorld *world,
+    EcsHandle system,
+    float delta_time,
+    EcsHandle filter,
+    void *param)
+{
+    assert(world->magic == ECS_WORLD_MAGIC);
+
+    /* The main thread does not receive jobs, so that it is free to do other
+     * work while the system is running */
+    if (!start_run(world, system, delta_time, filter, param, 1)) {
+        EcsSystemRun *run = &world->system_run;
+        assert(!run->system);
+        run->world = world;
+        run->system = system;
+        run->system_data = NULL;
+        run->interrupted_by = ecs_run_system(
+            world, system, delta_time, filter, param);
+    }
+
+    return &world->system_run;
+}
+
+EcsHandle ecs_wait_system(
+    EcsSystemRun *run)
+{
+    assert(run->system != 0);
+    return wait_run(run);
+}
+
+/** Get record of the table at index in the tables iterated by a query */
+static
+EcsSystemTable* get_query_table_data(
+    EcsQueryIter *it,
+    uint32_t index)
+{
+    EcsTableSystem *system_data = it->system_data;
+    if (it->filter) {
+        return get_filter_table_data(system_data, it->filter, index);
+    } else {
+        return ecs_array_get(
+            system_data->tables, &system_data->table_params, index);
+    }
+}
+
+/** Move iterator to the next run of enabled rows in a table, starting at
+ * it->row. Returns false if the table has no more enabled rows. */
+static
+bool next_query_run(
+    EcsQueryIter *it,
+    EcsTable *table)
+{
+    EcsRows *info = &it->rows;
+    uint32_t first = it->row, count = ecs_array_count(table->rows);
+    uint32_t run = ecs_table_enabled_run(table, &first, count);
+
+    if (!run) {
+        it->row = 0;
+        return false;
+    }
+
+    info->refs_data = it->refs_data;
+    info->refs_entity = it->refs_entity;
+    info->first = ecs_table_get(table, table->rows, first);
+    info->last = ECS_OFFSET(info->first, info->element_size * run);
+    it->count = run;
+
+    if (first + run < count) {
+        it->row = first + run;
+    } else {
+        it->row = 0;
+    }
+
+    return true;
+}
+
+EcsQuery* ecs_new_query(
+    EcsWorld *world,
+    const char *signature)
+{
+    assert(world->magic == ECS_WORLD_MAGIC);
+    assert(!world->in_progress);
+
+    if (!ecs_needs_tables(world, signature)) {
+        ecs_abort(ECS_INVALID_PARAMETERS, signature);
+    }
+
+    if (ecs_columns_count(signature) > ECS_QUERY_MAX_COLUMNS) {
+        ecs_abort(ECS_INVALID_PARAMETERS, signature);
+    }
+
+    size_t size = strlen(signature) + 1;
+    char *sig = ecs_os_malloc(size);
+    memcpy(sig, signature, size);
+
+    EcsQuery *result = ecs_os_malloc(sizeof(EcsQuery));
+    EcsTableSystem *system_data = &result->system_data;
+
+    /* A query matches tables in the same way as an on demand system without
+     * an action, so that its tables are matched and (de)activated the same */
+    init_table_system(world, system_data, EcsOnDemand, sig, NULL);
+
+    /* Queries are not entities, so they cannot have SYSTEM columns */
+    EcsSystemColumn *columns = ecs_array_buffer(system_data->base.columns);
+    uint32_t i, count = ecs_array_count(system_data->base.columns);
+    for (i = 0; i < count; i ++) {
+        if (columns[i].kind == EcsFromSystem) {
+            ecs_abort(ECS_INVALID_PARAMETERS, signature);
+        }
+    }
+
+    match_tables(world, NULL, 0, system_data);
+
+    *(EcsQuery**)ecs_array_add(&world->queries, &query_arr_params) = result;
+
+    return result;
+}
+
+void ecs_free_query(
+    EcsWorld *world,
+    EcsQuery *query)
+{
+    assert(world->magic == ECS_WORLD_MAGIC);
+    assert(!world->in_progress);
+
+    EcsTableSystem *system_data = &query->system_data;
+    EcsArray *arrays[] = {system_data->tables, system_data->inactive_tables};
+    uint32_t i, a;
+
+    for (a = 0; a < 2; a ++) {
+        EcsIter it = ecs_array_iter(arrays[a], &system_data->table_params);
+        while (ecs_iter_hasnext(&it)) {
+            EcsSystemTable *table_data = ecs_iter_next(&it);
+            remove_match(world, table_data->table, table_data->match_index);
+        }
+    }
+
+    EcsQuery **queries = ecs_array_buffer(world->queries);
+    uint32_t count = ecs_array_count(world->queries);
+    for (i = 0; i < count; i ++) {
+        if (queries[i] == query) {
+            ecs_array_remove_index(world->queries, &query_arr_params, i);
+            break;
+        }
+    }
+
+    ecs_os_free((char*)system_data->base.signature);
+    ecs_system_deinit(system_data);
+    ecs_os_free(query);
+}
+
+void ecs_set_query_skip_unchanged(
+    EcsWorld *world,
+    EcsQuery *query,
+    bool skip_unchanged)
+{
+    assert(world->magic == ECS_WORLD_MAGIC);
+    query->system_data.skip_unchanged = skip_unchanged;
+}
+
+EcsQueryIter ecs_query_iter(
+    EcsWorld *world,
+    EcsQuery *query,
+    EcsHandle filter)
+{
+    EcsWorld *real_world = world;
+    EcsStage *stage = ecs_get_stage(&real_world);
+    EcsTableSystem *system_data = &query->system_data;
+
+    EcsQueryIter result = {
+        .rows = {
+            .world = world,
+            .column_count = ecs_array_count(system_data->base.columns)
+        },
+        .system_data = system_data,
+        .version = ecs_world_next_version(real_world)
+    };
+
+    EcsSystemFilter *cached = NULL;
+    if (filter) {
+        cached = get_filter(real_world, system_data, filter);
+        if (!cached) {
+            result.filter_id = ecs_family_from_handle(
+                world, stage, filter, NULL);
+        }
+    }
+
+    if (cached) {
+        result.filter = cached;
+        result.table_count = ecs_array_count(cached->tables);
+    } else {
+        result.table_count = ecs_array_count(system_data->tables);
+    }
+
+    return result;
+}
+
+bool ecs_query_next(
+    EcsQueryIter *it)
+{
+    EcsTableSystem *system_data = it->system_data;
+    EcsRows *info = &it->rows;
+    EcsWorld *world = info->world;
+    uint32_t column_count = info->column_count;
+    uint32_t component_el_size = system_data->component_params.element_size;
+    char *component_buffer = ecs_array_buffer(system_data->components);
+
+    /* Continue with the next run of enabled rows in the current table */
+    if (it->row) {
+        EcsSystemTable *table_data = get_query_table_data(it, it->index - 1);
+        if (next_query_run(it, table_data->table)) {
+            return true;
+        }
+    }
+
+    while (it->index < it->table_count) {
+        EcsSystemTable *table_data = get_query_table_data(it, it->index ++);
+        EcsTable *table = table_data->table;
+        uint32_t count = ecs_array_count(table->rows);
+        if (!count) {
+            continue;
+        }
+
+        if (it->filter_id && !ecs_family_contains(
+            world, NULL, table->family_id, it->filter_id, true, true))
+        {
+            continue;
+        }
+
+        if (system_data->skip_unchanged) {
+            if (!table_changed(system_data, table_data, column_count)) {
+                continue;
+            }
+        }
+
+        /* The iterator may have been copied, so refs are stored in its own
+         * buffers every time */
+        info->refs_data = it->refs_data;
+        info->refs_entity = it->refs_entity;
+        if (table_data->refs_index) {
+            resolve_refs(world, system_data, table_data->refs_index, info);
+        }
+
+        info->element_size = table->row_params.element_size;
+        info->columns = table_data->columns;
+        info->components = ECS_OFFSET(component_buffer,
+            component_el_size * table_data->components_index);
+
+        /* Columns are marked as changed before the application writes them */
+        touch_columns(system_data, table_data, column_count, it->version);
+        table_data->version = it->version;
+
+        if (next_query_run(it, table)) {
+            return true;
+        }
+    }
+
+    it->count = 0;
+    return false;
+}
@@ -1,36 +1,179 @@
+#ifdef __linux__
+#define _GNU_SOURCE
+#include <sched.h>
+#endif
+
 #include <assert.h>
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include "include/util/time.h"
 #include "include/private/reflecs.h"
 
 const EcsArrayParams thread_arr_params = {
-    .element_size = sizeof(EcsThread)
+    .element_size = sizeof(EcsThread*)
 };
 
 const EcsArrayParams job_arr_params = {
     .element_size = sizeof(EcsJob)
 };
 
-/** Worker thread code. Processes a job for one system */
+/** Run a job. A job either runs a subset of the rows of a table system, a
+ * task (a system that is not matched with tables) or merges staged entities
+ * into a table. */
+static
+void run_job(
+    EcsWorld *world,
+    EcsThread *thread,
+    EcsJob *job)
+{
+    if (job->merge_table) {
+        ecs_merge_table(world, job->merge_table);
+    } else if (job->system_data) {
+        ecs_run_job(world, thread, job);
+    } else {
+        EcsWorld *task_world = thread ? (EcsWorld*)thread : world;
+        ecs_run_task(task_world, job->system, job->delta_time);
+    }
+}
+
+/** Add job to thread. If the thread cannot accept any more jobs, run the jobs
+ * that have been prepared so far before adding the new job. */
+static
+void add_job(
+    EcsWorld *world,
+    EcsThread *thread,
+    EcsJob *job)
+{
+    if (thread->job_count == ECS_MAX_JOBS_PER_WORKER) {
+        ecs_run_jobs(world);
+    }
+
+    thread->jobs[thread->job_count] = job;
+    thread->job_count ++;
+}
+
+/** Get number of rows in table at specified index in system tables array.
+ * Tables that do not match the filter of the run are treated as empty. */
+static
+uint32_t system_table_row_count(
+    EcsWorld *world,
+    EcsTableSystem *system_data,
+    bool *filtered,
+    uint32_t index)
+{
+    if (filtered && !filtered[index]) {
+        return 0;
+    }
+
+    EcsSystemTable *table_data = ecs_array_get(
+        system_data->tables, &system_data->table_params, index);
+    return ecs_array_count(table_data->table->rows);
+}
+
+/** Allocate memory that starts at a cache line boundary, and that is padded to
+ * a multiple of the cache line size */
+static
+void* alloc_cache_aligned(
+    size_t size)
+{
+    return ecs_os_alloc_aligned(
+        ECS_CACHE_LINE_SIZE, ECS_CACHE_LINE_ROUND(size));
+}
+
+/** Pin thread to a CPU core. Worker threads are assigned to the cores that the
+ * process is allowed to run on in order, so that the Nth thread is pinned to
+ * the Nth allowed core. */
+static
+void pin_thread(
+    EcsThread *thread)
+{
+#ifdef __linux__
+    cpu_set_t allowed;
+    if (sched_getaffinity(0, sizeof(cpu_set_t), &allowed)) {
+        fprintf(stderr, "sched_getaffinity failed: %s\n", strerror(errno));
+        return;
+    }
+
+    int cpu_count = CPU_COUNT(&allowed);
+    if (!cpu_count) {
+        return;
+    }
+
+    int n = thread->index % cpu_count, cpu;
+    for (cpu = 0; cpu < CPU_SETSIZE; cpu ++) {
+        if (CPU_ISSET(cpu, &allowed) && !n --) {
+            break;
+        }
+    }
+
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+    CPU_SET(cpu, &cpus);
+
+    int result = pthread_setaffinity_np(
+        pthread_self(), sizeof(cpu_set_t), &cpus);
+    if (result) {
+        fprintf(stderr, "pthread_setaffinity_np failed: %s\n",
+            strerror(result));
+    }
+#endif
+}
+
+/** Worker thread code. Processes the jobs assigned to the thread each time the
+ * main thread signals a new batch of jobs. Threads that are not active are
+ * parked until they are activated again. */
 static
 void* ecs_worker(void *arg) {
     EcsThread *thread = arg;
     EcsWorld *world = thread->world;
     int i;
 
+    if (world->pin_threads) {
+        pin_thread(thread);
+    }
+
+    /* Stage is allocated and initialized by the worker, so that its memory
+     * is first touched by (and is local to) the thread that uses it */
+    EcsStage *stage = alloc_cache_aligned(sizeof(EcsStage));
+    assert(stage != NULL);
+    ecs_stage_init(stage);
+    thread->stage = stage;
+
     pthread_mutex_lock(&world->thread_mutex);
     world->threads_running ++;
 
-    while (!world->quit_workers) {
-        pthread_cond_wait(&world->thread_cond, &world->thread_mutex);
-        if (world->quit_workers) {
-            break;
+    while (!world->quit_workers && !thread->quit) {
+        if (thread->index >= world->active_threads) {
+            pthread_cond_wait(&world->park_cond, &world->thread_mutex);
+            continue;
+        }
+
+        /* Wait for new batch of jobs. Checking the generation ensures that
+         * spurious wakeups do not cause jobs to be run twice. */
+        if (thread->job_generation == world->job_generation) {
+            pthread_cond_wait(&world->thread_cond, &world->thread_mutex);
+            continue;
         }
 
+        thread->job_generation = world->job_generation;
+
         EcsJob **jobs = thread->jobs;
         uint32_t job_count = thread->job_count;
+        bool measure = world->autotune_threads;
         pthread_mutex_unlock(&world->thread_mutex);
 
+        struct timespec start;
+        if (measure) {
+            ut_time_get(&start);
+        }
+
         for (i = 0; i < job_count; i ++) {
-            ecs_run_job(world, thread, jobs[i]);
+            run_job(world, thread, jobs[i]);
+        }
+
+        if (measure) {
+            thread->busy_time += ut_time_measure(&start);
         }
 
         pthread_mutex_lock(&world->thread_mutex);
@@ -38,7 +181,7 @@ void* ecs_worker(void *arg) {
 
         pthread_mutex_lock(&world->job_mutex);
         world->jobs_finished ++;
-        if (world->jobs_finished == world->threads_running) {
+        if (world->jobs_finished == world->active_threads - 1) {
             pthread_cond_signal(&world->job_cond);
         }
         pthread_mutex_unlock(&world->job_mutex);
@@ -66,22 +209,32 @@ void wait_for_threads(
     } while (wait);
 }
 
-/** Wait until threads have finished processing their jobs */
+/** Wait until active threads have finished processing their jobs */
 static
 void wait_for_jobs(
     EcsWorld *world)
 {
-    uint32_t thread_count = ecs_array_count(world->worker_threads) - 1;
+    uint32_t thread_count = world->active_threads - 1;
 
     pthread_mutex_lock(&world->job_mutex);
-    if (world->jobs_finished != thread_count) {
-        do {
-            pthread_cond_wait(&world->job_cond, &world->job_mutex);
-        } while (world->jobs_finished != thread_count);
+    while (world->jobs_finished != thread_count) {
+        pthread_cond_wait(&world->job_cond, &world->job_mutex);
     }
     pthread_mutex_unlock(&world->job_mutex);
 }
 
+/** Free resources of a thread that is no longer running */
+static
+void free_thread(
+    EcsThread *thread)
+{
+    if (thread->stage) {
+        ecs_stage_deinit(thread->stage);
+        ecs_os_free_aligned(thread->stage);
+    }
+    ecs_os_free_aligned(thread);
+}
+
 /** Stop worker threads */
 static
 void ecs_stop_threads(
@@ -90,63 +243,157 @@ void ecs_stop_threads(
     pthread_mutex_lock(&world->thread_mutex);
     world->quit_workers = true;
     pthread_cond_broadcast(&world->thread_cond);
+    pthread_cond_broadcast(&world->park_cond);
     pthread_mutex_unlock(&world->thread_mutex);
 
-    EcsThread *buffer = ecs_array_buffer(world->worker_threads);
+    EcsThread **buffer = ecs_array_buffer(world->worker_threads);
     uint32_t i, count = ecs_array_count(world->worker_threads);
-    for (i = 1; i < count; i ++) {
-        pthread_join(buffer[i].thread, NULL);
-        ecs_stage_deinit(buffer[i].stage);
+    for (i = 0; i < count; i ++) {
+        EcsThread *thread = buffer[i];
+        if (thread->thread) {
+            pthread_join(thread->thread, NULL);
+        }
+        free_thread(thread);
     }
 
     ecs_array_free(world->worker_threads);
-    ecs_array_free(world->stage_db);
-    world->stage_db = NULL;
     world->worker_threads = NULL;
     world->quit_workers = false;
     world->threads_running = 0;
+    world->active_threads = 0;
 }
 
-/** Start worker threads, wait until they are running */
+/** Add threads to the pool until it has the specified number of threads */
 static
-EcsResult start_threads(
+EcsResult add_threads(
     EcsWorld *world,
     uint32_t threads)
 {
-    if (world->worker_threads) {
-        return EcsError;
-    }
-
-    world->worker_threads = ecs_array_new(&thread_arr_params, threads);
-    world->stage_db = ecs_array_new(&stage_arr_params, threads - 1);
+    uint32_t i = ecs_array_count(world->worker_threads);
 
-    int i;
-    for (i = 0; i < threads; i ++) {
-        EcsThread *thread =
-            ecs_array_add(&world->worker_threads, &thread_arr_params);
+    for (; i < threads; i ++) {
+        EcsThread *thread = alloc_cache_aligned(sizeof(EcsThread));
+        if (!thread) {
+            return EcsError;
+        }
 
         thread->magic = ECS_THREAD_MAGIC;
         thread->world = world;
         thread->thread = 0;
         thread->job_count = 0;
+        thread->index = i;
+        thread->stage = NULL;
+        thread->next_handle = 0;
+        thread->handles_left = 0;
+        thread->job_generation = world->job_generation;
+        thread->busy_time = 0;
+        thread->quit = false;
 
         if (i != 0) {
-            thread->stage = ecs_array_add(&world->stage_db, &stage_arr_params);
-            ecs_stage_init(thread->stage);
             if (pthread_create(&thread->thread, NULL, ecs_worker, thread)) {
-                goto error;
+                ecs_os_free_aligned(thread);
+                return EcsError;
             }
-        } else {
-            thread->stage = NULL;
         }
+
+        *(EcsThread**)ecs_array_add(
+            &world->worker_threads, &thread_arr_params) = thread;
+    }
+
+    return EcsOk;
+}
+
+/** Stop and remove threads from the pool until it has the specified number of
+ * threads. Data that is still staged by removed threads is merged. */
+static
+void remove_threads(
+    EcsWorld *world,
+    uint32_t threads)
+{
+    EcsThread **buffer = ecs_array_buffer(world->worker_threads);
+    uint32_t i, count = ecs_array_count(world->worker_threads);
+    EcsThread *removed[count - threads];
+
+    pthread_mutex_lock(&world->thread_mutex);
+    for (i = threads; i < count; i ++) {
+        buffer[i]->quit = true;
+    }
+
+    /* Threads that keep running read these while holding the mutex */
+    world->threads_running = threads - 1;
+    if (world->active_threads > threads) {
+        world->active_threads = threads;
+    }
+
+    pthread_cond_broadcast(&world->thread_cond);
+    pthread_cond_broadcast(&world->park_cond);
+    pthread_mutex_unlock(&world->thread_mutex);
+
+    for (i = threads; i < count; i ++) {
+        removed[i - threads] = buffer[i];
+        pthread_join(buffer[i]->thread, NULL);
+    }
+
+    ecs_array_set_count(&world->worker_threads, &thread_arr_params, threads);
+
+    for (i = 0; i < count - threads; i ++) {
+        world->is_merging = true;
+        ecs_stage_merge(world, removed[i]->stage);
+        world->is_merging = false;
+        free_thread(removed[i]);
+    }
+}
+
+/** Start worker threads, wait until they are running */
+static
+EcsResult start_threads(
+    EcsWorld *world,
+    uint32_t threads)
+{
+    if (world->worker_threads) {
+        return EcsError;
+    }
+
+    world->worker_threads = ecs_array_new(&thread_arr_params, threads);
+    world->active_threads = threads;
+
+    if (add_threads(world, threads) != EcsOk) {
+        goto error;
     }
 
+    /* Stages of worker threads must be initialized before merging */
+    wait_for_threads(world);
+
     return EcsOk;
 error:
     ecs_stop_threads(world);
     return EcsError;
 }
 
+/** Change the number of active threads. Threads that become inactive are
+ * parked, and do not receive jobs until they are activated again. */
+static
+void set_active_threads(
+    EcsWorld *world,
+    uint32_t active)
+{
+    EcsThread **buffer = ecs_array_buffer(world->worker_threads);
+    uint32_t i;
+
+    pthread_mutex_lock(&world->thread_mutex);
+
+    /* Threads that are activated should only run the next batch of jobs */
+    for (i = world->active_threads; i < active; i ++) {
+        buffer[i]->job_generation = world->job_generation;
+    }
+
+    world->active_threads = active;
+    pthread_cond_broadcast(&world->park_cond);
+    pthread_mutex_unlock(&world->thread_mutex);
+
+    world->valid_schedule = false;
+}
+
 /** Create jobs for system */
 static
 void create_jobs(
@@ -168,125 +415,332 @@ void create_jobs(
 
 /* -- Private functions -- */
 
-/** Create a job per available thread for system */
+/** Create a job per available thread for system. Jobs are created for threads
+ * starting from first_thread, so that a system can be ran without involving
+ * the main thread. If filtered is not NULL, only rows of tables for which
+ * filtered is true are divided over the jobs. */
 void ecs_schedule_jobs(
     EcsWorld *world,
-    EcsHandle system)
+    EcsHandle system,
+    bool *filtered,
+    uint32_t first_thread)
 {
     EcsTableSystem *system_data = ecs_get_ptr(world, system, EcsTableSystem_h);
-    uint32_t thread_count = ecs_array_count(world->worker_threads);
+    uint32_t thread_count = world->active_threads - first_thread;
+    uint32_t table_count = ecs_array_count(system_data->tables);
     uint32_t total_rows = 0;
+    uint32_t i;
 
     if (ecs_array_count(system_data->jobs) != thread_count) {
         create_jobs(system_data, thread_count);
     }
 
-    EcsIter table_it = ecs_array_iter(
-        system_data->tables, &system_data->table_params);
-
-    while (ecs_iter_hasnext(&table_it)) {
-        uint32_t table_index = *(uint32_t*)ecs_iter_next(&table_it);
-        EcsTable *table = ecs_array_get(
-            world->table_db, &table_arr_params, table_index);
-        total_rows += ecs_array_count(table->rows);
+    for (i = 0; i < table_count; i ++) {
+        total_rows += system_table_row_count(world, system_data, filtered, i);
     }
 
-    float rows_per_thread = (float)total_rows / (float)thread_count;
-    float residual = 0;
-    int32_t rows_per_thread_i = rows_per_thread;
-
-    EcsIter it = ecs_array_iter(system_data->jobs, &job_arr_params);
-    table_it = ecs_array_iter(system_data->tables, &system_data->table_params);
-
+    /* Distribute rows evenly, the first jobs get the remainder */
+    uint32_t rows_per_job = total_rows / thread_count;
+    uint32_t residual = total_rows % thread_count;
     uint32_t sys_table_index = 0;
-    uint32_t table_index = *(uint32_t*)ecs_array_get(
-        system_data->tables, &system_data->table_params, 0);
-    EcsTable *table = ecs_array_get(
-        world->table_db, &table_arr_params, table_index);
-    uint32_t table_row_count = ecs_array_count(table->rows);
     uint32_t start_index = 0;
+    uint32_t table_row_count = 0;
 
-    EcsJob *job;
-    while (ecs_iter_hasnext(&it)) {
-        job = ecs_iter_next(&it);
-        int32_t rows_per_job = rows_per_thread_i;
-        residual += rows_per_thread - rows_per_job;
-        if (residual > 1) {
-            rows_per_job ++;
-            residual --;
+    if (table_count) {
+        table_row_count = system_table_row_count(
+            world, system_data, filtered, 0);
+    }
+
+    EcsJob *jobs = ecs_array_buffer(system_data->jobs);
+    for (i = 0; i < thread_count; i ++) {
+        EcsJob *job = &jobs[i];
+        uint32_t row_count = rows_per_job + (i < residual);
+
+        /* Move to the table in which the job starts */
+        while (start_index >= table_row_count &&
+              (sys_table_index + 1) < table_count)
+        {
+            start_index -= table_row_count;
+            sys_table_index ++;
+            table_row_count = system_table_row_count(
+                world, system_data, filtered, sys_table_index);
         }
 
         job->system = system;
         job->system_data = system_data;
+        job->merge_table = NULL;
         job->table_index = sys_table_index;
         job->start_index = start_index;
-        job->row_count = rows_per_job;
+        job->row_count = row_count;
+        job->filtered = filtered;
+        job->param = NULL;
+        job->interrupted_by = 0;
 
-        start_index += rows_per_job;
+        start_index += row_count;
+    }
+}
 
-        while (start_index > table_row_count) {
-            sys_table_index ++;
-            table_index = *(uint32_t*)ecs_array_get(
-                system_data->tables, &system_data->table_params, 0);
-            table = ecs_array_get(
-                world->table_db, &table_arr_params, table_index);
-            table_row_count = ecs_array_count(table->rows);
-            if (start_index > table_row_count) {
-                start_index -= table_row_count;
-            } else {
-                start_index = 0;
-            }
+/** Assign jobs of system to worker threads. Jobs are assigned to the last
+ * threads, so that when a system has fewer jobs than there are active
+ * threads, the main thread does not receive a job. */
+void ecs_assign_jobs(
+    EcsWorld *world,
+    EcsTableSystem *system_data,
+    float delta_time,
+    void *param)
+{
+    EcsThread **threads = ecs_array_buffer(world->worker_threads);
+    EcsJob *jobs = ecs_array_buffer(system_data->jobs);
+    uint32_t i, job_count = ecs_array_count(system_data->jobs);
+    uint32_t first_thread = world->active_threads - job_count;
+
+    for (i = 0; i < job_count; i++) {
+        EcsJob *job = &jobs[i];
+        job->interrupted_by = 0;
+
+        if (!job->row_count) {
+            continue;
         }
-    }
 
-    if (residual >= 0.9) {
-        job->row_count ++;
+        job->delta_time = delta_time;
+        job->param = param;
+        add_job(world, threads[first_thread + i], job);
     }
 }
 
-/** Assign jobs to worker threads, signal workers */
+/** Assign jobs of a frame system to worker threads. The seen version is the
+ * change version before any of the systems that run at the same time was
+ * prepared (see ecs_system_prepare_tables). */
 void ecs_prepare_jobs(
     EcsWorld *world,
-    EcsHandle system)
+    EcsHandle system,
+    float delta_time,
+    uint64_t seen)
 {
     EcsTableSystem *system_data = ecs_get_ptr(world, system, EcsTableSystem_h);
+    float system_delta_time;
+
+    if (!system_data->base.enabled) {
+        return;
+    }
+
+    if (!ecs_system_period_passed(system_data, delta_time, &system_delta_time)) {
+        return;
+    }
+
+    /* Systems that skip unchanged tables are scheduled for the tables that
+     * changed since the previous frame */
+    bool *filtered = ecs_system_prepare_tables(world, system_data, NULL, seen);
+    if (filtered) {
+        ecs_schedule_jobs(world, system, filtered, 0);
+    }
+
+    ecs_assign_jobs(world, system_data, system_delta_time, NULL);
+}
+
+/** Assign tasks to worker threads in round-robin fashion */
+void ecs_prepare_tasks(
+    EcsWorld *world,
+    EcsArray *tasks,
+    float delta_time)
+{
     EcsArray *threads = world->worker_threads;
-    EcsArray *jobs = system_data->jobs;
-    int i;
+    uint32_t thread_count = world->active_threads;
+    uint32_t i, count = ecs_array_count(tasks);
+    EcsHandle *buffer = ecs_array_buffer(tasks);
 
-    uint32_t thread_count = ecs_array_count(threads);
+    if (!world->task_jobs) {
+        world->task_jobs = ecs_array_new(&job_arr_params, count);
+    }
 
-    for (i = 0; i < thread_count; i++) {
-        EcsThread *thr = ecs_array_get(threads, &thread_arr_params, i);
-        uint32_t job_count = thr->job_count;
-        thr->jobs[job_count] = ecs_array_get(jobs, &job_arr_params, i);
-        thr->job_count = job_count + 1;
+    ecs_array_set_count(&world->task_jobs, &job_arr_params, count);
+    EcsJob *jobs = ecs_array_buffer(world->task_jobs);
+
+    for (i = 0; i < count; i ++) {
+        EcsJob *job = &jobs[i];
+        job->system = buffer[i];
+        job->system_data = NULL;
+        job->merge_table = NULL;
+        job->table_index = 0;
+        job->start_index = 0;
+        job->row_count = 0;
+        job->delta_time = delta_time;
+        job->filtered = NULL;
+        job->param = NULL;
+        job->interrupted_by = 0;
+
+        EcsThread *thr = *(EcsThread**)ecs_array_get(
+            threads, &thread_arr_params, i % thread_count);
+        add_job(world, thr, job);
     }
 }
 
-void ecs_run_jobs(
+/** Assign merge tables to worker threads. Each table is assigned to the thread
+ * with the fewest rows to merge so far. */
+void ecs_prepare_merge_jobs(
+    EcsWorld *world,
+    EcsArray *merge_tables)
+{
+    EcsThread **threads = ecs_array_buffer(world->worker_threads);
+    uint32_t thread_count = world->active_threads;
+    uint32_t i, t, job_count = 0, count = ecs_array_count(merge_tables);
+    EcsMergeTable *buffer = ecs_array_buffer(merge_tables);
+    uint32_t thread_rows[thread_count];
+
+    for (t = 0; t < thread_count; t ++) {
+        thread_rows[t] = 0;
+    }
+
+    if (!world->merge_jobs) {
+        world->merge_jobs = ecs_array_new(&job_arr_params, count);
+    }
+
+    ecs_array_set_count(&world->merge_jobs, &job_arr_params, count);
+    EcsJob *jobs = ecs_array_buffer(world->merge_jobs);
+
+    for (i = 0; i < count; i ++) {
+        EcsMergeTable *merge_table = &buffer[i];
+        uint32_t row_count = ecs_array_count(merge_table->rows);
+        if (!merge_table->table || !row_count) {
+            continue;
+        }
+
+        EcsJob *job = &jobs[job_count ++];
+        job->system = 0;
+        job->system_data = NULL;
+        job->merge_table = merge_table;
+        job->table_index = 0;
+        job->start_index = 0;
+        job->row_count = row_count;
+        job->delta_time = 0;
+        job->filtered = NULL;
+        job->param = NULL;
+        job->interrupted_by = 0;
+
+        uint32_t min = 0;
+        for (t = 1; t < thread_count; t ++) {
+            if (thread_rows[t] < thread_rows[min]) {
+                min = t;
+            }
+        }
+
+        thread_rows[min] += row_count;
+        add_job(world, threads[min], job);
+    }
+}
+
+/** Signal workers and run jobs for main thread. Workers may still be running
+ * when this function returns, ecs_wait_jobs waits for them to finish. */
+void ecs_start_jobs(
     EcsWorld *world)
 {
+    EcsThread **threads = ecs_array_buffer(world->worker_threads);
+    uint32_t i, thread_count = world->active_threads;
+
+    assert(!world->jobs_pending);
+
+    for (i = 0; i < thread_count; i ++) {
+        if (threads[i]->job_count) {
+            break;
+        }
+    }
+
+    /* Nothing to do */
+    if (i == thread_count) {
+        return;
+    }
+
     /* Make sure threads are ready to accept jobs */
     wait_for_threads(world);
 
+    bool measure = world->autotune_threads;
+    if (measure) {
+        ut_time_get(&world->jobs_start);
+    }
+
     pthread_mutex_lock(&world->thread_mutex);
     world->jobs_finished = 0;
+    world->job_generation ++;
+    world->jobs_pending = true;
     pthread_cond_broadcast(&world->thread_cond);
     pthread_mutex_unlock(&world->thread_mutex);
 
     /* Run job for thread 0 in main thread */
-    EcsThread *thread = ecs_array_buffer(world->worker_threads);
+    EcsThread *thread = threads[0];
     EcsJob **jobs = thread->jobs;
-    uint32_t i, job_count = thread->job_count;
+    uint32_t job_count = thread->job_count;
 
     for (i = 0; i < job_count; i ++) {
-        ecs_run_job(world, NULL, jobs[i]);
+        run_job(world, NULL, jobs[i]);
     }
     thread->job_count = 0;
 
-    if (world->jobs_finished != ecs_array_count(world->worker_threads) - 1) {
-        wait_for_jobs(world);
+    if (measure) {
+        struct timespec t = world->jobs_start;
+        thread->busy_time += ut_time_measure(&t);
+    }
+}
+
+/** Wait for jobs started by ecs_start_jobs to finish */
+void ecs_wait_jobs(
+    EcsWorld *world)
+{
+    if (!world->jobs_pending) {
+        return;
+    }
+
+    wait_for_jobs(world);
+    world->jobs_pending = false;
+
+    if (world->autotune_threads) {
+        world->jobs_time += ut_time_measure(&world->jobs_start);
+    }
+}
+
+/** Signal workers, run jobs for main thread and wait for workers to finish */
+void ecs_run_jobs(
+    EcsWorld *world)
+{
+    ecs_start_jobs(world);
+    ecs_wait_jobs(world);
+}
+
+/** Adjust the number of active threads based on how much of the time spent in
+ * jobs threads were busy. Threads are parked when they are mostly waiting for
+ * other threads, and are activated when all threads are mostly busy. */
+void ecs_tune_threads(
+    EcsWorld *world)
+{
+    if (++ world->tune_frames < ECS_AUTOTUNE_INTERVAL) {
+        return;
+    }
+
+    EcsThread **threads = ecs_array_buffer(world->worker_threads);
+    uint32_t i, thread_count = ecs_array_count(world->worker_threads);
+    uint32_t active = world->active_threads;
+    float busy_time = 0;
+
+    for (i = 0; i < thread_count; i ++) {
+        busy_time += threads[i]->busy_time;
+        threads[i]->busy_time = 0;
+    }
+
+    float jobs_time = world->jobs_time;
+    world->jobs_time = 0;
+    world->tune_frames = 0;
+
+    if (!jobs_time) {
+        return;
+    }
+
+    float utilization = busy_time / (jobs_time * active);
+
+    if (utilization < ECS_AUTOTUNE_LOW_UTILIZATION && active > 1) {
+        set_active_threads(world, active - 1);
+    } else if (utilization > ECS_AUTOTUNE_HIGH_UTILIZATION &&
+        active < thread_count)
+    {
+        set_active_threads(world, active + 1);
     }
 }
 
@@ -297,21 +751,39 @@ EcsResult ecs_set_threads(
     EcsWorld *world,
     uint32_t threads)
 {
-    if (ecs_array_count(world->worker_threads)) {
-        ecs_stop_threads(world);
-        pthread_cond_destroy(&world->thread_cond);
-        pthread_mutex_destroy(&world->thread_mutex);
-        pthread_cond_destroy(&world->job_cond);
-        pthread_mutex_destroy(&world->job_mutex);
-    }
-
-    if (threads > 1) {
-        pthread_cond_init(&world->thread_cond, NULL);
-        pthread_mutex_init(&world->thread_mutex, NULL);
-        pthread_cond_init(&world->job_cond, NULL);
-        pthread_mutex_init(&world->job_mutex, NULL);
-        if (start_threads(world, threads) != EcsOk) {
-            return EcsError;
+    uint32_t thread_count = ecs_array_count(world->worker_threads);
+
+    if (thread_count && threads > 1) {
+        /* Resize running pool. Parked threads are activated again. */
+        if (threads > thread_count) {
+            if (add_threads(world, threads) != EcsOk) {
+                return EcsError;
+            }
+            wait_for_threads(world);
+        } else if (threads < thread_count) {
+            remove_threads(world, threads);
+        }
+
+        set_active_threads(world, threads);
+    } else {
+        if (thread_count) {
+            ecs_stop_threads(world);
+            pthread_cond_destroy(&world->thread_cond);
+            pthread_cond_destroy(&world->park_cond);
+            pthread_mutex_destroy(&world->thread_mutex);
+            pthread_cond_destroy(&world->job_cond);
+            pthread_mutex_destroy(&world->job_mutex);
+        }
+
+        if (threads > 1) {
+            pthread_cond_init(&world->thread_cond, NULL);
+            pthread_cond_init(&world->park_cond, NULL);
+            pthread_mutex_init(&world->thread_mutex, NULL);
+            pthread_cond_init(&world->job_cond, NULL);
+            pthread_mutex_init(&world->job_mutex, NULL);
+            if (start_threads(world, threads) != EcsOk) {
+                return EcsError;
+            }
         }
     }
 
@@ -319,3 +791,25 @@ EcsResult ecs_set_threads(
 
     return EcsOk;
 }
+
+void ecs_set_autotune_threads(
+    EcsWorld *world,
+    bool autotune)
+{
+    assert(world->magic == ECS_WORLD_MAGIC);
+    world->autotune_threads = autotune;
+    world->tune_frames = 0;
+    world->jobs_time = 0;
+
+    if (!autotune && world->worker_threads) {
+        set_active_threads(world, ecs_array_count(world->worker_threads));
+    }
+}
+
+void ecs_set_pin_threads(
+    EcsWorld *world,
+    bool pin_threads)
+{
+    assert(world->magic == ECS_WORLD_MAGIC);
+    world->pin_threads = pin_threads;
+}
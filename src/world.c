@@ -9,18 +9,26 @@ const EcsArrayParams table_arr_params = {
     .element_size = sizeof(EcsTable)
 };
 
-const EcsArrayParams handle_arr_params = {
-    .element_size = sizeof(EcsHandle)
+const EcsArrayParams table_page_arr_params = {
+    .element_size = sizeof(EcsTable*)
 };
 
-const EcsArrayParams stage_arr_params = {
-    .element_size = sizeof(EcsStage)
+const EcsArrayParams handle_arr_params = {
+    .element_size = sizeof(EcsHandle)
 };
 
 const EcsArrayParams char_arr_params = {
     .element_size = sizeof(char)
 };
 
+const EcsArrayParams component_cache_arr_params = {
+    .element_size = sizeof(EcsComponentCache)
+};
+
+const EcsArrayParams index_arr_params = {
+    .element_size = sizeof(uint32_t)
+};
+
 /** Initialize component table. This table is manually constructed to bootstrap
  * reflecs. After this function has been called, the builtin components can be
  * created. */
@@ -29,15 +37,13 @@ void bootstrap_component_table(
     EcsWorld *world,
     uint64_t family_id)
 {
-    EcsTable *result = ecs_array_add(&world->table_db, &table_arr_params);
+    EcsTable *result = ecs_world_add_table(world);
     EcsArray *family = ecs_family_get(world, NULL, family_id);
     result->family_id = family_id;
     ecs_table_init_w_size(world, result, family, sizeof(EcsComponent));
-    result->columns = malloc(sizeof(uint16_t));
+    result->columns = ecs_os_malloc(sizeof(uint16_t));
     result->columns[0] = sizeof(EcsComponent);
-    uint32_t table_index = ecs_array_get_index(
-        world->table_db, &table_arr_params, result);
-    ecs_map_set64(world->table_index, family_id, table_index + 1);
+    ecs_map_set64(world->table_index, family_id, result->index + 1);
 }
 
 /** Bootstrap the EcsComponent component */
@@ -128,32 +134,30 @@ EcsTable* create_table(
     EcsStage *stage,
     EcsFamily family_id)
 {
-    EcsArray **table_db;
-    EcsMap *table_index;
+    bool in_stage = world->in_progress && world->threads_running;
+    EcsTable *result;
 
-    if (world->in_progress && world->threads_running) {
-        table_db = &stage->table_db_stage;
-        table_index = stage->table_stage;
+    if (in_stage) {
+        result = ecs_array_add(&stage->table_db_stage, &table_arr_params);
+        result->index = ecs_array_count(stage->table_db_stage) - 1;
     } else {
-        table_db = &world->table_db;
-        table_index = world->table_index;
+        result = ecs_world_add_table(world);
     }
 
-    EcsTable *result = ecs_array_add(table_db, &table_arr_params);
     result->family_id = family_id;
 
     if (ecs_table_init(world, stage, result) != EcsOk) {
         return NULL;
     }
 
-    uint32_t index = ecs_array_get_index(*table_db, &table_arr_params, result);
-    ecs_map_set64(table_index, family_id, index + 1);
-
-    notify_create_table(world, stage, world->pre_frame_systems, result);
-    notify_create_table(world, stage, world->post_frame_systems, result);
-    notify_create_table(world, stage, world->frame_systems, result);
-    notify_create_table(world, stage, world->inactive_systems, result);
-    notify_create_table(world, stage, world->on_demand_systems, result);
+    /* Systems store a pointer to a table in the world, so tables created in a
+     * stage are only registered with systems once the stage is merged */
+    if (in_stage) {
+        ecs_map_set64(stage->table_stage, family_id, result->index + 1);
+    } else {
+        ecs_map_set64(world->table_index, family_id, result->index + 1);
+        ecs_world_notify_create_table(world, stage, result);
+    }
 
     assert(result != NULL);
 
@@ -177,34 +181,22 @@ void clean_families(
 static
 void deinit_row_system(
     EcsRowSystem *data)
-{
-    ecs_array_free(data->components);
-}
-
-static
-void deinit_table_system(
-    EcsTableSystem *data)
 {
     ecs_array_free(data->base.columns);
     ecs_array_free(data->components);
-    ecs_array_free(data->tables);
-    ecs_array_free(data->inactive_tables);
-    if (data->jobs) ecs_array_free(data->jobs);
-    if (data->refs) ecs_array_free(data->refs);
-    data->base.enabled = false;
 }
 
 static
 void clean_tables(
     EcsWorld *world)
 {
-    EcsTable *buffer = ecs_array_buffer(world->table_db);
-    int32_t i, count = ecs_array_count(world->table_db);
+    int32_t i, count = world->table_count;
 
     for (i = count - 1; i >= 0; i --) {
-        EcsTable *table = &buffer[i];
-
-        ecs_table_deinit(world, table);
+        EcsTable *table = ecs_world_table(world, i);
+        if (table->family_id) {
+            ecs_table_deinit(world, table);
+        }
     }
 
     /* Free builtin systems */
@@ -217,11 +209,20 @@ void clean_tables(
     deinit_row_system(deinit_table_sys);
 
     for (i = 0; i < count; i ++) {
-        EcsTable *table = &buffer[i];
-        ecs_table_free(world, table);
+        EcsTable *table = ecs_world_table(world, i);
+        if (table->family_id) {
+            ecs_table_free(world, table);
+        }
+    }
+
+    EcsTable **pages = ecs_array_buffer(world->table_db);
+    count = ecs_array_count(world->table_db);
+    for (i = 0; i < count; i ++) {
+        ecs_os_free(pages[i]);
     }
 
     ecs_array_free(world->table_db);
+    ecs_array_free(world->table_free);
 }
 
 /** Cleanup resources allocated by table systems */
@@ -239,7 +240,7 @@ void remove_systems(
         {
             void *data = ecs_column(rows, row, 0);
             if (component == EcsTableSystem_h) {
-                deinit_table_system(data);
+                ecs_system_deinit(data);
             } else {
                 deinit_row_system(data);
             }
@@ -247,6 +248,174 @@ void remove_systems(
     }
 }
 
+/** Test if any stage has changes to components read by a system */
+static
+bool stages_intersect(
+    EcsWorld *world,
+    EcsSystem *system_data)
+{
+    if (ecs_stage_intersects(world, &world->stage, system_data)) {
+        return true;
+    }
+
+    uint32_t i, count = ecs_array_count(world->worker_threads);
+    EcsThread **buffer = ecs_array_buffer(world->worker_threads);
+    for (i = 1; i < count; i ++) {
+        if (ecs_stage_intersects(world, buffer[i]->stage, system_data)) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/** Test if no stage has data to merge */
+static
+bool stages_empty(
+    EcsWorld *world)
+{
+    if (!ecs_stage_is_empty(&world->stage)) {
+        return false;
+    }
+
+    uint32_t i, count = ecs_array_count(world->worker_threads);
+    EcsThread **buffer = ecs_array_buffer(world->worker_threads);
+    for (i = 1; i < count; i ++) {
+        if (!ecs_stage_is_empty(buffer[i]->stage)) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/** Merge stages at a sync point. Jobs that were prepared for earlier systems
+ * in the phase are ran first, as the systems may still stage changes. */
+static
+void sync_stages(
+    EcsWorld *world,
+    bool has_threads)
+{
+    if (has_threads) {
+        ecs_run_jobs(world);
+    }
+
+    world->in_progress = false;
+    ecs_merge(world);
+    world->in_progress = true;
+    world->sync_count ++;
+}
+
+/** Test if stages must be merged before running a system of a phase. Stages
+ * are only merged at sync points, and only if a system reads components of
+ * entities that were changed by an earlier system. */
+static
+bool sync_needed(
+    EcsWorld *world,
+    EcsHandle *buffer,
+    uint32_t count,
+    uint32_t index)
+{
+    if (!world->auto_merge) {
+        return false;
+    }
+
+    uint32_t i;
+
+    /* Sync point between phases applies to all systems in the phase */
+    if (!index && world->phase_sync) {
+        for (i = 0; i < count; i ++) {
+            EcsSystem *system_data = ecs_get_ptr(
+                world, buffer[i], EcsTableSystem_h);
+            if (stages_intersect(world, system_data)) {
+                return true;
+            }
+        }
+    }
+
+    EcsSystem *system_data = ecs_get_ptr(
+        world, buffer[index], EcsTableSystem_h);
+
+    return system_data->sync && stages_intersect(world, system_data);
+}
+
+/** Run the systems of a phase. If worker threads are available, the systems are
+ * scheduled as jobs. ecs_run_jobs does not return before all jobs of the phase
+ * have finished, which ensures phases are executed in order. */
+static
+void run_systems(
+    EcsWorld *world,
+    EcsArray *systems,
+    float delta_time,
+    bool has_threads)
+{
+    uint32_t i, system_count = ecs_array_count(systems);
+    if (!system_count) {
+        return;
+    }
+
+    /* Merging at a sync point can activate and deactivate systems, which
+     * modifies the array with systems, so iterate a copy */
+    EcsHandle buffer[system_count];
+    memcpy(buffer, ecs_array_buffer(systems), sizeof(EcsHandle) * system_count);
+
+    world->in_progress = true;
+
+    if (has_threads) {
+        bool valid_schedule = world->valid_schedule;
+
+        /* Systems run at the same time, so changes made by systems in this
+         * batch must be newer than what any of them has seen */
+        uint64_t seen = world->change_version;
+
+        for (i = 0; i < system_count; i ++) {
+            /* Merging changes tables, so systems need to be rescheduled */
+            if (sync_needed(world, buffer, system_count, i)) {
+                sync_stages(world, true);
+                valid_schedule = false;
+            }
+            if (!valid_schedule) {
+                ecs_schedule_jobs(world, buffer[i], NULL, 0);
+            }
+            ecs_prepare_jobs(world, buffer[i], delta_time, seen);
+        }
+        ecs_run_jobs(world);
+    } else {
+        for (i = 0; i < system_count; i ++) {
+            if (sync_needed(world, buffer, system_count, i)) {
+                sync_stages(world, false);
+            }
+            ecs_run_system(world, buffer[i], delta_time, 0, NULL);
+        }
+    }
+}
+
+/** Run periodic row systems (not matched to any entity). Tasks do not depend on
+ * each other, so with worker threads they are spread out over the threads. */
+static
+void run_tasks(
+    EcsWorld *world,
+    float delta_time,
+    bool has_threads)
+{
+    uint32_t i, system_count = ecs_array_count(world->tasks);
+    if (!system_count) {
+        return;
+    }
+
+    world->in_progress = true;
+
+    if (has_threads) {
+        ecs_prepare_tasks(world, world->tasks, delta_time);
+        ecs_run_jobs(world);
+    } else {
+        EcsHandle *buffer = ecs_array_buffer(world->tasks);
+        for (i = 0; i < system_count; i ++) {
+            ecs_run_task(world, buffer[i], delta_time);
+        }
+    }
+}
+
 /* -- Private functions -- */
 
 void _assert_func(
@@ -263,6 +432,69 @@ void _assert_func(
     }
 }
 
+/** Add a table to table_db. Tables are allocated in pages, so that a table
+ * never moves in memory once it has been created. Slots of collected tables
+ * are reused before new slots are added. */
+EcsTable* ecs_world_add_table(
+    EcsWorld *world)
+{
+    uint32_t index, count = ecs_array_count(world->table_free);
+
+    if (count) {
+        uint32_t *slots = ecs_array_buffer(world->table_free);
+        index = slots[count - 1];
+        ecs_array_remove_index(world->table_free, &index_arr_params, count - 1);
+    } else {
+        index = world->table_count ++;
+        if (!(index % ECS_TABLE_PAGE_SIZE)) {
+            EcsTable **page = ecs_array_add(
+                &world->table_db, &table_page_arr_params);
+            *page = ecs_os_calloc(sizeof(EcsTable) * ECS_TABLE_PAGE_SIZE);
+        }
+    }
+
+    EcsTable *result = ecs_world_table(world, index);
+    result->index = index;
+    return result;
+}
+
+/** Versions are issued from a single counter, so that a system can test whether
+ * any column of a table changed after it last processed the table by comparing
+ * with one version. Merges may run in worker threads, so the counter is
+ * incremented atomically. */
+uint64_t ecs_world_next_version(
+    EcsWorld *world)
+{
+    return __atomic_add_fetch(&world->change_version, 1, __ATOMIC_RELAXED);
+}
+
+/** Get table by its index in table_db */
+EcsTable* ecs_world_table(
+    EcsWorld *world,
+    uint32_t index)
+{
+    EcsTable **pages = ecs_array_buffer(world->table_db);
+    return &pages[index / ECS_TABLE_PAGE_SIZE][index % ECS_TABLE_PAGE_SIZE];
+}
+
+void ecs_world_notify_create_table(
+    EcsWorld *world,
+    EcsStage *stage,
+    EcsTable *table)
+{
+    notify_create_table(world, stage, world->pre_frame_systems, table);
+    notify_create_table(world, stage, world->post_frame_systems, table);
+    notify_create_table(world, stage, world->frame_systems, table);
+    notify_create_table(world, stage, world->inactive_systems, table);
+    notify_create_table(world, stage, world->on_demand_systems, table);
+
+    EcsQuery **queries = ecs_array_buffer(world->queries);
+    uint32_t i, count = ecs_array_count(world->queries);
+    for (i = 0; i < count; i ++) {
+        ecs_query_notify_create_table(world, stage, queries[i], table);
+    }
+}
+
 /** Get pointer to table data from family id */
 EcsTable* ecs_world_get_table(
     EcsWorld *world,
@@ -280,8 +512,7 @@ EcsTable* ecs_world_get_table(
     }
 
     if (table_index) {
-        return ecs_array_get(
-            world->table_db, &table_arr_params, table_index - 1);
+        return ecs_world_table(world, table_index - 1);
     } else {
         return create_table(world, stage, family_id);
     }
@@ -323,6 +554,15 @@ void ecs_world_activate_system(
 {
     EcsArray *src_array, *dst_array;
 
+    /* Systems with a sync point stay active, as merging at the sync point can
+     * add entities to their tables */
+    if (!active) {
+        EcsSystem *system_data = ecs_get_ptr(world, system, EcsTableSystem_h);
+        if (system_data && system_data->sync) {
+            return;
+        }
+    }
+
     if (active) {
         src_array = world->inactive_systems;
         dst_array = *frame_system_array(world, kind);
@@ -411,7 +651,9 @@ char* ecs_family_tostr(
 
     *(char*)ecs_array_add(&chbuf, &char_arr_params) = '\0';
 
-    char *result = strdup(ecs_array_buffer(chbuf));
+    uint32_t size = ecs_array_count(chbuf);
+    char *result = ecs_os_malloc(size);
+    memcpy(result, ecs_array_buffer(chbuf), size);
     ecs_array_free(chbuf);
     return result;
 }
@@ -436,11 +678,13 @@ EcsStage *ecs_get_stage(
 /* -- Public functions -- */
 
 EcsWorld *ecs_init(void) {
-    EcsWorld *world = malloc(sizeof(EcsWorld));
+    EcsWorld *world = ecs_os_malloc(sizeof(EcsWorld));
     world->magic = ECS_WORLD_MAGIC;
 
     world->table_db = ecs_array_new(
-        &table_arr_params, ECS_WORLD_INITIAL_TABLE_COUNT);
+        &table_page_arr_params, ECS_WORLD_INITIAL_TABLE_COUNT);
+    world->table_free = NULL;
+    world->table_count = 0;
     world->frame_systems = ecs_array_new(
         &handle_arr_params, ECS_WORLD_INITIAL_PERIODIC_SYSTEM_COUNT);
     world->pre_frame_systems = ecs_array_new(
@@ -451,6 +695,7 @@ EcsWorld *ecs_init(void) {
         &handle_arr_params, ECS_WORLD_INITIAL_PERIODIC_SYSTEM_COUNT);
     world->on_demand_systems = ecs_array_new(
         &handle_arr_params, ECS_WORLD_INITIAL_PERIODIC_SYSTEM_COUNT);
+    world->queries = ecs_array_new(&query_arr_params, 0);
 
     world->add_systems = ecs_map_new(ECS_WORLD_INITIAL_INIT_SYSTEM_COUNT);
     world->remove_systems = ecs_map_new(ECS_WORLD_INITIAL_DEINIT_SYSTEM_COUNT);
@@ -465,9 +710,15 @@ EcsWorld *ecs_init(void) {
     world->family_index = ecs_map_new(ECS_WORLD_INITIAL_TABLE_COUNT * 2);
     world->family_handles = ecs_map_new(ECS_WORLD_INITIAL_TABLE_COUNT * 2);
     world->prefab_index = ecs_map_new(ECS_WORLD_INITIAL_PREFAB_COUNT);
+    world->parent_index = ecs_map_new(ECS_WORLD_INITIAL_HIERARCHY_COUNT);
+    world->child_index = ecs_map_new(ECS_WORLD_INITIAL_HIERARCHY_COUNT);
 
-    world->stage_db = NULL;
     world->worker_threads = NULL;
+    world->task_jobs = NULL;
+    world->merge_jobs = NULL;
+    world->merge_tables = NULL;
+    world->merge_index = NULL;
+    world->merge_removed = NULL;
     world->jobs_finished = 0;
     world->threads_running = 0;
     world->valid_schedule = false;
@@ -478,7 +729,26 @@ EcsWorld *ecs_init(void) {
     world->measure_frame_time = false;
     world->measure_system_time = false;
     world->last_handle = 0;
+    world->handle_block_count = 0;
+    world->sync_count = 0;
+    world->huge_page_threshold = 0;
+    world->gc_frames = 0;
+    world->change_version = 0;
+    world->dirty_family = 0;
+    world->notify_version = 0;
+    world->component_cache = ecs_array_new(&component_cache_arr_params, 0);
+    world->sort_component = 0;
+    world->sort_action = NULL;
+    world->phase_sync = false;
     world->should_quit = false;
+    world->pin_threads = false;
+    world->autotune_threads = false;
+    world->active_threads = 0;
+    world->job_generation = 0;
+    world->tune_frames = 0;
+    world->jobs_time = 0;
+    world->jobs_pending = false;
+    world->system_run.system = 0;
 
     ut_time_get(&world->frame_start);
     world->frame_time = 0;
@@ -486,6 +756,7 @@ EcsWorld *ecs_init(void) {
     world->target_fps = 0;
     world->fps_sleep = 0;
     world->tick = 0;
+    world->frame_count = 0;
 
     ecs_stage_init(&world->stage);
 
@@ -551,16 +822,38 @@ EcsResult ecs_fini(
         ecs_set_threads(world, 0);
     }
 
+    /* Queries are registered with tables, so free them first */
+    EcsQuery **queries = ecs_array_buffer(world->queries);
+    for (i = ecs_array_count(world->queries); i > 0; i --) {
+        ecs_free_query(world, queries[i - 1]);
+    }
+
     clean_tables(world);
     clean_families(world);
 
     ecs_stage_deinit(&world->stage);
 
     ecs_array_free(world->frame_systems);
+    ecs_array_free(world->pre_frame_systems);
+    ecs_array_free(world->post_frame_systems);
     ecs_array_free(world->inactive_systems);
     ecs_array_free(world->on_demand_systems);
+    ecs_array_free(world->queries);
     ecs_array_free(world->tasks);
     ecs_array_free(world->fini_tasks);
+    ecs_array_free(world->component_cache);
+    if (world->task_jobs) ecs_array_free(world->task_jobs);
+    if (world->merge_jobs) ecs_array_free(world->merge_jobs);
+    if (world->merge_tables) {
+        EcsMergeTable *buffer = ecs_array_buffer(world->merge_tables);
+        uint32_t i, count = ecs_array_count(world->merge_tables);
+        for (i = 0; i < count; i ++) {
+            ecs_array_free(buffer[i].rows);
+        }
+        ecs_array_free(world->merge_tables);
+        ecs_map_free(world->merge_index);
+        ecs_array_free(world->merge_removed);
+    }
 
     ecs_map_free(world->add_systems);
     ecs_map_free(world->remove_systems);
@@ -570,7 +863,14 @@ EcsResult ecs_fini(
     ecs_map_free(world->family_handles);
     ecs_map_free(world->prefab_index);
 
-    free(world);
+    EcsIter it = ecs_map_iter(world->child_index);
+    while (ecs_iter_hasnext(&it)) {
+        ecs_array_free(ecs_iter_next(&it));
+    }
+    ecs_map_free(world->child_index);
+    ecs_map_free(world->parent_index);
+
+    ecs_os_free(world);
 
     return EcsOk;
 }
@@ -593,7 +893,23 @@ void ecs_dim_family(
         EcsFamily family_id = ecs_family_from_handle(world, NULL, type, NULL);
         EcsTable *table = ecs_world_get_table(world, NULL, family_id);
         if (table) {
-            ecs_array_set_size(&table->rows, &table->row_params, entity_count);
+            ecs_table_dim(world, table, entity_count);
+        }
+    }
+}
+
+void ecs_set_huge_page_threshold(
+    EcsWorld *world,
+    size_t size)
+{
+    assert(world->magic == ECS_WORLD_MAGIC);
+    world->huge_page_threshold = size;
+
+    uint32_t i, count = world->table_count;
+    for (i = 0; i < count; i ++) {
+        EcsTable *table = ecs_world_table(world, i);
+        if (table->family_id) {
+            ecs_table_dim(world, table, 0);
         }
     }
 }
@@ -602,12 +918,16 @@ EcsHandle ecs_lookup(
     EcsWorld *world,
     const char *id)
 {
-    EcsIter it = ecs_array_iter(world->table_db, &table_arr_params);
+    uint32_t i, table_count = world->table_count;
 
-    while (ecs_iter_hasnext(&it)) {
-        EcsTable *table = ecs_iter_next(&it);
+    for (i = 0; i < table_count; i ++) {
+        EcsTable *table = ecs_world_table(world, i);
         uint32_t offset;
 
+        if (!table->family_id) {
+            continue;
+        }
+
         if ((offset = ecs_table_column_offset(table, EcsId_h)) == -1) {
             continue;
         }
@@ -633,6 +953,7 @@ bool ecs_progress(
     float delta_time)
 {
     assert(world->magic == ECS_WORLD_MAGIC);
+    assert(!world->system_run.system);
 
     bool measure_frame_time = world->measure_frame_time;
 
@@ -646,55 +967,34 @@ bool ecs_progress(
 
     world->delta_time = delta_time;
 
-    /* Run pre-frame systems */
-    uint32_t i, system_count = ecs_array_count(world->pre_frame_systems);
-    EcsHandle *buffer = ecs_array_buffer(world->pre_frame_systems);
-    for (i = 0; i < system_count; i ++) {
-        ecs_run_system(world, buffer[i], delta_time, 0, NULL);
-    }
+    bool has_threads = ecs_array_count(world->worker_threads) != 0;
 
-    /* Run periodic table systems */
-    system_count = ecs_array_count(world->frame_systems);
-    if (system_count) {
-        buffer = ecs_array_buffer(world->frame_systems);
-        bool has_threads = ecs_array_count(world->worker_threads) != 0;
-
-        world->in_progress = true;
-
-        if (has_threads) {
-            bool valid_schedule = world->valid_schedule;
-            for (i = 0; i < system_count; i ++) {
-                if (!valid_schedule) {
-                    ecs_schedule_jobs(world, buffer[i]);
-                }
-                ecs_prepare_jobs(world, buffer[i]);
-            }
-            ecs_run_jobs(world);
+    /* Restore the order of tables that changed since the last frame */
+    ecs_sort_tables(world);
 
-            world->valid_schedule = true;
-        } else {
-            for (i = 0; i < system_count; i ++) {
-                ecs_run_system(world, buffer[i], delta_time, 0, NULL);
-            }
-        }
+    /* Run systems in phases. When using worker threads, jobs of a phase must
+     * have finished before the next phase starts. */
+    run_systems(world, world->pre_frame_systems, delta_time, has_threads);
+
+    /* Changes made by EcsPreFrame systems are merged before EcsOnFrame
+     * systems run, so that the other phases see them in the same frame. Jobs
+     * of the phase have already finished, and merging changes tables, so jobs
+     * need to be rescheduled. */
+    if (world->in_progress && world->auto_merge && !stages_empty(world)) {
+        sync_stages(world, false);
+        world->valid_schedule = false;
     }
 
-    /* Run periodic row systems (not matched to any entity) */
-    system_count = ecs_array_count(world->tasks);
-    if (system_count) {
-        world->in_progress = true;
+    run_systems(world, world->frame_systems, delta_time, has_threads);
+    run_tasks(world, delta_time, has_threads);
+    run_systems(world, world->post_frame_systems, delta_time, has_threads);
 
-        EcsHandle *buffer = ecs_array_buffer(world->tasks);
-        for (i = 0; i < system_count; i ++) {
-            ecs_run_task(world, buffer[i], delta_time);
-        }
-    }
+    if (has_threads) {
+        world->valid_schedule = true;
 
-    /* Run post-frame systems */
-    system_count = ecs_array_count(world->post_frame_systems);
-    buffer = ecs_array_buffer(world->post_frame_systems);
-    for (i = 0; i < system_count; i ++) {
-        ecs_run_system(world, buffer[i], delta_time, 0, NULL);
+        if (world->autotune_threads) {
+            ecs_tune_threads(world);
+        }
     }
 
     /* Profile system time & merge if systems were processed */
@@ -708,9 +1008,15 @@ bool ecs_progress(
 
         if (world->auto_merge) {
             ecs_merge(world);
+
+            if (world->gc_frames && !(world->frame_count % world->gc_frames)) {
+                ecs_gc(world);
+            }
         }
     }
 
+    world->frame_count ++;
+
     /*  Profile total frame time */
     if (measure_frame_time) {
         struct timespec t = world->frame_start;
@@ -749,20 +1055,55 @@ void ecs_merge(
 {
     assert(world->magic == ECS_WORLD_MAGIC);
     assert(world->is_merging == false);
+    assert(!world->system_run.system);
 
     world->is_merging = true;
 
     ecs_stage_merge(world, &world->stage);
 
-    uint32_t i, count = ecs_array_count(world->stage_db);
-    EcsStage *buffer = ecs_array_buffer(world->stage_db);
-    for (i = 0; i < count; i ++) {
-        ecs_stage_merge(world, &buffer[i]);
+    /* Thread 0 is the main thread, which uses the stage of the world */
+    uint32_t i, count = ecs_array_count(world->worker_threads);
+    EcsThread **buffer = ecs_array_buffer(world->worker_threads);
+    for (i = 1; i < count; i ++) {
+        ecs_stage_merge(world, buffer[i]->stage);
     }
 
     world->is_merging = false;
 }
 
+void ecs_set_sync_point(
+    EcsWorld *world,
+    EcsHandle system,
+    bool sync)
+{
+    assert(world->magic == ECS_WORLD_MAGIC);
+    EcsTableSystem *system_data = ecs_get_ptr(world, system, EcsTableSystem_h);
+    assert(system_data != NULL);
+
+    EcsSystemKind kind = system_data->base.kind;
+    if (kind == EcsOnDemand) {
+        return;
+    }
+
+    if (sync) {
+        ecs_world_activate_system(world, system, kind, true);
+        system_data->base.sync = true;
+    } else {
+        system_data->base.sync = false;
+        if (!ecs_array_count(system_data->tables)) {
+            ecs_world_activate_system(world, system, kind, false);
+        }
+    }
+}
+
+void ecs_set_phase_sync(
+    EcsWorld *world,
+    bool sync)
+{
+    assert(world->magic == ECS_WORLD_MAGIC);
+    world->phase_sync = sync;
+}
+
 void ecs_set_automerge(
     EcsWorld *world,
     bool auto_merge)
@@ -0,0 +1,204 @@
+/* This is a managed file. Do not delete this comment. */
+
+#include <include/test.h>
+
+typedef struct Foo {
+    int x;
+} Foo;
+
+typedef struct Bar {
+    int x;
+} Bar;
+
+static int alloc_count;
+static int live_count;
+
+static
+void* count_alloc(
+    size_t size,
+    void *ctx)
+{
+    __sync_fetch_and_add(&alloc_count, 1);
+    __sync_fetch_and_add(&live_count, 1);
+    return malloc(size);
+}
+
+static
+void* count_realloc(
+    void *ptr,
+    size_t size,
+    void *ctx)
+{
+    return realloc(ptr, size);
+}
+
+static
+void count_free(
+    void *ptr,
+    void *ctx)
+{
+    __sync_fetch_and_sub(&live_count, 1);
+    free(ptr);
+}
+
+static EcsAllocator count_allocator = {
+    .alloc = count_alloc,
+    .realloc = count_realloc,
+    .free = count_free
+};
+
+void AllocAddBar(EcsRows *rows) {
+    EcsHandle Bar_h = *(EcsHandle*)ecs_get_context(rows->world);
+    void *row;
+    for (row = rows->first; row < rows->last; row = ecs_next(rows, row)) {
+        Foo *foo = ecs_column(rows, row, 0);
+        ecs_set(rows->world, ecs_entity(row), Bar, {foo->x * 2});
+    }
+}
+
+static
+void run_world(
+    uint32_t threads)
+{
+    EcsWorld *world = ecs_init();
+    test_assert(world != NULL);
+
+    ECS_COMPONENT(world, Foo);
+    ECS_COMPONENT(world, Bar);
+    ECS_SYSTEM(world, AllocAddBar, EcsOnFrame, Foo, !Bar);
+
+    if (threads) {
+        test_assert(ecs_set_threads(world, threads) == EcsOk);
+    }
+
+    int i, ENTITIES = 1000;
+    EcsHandle handles[ENTITIES];
+    for (i = 0; i < ENTITIES; i ++) {
+        handles[i] = ecs_set(world, 0, Foo, {i});
+    }
+
+    ecs_set_context(world, &Bar_h);
+    ecs_progress(world, 0);
+
+    for (i = 0; i < ENTITIES; i ++) {
+        test_assert(ecs_has(world, handles[i], Bar_h));
+        test_assertint(ecs_get(world, handles[i], Bar).x, i * 2);
+    }
+
+    ecs_fini(world);
+}
+
+void test_EcsAllocator_tc_custom_allocator(
+    test_EcsAllocator this)
+{
+    alloc_count = 0;
+    live_count = 0;
+
+    ecs_set_allocator(&count_allocator);
+    test_assert(ecs_get_allocator()->alloc == count_alloc);
+    run_world(0);
+    ecs_set_allocator(NULL);
+
+    test_assert(alloc_count != 0);
+    test_assertint(live_count, 0);
+}
+
+void test_EcsAllocator_tc_custom_allocator_w_threads(
+    test_EcsAllocator this)
+{
+    alloc_count = 0;
+    live_count = 0;
+
+    ecs_set_allocator(&count_allocator);
+    run_world(4);
+    ecs_set_allocator(NULL);
+
+    test_assert(alloc_count != 0);
+    test_assertint(live_count, 0);
+}
+
+void test_EcsAllocator_tc_pool_allocator(
+    test_EcsAllocator this)
+{
+    const EcsAllocator *pool = ecs_pool_allocator();
+    test_assert(pool->alloc_fixed != NULL);
+    test_assert(pool->free_fixed != NULL);
+
+    ecs_set_allocator(pool);
+    run_world(0);
+    run_world(4);
+    ecs_set_allocator(NULL);
+
+    test_assert(ecs_get_allocator()->alloc_fixed == NULL);
+}
+
+void test_EcsAllocator_tc_huge_page_threshold(
+    test_EcsAllocator this)
+{
+    EcsWorld *world = ecs_init();
+    test_assert(world != NULL);
+
+    ECS_COMPONENT(world, Foo);
+    ECS_COMPONENT(world, Bar);
+    ECS_SYSTEM(world, AllocAddBar, EcsOnFrame, Foo, !Bar);
+
+    ecs_set_huge_page_threshold(world, 1024);
+
+    int i, ENTITIES = 10000;
+    EcsHandle *handles = malloc(ENTITIES * sizeof(EcsHandle));
+    for (i = 0; i < ENTITIES; i ++) {
+        handles[i] = ecs_set(world, 0, Foo, {i});
+    }
+
+    ecs_set_context(world, &Bar_h);
+    ecs_progress(world, 0);
+
+    for (i = 0; i < ENTITIES; i ++) {
+        test_assert(ecs_has(world, handles[i], Bar_h));
+        test_assertint(ecs_get(world, handles[i], Foo).x, i);
+        test_assertint(ecs_get(world, handles[i], Bar).x, i * 2);
+    }
+
+    /* Deleting most entities shrinks the table */
+    for (i = 0; i < ENTITIES - 10; i ++) {
+        ecs_delete(world, handles[i]);
+    }
+
+    for (; i < ENTITIES; i ++) {
+        test_assertint(ecs_get(world, handles[i], Foo).x, i);
+        test_assertint(ecs_get(world, handles[i], Bar).x, i * 2);
+    }
+
+    free(handles);
+    ecs_fini(world);
+}
+
+void test_EcsAllocator_tc_huge_page_dim_family(
+    test_EcsAllocator this)
+{
+    EcsWorld *world = ecs_init();
+    test_assert(world != NULL);
+
+    ECS_COMPONENT(world, Foo);
+    ECS_COMPONENT(world, Bar);
+    ECS_FAMILY(world, FooBar, Foo, Bar);
+
+    ecs_set_huge_page_threshold(world, 1024 * 1024);
+    ecs_dim_family(world, FooBar_h, 100000);
+
+    int i, ENTITIES = 100000;
+    EcsHandle *handles = malloc(ENTITIES * sizeof(EcsHandle));
+    for (i = 0; i < ENTITIES; i ++) {
+        handles[i] = ecs_new(world, FooBar_h);
+        ecs_set(world, handles[i], Foo, {i});
+        ecs_set(world, handles[i], Bar, {i * 2});
+    }
+
+    for (i = 0; i < ENTITIES; i ++) {
+        test_assertint(ecs_get(world, handles[i], Foo).x, i);
+        test_assertint(ecs_get(world, handles[i], Bar).x, i * 2);
+    }
+
+    free(handles);
+    ecs_fini(world);
+}
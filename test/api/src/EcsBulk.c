@@ -0,0 +1,261 @@
+/* This is a managed file. Do not delete this comment. */
+
+#include <include/test.h>
+
+typedef struct Foo {
+    int x;
+    int y;
+} Foo;
+
+typedef struct Bar {
+    int x;
+} Bar;
+
+static int set_invoked;
+static int set_rows;
+
+static
+void OnSetFoo(EcsRows *rows) {
+    void *row;
+    set_invoked ++;
+    for (row = rows->first; row < rows->last; row = ecs_next(rows, row)) {
+        set_rows ++;
+    }
+}
+
+static
+void ScatterFoo(EcsRows *rows) {
+    EcsHandle *entities = ecs_get_context(rows->world);
+    Foo values[3] = {{1, 2}, {3, 4}, {5, 6}};
+    ecs_scatter(rows->world, ecs_handle(rows, 1), entities, 3, values);
+}
+
+void test_EcsBulk_tc_scatter(
+    test_EcsBulk this)
+{
+    EcsWorld *world = ecs_init();
+    ECS_COMPONENT(world, Foo);
+    ECS_COMPONENT(world, Bar);
+    ECS_FAMILY(world, FooBar, Foo, Bar);
+
+    EcsHandle entities[4];
+    ecs_new_w_count(world, Foo_h, 2, entities);
+    ecs_new_w_count(world, FooBar_h, 2, &entities[2]);
+
+    Foo values[4] = {{10, 20}, {30, 40}, {50, 60}, {70, 80}};
+    ecs_scatter(world, Foo_h, entities, 4, values);
+
+    int i;
+    for (i = 0; i < 4; i ++) {
+        Foo *foo = ecs_get_ptr(world, entities[i], Foo_h);
+        test_assert(foo != NULL);
+        test_assertint(foo->x, values[i].x);
+        test_assertint(foo->y, values[i].y);
+    }
+
+    ecs_fini(world);
+}
+
+void test_EcsBulk_tc_scatter_add_component(
+    test_EcsBulk this)
+{
+    EcsWorld *world = ecs_init();
+    ECS_COMPONENT(world, Foo);
+    ECS_COMPONENT(world, Bar);
+
+    EcsHandle entities[3];
+    entities[0] = ecs_new(world, Foo_h);
+    entities[1] = ecs_new(world, Bar_h);
+    entities[2] = ecs_new(world, Foo_h);
+
+    Foo values[3] = {{1, 2}, {3, 4}, {5, 6}};
+    ecs_scatter(world, Foo_h, entities, 3, values);
+
+    /* Entity without the component is added to the component */
+    test_assert(ecs_has(world, entities[1], Foo_h));
+    test_assert(ecs_has(world, entities[1], Bar_h));
+
+    int i;
+    for (i = 0; i < 3; i ++) {
+        test_assertint(ecs_get(world, entities[i], Foo).x, values[i].x);
+        test_assertint(ecs_get(world, entities[i], Foo).y, values[i].y);
+    }
+
+    ecs_fini(world);
+}
+
+void test_EcsBulk_tc_scatter_on_set(
+    test_EcsBulk this)
+{
+    EcsWorld *world = ecs_init();
+    ECS_COMPONENT(world, Foo);
+    ECS_SYSTEM(world, OnSetFoo, EcsOnSet, Foo);
+
+    EcsHandle entities[10];
+    ecs_new_w_count(world, Foo_h, 10, entities);
+
+    Foo values[10] = {{0}};
+    set_invoked = 0;
+    set_rows = 0;
+    ecs_scatter(world, Foo_h, entities, 10, values);
+
+    /* OnSet systems are invoked once for a range of consecutive rows */
+    test_assertint(set_invoked, 1);
+    test_assertint(set_rows, 10);
+
+    /* Entities that are not ordered by row are notified in multiple ranges */
+    EcsHandle reversed[2] = {entities[1], entities[0]};
+    set_invoked = 0;
+    set_rows = 0;
+    ecs_scatter(world, Foo_h, reversed, 2, values);
+    test_assertint(set_invoked, 2);
+    test_assertint(set_rows, 2);
+
+    ecs_fini(world);
+}
+
+void test_EcsBulk_tc_scatter_in_progress(
+    test_EcsBulk this)
+{
+    EcsWorld *world = ecs_init();
+    ECS_COMPONENT(world, Foo);
+    ECS_COMPONENT(world, Bar);
+    ECS_SYSTEM(world, ScatterFoo, EcsOnFrame, Bar, HANDLE.Foo);
+
+    EcsHandle entities[3];
+    ecs_new_w_count(world, Foo_h, 3, entities);
+    ecs_new(world, Bar_h);
+    ecs_set_context(world, entities);
+
+    ecs_progress(world, 0);
+
+    test_assertint(ecs_get(world, entities[0], Foo).x, 1);
+    test_assertint(ecs_get(world, entities[1], Foo).x, 3);
+    test_assertint(ecs_get(world, entities[2], Foo).y, 6);
+
+    ecs_fini(world);
+}
+
+void test_EcsBulk_tc_gather(
+    test_EcsBulk this)
+{
+    EcsWorld *world = ecs_init();
+    ECS_COMPONENT(world, Foo);
+    ECS_COMPONENT(world, Bar);
+    ECS_FAMILY(world, FooBar, Foo, Bar);
+
+    EcsHandle entities[4];
+    entities[0] = ecs_set(world, 0, Foo, {1, 2});
+    entities[1] = ecs_new(world, Bar_h);
+    entities[2] = ecs_new(world, FooBar_h);
+    ecs_set(world, entities[2], Foo, {3, 4});
+    entities[3] = ecs_set(world, 0, Foo, {5, 6});
+
+    Foo values[4];
+    test_assertint(ecs_gather(world, Foo_h, entities, 4, values), 3);
+
+    test_assertint(values[0].x, 1);
+    test_assertint(values[0].y, 2);
+    test_assertint(values[1].x, 0);
+    test_assertint(values[1].y, 0);
+    test_assertint(values[2].x, 3);
+    test_assertint(values[2].y, 4);
+    test_assertint(values[3].x, 5);
+    test_assertint(values[3].y, 6);
+
+    ecs_fini(world);
+}
+
+void test_EcsBulk_tc_gather_prefab(
+    test_EcsBulk this)
+{
+    EcsWorld *world = ecs_init();
+    ECS_COMPONENT(world, Foo);
+    ECS_COMPONENT(world, Bar);
+    ECS_PREFAB(world, MyPrefab, Foo);
+    ECS_FAMILY(world, MyFamily, MyPrefab, Bar);
+
+    ecs_set(world, MyPrefab_h, Foo, {10, 20});
+
+    EcsHandle entities[2];
+    ecs_new_w_count(world, MyFamily_h, 2, entities);
+
+    Foo values[2];
+    test_assertint(ecs_gather(world, Foo_h, entities, 2, values), 2);
+    test_assertint(values[0].x, 10);
+    test_assertint(values[1].y, 20);
+
+    ecs_fini(world);
+}
+
+void test_EcsBulk_tc_copy_column(
+    test_EcsBulk this)
+{
+    EcsWorld *world = ecs_init();
+    ECS_COMPONENT(world, Foo);
+    ECS_COMPONENT(world, Bar);
+    ECS_FAMILY(world, FooBar, Foo, Bar);
+
+    EcsHandle entities[5];
+    ecs_new_w_count(world, Foo_h, 3, entities);
+    ecs_new_w_count(world, FooBar_h, 2, &entities[3]);
+    ecs_new(world, Bar_h);
+
+    int i;
+    for (i = 0; i < 5; i ++) {
+        ecs_set(world, entities[i], Foo, {i, i * 2});
+    }
+
+    test_assertint(ecs_copy_column(world, Foo_h, 0, NULL, 0, NULL), 5);
+
+    Foo values[5];
+    EcsHandle handles[5];
+    test_assertint(ecs_copy_column(world, Foo_h, 0, values, 5, handles), 5);
+
+    /* Each copied value is stored at the index of its entity */
+    int found = 0;
+    for (i = 0; i < 5; i ++) {
+        int j;
+        for (j = 0; j < 5; j ++) {
+            if (handles[i] == entities[j]) {
+                test_assertint(values[i].x, j);
+                test_assertint(values[i].y, j * 2);
+                found ++;
+            }
+        }
+    }
+    test_assertint(found, 5);
+
+    /* Copy is limited by capacity */
+    test_assertint(ecs_copy_column(world, Foo_h, 0, values, 4, NULL), 4);
+
+    ecs_fini(world);
+}
+
+void test_EcsBulk_tc_copy_column_filter(
+    test_EcsBulk this)
+{
+    EcsWorld *world = ecs_init();
+    ECS_COMPONENT(world, Foo);
+    ECS_COMPONENT(world, Bar);
+    ECS_FAMILY(world, FooBar, Foo, Bar);
+
+    EcsHandle entities[2];
+    ecs_new_w_count(world, Foo_h, 3, NULL);
+    ecs_new_w_count(world, FooBar_h, 2, entities);
+    ecs_set(world, entities[0], Foo, {1, 2});
+    ecs_set(world, entities[1], Foo, {3, 4});
+
+    test_assertint(ecs_copy_column(world, Foo_h, Bar_h, NULL, 0, NULL), 2);
+
+    Foo values[2];
+    EcsHandle handles[2];
+    test_assertint(
+        ecs_copy_column(world, Foo_h, Bar_h, values, 2, handles), 2);
+    test_assert(handles[0] == entities[0]);
+    test_assert(handles[1] == entities[1]);
+    test_assertint(values[0].x, 1);
+    test_assertint(values[1].y, 4);
+
+    ecs_fini(world);
+}
@@ -0,0 +1,293 @@
+/* This is a managed file. Do not delete this comment. */
+
+#include <include/test.h>
+
+typedef struct Foo {
+    int x;
+} Foo;
+
+typedef struct Bar {
+    int x;
+} Bar;
+
+/* Counters are updated atomically, as systems may run on worker threads */
+static int invoked;
+static int rows_invoked;
+
+void ReadFoo(EcsRows *rows) {
+    void *row;
+    int count = 0;
+    for (row = rows->first; row < rows->last; row = ecs_next(rows, row)) {
+        count ++;
+    }
+
+    __sync_fetch_and_add(&invoked, 1);
+    __sync_fetch_and_add(&rows_invoked, count);
+}
+
+void WriteFoo(EcsRows *rows) {
+    void *row;
+    for (row = rows->first; row < rows->last; row = ecs_next(rows, row)) {
+        Foo *foo = ecs_column(rows, row, 0);
+        foo->x ++;
+    }
+}
+
+void IncFoo(EcsRows *rows) {
+    __sync_fetch_and_add(&invoked, 1);
+    WriteFoo(rows);
+}
+
+void SetFoo(EcsRows *rows) {
+    void *row;
+    for (row = rows->first; row < rows->last; row = ecs_next(rows, row)) {
+        EcsHandle entity = ecs_entity(row);
+        Bar *bar = ecs_column(rows, row, 0);
+        ecs_set_ptr(rows->world, entity, ecs_handle(rows, 1), &(Foo){bar->x});
+    }
+}
+
+void test_EcsChange_tc_skip_unchanged(
+    test_EcsChange this)
+{
+    EcsWorld *world = ecs_init();
+    test_assert(world != NULL);
+
+    ECS_COMPONENT(world, Foo);
+    ECS_SYSTEM(world, ReadFoo, EcsOnFrame, [in] Foo);
+    ecs_set_skip_unchanged(world, ReadFoo_h, true);
+
+    EcsHandle e1 = ecs_set(world, 0, Foo, {10});
+    ecs_set(world, 0, Foo, {20});
+
+    invoked = 0;
+    ecs_progress(world, 0);
+    test_assertint(invoked, 1);
+
+    /* Nothing changed */
+    invoked = 0;
+    ecs_progress(world, 0);
+    ecs_progress(world, 0);
+    test_assertint(invoked, 0);
+
+    ecs_set(world, e1, Foo, {11});
+
+    invoked = 0;
+    ecs_progress(world, 0);
+    test_assertint(invoked, 1);
+
+    invoked = 0;
+    ecs_progress(world, 0);
+    test_assertint(invoked, 0);
+
+    /* System runs every frame when it no longer skips tables */
+    ecs_set_skip_unchanged(world, ReadFoo_h, false);
+
+    invoked = 0;
+    ecs_progress(world, 0);
+    ecs_progress(world, 0);
+    test_assertint(invoked, 2);
+
+    ecs_fini(world);
+}
+
+void test_EcsChange_tc_skip_unchanged_new_entity(
+    test_EcsChange this)
+{
+    EcsWorld *world = ecs_init();
+    test_assert(world != NULL);
+
+    ECS_COMPONENT(world, Foo);
+    ECS_COMPONENT(world, Bar);
+    ECS_FAMILY(world, FooBar, Foo, Bar);
+    ECS_SYSTEM(world, ReadFoo, EcsOnFrame, [in] Foo);
+    ecs_set_skip_unchanged(world, ReadFoo_h, true);
+
+    ecs_new(world, Foo_h);
+    EcsHandle e2 = ecs_new(world, FooBar_h);
+    ecs_new(world, FooBar_h);
+
+    rows_invoked = 0;
+    ecs_progress(world, 0);
+    test_assertint(rows_invoked, 3);
+
+    /* Only the table to which the entity is added is evaluated */
+    ecs_new(world, Foo_h);
+
+    rows_invoked = 0;
+    ecs_progress(world, 0);
+    test_assertint(rows_invoked, 2);
+
+    ecs_delete(world, e2);
+
+    rows_invoked = 0;
+    ecs_progress(world, 0);
+    test_assertint(rows_invoked, 1);
+
+    /* Changing a column that the system does not read is not a change */
+    EcsHandle e3 = ecs_new(world, FooBar_h);
+    ecs_progress(world, 0);
+    ecs_set(world, e3, Bar, {10});
+
+    rows_invoked = 0;
+    ecs_progress(world, 0);
+    test_assertint(rows_invoked, 0);
+
+    ecs_fini(world);
+}
+
+void test_EcsChange_tc_skip_unchanged_out_column(
+    test_EcsChange this)
+{
+    EcsWorld *world = ecs_init();
+    test_assert(world != NULL);
+
+    ECS_COMPONENT(world, Foo);
+    ECS_COMPONENT(world, Bar);
+    ECS_SYSTEM(world, WriteFoo, EcsOnFrame, [out] Foo, [in] Bar);
+    ECS_SYSTEM(world, ReadFoo, EcsOnFrame, [in] Foo);
+    ecs_set_skip_unchanged(world, ReadFoo_h, true);
+
+    EcsHandle e1 = ecs_new(world, Foo_h);
+    ecs_add(world, e1, Bar_h);
+    ecs_set(world, e1, Foo, {10});
+    ecs_new(world, Foo_h);
+
+    invoked = 0;
+    ecs_progress(world, 0);
+    test_assertint(invoked, 2);
+
+    /* Foo of first table is written every frame */
+    invoked = 0;
+    ecs_progress(world, 0);
+    ecs_progress(world, 0);
+    test_assertint(invoked, 2);
+    test_assertint(ecs_get(world, e1, Foo).x, 13);
+
+    /* ReadFoo runs before WriteFoo, and detects the last write in the next
+     * frame */
+    ecs_enable(world, WriteFoo_h, false);
+
+    invoked = 0;
+    ecs_progress(world, 0);
+    test_assertint(invoked, 1);
+
+    invoked = 0;
+    ecs_progress(world, 0);
+    test_assertint(invoked, 0);
+
+    ecs_fini(world);
+}
+
+void test_EcsChange_tc_skip_unchanged_inout_column(
+    test_EcsChange this)
+{
+    EcsWorld *world = ecs_init();
+    test_assert(world != NULL);
+
+    ECS_COMPONENT(world, Foo);
+    ECS_SYSTEM(world, IncFoo, EcsOnFrame, Foo);
+    ECS_SYSTEM(world, ReadFoo, EcsOnFrame, [in] Foo);
+    ecs_set_skip_unchanged(world, IncFoo_h, true);
+    ecs_set_skip_unchanged(world, ReadFoo_h, true);
+
+    EcsHandle e1 = ecs_set(world, 0, Foo, {10});
+
+    invoked = 0;
+    ecs_progress(world, 0);
+    test_assertint(invoked, 2);
+    test_assertint(ecs_get(world, e1, Foo).x, 11);
+
+    /* Writes of a system are not detected by the system itself. ReadFoo ran
+     * after IncFoo in the previous frame, so it has seen the last write. */
+    invoked = 0;
+    ecs_progress(world, 0);
+    test_assertint(invoked, 0);
+
+    ecs_set(world, e1, Foo, {20});
+
+    invoked = 0;
+    ecs_progress(world, 0);
+    ecs_progress(world, 0);
+    test_assertint(invoked, 2);
+    test_assertint(ecs_get(world, e1, Foo).x, 21);
+
+    ecs_fini(world);
+}
+
+void test_EcsChange_tc_skip_unchanged_staged_set(
+    test_EcsChange this)
+{
+    EcsWorld *world = ecs_init();
+    test_assert(world != NULL);
+
+    ECS_COMPONENT(world, Foo);
+    ECS_COMPONENT(world, Bar);
+    ECS_SYSTEM(world, ReadFoo, EcsOnFrame, [in] Foo);
+    ECS_SYSTEM(world, SetFoo, EcsOnFrame, [in] Bar, HANDLE.Foo);
+    ecs_set_skip_unchanged(world, ReadFoo_h, true);
+    ecs_set_skip_unchanged(world, SetFoo_h, true);
+
+    EcsHandle e1 = ecs_set(world, 0, Foo, {10});
+    ecs_set(world, e1, Bar, {20});
+
+    invoked = 0;
+    ecs_progress(world, 0);
+    test_assertint(invoked, 1);
+    test_assertint(ecs_get(world, e1, Foo).x, 20);
+
+    /* Value set by SetFoo is merged after ReadFoo ran */
+    invoked = 0;
+    ecs_progress(world, 0);
+    test_assertint(invoked, 1);
+
+    invoked = 0;
+    ecs_progress(world, 0);
+    test_assertint(invoked, 0);
+
+    ecs_fini(world);
+}
+
+void test_EcsChange_tc_skip_unchanged_w_threads(
+    test_EcsChange this)
+{
+    EcsWorld *world = ecs_init();
+    test_assert(world != NULL);
+
+    ECS_COMPONENT(world, Foo);
+    ECS_COMPONENT(world, Bar);
+    ECS_SYSTEM(world, ReadFoo, EcsOnFrame, [in] Foo);
+    ecs_set_skip_unchanged(world, ReadFoo_h, true);
+
+    int i, ENTITIES = 10;
+    EcsHandle handles[ENTITIES];
+
+    for (i = 0; i < ENTITIES; i ++) {
+        handles[i] = ecs_set(world, 0, Foo, {i});
+        if (i % 2) {
+            ecs_set(world, handles[i], Bar, {i});
+        }
+    }
+
+    test_assert(ecs_set_threads(world, 2) == EcsOk);
+
+    rows_invoked = 0;
+    ecs_progress(world, 0);
+    test_assertint(rows_invoked, ENTITIES);
+
+    rows_invoked = 0;
+    ecs_progress(world, 0);
+    test_assertint(rows_invoked, 0);
+
+    ecs_set(world, handles[1], Foo, {20});
+
+    rows_invoked = 0;
+    ecs_progress(world, 0);
+    test_assertint(rows_invoked, ENTITIES / 2);
+
+    rows_invoked = 0;
+    ecs_progress(world, 0);
+    test_assertint(rows_invoked, 0);
+
+    ecs_fini(world);
+}
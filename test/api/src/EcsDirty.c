@@ -0,0 +1,250 @@
+/* This is a managed file. Do not delete this comment. */
+
+#include <include/test.h>
+
+typedef struct Foo {
+    int x;
+} Foo;
+
+typedef struct Bar {
+    int x;
+} Bar;
+
+void MarkFoo(EcsRows *rows) {
+    void *row;
+    for (row = rows->first; row < rows->last; row = ecs_next(rows, row)) {
+        Foo *foo = ecs_column(rows, row, 0);
+        foo->x ++;
+    }
+    ecs_set_dirty(rows, 0);
+}
+
+void SetFooFromBar(EcsRows *rows) {
+    void *row;
+    for (row = rows->first; row < rows->last; row = ecs_next(rows, row)) {
+        Bar *bar = ecs_column(rows, row, 0);
+        if (bar->x) {
+            ecs_set_ptr(rows->world, ecs_entity(row), ecs_handle(rows, 1),
+                &(Foo){bar->x});
+        }
+    }
+}
+
+static
+uint32_t dirty_entities(
+    EcsWorld *world,
+    EcsHandle component,
+    EcsHandle filter,
+    EcsHandle *entities_out)
+{
+    uint32_t count = 0;
+    EcsIter it = ecs_dirty_iter(world, component, filter);
+    while (ecs_iter_hasnext(&it)) {
+        EcsHandle *e = ecs_iter_next(&it);
+        if (entities_out) {
+            entities_out[count] = *e;
+        }
+        count ++;
+    }
+    return count;
+}
+
+void test_EcsDirty_tc_dirty_set(
+    test_EcsDirty this)
+{
+    EcsWorld *world = ecs_init();
+    test_assert(world != NULL);
+
+    ECS_COMPONENT(world, Foo);
+    ecs_track_dirty(world, Foo_h);
+
+    ecs_set(world, 0, Foo, {10});
+    EcsHandle e2 = ecs_set(world, 0, Foo, {20});
+    ecs_set(world, 0, Foo, {30});
+
+    /* New entities are dirty */
+    test_assertint(ecs_dirty_count(world, Foo_h, 0), 3);
+    test_assertint(dirty_entities(world, Foo_h, 0, NULL), 3);
+
+    ecs_clear_dirty(world, Foo_h);
+    test_assertint(ecs_dirty_count(world, Foo_h, 0), 0);
+    test_assertint(dirty_entities(world, Foo_h, 0, NULL), 0);
+
+    ecs_set(world, e2, Foo, {21});
+
+    EcsHandle entities[3];
+    test_assertint(ecs_dirty_count(world, Foo_h, 0), 1);
+    test_assertint(dirty_entities(world, Foo_h, 0, entities), 1);
+    test_assertint(entities[0], e2);
+
+    ecs_clear_dirty(world, 0);
+    test_assertint(ecs_dirty_count(world, Foo_h, 0), 0);
+
+    ecs_fini(world);
+}
+
+void test_EcsDirty_tc_dirty_delete(
+    test_EcsDirty this)
+{
+    EcsWorld *world = ecs_init();
+    test_assert(world != NULL);
+
+    ECS_COMPONENT(world, Foo);
+    ECS_COMPONENT(world, Bar);
+    ecs_track_dirty(world, Foo_h);
+
+    EcsHandle e1 = ecs_set(world, 0, Foo, {10});
+    ecs_set(world, 0, Foo, {20});
+    EcsHandle e3 = ecs_set(world, 0, Foo, {30});
+    ecs_clear_dirty(world, 0);
+
+    /* Last row is moved to the row of the deleted entity */
+    ecs_set(world, e3, Foo, {31});
+    ecs_delete(world, e1);
+
+    EcsHandle entities[3];
+    test_assertint(ecs_dirty_count(world, Foo_h, 0), 1);
+    test_assertint(dirty_entities(world, Foo_h, 0, entities), 1);
+    test_assertint(entities[0], e3);
+
+    /* Dirty bit of deleted row is cleared */
+    ecs_delete(world, e3);
+    test_assertint(ecs_dirty_count(world, Foo_h, 0), 0);
+
+    /* Untracked components are never dirty */
+    ecs_set(world, 0, Bar, {10});
+    test_assertint(ecs_dirty_count(world, Bar_h, 0), 0);
+
+    ecs_fini(world);
+}
+
+void test_EcsDirty_tc_dirty_staged_set(
+    test_EcsDirty this)
+{
+    EcsWorld *world = ecs_init();
+    test_assert(world != NULL);
+
+    ECS_COMPONENT(world, Foo);
+    ECS_COMPONENT(world, Bar);
+    ECS_SYSTEM(world, SetFooFromBar, EcsOnFrame, Bar, HANDLE.Foo);
+    ecs_track_dirty(world, Foo_h);
+
+    EcsHandle e1 = ecs_set(world, 0, Foo, {10});
+    ecs_set(world, e1, Bar, {0});
+    EcsHandle e2 = ecs_set(world, 0, Foo, {20});
+    ecs_set(world, e2, Bar, {30});
+    ecs_clear_dirty(world, 0);
+
+    ecs_progress(world, 0);
+
+    EcsHandle entities[2];
+    test_assertint(dirty_entities(world, Foo_h, 0, entities), 1);
+    test_assertint(entities[0], e2);
+    test_assertint(ecs_get(world, e2, Foo).x, 30);
+
+    ecs_fini(world);
+}
+
+void test_EcsDirty_tc_dirty_system_mark(
+    test_EcsDirty this)
+{
+    EcsWorld *world = ecs_init();
+    test_assert(world != NULL);
+
+    ECS_COMPONENT(world, Foo);
+    ECS_COMPONENT(world, Bar);
+    ECS_SYSTEM(world, MarkFoo, EcsOnFrame, Foo, !Bar);
+    ecs_track_dirty(world, Foo_h);
+
+    ecs_new_w_count(world, Foo_h, 100, NULL);
+    EcsHandle e = ecs_new(world, Foo_h);
+    ecs_add(world, e, Bar_h);
+    ecs_clear_dirty(world, 0);
+
+    ecs_progress(world, 0);
+
+    test_assertint(ecs_dirty_count(world, Foo_h, 0), 100);
+    test_assertint(dirty_entities(world, Foo_h, 0, NULL), 100);
+
+    ecs_fini(world);
+}
+
+void test_EcsDirty_tc_dirty_system_mark_w_threads(
+    test_EcsDirty this)
+{
+    EcsWorld *world = ecs_init();
+    test_assert(world != NULL);
+
+    ECS_COMPONENT(world, Foo);
+    ECS_SYSTEM(world, MarkFoo, EcsOnFrame, Foo);
+    ecs_track_dirty(world, Foo_h);
+
+    ecs_new_w_count(world, Foo_h, 1000, NULL);
+    ecs_clear_dirty(world, 0);
+
+    test_assert(ecs_set_threads(world, 3) == EcsOk);
+    ecs_progress(world, 0);
+
+    test_assertint(ecs_dirty_count(world, Foo_h, 0), 1000);
+    test_assertint(dirty_entities(world, Foo_h, 0, NULL), 1000);
+
+    ecs_fini(world);
+}
+
+void test_EcsDirty_tc_dirty_filter(
+    test_EcsDirty this)
+{
+    EcsWorld *world = ecs_init();
+    test_assert(world != NULL);
+
+    ECS_COMPONENT(world, Foo);
+    ECS_COMPONENT(world, Bar);
+    ECS_FAMILY(world, FooBar, Foo, Bar);
+    ecs_track_dirty(world, Foo_h);
+
+    ecs_new_w_count(world, Foo_h, 10, NULL);
+    EcsHandle e = ecs_new(world, FooBar_h);
+    ecs_new(world, Bar_h);
+
+    test_assertint(ecs_dirty_count(world, Foo_h, 0), 11);
+    test_assertint(ecs_dirty_count(world, Foo_h, Bar_h), 1);
+    test_assertint(ecs_dirty_count(world, Foo_h, FooBar_h), 1);
+
+    EcsHandle entities[1];
+    test_assertint(dirty_entities(world, Foo_h, Bar_h, entities), 1);
+    test_assertint(entities[0], e);
+
+    ecs_fini(world);
+}
+
+void test_EcsDirty_tc_dirty_many_rows(
+    test_EcsDirty this)
+{
+    EcsWorld *world = ecs_init();
+    test_assert(world != NULL);
+
+    ECS_COMPONENT(world, Foo);
+    ecs_track_dirty(world, Foo_h);
+
+    int i, COUNT = 200;
+    EcsHandle handles[COUNT];
+    ecs_new_w_count(world, Foo_h, COUNT, handles);
+    test_assertint(ecs_dirty_count(world, Foo_h, 0), COUNT);
+    ecs_clear_dirty(world, Foo_h);
+
+    for (i = 0; i < COUNT; i += 3) {
+        ecs_set(world, handles[i], Foo, {i});
+    }
+
+    EcsHandle entities[COUNT];
+    uint32_t count = dirty_entities(world, Foo_h, 0, entities);
+    test_assertint(count, (COUNT + 2) / 3);
+    test_assertint(ecs_dirty_count(world, Foo_h, 0), count);
+
+    for (i = 0; i < count; i ++) {
+        test_assertint(ecs_get(world, entities[i], Foo).x % 3, 0);
+        test_assertint((entities[i] - handles[0]) % 3, 0);
+    }
+
+    ecs_fini(world);
+}
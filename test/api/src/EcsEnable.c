@@ -0,0 +1,290 @@
+/* This is a managed file. Do not delete this comment. */
+
+#include <include/test.h>
+
+typedef struct Foo {
+    int x;
+} Foo;
+
+typedef struct Bar {
+    int x;
+} Bar;
+
+static int invoked;
+static int rows_count;
+
+static
+void IncFoo(EcsRows *rows) {
+    void *row;
+    invoked ++;
+    for (row = rows->first; row < rows->last; row = ecs_next(rows, row)) {
+        Foo *foo = ecs_column(rows, row, 0);
+        foo->x ++;
+        rows_count ++;
+    }
+}
+
+/* Does not count invocations, so it can run in multiple threads */
+static
+void IncFooMt(EcsRows *rows) {
+    void *row;
+    for (row = rows->first; row < rows->last; row = ecs_next(rows, row)) {
+        Foo *foo = ecs_column(rows, row, 0);
+        foo->x ++;
+    }
+}
+
+static
+void AddBar(EcsRows *rows) {
+    EcsHandle *entity = ecs_get_context(rows->world);
+    ecs_stage_add(rows->world, *entity, ecs_handle(rows, 1));
+    ecs_commit(rows->world, *entity);
+}
+
+static
+void create_entities(
+    EcsWorld *world,
+    EcsHandle Foo_h,
+    EcsHandle type,
+    EcsHandle *entities,
+    uint32_t count)
+{
+    uint32_t i;
+    ecs_new_w_count(world, type, count, entities);
+    for (i = 0; i < count; i ++) {
+        ecs_set(world, entities[i], Foo, {0});
+    }
+}
+
+void test_EcsEnable_tc_disable(
+    test_EcsEnable this)
+{
+    EcsWorld *world = ecs_init();
+    ECS_COMPONENT(world, Foo);
+    ECS_SYSTEM(world, IncFoo, EcsOnDemand, Foo);
+
+    EcsHandle entities[5];
+    create_entities(world, Foo_h, Foo_h, entities, 5);
+
+    ecs_enable_entity(world, entities[1], false);
+    ecs_enable_entity(world, entities[3], false);
+    test_assert(ecs_is_entity_enabled(world, entities[0]));
+    test_assert(!ecs_is_entity_enabled(world, entities[1]));
+    test_assert(!ecs_is_entity_enabled(world, entities[3]));
+
+    invoked = 0;
+    rows_count = 0;
+    ecs_run_system(world, IncFoo_h, 0, 0, NULL);
+
+    /* System is invoked once for each run of enabled entities */
+    test_assertint(invoked, 3);
+    test_assertint(rows_count, 3);
+
+    int i;
+    for (i = 0; i < 5; i ++) {
+        test_assertint(ecs_get(world, entities[i], Foo).x, i % 2 ? 0 : 1);
+    }
+
+    /* Disabled entities are not moved to another table */
+    test_assert(ecs_get_ptr(world, entities[1], Foo_h) ==
+        ECS_OFFSET(ecs_get_ptr(world, entities[0], Foo_h),
+            sizeof(Foo) + sizeof(EcsHandle)));
+
+    ecs_fini(world);
+}
+
+void test_EcsEnable_tc_enable(
+    test_EcsEnable this)
+{
+    EcsWorld *world = ecs_init();
+    ECS_COMPONENT(world, Foo);
+    ECS_SYSTEM(world, IncFoo, EcsOnDemand, Foo);
+
+    EcsHandle entities[3];
+    create_entities(world, Foo_h, Foo_h, entities, 3);
+
+    ecs_enable_entity(world, entities[1], false);
+    ecs_enable_entity(world, entities[1], false);
+    ecs_enable_entity(world, entities[1], true);
+    test_assert(ecs_is_entity_enabled(world, entities[1]));
+
+    invoked = 0;
+    rows_count = 0;
+    ecs_run_system(world, IncFoo_h, 0, 0, NULL);
+    test_assertint(invoked, 1);
+    test_assertint(rows_count, 3);
+
+    ecs_fini(world);
+}
+
+void test_EcsEnable_tc_disable_delete(
+    test_EcsEnable this)
+{
+    EcsWorld *world = ecs_init();
+    ECS_COMPONENT(world, Foo);
+    ECS_SYSTEM(world, IncFoo, EcsOnDemand, Foo);
+
+    EcsHandle entities[4];
+    create_entities(world, Foo_h, Foo_h, entities, 4);
+
+    ecs_enable_entity(world, entities[0], false);
+    ecs_enable_entity(world, entities[3], false);
+
+    /* Last entity is moved to the row of the deleted entity */
+    ecs_delete(world, entities[0]);
+    test_assert(ecs_is_entity_enabled(world, entities[1]));
+    test_assert(ecs_is_entity_enabled(world, entities[2]));
+    test_assert(!ecs_is_entity_enabled(world, entities[3]));
+
+    invoked = 0;
+    rows_count = 0;
+    ecs_run_system(world, IncFoo_h, 0, 0, NULL);
+    test_assertint(rows_count, 2);
+    test_assertint(ecs_get(world, entities[3], Foo).x, 0);
+
+    ecs_delete(world, entities[3]);
+    invoked = 0;
+    rows_count = 0;
+    ecs_run_system(world, IncFoo_h, 0, 0, NULL);
+    test_assertint(invoked, 1);
+    test_assertint(rows_count, 2);
+
+    ecs_fini(world);
+}
+
+void test_EcsEnable_tc_disable_add_component(
+    test_EcsEnable this)
+{
+    EcsWorld *world = ecs_init();
+    ECS_COMPONENT(world, Foo);
+    ECS_COMPONENT(world, Bar);
+    ECS_SYSTEM(world, IncFoo, EcsOnDemand, Foo);
+
+    EcsHandle entities[2];
+    create_entities(world, Foo_h, Foo_h, entities, 2);
+
+    ecs_enable_entity(world, entities[0], false);
+    ecs_stage_add(world, entities[0], Bar_h);
+    ecs_commit(world, entities[0]);
+
+    test_assert(ecs_has(world, entities[0], Bar_h));
+    test_assert(!ecs_is_entity_enabled(world, entities[0]));
+
+    invoked = 0;
+    rows_count = 0;
+    ecs_run_system(world, IncFoo_h, 0, 0, NULL);
+    test_assertint(rows_count, 1);
+    test_assertint(ecs_get(world, entities[0], Foo).x, 0);
+
+    ecs_fini(world);
+}
+
+void test_EcsEnable_tc_disable_add_component_in_progress(
+    test_EcsEnable this)
+{
+    EcsWorld *world = ecs_init();
+    ECS_COMPONENT(world, Foo);
+    ECS_COMPONENT(world, Bar);
+    ECS_SYSTEM(world, AddBar, EcsOnFrame, Bar, HANDLE.Bar);
+
+    EcsHandle entities[2];
+    create_entities(world, Foo_h, Foo_h, entities, 2);
+    ecs_new(world, Bar_h);
+
+    ecs_enable_entity(world, entities[1], false);
+    ecs_set_context(world, &entities[1]);
+    ecs_progress(world, 0);
+
+    test_assert(ecs_has(world, entities[1], Bar_h));
+    test_assert(!ecs_is_entity_enabled(world, entities[1]));
+    test_assert(ecs_is_entity_enabled(world, entities[0]));
+
+    ecs_fini(world);
+}
+
+void test_EcsEnable_tc_disable_frame_system(
+    test_EcsEnable this)
+{
+    EcsWorld *world = ecs_init();
+    ECS_COMPONENT(world, Foo);
+    ECS_SYSTEM(world, IncFoo, EcsOnFrame, Foo);
+
+    EcsHandle entities[4];
+    create_entities(world, Foo_h, Foo_h, entities, 4);
+    ecs_enable_entity(world, entities[2], false);
+
+    ecs_progress(world, 0);
+
+    test_assertint(ecs_get(world, entities[0], Foo).x, 1);
+    test_assertint(ecs_get(world, entities[1], Foo).x, 1);
+    test_assertint(ecs_get(world, entities[2], Foo).x, 0);
+    test_assertint(ecs_get(world, entities[3], Foo).x, 1);
+
+    ecs_fini(world);
+}
+
+void test_EcsEnable_tc_disable_threads(
+    test_EcsEnable this)
+{
+    EcsWorld *world = ecs_init();
+    ECS_COMPONENT(world, Foo);
+    ECS_SYSTEM(world, IncFooMt, EcsOnFrame, Foo);
+
+    EcsHandle entities[100];
+    create_entities(world, Foo_h, Foo_h, entities, 100);
+
+    int i;
+    for (i = 0; i < 100; i += 3) {
+        ecs_enable_entity(world, entities[i], false);
+    }
+
+    ecs_set_threads(world, 4);
+    ecs_progress(world, 0);
+
+    for (i = 0; i < 100; i ++) {
+        test_assertint(ecs_get(world, entities[i], Foo).x, i % 3 ? 1 : 0);
+    }
+
+    ecs_fini(world);
+}
+
+void test_EcsEnable_tc_disable_query(
+    test_EcsEnable this)
+{
+    EcsWorld *world = ecs_init();
+    ECS_COMPONENT(world, Foo);
+    ECS_COMPONENT(world, Bar);
+    ECS_FAMILY(world, FooBar, Foo, Bar);
+
+    EcsHandle entities[6];
+    create_entities(world, Foo_h, Foo_h, entities, 3);
+    create_entities(world, Foo_h, FooBar_h, &entities[3], 3);
+
+    ecs_enable_entity(world, entities[1], false);
+    ecs_enable_entity(world, entities[3], false);
+    ecs_enable_entity(world, entities[4], false);
+    ecs_enable_entity(world, entities[5], false);
+
+    EcsQuery *query = ecs_new_query(world, "Foo");
+
+    int ranges = 0, rows = 0;
+    EcsQueryIter it = ecs_query_iter(world, query, 0);
+    while (ecs_query_next(&it)) {
+        void *row;
+        for (row = it.rows.first; row < it.rows.last; row = ecs_next(&it.rows, row)) {
+            Foo *foo = ecs_column(&it.rows, row, 0);
+            foo->x ++;
+            rows ++;
+        }
+        ranges ++;
+    }
+
+    /* Table without enabled entities is not visited */
+    test_assertint(ranges, 2);
+    test_assertint(rows, 2);
+    test_assertint(ecs_get(world, entities[0], Foo).x, 1);
+    test_assertint(ecs_get(world, entities[1], Foo).x, 0);
+    test_assertint(ecs_get(world, entities[2], Foo).x, 1);
+
+    ecs_fini(world);
+}
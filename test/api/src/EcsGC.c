@@ -0,0 +1,215 @@
+/* This is a managed file. Do not delete this comment. */
+
+#include <include/test.h>
+
+typedef struct Foo {
+    int x;
+} Foo;
+
+typedef struct Bar {
+    int x;
+} Bar;
+
+typedef struct Hello {
+    int x;
+} Hello;
+
+static int invoked;
+static int rows_invoked;
+
+void GCCount(EcsRows *rows) {
+    void *row;
+    invoked ++;
+    for (row = rows->first; row < rows->last; row = ecs_next(rows, row)) {
+        Foo *foo = ecs_column(rows, row, 0);
+        foo->x ++;
+        rows_invoked ++;
+    }
+}
+
+void GCCount2(EcsRows *rows) {
+    GCCount(rows);
+}
+
+void test_EcsGC_tc_gc_empty_table(
+    test_EcsGC this)
+{
+    EcsWorld *world = ecs_init();
+    test_assert(world != NULL);
+
+    ECS_COMPONENT(world, Foo);
+    ECS_COMPONENT(world, Bar);
+    ECS_COMPONENT(world, Hello);
+    ECS_FAMILY(world, FooHello, Foo, Hello);
+
+    /* Make sure the tables that exist after initialization are empty */
+    ecs_gc(world);
+
+    EcsHandle e1 = ecs_new(world, Foo_h);
+    EcsHandle e2 = ecs_new(world, Foo_h);
+    ecs_add(world, e2, Bar_h);
+    test_assert(ecs_has(world, e2, Bar_h));
+
+    ecs_delete(world, e2);
+    test_assertint(ecs_gc(world), 1);
+    test_assertint(ecs_gc(world), 0);
+
+    test_assert(ecs_has(world, e1, Foo_h));
+    test_assert(!ecs_has(world, e1, Bar_h));
+
+    /* Tables of explicitly created families are not collected */
+    EcsHandle e3 = ecs_new(world, FooHello_h);
+    ecs_delete(world, e3);
+    test_assertint(ecs_gc(world), 0);
+
+    ecs_fini(world);
+}
+
+void test_EcsGC_tc_gc_after_n_frames(
+    test_EcsGC this)
+{
+    EcsWorld *world = ecs_init();
+    test_assert(world != NULL);
+
+    ECS_COMPONENT(world, Foo);
+    ECS_COMPONENT(world, Bar);
+    ECS_SYSTEM(world, GCCount, EcsOnFrame, Foo);
+
+    ecs_set_table_gc(world, 3);
+
+    EcsHandle e1 = ecs_new(world, Foo_h);
+    EcsHandle e2 = ecs_new(world, Foo_h);
+    ecs_add(world, e2, Bar_h);
+    ecs_set(world, e1, Foo, {10});
+
+    ecs_progress(world, 0);
+    ecs_delete(world, e2);
+
+    invoked = 0;
+    rows_invoked = 0;
+
+    int i;
+    for (i = 0; i < 7; i ++) {
+        ecs_progress(world, 0);
+    }
+
+    test_assertint(invoked, 7);
+    test_assertint(rows_invoked, 7);
+    test_assertint(ecs_get(world, e1, Foo).x, 18);
+
+    /* Table was collected while progressing */
+    test_assertint(ecs_gc(world), 0);
+
+    ecs_fini(world);
+}
+
+void test_EcsGC_tc_gc_system_after_gc(
+    test_EcsGC this)
+{
+    EcsWorld *world = ecs_init();
+    test_assert(world != NULL);
+
+    ECS_COMPONENT(world, Foo);
+    ECS_COMPONENT(world, Bar);
+    ECS_COMPONENT(world, Hello);
+    ECS_SYSTEM(world, GCCount, EcsOnFrame, Foo);
+
+    EcsHandle e1 = ecs_new(world, Foo_h);
+    EcsHandle e2 = ecs_new(world, Foo_h);
+    ecs_add(world, e2, Bar_h);
+    EcsHandle e3 = ecs_new(world, Bar_h);
+    ecs_add(world, e3, Foo_h);
+    ecs_add(world, e3, Hello_h);
+
+    ecs_delete(world, e2);
+    test_assert(ecs_gc(world) != 0);
+
+    ECS_SYSTEM(world, GCCount2, EcsOnFrame, Foo);
+
+    invoked = 0;
+    rows_invoked = 0;
+    ecs_progress(world, 0);
+
+    test_assertint(invoked, 4);
+    test_assertint(rows_invoked, 4);
+
+    /* Removing the last tables of a system deactivates it */
+    ecs_delete(world, e1);
+    ecs_delete(world, e3);
+    test_assert(ecs_gc(world) != 0);
+
+    invoked = 0;
+    rows_invoked = 0;
+    ecs_progress(world, 0);
+
+    test_assertint(invoked, 0);
+    test_assertint(rows_invoked, 0);
+
+    ecs_fini(world);
+}
+
+void test_EcsGC_tc_gc_recreate_table(
+    test_EcsGC this)
+{
+    EcsWorld *world = ecs_init();
+    test_assert(world != NULL);
+
+    ECS_COMPONENT(world, Foo);
+    ECS_COMPONENT(world, Bar);
+    ECS_SYSTEM(world, GCCount, EcsOnFrame, Foo);
+
+    ecs_gc(world);
+
+    EcsHandle e1 = ecs_new(world, Foo_h);
+    ecs_add(world, e1, Bar_h);
+    ecs_delete(world, e1);
+    test_assertint(ecs_gc(world), 2);
+
+    /* Table is created again in the slot of the collected table */
+    EcsHandle e2 = ecs_new(world, Foo_h);
+    ecs_add(world, e2, Bar_h);
+    ecs_set(world, e2, Foo, {10});
+    ecs_set(world, e2, Bar, {20});
+
+    invoked = 0;
+    rows_invoked = 0;
+    ecs_progress(world, 0);
+
+    test_assertint(invoked, 1);
+    test_assertint(rows_invoked, 1);
+    test_assertint(ecs_get(world, e2, Foo).x, 11);
+    test_assertint(ecs_get(world, e2, Bar).x, 20);
+
+    ecs_fini(world);
+}
+
+void test_EcsGC_tc_gc_staged_family(
+    test_EcsGC this)
+{
+    EcsWorld *world = ecs_init();
+    test_assert(world != NULL);
+
+    ECS_COMPONENT(world, Foo);
+    ECS_COMPONENT(world, Bar);
+
+    EcsHandle e = ecs_new(world, 0);
+
+    /* Family of staged components is not collected before it is committed */
+    ecs_stage_add(world, e, Foo_h);
+    ecs_stage_add(world, e, Bar_h);
+    ecs_gc(world);
+    ecs_commit(world, e);
+
+    test_assert(ecs_has(world, e, Foo_h));
+    test_assert(ecs_has(world, e, Bar_h));
+
+    ecs_stage_remove(world, e, Foo_h);
+    ecs_stage_remove(world, e, Bar_h);
+    ecs_gc(world);
+    ecs_commit(world, e);
+
+    test_assert(!ecs_has(world, e, Foo_h));
+    test_assert(!ecs_has(world, e, Bar_h));
+
+    ecs_fini(world);
+}
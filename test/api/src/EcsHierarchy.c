@@ -0,0 +1,276 @@
+/* This is a managed file. Do not delete this comment. */
+
+#include <include/test.h>
+
+typedef struct Foo {
+    int x;
+} Foo;
+
+typedef struct Bar {
+    int x;
+} Bar;
+
+static int invoked;
+static int rows_count;
+
+static
+void CountFoo(EcsRows *rows) {
+    void *row;
+    invoked ++;
+    for (row = rows->first; row < rows->last; row = ecs_next(rows, row)) {
+        Foo *foo = ecs_column(rows, row, 0);
+        foo->x ++;
+        rows_count ++;
+    }
+}
+
+void test_EcsHierarchy_tc_adopt(
+    test_EcsHierarchy this)
+{
+    EcsWorld *world = ecs_init();
+    ECS_COMPONENT(world, Foo);
+
+    EcsHandle parent = ecs_new(world, Foo_h);
+    EcsHandle e1 = ecs_new(world, Foo_h);
+    EcsHandle e2 = ecs_new(world, Foo_h);
+
+    test_assert(ecs_get_parent(world, e1) == 0);
+    test_assertint(ecs_get_children(world, parent, NULL, 0), 0);
+
+    ecs_adopt(world, e1, parent);
+    ecs_adopt(world, e2, parent);
+
+    /* Adopting does not move entities to another table */
+    test_assert(ecs_has(world, e1, Foo_h));
+    test_assert(!ecs_has(world, e1, parent));
+
+    test_assert(ecs_get_parent(world, e1) == parent);
+    test_assert(ecs_get_parent(world, e2) == parent);
+    test_assertint(ecs_get_children(world, parent, NULL, 0), 2);
+
+    EcsHandle children[2];
+    test_assertint(ecs_get_children(world, parent, children, 2), 2);
+    test_assert(children[0] == e1);
+    test_assert(children[1] == e2);
+
+    test_assertint(ecs_get_children(world, parent, children, 1), 1);
+
+    ecs_adopt(world, e1, 0);
+    test_assert(ecs_get_parent(world, e1) == 0);
+    test_assertint(ecs_get_children(world, parent, children, 2), 1);
+    test_assert(children[0] == e2);
+
+    ecs_fini(world);
+}
+
+void test_EcsHierarchy_tc_adopt_change_parent(
+    test_EcsHierarchy this)
+{
+    EcsWorld *world = ecs_init();
+    ECS_COMPONENT(world, Foo);
+
+    EcsHandle p1 = ecs_new(world, 0);
+    EcsHandle p2 = ecs_new(world, 0);
+    EcsHandle e = ecs_new(world, Foo_h);
+
+    ecs_adopt(world, e, p1);
+    ecs_adopt(world, e, p2);
+
+    test_assert(ecs_get_parent(world, e) == p2);
+    test_assertint(ecs_get_children(world, p1, NULL, 0), 0);
+    test_assertint(ecs_get_children(world, p2, NULL, 0), 1);
+
+    ecs_fini(world);
+}
+
+void test_EcsHierarchy_tc_delete_child(
+    test_EcsHierarchy this)
+{
+    EcsWorld *world = ecs_init();
+    ECS_COMPONENT(world, Foo);
+
+    EcsHandle parent = ecs_new(world, Foo_h);
+    EcsHandle e1 = ecs_new(world, Foo_h);
+    EcsHandle e2 = ecs_new(world, Foo_h);
+    ecs_adopt(world, e1, parent);
+    ecs_adopt(world, e2, parent);
+
+    ecs_delete(world, e1);
+    test_assert(ecs_get_parent(world, e1) == 0);
+
+    EcsHandle children[2];
+    test_assertint(ecs_get_children(world, parent, children, 2), 1);
+    test_assert(children[0] == e2);
+
+    ecs_fini(world);
+}
+
+void test_EcsHierarchy_tc_delete_parent(
+    test_EcsHierarchy this)
+{
+    EcsWorld *world = ecs_init();
+    ECS_COMPONENT(world, Foo);
+
+    EcsHandle parent = ecs_new(world, Foo_h);
+    EcsHandle e1 = ecs_new(world, Foo_h);
+    EcsHandle e2 = ecs_new(world, Foo_h);
+    ecs_adopt(world, e1, parent);
+    ecs_adopt(world, e2, parent);
+
+    /* Children are orphaned, not deleted */
+    ecs_delete(world, parent);
+    test_assert(ecs_get_parent(world, e1) == 0);
+    test_assert(ecs_get_parent(world, e2) == 0);
+    test_assertint(ecs_get_children(world, parent, NULL, 0), 0);
+    test_assert(ecs_has(world, e1, Foo_h));
+
+    ecs_fini(world);
+}
+
+void test_EcsHierarchy_tc_group_children(
+    test_EcsHierarchy this)
+{
+    EcsWorld *world = ecs_init();
+    ECS_COMPONENT(world, Foo);
+
+    EcsHandle p1 = ecs_new(world, 0);
+    EcsHandle p2 = ecs_new(world, 0);
+
+    EcsHandle entities[8];
+    int i;
+    for (i = 0; i < 8; i ++) {
+        entities[i] = ecs_set(world, 0, Foo, {i});
+        ecs_adopt(world, entities[i], i % 2 ? p2 : p1);
+    }
+
+    ecs_group_children(world);
+
+    /* Values still belong to the same entities */
+    for (i = 0; i < 8; i ++) {
+        test_assertint(ecs_get(world, entities[i], Foo).x, i);
+    }
+
+    /* Children of a parent are contiguous */
+    void *prev = NULL;
+    for (i = 0; i < 8; i += 2) {
+        void *ptr = ecs_get_ptr(world, entities[i], Foo_h);
+        if (prev) {
+            test_assert(ptr > prev);
+        }
+        prev = ptr;
+    }
+
+    for (i = 1; i < 8; i += 2) {
+        void *ptr = ecs_get_ptr(world, entities[i], Foo_h);
+        test_assert(ptr > prev);
+        prev = ptr;
+    }
+
+    ecs_fini(world);
+}
+
+void test_EcsHierarchy_tc_run_w_parent(
+    test_EcsHierarchy this)
+{
+    EcsWorld *world = ecs_init();
+    ECS_COMPONENT(world, Foo);
+    ECS_COMPONENT(world, Bar);
+    ECS_FAMILY(world, FooBar, Foo, Bar);
+    ECS_SYSTEM(world, CountFoo, EcsOnDemand, Foo);
+
+    EcsHandle p1 = ecs_new(world, 0);
+    EcsHandle p2 = ecs_new(world, 0);
+
+    EcsHandle entities[6];
+    ecs_new_w_count(world, Foo_h, 4, entities);
+    ecs_new_w_count(world, FooBar_h, 2, &entities[4]);
+
+    int i;
+    for (i = 0; i < 6; i ++) {
+        ecs_set(world, entities[i], Foo, {0});
+        ecs_adopt(world, entities[i], i % 2 ? p2 : p1);
+    }
+
+    invoked = 0;
+    rows_count = 0;
+    ecs_run_system_w_parent(world, CountFoo_h, 0, p1, NULL);
+
+    /* Children of p1 are not consecutive */
+    test_assertint(invoked, 3);
+    test_assertint(rows_count, 3);
+
+    for (i = 0; i < 6; i ++) {
+        test_assertint(ecs_get(world, entities[i], Foo).x, i % 2 ? 0 : 1);
+    }
+
+    ecs_fini(world);
+}
+
+void test_EcsHierarchy_tc_run_w_parent_grouped(
+    test_EcsHierarchy this)
+{
+    EcsWorld *world = ecs_init();
+    ECS_COMPONENT(world, Foo);
+    ECS_COMPONENT(world, Bar);
+    ECS_FAMILY(world, FooBar, Foo, Bar);
+    ECS_SYSTEM(world, CountFoo, EcsOnDemand, Foo);
+
+    EcsHandle p1 = ecs_new(world, 0);
+    EcsHandle p2 = ecs_new(world, 0);
+
+    EcsHandle entities[6];
+    ecs_new_w_count(world, Foo_h, 4, entities);
+    ecs_new_w_count(world, FooBar_h, 2, &entities[4]);
+
+    int i;
+    for (i = 0; i < 6; i ++) {
+        ecs_set(world, entities[i], Foo, {0});
+        ecs_adopt(world, entities[i], i % 2 ? p2 : p1);
+    }
+
+    ecs_group_children(world);
+
+    /* One invocation per table */
+    invoked = 0;
+    rows_count = 0;
+    ecs_run_system_w_parent(world, CountFoo_h, 0, p1, NULL);
+    test_assertint(invoked, 2);
+    test_assertint(rows_count, 3);
+
+    invoked = 0;
+    rows_count = 0;
+    ecs_run_system_w_parent(world, CountFoo_h, 0, p2, NULL);
+    test_assertint(invoked, 2);
+    test_assertint(rows_count, 3);
+
+    for (i = 0; i < 6; i ++) {
+        test_assertint(ecs_get(world, entities[i], Foo).x, 1);
+    }
+
+    ecs_fini(world);
+}
+
+void test_EcsHierarchy_tc_run_w_parent_no_match(
+    test_EcsHierarchy this)
+{
+    EcsWorld *world = ecs_init();
+    ECS_COMPONENT(world, Foo);
+    ECS_COMPONENT(world, Bar);
+    ECS_SYSTEM(world, CountFoo, EcsOnDemand, Foo);
+
+    EcsHandle parent = ecs_new(world, 0);
+    EcsHandle e1 = ecs_new(world, Bar_h);
+    EcsHandle e2 = ecs_new(world, Foo_h);
+    ecs_adopt(world, e1, parent);
+
+    invoked = 0;
+    rows_count = 0;
+    ecs_run_system_w_parent(world, CountFoo_h, 0, parent, NULL);
+    test_assertint(invoked, 0);
+
+    /* Parent without children */
+    ecs_run_system_w_parent(world, CountFoo_h, 0, e2, NULL);
+    test_assertint(invoked, 0);
+
+    ecs_fini(world);
+}
@@ -836,3 +836,155 @@ void test_EcsInitSystem_tc_on_remove_disable(
 
     ecs_fini(world);
 }
+
+typedef struct BatchContext {
+    int invoked;
+    int rows;
+    int foo_sum;
+    int bar_sum;
+} BatchContext;
+
+static
+void CountFoo(EcsRows *rows) {
+    BatchContext *ctx = ecs_get_context(rows->world);
+    void *row;
+
+    ctx->invoked ++;
+    for (row = rows->first; row < rows->last; row = ecs_next(rows, row)) {
+        Foo *foo = ecs_column(rows, row, 0);
+        *foo = 10;
+        ctx->foo_sum += *foo;
+        ctx->rows ++;
+    }
+}
+
+static
+void CountBar(EcsRows *rows) {
+    BatchContext *ctx = ecs_get_context(rows->world);
+    void *row;
+
+    ctx->invoked ++;
+    for (row = rows->first; row < rows->last; row = ecs_next(rows, row)) {
+        Bar *bar = ecs_column(rows, row, 0);
+        *bar = 20;
+        ctx->bar_sum += *bar;
+        ctx->rows ++;
+    }
+}
+
+void test_EcsInitSystem_tc_init_w_count_batched(
+    test_EcsInitSystem this)
+{
+    EcsWorld *world = ecs_init();
+    test_assert(world != NULL);
+
+    ECS_COMPONENT(world, Foo);
+    ECS_SYSTEM(world, CountFoo, EcsOnAdd, Foo);
+
+    BatchContext ctx = {0};
+    ecs_set_context(world, &ctx);
+
+    EcsHandle handles[100];
+    ecs_new_w_count(world, Foo_h, 100, handles);
+
+    /* System is invoked once for all new rows */
+    test_assertint(ctx.invoked, 1);
+    test_assertint(ctx.rows, 100);
+    test_assertint(ecs_get(world, handles[0], Foo), 10);
+    test_assertint(ecs_get(world, handles[99], Foo), 10);
+
+    ecs_fini(world);
+}
+
+void test_EcsInitSystem_tc_deinit_after_fini_batched(
+    test_EcsInitSystem this)
+{
+    EcsWorld *world = ecs_init();
+    test_assert(world != NULL);
+
+    ECS_COMPONENT(world, Foo);
+    ECS_COMPONENT(world, Bar);
+    ECS_FAMILY(world, FooBar, Foo, Bar);
+    ECS_SYSTEM(world, CountFoo, EcsOnRemove, Foo);
+
+    BatchContext ctx = {0};
+    ecs_set_context(world, &ctx);
+
+    ecs_new_w_count(world, Foo_h, 50, NULL);
+    ecs_new_w_count(world, FooBar_h, 30, NULL);
+    test_assertint(ctx.invoked, 0);
+
+    ecs_fini(world);
+
+    /* System is invoked once per table */
+    test_assertint(ctx.invoked, 2);
+    test_assertint(ctx.rows, 80);
+}
+
+void test_EcsInitSystem_tc_init_2_systems_w_count(
+    test_EcsInitSystem this)
+{
+    EcsWorld *world = ecs_init();
+    test_assert(world != NULL);
+
+    ECS_COMPONENT(world, Foo);
+    ECS_COMPONENT(world, Bar);
+    ECS_FAMILY(world, FooBar, Foo, Bar);
+    ECS_SYSTEM(world, CountFoo, EcsOnAdd, Foo);
+    ECS_SYSTEM(world, CountBar, EcsOnAdd, Bar);
+
+    BatchContext ctx = {0};
+    ecs_set_context(world, &ctx);
+
+    EcsHandle handles[3];
+    ecs_new_w_count(world, FooBar_h, 3, handles);
+
+    /* Each system is invoked once, with the columns of its own component */
+    test_assertint(ctx.invoked, 2);
+    test_assertint(ctx.rows, 6);
+    test_assertint(ctx.foo_sum, 30);
+    test_assertint(ctx.bar_sum, 60);
+
+    int i;
+    for (i = 0; i < 3; i ++) {
+        test_assertint(ecs_get(world, handles[i], Foo), 10);
+        test_assertint(ecs_get(world, handles[i], Bar), 20);
+    }
+
+    /* Adding a single component only notifies the system of that component */
+    EcsHandle e = ecs_new(world, Foo_h);
+    ecs_add(world, e, Bar_h);
+    test_assertint(ctx.invoked, 4);
+    test_assertint(ecs_get(world, e, Foo), 10);
+    test_assertint(ecs_get(world, e, Bar), 20);
+
+    ecs_fini(world);
+}
+
+void test_EcsInitSystem_tc_init_system_after_new(
+    test_EcsInitSystem this)
+{
+    EcsWorld *world = ecs_init();
+    test_assert(world != NULL);
+
+    ECS_COMPONENT(world, Foo);
+    ECS_COMPONENT(world, Bar);
+    ECS_FAMILY(world, FooBar, Foo, Bar);
+    ECS_SYSTEM(world, CountFoo, EcsOnAdd, Foo);
+
+    BatchContext ctx = {0};
+    ecs_set_context(world, &ctx);
+
+    ecs_new(world, FooBar_h);
+    test_assertint(ctx.invoked, 1);
+    test_assertint(ctx.bar_sum, 0);
+
+    /* Row systems cached by the table must include systems created later */
+    ECS_SYSTEM(world, CountBar, EcsOnAdd, Bar);
+    EcsHandle e = ecs_new(world, FooBar_h);
+    test_assertint(ctx.invoked, 3);
+    test_assertint(ctx.bar_sum, 20);
+    test_assertint(ecs_get(world, e, Bar), 20);
+
+    ecs_fini(world);
+}
@@ -652,3 +652,578 @@ void test_EcsJobs_tc_6_thread_5_entity(
 
     ecs_fini(world);
 }
+
+typedef struct Bar {
+    int x;
+} Bar;
+
+void ProgressBar(EcsRows *rows) {
+    void *row;
+    for (row = rows->first; row < rows->last; row = ecs_next(rows, row)) {
+        Bar *bar = ecs_column(rows, row, 0);
+        bar->x ++;
+    }
+}
+
+static int task_1_count;
+static int task_2_count;
+static int task_3_count;
+
+void Task1(EcsRows *rows) {
+    task_1_count ++;
+}
+
+void Task2(EcsRows *rows) {
+    task_2_count ++;
+}
+
+void Task3(EcsRows *rows) {
+    task_3_count ++;
+}
+
+void test_EcsJobs_tc_2_thread_pre_frame(
+    test_EcsJobs this)
+{
+    EcsWorld *world = ecs_init();
+    ECS_COMPONENT(world, Foo);
+    ECS_SYSTEM(world, Progress, EcsPreFrame, Foo);
+
+    int i, ENTITIES = 10, THREADS = 2;
+    EcsHandle handles[ENTITIES];
+
+    for (i = 0; i < ENTITIES; i ++) {
+        handles[i] = ecs_new(world, Foo_h);
+        ecs_set(world, handles[i], Foo, {0});
+    }
+
+    ecs_set_threads(world, THREADS);
+    ecs_progress(world, 0);
+
+    for (i = 0; i < ENTITIES; i ++) {
+        test_assertint(ecs_get(world, handles[i], Foo).x, 1);
+    }
+
+    ecs_progress(world, 0);
+
+    for (i = 0; i < ENTITIES; i ++) {
+        test_assertint(ecs_get(world, handles[i], Foo).x, 2);
+    }
+
+    ecs_fini(world);
+}
+
+void test_EcsJobs_tc_2_thread_post_frame(
+    test_EcsJobs this)
+{
+    EcsWorld *world = ecs_init();
+    ECS_COMPONENT(world, Foo);
+    ECS_SYSTEM(world, Progress, EcsPostFrame, Foo);
+
+    int i, ENTITIES = 10, THREADS = 2;
+    EcsHandle handles[ENTITIES];
+
+    for (i = 0; i < ENTITIES; i ++) {
+        handles[i] = ecs_new(world, Foo_h);
+        ecs_set(world, handles[i], Foo, {0});
+    }
+
+    ecs_set_threads(world, THREADS);
+    ecs_progress(world, 0);
+
+    for (i = 0; i < ENTITIES; i ++) {
+        test_assertint(ecs_get(world, handles[i], Foo).x, 1);
+    }
+
+    ecs_progress(world, 0);
+
+    for (i = 0; i < ENTITIES; i ++) {
+        test_assertint(ecs_get(world, handles[i], Foo).x, 2);
+    }
+
+    ecs_fini(world);
+}
+
+void test_EcsJobs_tc_2_thread_tasks(
+    test_EcsJobs this)
+{
+    EcsWorld *world = ecs_init();
+    ECS_SYSTEM(world, Task1, EcsOnFrame, 0);
+    ECS_SYSTEM(world, Task2, EcsOnFrame, 0);
+    ECS_SYSTEM(world, Task3, EcsOnFrame, 0);
+
+    task_1_count = 0;
+    task_2_count = 0;
+    task_3_count = 0;
+
+    ecs_set_threads(world, 2);
+    ecs_progress(world, 0);
+
+    test_assertint(task_1_count, 1);
+    test_assertint(task_2_count, 1);
+    test_assertint(task_3_count, 1);
+
+    ecs_progress(world, 0);
+
+    test_assertint(task_1_count, 2);
+    test_assertint(task_2_count, 2);
+    test_assertint(task_3_count, 2);
+
+    ecs_fini(world);
+}
+
+void test_EcsJobs_tc_3_thread_2_tables(
+    test_EcsJobs this)
+{
+    EcsWorld *world = ecs_init();
+    ECS_COMPONENT(world, Foo);
+    ECS_COMPONENT(world, Bar);
+    ECS_FAMILY(world, FooBar, Foo, Bar);
+    ECS_SYSTEM(world, Progress, EcsOnFrame, Foo);
+
+    int i, ENTITIES = 7, THREADS = 3;
+    EcsHandle handles[ENTITIES * 2];
+
+    for (i = 0; i < ENTITIES; i ++) {
+        handles[i] = ecs_new(world, Foo_h);
+        ecs_set(world, handles[i], Foo, {0});
+    }
+
+    for (i = ENTITIES; i < ENTITIES * 2; i ++) {
+        handles[i] = ecs_new(world, FooBar_h);
+        ecs_set(world, handles[i], Foo, {0});
+    }
+
+    ecs_set_threads(world, THREADS);
+    ecs_progress(world, 0);
+
+    for (i = 0; i < ENTITIES * 2; i ++) {
+        test_assertint(ecs_get(world, handles[i], Foo).x, 1);
+    }
+
+    ecs_progress(world, 0);
+
+    for (i = 0; i < ENTITIES * 2; i ++) {
+        test_assertint(ecs_get(world, handles[i], Foo).x, 2);
+    }
+
+    ecs_fini(world);
+}
+
+typedef struct Spawner {
+    EcsHandle spawned;
+} Spawner;
+
+void Spawn(EcsRows *rows) {
+    EcsHandle *Bar_h = ecs_get_context(rows->world);
+    void *row;
+    for (row = rows->first; row < rows->last; row = ecs_next(rows, row)) {
+        Spawner *spawner = ecs_column(rows, row, 0);
+        spawner->spawned = ecs_new(rows->world, *Bar_h);
+    }
+}
+
+void test_EcsJobs_tc_4_thread_new_in_progress(
+    test_EcsJobs this)
+{
+    EcsWorld *world = ecs_init();
+    ECS_COMPONENT(world, Spawner);
+    ECS_COMPONENT(world, Bar);
+    ECS_SYSTEM(world, Spawn, EcsOnFrame, Spawner);
+
+    int i, j, ENTITIES = 100, THREADS = 4;
+    EcsHandle handles[ENTITIES];
+
+    for (i = 0; i < ENTITIES; i ++) {
+        handles[i] = ecs_new(world, Spawner_h);
+    }
+
+    ecs_set_context(world, &Bar_h);
+    ecs_set_threads(world, THREADS);
+    ecs_progress(world, 0);
+
+    for (i = 0; i < ENTITIES; i ++) {
+        EcsHandle spawned = ecs_get(world, handles[i], Spawner).spawned;
+        test_assert(spawned != 0);
+        test_assert(ecs_has(world, spawned, Bar_h));
+
+        for (j = 0; j < i; j ++) {
+            test_assert(ecs_get(world, handles[j], Spawner).spawned != spawned);
+        }
+    }
+
+    /* Handles created outside of progress may not collide with handles that
+     * were issued to threads */
+    EcsHandle e = ecs_new(world, 0);
+    for (i = 0; i < ENTITIES; i ++) {
+        test_assert(ecs_get(world, handles[i], Spawner).spawned != e);
+    }
+
+    ecs_fini(world);
+}
+
+typedef struct Hello {
+    int x;
+} Hello;
+
+void SpawnFamily(EcsRows *rows) {
+    EcsHandle *BarHello_h = ecs_get_context(rows->world);
+    EcsHandle Bar_h = ecs_handle(rows, 1);
+    void *row;
+    for (row = rows->first; row < rows->last; row = ecs_next(rows, row)) {
+        Spawner *spawner = ecs_column(rows, row, 0);
+        EcsHandle e = ecs_new(rows->world, *BarHello_h);
+        ecs_set(rows->world, e, Bar, {10});
+        spawner->spawned = e;
+    }
+}
+
+void test_EcsJobs_tc_4_thread_new_w_family_in_progress(
+    test_EcsJobs this)
+{
+    EcsWorld *world = ecs_init();
+    ECS_COMPONENT(world, Spawner);
+    ECS_COMPONENT(world, Bar);
+    ECS_COMPONENT(world, Hello);
+    ECS_FAMILY(world, BarHello, Bar, Hello);
+    ECS_SYSTEM(world, SpawnFamily, EcsOnFrame, Spawner, HANDLE.Bar);
+
+    int i, f, ENTITIES = 100, THREADS = 4, FRAMES = 3;
+    EcsHandle handles[ENTITIES];
+
+    for (i = 0; i < ENTITIES; i ++) {
+        handles[i] = ecs_new(world, Spawner_h);
+    }
+
+    /* The table for BarHello does not exist yet, so it is created by the
+     * worker threads while the main thread creates entities in its own job */
+    ecs_set_context(world, &BarHello_h);
+    ecs_set_threads(world, THREADS);
+
+    for (f = 0; f < FRAMES; f ++) {
+        ecs_progress(world, 0);
+
+        for (i = 0; i < ENTITIES; i ++) {
+            EcsHandle spawned = ecs_get(world, handles[i], Spawner).spawned;
+            test_assert(spawned != 0);
+            test_assert(ecs_has(world, spawned, BarHello_h));
+            test_assertint(ecs_get(world, spawned, Bar).x, 10);
+        }
+    }
+
+    ecs_fini(world);
+}
+
+void test_EcsJobs_tc_2_thread_pinned(
+    test_EcsJobs this)
+{
+    EcsWorld *world = ecs_init();
+    ECS_COMPONENT(world, Foo);
+    ECS_SYSTEM(world, Progress, EcsOnFrame, Foo);
+
+    int i, ENTITIES = 10, THREADS = 2;
+    EcsHandle handles[ENTITIES];
+
+    for (i = 0; i < ENTITIES; i ++) {
+        handles[i] = ecs_new(world, Foo_h);
+        ecs_set(world, handles[i], Foo, {0});
+    }
+
+    ecs_set_pin_threads(world, true);
+    ecs_set_threads(world, THREADS);
+    ecs_progress(world, 0);
+
+    for (i = 0; i < ENTITIES; i ++) {
+        test_assertint(ecs_get(world, handles[i], Foo).x, 1);
+    }
+
+    ecs_fini(world);
+}
+
+void test_EcsJobs_tc_grow_threads(
+    test_EcsJobs this)
+{
+    EcsWorld *world = ecs_init();
+    ECS_COMPONENT(world, Foo);
+    ECS_SYSTEM(world, Progress, EcsOnFrame, Foo);
+
+    int i, ENTITIES = 10;
+    EcsHandle handles[ENTITIES];
+
+    for (i = 0; i < ENTITIES; i ++) {
+        handles[i] = ecs_new(world, Foo_h);
+        ecs_set(world, handles[i], Foo, {0});
+    }
+
+    ecs_set_threads(world, 2);
+    ecs_progress(world, 0);
+
+    for (i = 0; i < ENTITIES; i ++) {
+        test_assertint(ecs_get(world, handles[i], Foo).x, 1);
+    }
+
+    ecs_set_threads(world, 4);
+    ecs_progress(world, 0);
+
+    for (i = 0; i < ENTITIES; i ++) {
+        test_assertint(ecs_get(world, handles[i], Foo).x, 2);
+    }
+
+    ecs_fini(world);
+}
+
+void test_EcsJobs_tc_shrink_threads(
+    test_EcsJobs this)
+{
+    EcsWorld *world = ecs_init();
+    ECS_COMPONENT(world, Foo);
+    ECS_SYSTEM(world, Progress, EcsOnFrame, Foo);
+
+    int i, ENTITIES = 10;
+    EcsHandle handles[ENTITIES];
+
+    for (i = 0; i < ENTITIES; i ++) {
+        handles[i] = ecs_new(world, Foo_h);
+        ecs_set(world, handles[i], Foo, {0});
+    }
+
+    ecs_set_threads(world, 4);
+    ecs_progress(world, 0);
+
+    for (i = 0; i < ENTITIES; i ++) {
+        test_assertint(ecs_get(world, handles[i], Foo).x, 1);
+    }
+
+    ecs_set_threads(world, 2);
+    ecs_progress(world, 0);
+
+    for (i = 0; i < ENTITIES; i ++) {
+        test_assertint(ecs_get(world, handles[i], Foo).x, 2);
+    }
+
+    ecs_fini(world);
+}
+
+void test_EcsJobs_tc_shrink_threads_w_staged_data(
+    test_EcsJobs this)
+{
+    EcsWorld *world = ecs_init();
+    ECS_COMPONENT(world, Spawner);
+    ECS_COMPONENT(world, Bar);
+    ECS_SYSTEM(world, Spawn, EcsOnFrame, Spawner);
+
+    int i, ENTITIES = 100;
+    EcsHandle handles[ENTITIES];
+
+    for (i = 0; i < ENTITIES; i ++) {
+        handles[i] = ecs_new(world, Spawner_h);
+    }
+
+    ecs_set_context(world, &Bar_h);
+    ecs_set_automerge(world, false);
+    ecs_set_threads(world, 4);
+    ecs_progress(world, 0);
+
+    /* Removing threads merges data staged by removed threads */
+    ecs_set_threads(world, 2);
+    ecs_merge(world);
+
+    for (i = 0; i < ENTITIES; i ++) {
+        EcsHandle spawned = ecs_get(world, handles[i], Spawner).spawned;
+        test_assert(spawned != 0);
+        test_assert(ecs_has(world, spawned, Bar_h));
+    }
+
+    ecs_fini(world);
+}
+
+void test_EcsJobs_tc_autotune_threads(
+    test_EcsJobs this)
+{
+    EcsWorld *world = ecs_init();
+    ECS_COMPONENT(world, Foo);
+    ECS_SYSTEM(world, Progress, EcsOnFrame, Foo);
+
+    int i, f, ENTITIES = 10, FRAMES = 100;
+    EcsHandle handles[ENTITIES];
+
+    for (i = 0; i < ENTITIES; i ++) {
+        handles[i] = ecs_new(world, Foo_h);
+        ecs_set(world, handles[i], Foo, {0});
+    }
+
+    ecs_set_threads(world, 4);
+    ecs_set_autotune_threads(world, true);
+
+    for (f = 0; f < FRAMES; f ++) {
+        ecs_progress(world, 0);
+    }
+
+    for (i = 0; i < ENTITIES; i ++) {
+        test_assertint(ecs_get(world, handles[i], Foo).x, FRAMES);
+    }
+
+    ecs_set_autotune_threads(world, false);
+    ecs_progress(world, 0);
+
+    for (i = 0; i < ENTITIES; i ++) {
+        test_assertint(ecs_get(world, handles[i], Foo).x, FRAMES + 1);
+    }
+
+    ecs_fini(world);
+}
+
+void AddParam(EcsRows *rows) {
+    int *param = rows->param;
+    void *row;
+    for (row = rows->first; row < rows->last; row = ecs_next(rows, row)) {
+        Foo *foo = ecs_column(rows, row, 0);
+        foo->x += *param;
+    }
+}
+
+void test_EcsJobs_tc_run_system_parallel(
+    test_EcsJobs this)
+{
+    EcsWorld *world = ecs_init();
+    ECS_COMPONENT(world, Foo);
+    ECS_COMPONENT(world, Bar);
+    ECS_FAMILY(world, FooBar, Foo, Bar);
+    ECS_SYSTEM(world, AddParam, EcsOnDemand, Foo);
+
+    int i, ENTITIES = 7, THREADS = 3, param = 2;
+    EcsHandle handles[ENTITIES * 2];
+
+    for (i = 0; i < ENTITIES; i ++) {
+        handles[i] = ecs_new(world, Foo_h);
+        ecs_set(world, handles[i], Foo, {0});
+    }
+
+    for (i = ENTITIES; i < ENTITIES * 2; i ++) {
+        handles[i] = ecs_new(world, FooBar_h);
+        ecs_set(world, handles[i], Foo, {0});
+    }
+
+    ecs_set_threads(world, THREADS);
+    ecs_run_system_parallel(world, AddParam_h, 0, 0, &param);
+
+    for (i = 0; i < ENTITIES * 2; i ++) {
+        test_assertint(ecs_get(world, handles[i], Foo).x, 2);
+    }
+
+    ecs_fini(world);
+}
+
+void test_EcsJobs_tc_run_system_parallel_w_filter(
+    test_EcsJobs this)
+{
+    EcsWorld *world = ecs_init();
+    ECS_COMPONENT(world, Foo);
+    ECS_COMPONENT(world, Bar);
+    ECS_FAMILY(world, FooBar, Foo, Bar);
+    ECS_SYSTEM(world, AddParam, EcsOnDemand, Foo);
+
+    int i, ENTITIES = 7, THREADS = 3, param = 1;
+    EcsHandle handles[ENTITIES * 2];
+
+    for (i = 0; i < ENTITIES; i ++) {
+        handles[i] = ecs_new(world, Foo_h);
+        ecs_set(world, handles[i], Foo, {0});
+    }
+
+    for (i = ENTITIES; i < ENTITIES * 2; i ++) {
+        handles[i] = ecs_new(world, FooBar_h);
+        ecs_set(world, handles[i], Foo, {0});
+    }
+
+    ecs_set_threads(world, THREADS);
+    ecs_run_system_parallel(world, AddParam_h, 0, Bar_h, &param);
+
+    for (i = 0; i < ENTITIES; i ++) {
+        test_assertint(ecs_get(world, handles[i], Foo).x, 0);
+    }
+
+    for (i = ENTITIES; i < ENTITIES * 2; i ++) {
+        test_assertint(ecs_get(world, handles[i], Foo).x, 1);
+    }
+
+    /* Run without filter, to verify the filter is not reused */
+    ecs_run_system_parallel(world, AddParam_h, 0, 0, &param);
+
+    for (i = 0; i < ENTITIES; i ++) {
+        test_assertint(ecs_get(world, handles[i], Foo).x, 1);
+    }
+
+    for (i = ENTITIES; i < ENTITIES * 2; i ++) {
+        test_assertint(ecs_get(world, handles[i], Foo).x, 2);
+    }
+
+    ecs_fini(world);
+}
+
+void test_EcsJobs_tc_run_system_parallel_new(
+    test_EcsJobs this)
+{
+    EcsWorld *world = ecs_init();
+    ECS_COMPONENT(world, Spawner);
+    ECS_COMPONENT(world, Bar);
+    ECS_SYSTEM(world, Spawn, EcsOnDemand, Spawner);
+
+    int i, ENTITIES = 100, THREADS = 4;
+    EcsHandle handles[ENTITIES];
+
+    for (i = 0; i < ENTITIES; i ++) {
+        handles[i] = ecs_new(world, Spawner_h);
+    }
+
+    ecs_set_context(world, &Bar_h);
+    ecs_set_threads(world, THREADS);
+    ecs_run_system_parallel(world, Spawn_h, 0, 0, NULL);
+
+    /* Entities created by the system are merged when the run has finished */
+    for (i = 0; i < ENTITIES; i ++) {
+        EcsHandle spawned = ecs_get(world, handles[i], Spawner).spawned;
+        test_assert(spawned != 0);
+        test_assert(ecs_has(world, spawned, Bar_h));
+    }
+
+    ecs_fini(world);
+}
+
+void test_EcsJobs_tc_run_system_async(
+    test_EcsJobs this)
+{
+    EcsWorld *world = ecs_init();
+    ECS_COMPONENT(world, Foo);
+    ECS_SYSTEM(world, AddParam, EcsOnDemand, Foo);
+
+    int i, ENTITIES = 10, THREADS = 3, param = 3;
+    EcsHandle handles[ENTITIES];
+
+    for (i = 0; i < ENTITIES; i ++) {
+        handles[i] = ecs_new(world, Foo_h);
+        ecs_set(world, handles[i], Foo, {0});
+    }
+
+    ecs_set_threads(world, THREADS);
+
+    EcsSystemRun *run = ecs_run_system_async(
+        world, AddParam_h, 0, 0, &param);
+    test_assert(run != NULL);
+    test_assert(ecs_wait_system(run) == 0);
+
+    for (i = 0; i < ENTITIES; i ++) {
+        test_assertint(ecs_get(world, handles[i], Foo).x, 3);
+    }
+
+    /* Progressing after waiting for the run must be allowed */
+    ecs_progress(world, 0);
+
+    run = ecs_run_system_async(world, AddParam_h, 0, 0, &param);
+    ecs_wait_system(run);
+
+    for (i = 0; i < ENTITIES; i ++) {
+        test_assertint(ecs_get(world, handles[i], Foo).x, 6);
+    }
+
+    ecs_fini(world);
+}
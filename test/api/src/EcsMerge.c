@@ -1,6 +1,7 @@
 /* This is a managed file. Do not delete this comment. */
 
 #include <include/test.h>
+#include "../../include/util/stats.h"
 
 typedef struct Foo {
     int x;
@@ -253,10 +254,11 @@ void test_EcsMerge_tc_merge_add_remove(
 
     test_assertint(ecs_get(world, e, Foo).x, 12);
 
+    /* Adding and removing a component before committing cancels out */
     ecs_merge(world);
 
     test_assert(ecs_has(world, e, Foo_h));
-    test_assert(ecs_has(world, e, Bar_h));
+    test_assert(!ecs_has(world, e, Bar_h));
 
     test_assertint(ecs_get(world, e, Foo).x, 12);
 
@@ -267,7 +269,7 @@ void test_EcsMerge_tc_merge_add_remove(
     ecs_merge(world);
 
     test_assert(ecs_has(world, e, Foo_h));
-    test_assert(ecs_has(world, e, Bar_h));
+    test_assert(!ecs_has(world, e, Bar_h));
 
     test_assertint(ecs_get(world, e, Foo).x, 14);
 
@@ -686,3 +688,464 @@ void test_EcsMerge_tc_merge_set_existing(
 
     ecs_fini(world);
 }
+
+void test_EcsMerge_tc_merge_add_w_threads(
+    test_EcsMerge this)
+{
+    EcsWorld *world = ecs_init();
+    test_assert(world != NULL);
+
+    ECS_COMPONENT(world, Foo);
+    ECS_COMPONENT(world, Bar);
+    ECS_COMPONENT(world, Hello);
+    ECS_FAMILY(world, FooHello, Foo, Hello);
+    ECS_SYSTEM(world, MergeAdd, EcsOnFrame, Foo);
+
+    int i, ENTITIES = 500;
+    EcsHandle handles[ENTITIES];
+
+    for (i = 0; i < ENTITIES; i ++) {
+        if (i % 2) {
+            handles[i] = ecs_new(world, Foo_h);
+        } else {
+            handles[i] = ecs_new(world, FooHello_h);
+        }
+        ecs_set(world, handles[i], Foo, {i});
+    }
+
+    Context ctx = {.component = Bar_h};
+    ecs_set_context(world, &ctx);
+
+    ecs_set_threads(world, 4);
+    ecs_progress(world, 0);
+
+    for (i = 0; i < ENTITIES; i ++) {
+        test_assert(ecs_has(world, handles[i], Foo_h));
+        test_assert(ecs_has(world, handles[i], Bar_h));
+        if (i % 2) {
+            test_assert(!ecs_has(world, handles[i], Hello_h));
+        } else {
+            test_assert(ecs_has(world, handles[i], Hello_h));
+        }
+        test_assertint(ecs_get(world, handles[i], Foo).x, i + 2);
+        test_assertint(ecs_get(world, handles[i], Bar).x, i * 2);
+    }
+
+    ecs_fini(world);
+}
+
+void test_EcsMerge_tc_merge_remove_w_threads(
+    test_EcsMerge this)
+{
+    EcsWorld *world = ecs_init();
+    test_assert(world != NULL);
+
+    ECS_COMPONENT(world, Foo);
+    ECS_COMPONENT(world, Bar);
+    ECS_FAMILY(world, FooBar, Foo, Bar);
+    ECS_SYSTEM(world, MergeRemove, EcsOnFrame, Foo);
+
+    int i, ENTITIES = 500;
+    EcsHandle handles[ENTITIES];
+
+    for (i = 0; i < ENTITIES; i ++) {
+        handles[i] = ecs_new(world, FooBar_h);
+        ecs_set(world, handles[i], Foo, {i});
+        ecs_set(world, handles[i], Bar, {i * 2});
+    }
+
+    Context ctx = {.component = Bar_h};
+    ecs_set_context(world, &ctx);
+
+    ecs_set_threads(world, 4);
+    ecs_progress(world, 0);
+
+    for (i = 0; i < ENTITIES; i ++) {
+        test_assert(ecs_has(world, handles[i], Foo_h));
+        test_assert(!ecs_has(world, handles[i], Bar_h));
+        test_assertint(ecs_get(world, handles[i], Foo).x, i);
+    }
+
+    ecs_fini(world);
+}
+
+void MergeAddRemoveAdd(EcsRows *rows) {
+    EcsWorld *world = rows->world;
+    Context *ctx = ecs_get_context(world);
+    void *row;
+    for (row = rows->first; row < rows->last; row = ecs_next(rows, row)) {
+        EcsHandle entity = ecs_entity(row);
+        ecs_add(world, entity, ctx->component);
+        ecs_remove(world, entity, ctx->component);
+        ecs_add(world, entity, ctx->component);
+    }
+}
+
+static int remove_count = 0;
+
+void CountRemove(EcsRows *rows) {
+    remove_count ++;
+}
+
+void test_EcsMerge_tc_merge_add_remove_add_in_progress(
+    test_EcsMerge this)
+{
+    EcsWorld *world = ecs_init();
+    test_assert(world != NULL);
+
+    ECS_COMPONENT(world, Foo);
+    ECS_COMPONENT(world, Bar);
+    ECS_SYSTEM(world, MergeAddRemoveAdd, EcsOnFrame, Foo);
+    ECS_SYSTEM(world, CountRemove, EcsOnRemove, Bar);
+
+    EcsHandle e = ecs_new(world, Foo_h);
+    test_assert(!ecs_has(world, e, Bar_h));
+
+    Context ctx = {.component = Bar_h};
+    ecs_set_context(world, &ctx);
+
+    remove_count = 0;
+    ecs_progress(world, 0);
+
+    /* The staged remove is cancelled by adding the component again */
+    test_assert(ecs_has(world, e, Foo_h));
+    test_assert(ecs_has(world, e, Bar_h));
+    test_assertint(remove_count, 0);
+
+    ecs_fini(world);
+}
+
+void test_EcsMerge_tc_merge_remove_from_n_tables(
+    test_EcsMerge this)
+{
+    EcsWorld *world = ecs_init();
+    test_assert(world != NULL);
+
+    ECS_COMPONENT(world, Foo);
+    ECS_COMPONENT(world, Bar);
+    ECS_COMPONENT(world, Hello);
+    ECS_FAMILY(world, FooHello, Foo, Hello);
+    ECS_FAMILY(world, FooBarHello, Foo, Bar, Hello);
+    ECS_SYSTEM(world, MergeRemove, EcsOnFrame, Foo);
+
+    int i, ENTITIES = 300;
+    EcsHandle handles[ENTITIES];
+
+    /* Interleave entities, so that rows from different tables are merged into
+     * the same destination table */
+    for (i = 0; i < ENTITIES; i ++) {
+        if (i % 3 == 0) {
+            handles[i] = ecs_new(world, Foo_h);
+        } else if (i % 3 == 1) {
+            handles[i] = ecs_new(world, FooHello_h);
+        } else {
+            handles[i] = ecs_new(world, FooBarHello_h);
+            ecs_set(world, handles[i], Bar, {i * 3});
+        }
+        ecs_set(world, handles[i], Foo, {i});
+    }
+
+    Context ctx = {.component = Hello_h};
+    ecs_set_context(world, &ctx);
+
+    ecs_progress(world, 0);
+
+    for (i = 0; i < ENTITIES; i ++) {
+        test_assert(ecs_has(world, handles[i], Foo_h));
+        test_assert(!ecs_has(world, handles[i], Hello_h));
+        test_assertint(ecs_get(world, handles[i], Foo).x, i);
+
+        if (i % 3 == 2) {
+            test_assert(ecs_has(world, handles[i], Bar_h));
+            test_assertint(ecs_get(world, handles[i], Bar).x, i * 3);
+        } else {
+            test_assert(!ecs_has(world, handles[i], Bar_h));
+        }
+    }
+
+    ecs_fini(world);
+}
+
+void MergeToggle(EcsRows *rows) {
+    EcsWorld *world = rows->world;
+    Context *ctx = ecs_get_context(world);
+    EcsHandle Bar_h = ctx->component;
+    void *row;
+    for (row = rows->first; row < rows->last; row = ecs_next(rows, row)) {
+        EcsHandle entity = ecs_entity(row);
+        Foo *foo = ecs_column(rows, row, 0);
+        if (ecs_has(world, entity, Bar_h)) {
+            ecs_stage_remove(world, entity, Bar_h);
+            ecs_commit(world, entity);
+        } else {
+            ecs_set(world, entity, Bar, {foo->x * 2});
+        }
+        foo->x ++;
+    }
+}
+
+void test_EcsMerge_tc_merge_toggle_n_frames(
+    test_EcsMerge this)
+{
+    EcsWorld *world = ecs_init();
+    test_assert(world != NULL);
+
+    ECS_COMPONENT(world, Foo);
+    ECS_COMPONENT(world, Bar);
+    ECS_SYSTEM(world, MergeToggle, EcsOnFrame, Foo);
+
+    int i, f, ENTITIES = 100, FRAMES = 5;
+    EcsHandle handles[ENTITIES];
+
+    for (i = 0; i < ENTITIES; i ++) {
+        handles[i] = ecs_new(world, Foo_h);
+        ecs_set(world, handles[i], Foo, {i});
+    }
+
+    Context ctx = {.component = Bar_h};
+    ecs_set_context(world, &ctx);
+
+    /* Staged rows alternate between two families, so that staged data is
+     * reused, freed and allocated again across frames */
+    for (f = 0; f < FRAMES; f ++) {
+        ecs_progress(world, 0);
+
+        for (i = 0; i < ENTITIES; i ++) {
+            test_assert(ecs_has(world, handles[i], Foo_h));
+            test_assertint(ecs_get(world, handles[i], Foo).x, i + f + 1);
+
+            if (f % 2 == 0) {
+                test_assert(ecs_has(world, handles[i], Bar_h));
+                test_assertint(ecs_get(world, handles[i], Bar).x, (i + f) * 2);
+            } else {
+                test_assert(!ecs_has(world, handles[i], Bar_h));
+            }
+        }
+    }
+
+    ecs_fini(world);
+}
+
+#define CYCLE_COMPONENTS (8)
+
+typedef struct CycleContext {
+    EcsHandle components[CYCLE_COMPONENTS];
+    int frame;
+} CycleContext;
+
+void MergeCycle(EcsRows *rows) {
+    EcsWorld *world = rows->world;
+    CycleContext *ctx = ecs_get_context(world);
+    EcsHandle cur = ctx->components[ctx->frame % CYCLE_COMPONENTS];
+    EcsHandle prev = ctx->components[
+        (ctx->frame + CYCLE_COMPONENTS - 1) % CYCLE_COMPONENTS];
+    void *row;
+    for (row = rows->first; row < rows->last; row = ecs_next(rows, row)) {
+        EcsHandle entity = ecs_entity(row);
+        if (ctx->frame) {
+            ecs_stage_remove(world, entity, prev);
+        }
+        ecs_stage_add(world, entity, cur);
+        ecs_commit(world, entity);
+    }
+}
+
+void test_EcsMerge_tc_merge_cycle_families_n_frames(
+    test_EcsMerge this)
+{
+    EcsWorld *world = ecs_init();
+    test_assert(world != NULL);
+
+    ECS_COMPONENT(world, Foo);
+    ECS_SYSTEM(world, MergeCycle, EcsOnFrame, Foo);
+
+    int i, f, ENTITIES = 10, FRAMES = CYCLE_COMPONENTS * 4;
+    EcsHandle handles[ENTITIES];
+    CycleContext ctx = {.frame = 0};
+
+    /* Component ids are not copied, so they cannot be stored on the stack */
+    const char *ids[CYCLE_COMPONENTS] = {
+        "Cycle0", "Cycle1", "Cycle2", "Cycle3",
+        "Cycle4", "Cycle5", "Cycle6", "Cycle7"
+    };
+
+    for (i = 0; i < CYCLE_COMPONENTS; i ++) {
+        ctx.components[i] = ecs_new_component(world, ids[i], sizeof(int));
+    }
+
+    for (i = 0; i < ENTITIES; i ++) {
+        handles[i] = ecs_new(world, Foo_h);
+    }
+
+    ecs_set_context(world, &ctx);
+
+    /* Each frame stages rows for a different family. Staged arrays that are
+     * not used in a frame are removed, so the memory used by the stage does
+     * not grow with every family the stage has ever used. */
+    uint32_t stage_used = 0;
+
+    for (f = 0; f < FRAMES; f ++) {
+        ctx.frame = f;
+        ecs_progress(world, 0);
+
+        EcsHandle cur = ctx.components[f % CYCLE_COMPONENTS];
+        for (i = 0; i < ENTITIES; i ++) {
+            test_assert(ecs_has(world, handles[i], Foo_h));
+            test_assert(ecs_has(world, handles[i], cur));
+        }
+
+        EcsWorldStats stats = {0};
+        ecs_get_stats(world, &stats);
+        if (!f) {
+            stage_used = stats.memory.stage.used;
+        } else {
+            test_assertint(stats.memory.stage.used, stage_used);
+        }
+        ecs_free_stats(world, &stats);
+    }
+
+    ecs_fini(world);
+}
+
+static int set_count = 0;
+
+void CountSet(EcsRows *rows) {
+    set_count ++;
+}
+
+void MergeSetTwice(EcsRows *rows) {
+    EcsWorld *world = rows->world;
+    Context *ctx = ecs_get_context(world);
+    EcsHandle Bar_h = ctx->component;
+    void *row;
+    for (row = rows->first; row < rows->last; row = ecs_next(rows, row)) {
+        EcsHandle entity = ecs_entity(row);
+        ecs_set(world, entity, Bar, {10});
+        test_assert(ecs_has(world, entity, Bar_h));
+        test_assertint(ecs_get(world, entity, Bar).x, 10);
+
+        ecs_set(world, entity, Bar, {ecs_get(world, entity, Bar).x + 1});
+        test_assertint(ecs_get(world, entity, Bar).x, 11);
+    }
+}
+
+void test_EcsMerge_tc_merge_set_twice_in_progress(
+    test_EcsMerge this)
+{
+    EcsWorld *world = ecs_init();
+    test_assert(world != NULL);
+
+    ECS_COMPONENT(world, Foo);
+    ECS_COMPONENT(world, Bar);
+    ECS_SYSTEM(world, MergeSetTwice, EcsOnFrame, Foo);
+    ECS_SYSTEM(world, CountSet, EcsOnSet, Bar);
+
+    EcsHandle e = ecs_new(world, Foo_h);
+    test_assert(!ecs_has(world, e, Bar_h));
+
+    Context ctx = {.component = Bar_h};
+    ecs_set_context(world, &ctx);
+
+    set_count = 0;
+    ecs_progress(world, 0);
+
+    /* Both values are recorded, only the last one is set when merging */
+    test_assert(ecs_has(world, e, Foo_h));
+    test_assert(ecs_has(world, e, Bar_h));
+    test_assertint(ecs_get(world, e, Bar).x, 11);
+    test_assertint(set_count, 1);
+
+    ecs_fini(world);
+}
+
+static int add_count = 0;
+
+void CountAdd(EcsRows *rows) {
+    add_count ++;
+}
+
+void MergeSetRemove(EcsRows *rows) {
+    EcsWorld *world = rows->world;
+    Context *ctx = ecs_get_context(world);
+    EcsHandle Bar_h = ctx->component;
+    void *row;
+    for (row = rows->first; row < rows->last; row = ecs_next(rows, row)) {
+        EcsHandle entity = ecs_entity(row);
+        ecs_set(world, entity, Bar, {10});
+        ecs_remove(world, entity, Bar_h);
+        test_assert(!ecs_has(world, entity, Bar_h));
+        test_assert(ecs_get_ptr(world, entity, Bar_h) == NULL);
+    }
+}
+
+void test_EcsMerge_tc_merge_set_remove_in_progress(
+    test_EcsMerge this)
+{
+    EcsWorld *world = ecs_init();
+    test_assert(world != NULL);
+
+    ECS_COMPONENT(world, Foo);
+    ECS_COMPONENT(world, Bar);
+    ECS_SYSTEM(world, MergeSetRemove, EcsOnFrame, Foo);
+    ECS_SYSTEM(world, CountAdd, EcsOnAdd, Bar);
+    ECS_SYSTEM(world, CountRemove, EcsOnRemove, Bar);
+
+    EcsHandle e = ecs_new(world, Foo_h);
+
+    Context ctx = {.component = Bar_h};
+    ecs_set_context(world, &ctx);
+
+    add_count = 0;
+    remove_count = 0;
+    ecs_progress(world, 0);
+
+    /* Setting and then removing the component cancels out */
+    test_assert(ecs_has(world, e, Foo_h));
+    test_assert(!ecs_has(world, e, Bar_h));
+    test_assertint(add_count, 0);
+    test_assertint(remove_count, 0);
+
+    ecs_fini(world);
+}
+
+void MergeDeleteSet(EcsRows *rows) {
+    EcsWorld *world = rows->world;
+    Context *ctx = ecs_get_context(world);
+    EcsHandle Bar_h = ctx->component;
+    EcsHandle Foo_h = ctx->component2;
+    void *row;
+    for (row = rows->first; row < rows->last; row = ecs_next(rows, row)) {
+        EcsHandle entity = ecs_entity(row);
+        ecs_delete(world, entity);
+        test_assert(!ecs_has(world, entity, Foo_h));
+        test_assert(ecs_get_ptr(world, entity, Foo_h) == NULL);
+
+        ecs_set(world, entity, Bar, {20});
+        test_assert(ecs_has(world, entity, Bar_h));
+    }
+}
+
+void test_EcsMerge_tc_merge_delete_set_in_progress(
+    test_EcsMerge this)
+{
+    EcsWorld *world = ecs_init();
+    test_assert(world != NULL);
+
+    ECS_COMPONENT(world, Foo);
+    ECS_COMPONENT(world, Bar);
+    ECS_SYSTEM(world, MergeDeleteSet, EcsOnFrame, Foo);
+
+    EcsHandle e = ecs_new(world, Foo_h);
+
+    Context ctx = {.component = Bar_h, .component2 = Foo_h};
+    ecs_set_context(world, &ctx);
+
+    ecs_progress(world, 0);
+
+    /* Records before the delete are discarded, records after it are not */
+    test_assert(!ecs_has(world, e, Foo_h));
+    test_assert(ecs_has(world, e, Bar_h));
+    test_assertint(ecs_get(world, e, Bar).x, 20);
+
+    ecs_fini(world);
+}
@@ -2048,3 +2048,203 @@ void test_EcsOnFrameSystem_tc_system_prefab_or_component(
 
     ecs_fini(world);
 }
+
+void test_EcsOnFrameSystem_tc_system_activate_tables(
+    test_EcsOnFrameSystem this)
+{
+    Context ctx = {0};
+    EcsWorld *world = ecs_init();
+    ECS_COMPONENT(world, Foo);
+    ECS_COMPONENT(world, Bar);
+    ECS_COMPONENT(world, Hello);
+    ECS_COMPONENT(world, World);
+    ECS_FAMILY(world, FooBar, Foo, Bar);
+    ECS_FAMILY(world, FooHello, Foo, Hello);
+    ECS_FAMILY(world, FooWorld, Foo, World);
+    ECS_SYSTEM(world, TestSystem, EcsOnFrame, Foo);
+
+    EcsHandle families[] = {Foo_h, FooBar_h, FooHello_h, FooWorld_h};
+    EcsHandle entities[4];
+    int i;
+
+    for (i = 0; i < 4; i ++) {
+        entities[i] = ecs_new(world, families[i]);
+    }
+
+    ecs_set_context(world, &ctx);
+    ecs_progress(world, 0);
+    test_assertint(ctx.count, 4);
+
+    /* Deactivate tables in a different order than they were activated, so
+     * that records are moved around in the arrays of the system */
+    ecs_delete(world, entities[1]);
+    ecs_delete(world, entities[3]);
+    ctx.count = 0;
+    ecs_progress(world, 0);
+    test_assertint(ctx.count, 2);
+    test_assert(ctx.entities[0] == entities[0] || ctx.entities[1] == entities[0]);
+    test_assert(ctx.entities[0] == entities[2] || ctx.entities[1] == entities[2]);
+
+    ecs_delete(world, entities[0]);
+    entities[3] = ecs_new(world, FooWorld_h);
+    entities[1] = ecs_new(world, FooBar_h);
+    ctx.count = 0;
+    ecs_progress(world, 0);
+    test_assertint(ctx.count, 3);
+
+    ecs_delete(world, entities[2]);
+    ecs_delete(world, entities[3]);
+    ecs_delete(world, entities[1]);
+    ctx.count = 0;
+    ecs_progress(world, 0);
+    test_assertint(ctx.count, 0);
+
+    entities[2] = ecs_new(world, FooHello_h);
+    ctx.count = 0;
+    ecs_progress(world, 0);
+    test_assertint(ctx.count, 1);
+    test_assert(ctx.entities[0] == entities[2]);
+
+    ecs_fini(world);
+}
+
+static
+void SumSystem(EcsRows *rows) {
+    void *row;
+    int *sum = ecs_get_context(rows->world);
+    for (row = rows->first; row < rows->last; row = ecs_next(rows, row)) {
+        int *foo = ecs_column(rows, row, 0);
+        *sum += *foo;
+    }
+}
+
+void test_EcsOnFrameSystem_tc_system_many_tables(
+    test_EcsOnFrameSystem this)
+{
+    EcsWorld *world = ecs_init();
+    ECS_COMPONENT(world, Foo);
+    ECS_SYSTEM(world, SumSystem, EcsOnFrame, Foo);
+
+    const char *ids[] = {"C0", "C1", "C2", "C3", "C4", "C5", "C6"};
+    EcsHandle components[7];
+    int i, c, sum = 0;
+
+    for (c = 0; c < 7; c ++) {
+        components[c] = ecs_new_component(world, ids[c], sizeof(int));
+    }
+
+    /* Create more tables than fit in a single page of the table store */
+    for (i = 0; i < 128; i ++) {
+        EcsHandle e = ecs_new(world, Foo_h);
+        for (c = 0; c < 7; c ++) {
+            if (i & (1 << c)) {
+                ecs_add(world, e, components[c]);
+            }
+        }
+        *(int*)ecs_get_ptr(world, e, Foo_h) = i + 1;
+    }
+
+    ecs_set_context(world, &sum);
+    ecs_progress(world, 0);
+
+    test_assertint(sum, 128 * 129 / 2);
+
+    ecs_fini(world);
+}
+
+void test_EcsOnFrameSystem_tc_system_on_demand_w_filter_new_table(
+    test_EcsOnFrameSystem this)
+{
+    EcsWorld *world = ecs_init();
+    ECS_COMPONENT(world, Foo);
+    ECS_COMPONENT(world, Bar);
+    ECS_COMPONENT(world, Hello);
+    ECS_FAMILY(world, MyFamily, Foo, Bar);
+    ECS_SYSTEM(world, TestSystem, EcsOnDemand, Foo);
+
+    EcsHandle e1 = ecs_new(world, Foo_h);
+    EcsHandle e2 = ecs_new(world, MyFamily_h);
+    test_assert(e1 != 0);
+
+    Context ctx = {0};
+    ecs_set_context(world, &ctx);
+    ecs_run_system(world, TestSystem_h, 0, Bar_h, NULL);
+    test_assertint(ctx.count, 1);
+    test_assert(ctx.entities[0] == e2);
+
+    /* Tables created after the filter was first used are matched */
+    EcsHandle e3 = ecs_new(world, MyFamily_h);
+    ecs_add(world, e3, Hello_h);
+
+    memset(&ctx, 0, sizeof(Context));
+    ecs_run_system(world, TestSystem_h, 0, Bar_h, NULL);
+    test_assertint(ctx.count, 2);
+
+    /* Tables that become empty are no longer visited */
+    ecs_delete(world, e2);
+
+    memset(&ctx, 0, sizeof(Context));
+    ecs_run_system(world, TestSystem_h, 0, Bar_h, NULL);
+    test_assertint(ctx.count, 1);
+    test_assert(ctx.entities[0] == e3);
+
+    /* Tables that are no longer empty are visited again */
+    e2 = ecs_new(world, MyFamily_h);
+
+    memset(&ctx, 0, sizeof(Context));
+    ecs_run_system(world, TestSystem_h, 0, Bar_h, NULL);
+    test_assertint(ctx.count, 2);
+
+    /* A different filter is cached separately */
+    memset(&ctx, 0, sizeof(Context));
+    ecs_run_system(world, TestSystem_h, 0, Hello_h, NULL);
+    test_assertint(ctx.count, 1);
+    test_assert(ctx.entities[0] == e3);
+
+    ecs_fini(world);
+}
+
+void test_EcsOnFrameSystem_tc_system_on_demand_w_filter_many_tables(
+    test_EcsOnFrameSystem this)
+{
+    EcsWorld *world = ecs_init();
+    ECS_COMPONENT(world, Foo);
+    ECS_SYSTEM(world, SumSystem, EcsOnDemand, Foo);
+
+    const char *ids[] = {"C0", "C1", "C2", "C3", "C4", "C5", "C6"};
+    EcsHandle components[7];
+    int i, c;
+
+    for (c = 0; c < 7; c ++) {
+        components[c] = ecs_new_component(world, ids[c], sizeof(int));
+    }
+
+    for (i = 0; i < 128; i ++) {
+        EcsHandle e = ecs_new(world, Foo_h);
+        for (c = 0; c < 7; c ++) {
+            if (i & (1 << c)) {
+                ecs_add(world, e, components[c]);
+            }
+        }
+        *(int*)ecs_get_ptr(world, e, Foo_h) = i;
+    }
+
+    /* Run twice, so that the second run uses the cached filters */
+    int run;
+    for (run = 0; run < 2; run ++) {
+        for (c = 0; c < 7; c ++) {
+            int sum = 0, expect = 0;
+            for (i = 0; i < 128; i ++) {
+                if (i & (1 << c)) {
+                    expect += i;
+                }
+            }
+
+            ecs_set_context(world, &sum);
+            ecs_run_system(world, SumSystem_h, 0, components[c], NULL);
+            test_assertint(sum, expect);
+        }
+    }
+
+    ecs_fini(world);
+}
@@ -0,0 +1,319 @@
+/* This is a managed file. Do not delete this comment. */
+
+#include <include/test.h>
+#include "../../include/util/stats.h"
+
+typedef struct Foo {
+    int x;
+    int y;
+} Foo;
+
+typedef struct Bar {
+    int x;
+} Bar;
+
+static
+int sum_foo(
+    EcsWorld *world,
+    EcsQuery *query,
+    EcsHandle filter,
+    int *tables)
+{
+    int result = 0;
+    *tables = 0;
+
+    EcsQueryIter it = ecs_query_iter(world, query, filter);
+    while (ecs_query_next(&it)) {
+        void *row;
+        int count = 0;
+        for (row = it.rows.first; row < it.rows.last; row = ecs_next(&it.rows, row)) {
+            Foo *foo = ecs_column(&it.rows, row, 0);
+            result += foo->x;
+            count ++;
+        }
+        test_assertint(count, it.count);
+        (*tables) ++;
+    }
+
+    return result;
+}
+
+void test_EcsQuery_tc_query(
+    test_EcsQuery this)
+{
+    EcsWorld *world = ecs_init();
+    ECS_COMPONENT(world, Foo);
+    ECS_COMPONENT(world, Bar);
+    ECS_FAMILY(world, FooBar, Foo, Bar);
+
+    EcsHandle e1 = ecs_set(world, 0, Foo, {1, 0});
+    EcsHandle e2 = ecs_set(world, 0, Foo, {2, 0});
+    EcsHandle e3 = ecs_new(world, FooBar_h);
+    ecs_set(world, e3, Foo, {4, 0});
+    ecs_set(world, 0, Bar, {8});
+
+    EcsQuery *query = ecs_new_query(world, "Foo");
+    test_assert(query != NULL);
+
+    int tables;
+    test_assertint(sum_foo(world, query, 0, &tables), 7);
+    test_assertint(tables, 2);
+
+    /* Write through the iterator */
+    EcsQueryIter it = ecs_query_iter(world, query, 0);
+    while (ecs_query_next(&it)) {
+        void *row;
+        for (row = it.rows.first; row < it.rows.last; row = ecs_next(&it.rows, row)) {
+            Foo *foo = ecs_column(&it.rows, row, 0);
+            foo->y = foo->x * 10;
+        }
+    }
+
+    test_assertint(ecs_get(world, e1, Foo).y, 10);
+    test_assertint(ecs_get(world, e2, Foo).y, 20);
+    test_assertint(ecs_get(world, e3, Foo).y, 40);
+
+    ecs_fini(world);
+}
+
+void test_EcsQuery_tc_query_new_table(
+    test_EcsQuery this)
+{
+    EcsWorld *world = ecs_init();
+    ECS_COMPONENT(world, Foo);
+    ECS_COMPONENT(world, Bar);
+
+    EcsQuery *query = ecs_new_query(world, "Foo");
+    ecs_set(world, 0, Foo, {1, 0});
+
+    int tables;
+    test_assertint(sum_foo(world, query, 0, &tables), 1);
+    test_assertint(tables, 1);
+
+    /* Table created after the query is matched */
+    EcsHandle e = ecs_set(world, 0, Foo, {2, 0});
+    ecs_add(world, e, Bar_h);
+    ecs_commit(world, e);
+
+    test_assertint(sum_foo(world, query, 0, &tables), 3);
+    test_assertint(tables, 2);
+
+    ecs_fini(world);
+}
+
+void test_EcsQuery_tc_query_empty_table(
+    test_EcsQuery this)
+{
+    EcsWorld *world = ecs_init();
+    ECS_COMPONENT(world, Foo);
+    ECS_COMPONENT(world, Bar);
+
+    EcsHandle e1 = ecs_set(world, 0, Foo, {1, 0});
+    EcsHandle e2 = ecs_set(world, 0, Foo, {2, 0});
+    ecs_add(world, e2, Bar_h);
+    ecs_commit(world, e2);
+
+    EcsQuery *query = ecs_new_query(world, "Foo");
+
+    /* Table that became empty is skipped */
+    ecs_delete(world, e1);
+
+    int tables;
+    test_assertint(sum_foo(world, query, 0, &tables), 2);
+    test_assertint(tables, 1);
+
+    ecs_set(world, 0, Foo, {4, 0});
+    test_assertint(sum_foo(world, query, 0, &tables), 6);
+    test_assertint(tables, 2);
+
+    ecs_fini(world);
+}
+
+void test_EcsQuery_tc_query_w_filter(
+    test_EcsQuery this)
+{
+    EcsWorld *world = ecs_init();
+    ECS_COMPONENT(world, Foo);
+    ECS_COMPONENT(world, Bar);
+    ECS_FAMILY(world, FooBar, Foo, Bar);
+
+    ecs_set(world, 0, Foo, {1, 0});
+    EcsHandle e = ecs_new(world, FooBar_h);
+    ecs_set(world, e, Foo, {2, 0});
+
+    EcsQuery *query = ecs_new_query(world, "Foo");
+
+    int tables;
+    test_assertint(sum_foo(world, query, Bar_h, &tables), 2);
+    test_assertint(tables, 1);
+
+    test_assertint(sum_foo(world, query, 0, &tables), 3);
+    test_assertint(tables, 2);
+
+    ecs_fini(world);
+}
+
+void test_EcsQuery_tc_query_prefab(
+    test_EcsQuery this)
+{
+    EcsWorld *world = ecs_init();
+    ECS_COMPONENT(world, Foo);
+    ECS_COMPONENT(world, Bar);
+    ECS_PREFAB(world, MyPrefab, Foo);
+    ECS_FAMILY(world, MyFamily, MyPrefab, Bar);
+
+    ecs_set(world, MyPrefab_h, Foo, {10, 20});
+    ecs_new_w_count(world, MyFamily_h, 3, NULL);
+
+    EcsQuery *query = ecs_new_query(world, "Bar, Foo");
+
+    int tables = 0, rows = 0;
+    EcsQueryIter it = ecs_query_iter(world, query, 0);
+    while (ecs_query_next(&it)) {
+        void *row;
+        for (row = it.rows.first; row < it.rows.last; row = ecs_next(&it.rows, row)) {
+            Foo *foo = ecs_column(&it.rows, row, 1);
+            test_assertint(foo->x, 10);
+            test_assertint(foo->y, 20);
+            rows ++;
+        }
+        tables ++;
+    }
+
+    test_assertint(tables, 1);
+    test_assertint(rows, 3);
+
+    ecs_fini(world);
+}
+
+void test_EcsQuery_tc_query_no_match(
+    test_EcsQuery this)
+{
+    EcsWorld *world = ecs_init();
+    ECS_COMPONENT(world, Foo);
+    ECS_COMPONENT(world, Bar);
+
+    ecs_set(world, 0, Bar, {1});
+
+    EcsQuery *query = ecs_new_query(world, "Foo");
+    EcsQueryIter it = ecs_query_iter(world, query, 0);
+    test_assert(!ecs_query_next(&it));
+    test_assertint(it.count, 0);
+
+    ecs_fini(world);
+}
+
+void test_EcsQuery_tc_query_skip_unchanged(
+    test_EcsQuery this)
+{
+    EcsWorld *world = ecs_init();
+    ECS_COMPONENT(world, Foo);
+    ECS_COMPONENT(world, Bar);
+    ECS_FAMILY(world, FooBar, Foo, Bar);
+
+    ecs_set(world, 0, Foo, {1, 0});
+    EcsHandle e = ecs_new(world, FooBar_h);
+    ecs_set(world, e, Foo, {2, 0});
+
+    EcsQuery *query = ecs_new_query(world, "[in] Foo");
+    ecs_set_query_skip_unchanged(world, query, true);
+
+    int tables;
+    test_assertint(sum_foo(world, query, 0, &tables), 3);
+    test_assertint(tables, 2);
+
+    /* Nothing changed */
+    test_assertint(sum_foo(world, query, 0, &tables), 0);
+    test_assertint(tables, 0);
+
+    ecs_set(world, e, Foo, {4, 0});
+    test_assertint(sum_foo(world, query, 0, &tables), 4);
+    test_assertint(tables, 1);
+
+    ecs_fini(world);
+}
+
+void test_EcsQuery_tc_query_signature_copy(
+    test_EcsQuery this)
+{
+    EcsWorld *world = ecs_init();
+    ECS_COMPONENT(world, Foo);
+    ECS_COMPONENT(world, Bar);
+
+    ecs_set(world, 0, Foo, {1, 0});
+    ecs_set(world, 0, Bar, {2});
+
+    /* The query does not keep a pointer to the signature */
+    char signature[] = "Foo";
+    EcsQuery *query = ecs_new_query(world, signature);
+    strcpy(signature, "Bar");
+
+    int tables;
+    test_assertint(sum_foo(world, query, 0, &tables), 1);
+    test_assertint(tables, 1);
+
+    /* Queries are not systems */
+    EcsWorldStats stats = {0};
+    ecs_get_stats(world, &stats);
+    test_assertint(ecs_array_count(stats.on_demand_systems), 0);
+    ecs_free_stats(world, &stats);
+
+    /* Tables created after the signature changed still match Foo */
+    EcsHandle e = ecs_set(world, 0, Foo, {4, 0});
+    ecs_add(world, e, Bar_h);
+    ecs_commit(world, e);
+
+    test_assertint(sum_foo(world, query, 0, &tables), 5);
+    test_assertint(tables, 2);
+
+    ecs_fini(world);
+}
+
+void test_EcsQuery_tc_free_query(
+    test_EcsQuery this)
+{
+    EcsWorld *world = ecs_init();
+    ECS_COMPONENT(world, Foo);
+    ECS_COMPONENT(world, Bar);
+    ECS_FAMILY(world, FooBar, Foo, Bar);
+
+    ecs_set(world, 0, Foo, {1, 0});
+    EcsHandle e = ecs_new(world, FooBar_h);
+    ecs_set(world, e, Foo, {2, 0});
+
+    EcsQuery *q1 = ecs_new_query(world, "Foo");
+    EcsQuery *q2 = ecs_new_query(world, "Foo");
+    EcsQuery *q3 = ecs_new_query(world, "Foo");
+
+    int tables;
+    test_assertint(sum_foo(world, q3, Bar_h, &tables), 2);
+    test_assertint(tables, 1);
+
+    /* Queries matched after the freed query are moved in the match arrays
+     * of the tables, and keep working when tables are (de)activated */
+    ecs_free_query(world, q1);
+
+    ecs_delete(world, e);
+    test_assertint(sum_foo(world, q2, 0, &tables), 1);
+    test_assertint(tables, 1);
+    test_assertint(sum_foo(world, q3, 0, &tables), 1);
+    test_assertint(tables, 1);
+
+    e = ecs_new(world, FooBar_h);
+    ecs_set(world, e, Foo, {4, 0});
+    test_assertint(sum_foo(world, q2, 0, &tables), 5);
+    test_assertint(tables, 2);
+    test_assertint(sum_foo(world, q3, Bar_h, &tables), 4);
+    test_assertint(tables, 1);
+
+    ecs_free_query(world, q3);
+    test_assertint(sum_foo(world, q2, 0, &tables), 5);
+    test_assertint(tables, 2);
+
+    /* Collecting tables after a query is freed */
+    ecs_delete(world, e);
+    ecs_free_query(world, q2);
+    ecs_gc(world);
+
+    ecs_fini(world);
+}
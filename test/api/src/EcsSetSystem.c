@@ -228,3 +228,49 @@ void test_EcsSetSystem_tc_on_add_in_on_set(
 
     ecs_fini(world);
 }
+
+void test_EcsSetSystem_tc_set_system_after_set(
+    test_EcsSetSystem this)
+{
+    EcsWorld *world = ecs_init();
+
+    ECS_COMPONENT(world, Foo);
+
+    set_system_called = 0;
+    EcsHandle h = ecs_new(world, 0);
+    ecs_set(world, h, Foo, {10});
+    test_assertint(set_system_called, 0);
+    test_assertint(ecs_get(world, h, Foo), 10);
+
+    /* Component data cached by the previous set must include the new system */
+    ECS_SYSTEM(world, Set, EcsOnSet, Foo);
+    ecs_set(world, h, Foo, {20});
+    test_assertint(set_system_called, 1);
+    test_assertint(ecs_get(world, h, Foo), 21);
+
+    ecs_fini(world);
+}
+
+void test_EcsSetSystem_tc_set_no_system_for_component(
+    test_EcsSetSystem this)
+{
+    EcsWorld *world = ecs_init();
+
+    ECS_COMPONENT(world, Foo);
+    ECS_COMPONENT(world, Bar);
+    ECS_SYSTEM(world, Set, EcsOnSet, Foo);
+
+    set_system_called = 0;
+    EcsHandle h = ecs_new(world, 0);
+    ecs_set(world, h, Bar, {10});
+    ecs_set(world, h, Bar, {20});
+    test_assertint(set_system_called, 0);
+    test_assertint(ecs_get(world, h, Bar), 20);
+
+    ecs_set(world, h, Foo, {10});
+    test_assertint(set_system_called, 1);
+    test_assertint(ecs_get(world, h, Foo), 11);
+    test_assertint(ecs_get(world, h, Bar), 20);
+
+    ecs_fini(world);
+}
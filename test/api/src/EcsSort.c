@@ -0,0 +1,302 @@
+/* This is a managed file. Do not delete this comment. */
+
+#include <include/test.h>
+
+typedef struct Foo {
+    int x;
+} Foo;
+
+typedef struct Bar {
+    int x;
+} Bar;
+
+typedef struct Position {
+    uint32_t x;
+    uint32_t y;
+} Position;
+
+static int system_rows;
+static int system_last;
+static bool system_sorted;
+
+static
+uint64_t foo_key(
+    EcsHandle entity,
+    const void *component)
+{
+    const Foo *foo = component;
+    return foo->x;
+}
+
+static
+uint64_t foo_key_half(
+    EcsHandle entity,
+    const void *component)
+{
+    const Foo *foo = component;
+    return foo->x / 2;
+}
+
+static
+uint64_t position_key(
+    EcsHandle entity,
+    const void *component)
+{
+    const Position *p = component;
+    return ecs_morton_code(p->x, p->y);
+}
+
+static
+void CheckSorted(EcsRows *rows) {
+    void *row;
+    for (row = rows->first; row < rows->last; row = ecs_next(rows, row)) {
+        Foo *foo = ecs_column(rows, row, 0);
+        if (system_rows && foo->x < system_last) {
+            system_sorted = false;
+        }
+        system_last = foo->x;
+        system_rows ++;
+    }
+}
+
+/* Test if entities are stored in the order of their x value */
+static
+bool is_sorted(
+    EcsWorld *world,
+    EcsHandle Foo_h,
+    EcsHandle *entities,
+    uint32_t count)
+{
+    uint32_t i, j;
+    for (i = 0; i < count; i ++) {
+        for (j = 0; j < count; j ++) {
+            int x_i = ecs_get(world, entities[i], Foo).x;
+            int x_j = ecs_get(world, entities[j], Foo).x;
+            void *ptr_i = ecs_get_ptr(world, entities[i], Foo_h);
+            void *ptr_j = ecs_get_ptr(world, entities[j], Foo_h);
+            if (x_i < x_j && ptr_i > ptr_j) {
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+void test_EcsSort_tc_sort(
+    test_EcsSort this)
+{
+    EcsWorld *world = ecs_init();
+    ECS_COMPONENT(world, Foo);
+
+    int values[6] = {5, 3, 9, 1, 7, 2};
+    EcsHandle entities[6];
+    int i;
+    for (i = 0; i < 6; i ++) {
+        entities[i] = ecs_set(world, 0, Foo, {values[i]});
+    }
+
+    test_assert(!is_sorted(world, Foo_h, entities, 6));
+
+    ecs_sort(world, Foo_h, foo_key);
+
+    test_assert(is_sorted(world, Foo_h, entities, 6));
+
+    /* Values still belong to the same entities */
+    for (i = 0; i < 6; i ++) {
+        test_assertint(ecs_get(world, entities[i], Foo).x, values[i]);
+    }
+
+    ecs_fini(world);
+}
+
+void test_EcsSort_tc_sort_stable(
+    test_EcsSort this)
+{
+    EcsWorld *world = ecs_init();
+    ECS_COMPONENT(world, Foo);
+
+    int values[6] = {5, 3, 4, 2, 1, 0};
+    EcsHandle entities[6];
+    int i;
+    for (i = 0; i < 6; i ++) {
+        entities[i] = ecs_set(world, 0, Foo, {values[i]});
+    }
+
+    ecs_sort(world, Foo_h, foo_key_half);
+
+    /* Entities with the same key keep their order */
+    void *p0 = ecs_get_ptr(world, entities[0], Foo_h);
+    void *p2 = ecs_get_ptr(world, entities[2], Foo_h);
+    void *p1 = ecs_get_ptr(world, entities[1], Foo_h);
+    void *p3 = ecs_get_ptr(world, entities[3], Foo_h);
+    void *p4 = ecs_get_ptr(world, entities[4], Foo_h);
+    void *p5 = ecs_get_ptr(world, entities[5], Foo_h);
+    test_assert(p4 < p5);
+    test_assert(p5 < p1);
+    test_assert(p1 < p3);
+    test_assert(p3 < p0);
+    test_assert(p0 < p2);
+
+    ecs_fini(world);
+}
+
+void test_EcsSort_tc_sort_tables(
+    test_EcsSort this)
+{
+    EcsWorld *world = ecs_init();
+    ECS_COMPONENT(world, Foo);
+    ECS_COMPONENT(world, Bar);
+    ECS_FAMILY(world, FooBar, Foo, Bar);
+
+    EcsHandle entities[8];
+    int i;
+    for (i = 0; i < 4; i ++) {
+        entities[i] = ecs_set(world, 0, Foo, {10 - i});
+    }
+
+    for (i = 4; i < 8; i ++) {
+        entities[i] = ecs_new(world, FooBar_h);
+        ecs_set(world, entities[i], Foo, {10 - i});
+    }
+
+    ecs_sort(world, Foo_h, foo_key);
+
+    test_assert(is_sorted(world, Foo_h, entities, 4));
+    test_assert(is_sorted(world, Foo_h, &entities[4], 4));
+
+    ecs_fini(world);
+}
+
+void test_EcsSort_tc_sort_dirty(
+    test_EcsSort this)
+{
+    EcsWorld *world = ecs_init();
+    ECS_COMPONENT(world, Foo);
+
+    ecs_track_dirty(world, Foo_h);
+
+    EcsHandle entities[4];
+    int i;
+    for (i = 0; i < 4; i ++) {
+        entities[i] = ecs_set(world, 0, Foo, {10 - i});
+    }
+
+    ecs_clear_dirty(world, Foo_h);
+    ecs_set(world, entities[0], Foo, {10});
+
+    ecs_sort(world, Foo_h, foo_key);
+
+    /* Dirty bits move with the rows */
+    int count = 0;
+    EcsIter it = ecs_dirty_iter(world, Foo_h, 0);
+    while (ecs_iter_hasnext(&it)) {
+        EcsHandle *e = ecs_iter_next(&it);
+        test_assert(*e == entities[0]);
+        count ++;
+    }
+
+    test_assertint(count, 1);
+
+    ecs_fini(world);
+}
+
+void test_EcsSort_tc_sort_disabled(
+    test_EcsSort this)
+{
+    EcsWorld *world = ecs_init();
+    ECS_COMPONENT(world, Foo);
+
+    EcsHandle entities[4];
+    int i;
+    for (i = 0; i < 4; i ++) {
+        entities[i] = ecs_set(world, 0, Foo, {10 - i});
+    }
+
+    ecs_enable_entity(world, entities[3], false);
+    ecs_sort(world, Foo_h, foo_key);
+
+    test_assert(!ecs_is_entity_enabled(world, entities[3]));
+    for (i = 0; i < 3; i ++) {
+        test_assert(ecs_is_entity_enabled(world, entities[i]));
+    }
+
+    ecs_fini(world);
+}
+
+void test_EcsSort_tc_set_sort(
+    test_EcsSort this)
+{
+    EcsWorld *world = ecs_init();
+    ECS_COMPONENT(world, Foo);
+    ECS_SYSTEM(world, CheckSorted, EcsOnFrame, Foo);
+
+    EcsHandle entities[6];
+    int i;
+    for (i = 0; i < 4; i ++) {
+        entities[i] = ecs_set(world, 0, Foo, {(i * 7) % 5});
+    }
+
+    ecs_set_sort(world, Foo_h, foo_key);
+    test_assert(is_sorted(world, Foo_h, entities, 4));
+
+    /* New entities are sorted at the start of the next frame */
+    entities[4] = ecs_set(world, 0, Foo, {3});
+    entities[5] = ecs_set(world, 0, Foo, {2});
+
+    system_rows = 0;
+    system_sorted = true;
+    ecs_progress(world, 0);
+    test_assertint(system_rows, 6);
+    test_assert(system_sorted);
+    test_assert(is_sorted(world, Foo_h, entities, 6));
+
+    /* Changed values are sorted as well */
+    ecs_set(world, entities[4], Foo, {100});
+    system_rows = 0;
+    system_sorted = true;
+    ecs_progress(world, 0);
+    test_assert(system_sorted);
+    test_assert(is_sorted(world, Foo_h, entities, 6));
+
+    /* Disabled sorting */
+    ecs_set_sort(world, 0, NULL);
+    ecs_set(world, entities[4], Foo, {-100});
+    system_rows = 0;
+    system_sorted = true;
+    ecs_progress(world, 0);
+    test_assert(!system_sorted);
+
+    ecs_fini(world);
+}
+
+void test_EcsSort_tc_morton_code(
+    test_EcsSort this)
+{
+    test_assert(ecs_morton_code(0, 0) == 0);
+    test_assert(ecs_morton_code(1, 0) == 1);
+    test_assert(ecs_morton_code(0, 1) == 2);
+    test_assert(ecs_morton_code(3, 3) == 15);
+    test_assert(ecs_morton_code(UINT32_MAX, 0) == 0x5555555555555555ull);
+    test_assert(ecs_morton_code(0, UINT32_MAX) == 0xAAAAAAAAAAAAAAAAull);
+
+    /* Sort by position */
+    EcsWorld *world = ecs_init();
+    ECS_COMPONENT(world, Position);
+
+    EcsHandle e1 = ecs_set(world, 0, Position, {100, 100});
+    EcsHandle e2 = ecs_set(world, 0, Position, {0, 0});
+    EcsHandle e3 = ecs_set(world, 0, Position, {101, 100});
+    EcsHandle e4 = ecs_set(world, 0, Position, {1, 1});
+
+    ecs_sort(world, Position_h, position_key);
+
+    /* Entities close in space are close in memory */
+    uint32_t size = sizeof(Position) + sizeof(EcsHandle);
+    test_assert(ECS_OFFSET(ecs_get_ptr(world, e2, Position_h), size) ==
+        ecs_get_ptr(world, e4, Position_h));
+    test_assert(ECS_OFFSET(ecs_get_ptr(world, e1, Position_h), size) ==
+        ecs_get_ptr(world, e3, Position_h));
+
+    ecs_fini(world);
+}
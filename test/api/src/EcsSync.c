@@ -0,0 +1,250 @@
+/* This is a managed file. Do not delete this comment. */
+
+#include <include/test.h>
+
+typedef struct Foo {
+    int x;
+} Foo;
+
+typedef struct Bar {
+    int x;
+} Bar;
+
+typedef struct Spawner {
+    EcsHandle spawned;
+} Spawner;
+
+typedef struct Context {
+    EcsHandle component;
+    int count;
+} Context;
+
+void SyncSpawn(EcsRows *rows) {
+    Context *ctx = ecs_get_context(rows->world);
+    void *row;
+    for (row = rows->first; row < rows->last; row = ecs_next(rows, row)) {
+        Spawner *spawner = ecs_column(rows, row, 0);
+        spawner->spawned = ecs_new(rows->world, ctx->component);
+    }
+}
+
+/* Counts rows atomically, as the system may run on worker threads */
+void SyncCount(EcsRows *rows) {
+    Context *ctx = ecs_get_context(rows->world);
+    void *row;
+    int count = 0;
+    for (row = rows->first; row < rows->last; row = ecs_next(rows, row)) {
+        count ++;
+    }
+
+    __sync_fetch_and_add(&ctx->count, count);
+}
+
+void SyncCountBar(EcsRows *rows) {
+    SyncCount(rows);
+}
+
+void test_EcsSync_tc_sync_point(
+    test_EcsSync this)
+{
+    EcsWorld *world = ecs_init();
+    ECS_COMPONENT(world, Spawner);
+    ECS_COMPONENT(world, Foo);
+    ECS_SYSTEM(world, SyncSpawn, EcsPreFrame, Spawner);
+    ECS_SYSTEM(world, SyncCount, EcsOnFrame, Foo);
+
+    int i, ENTITIES = 10;
+    for (i = 0; i < ENTITIES; i ++) {
+        ecs_new(world, Spawner_h);
+    }
+
+    Context ctx = {.component = Foo_h};
+    ecs_set_context(world, &ctx);
+    ecs_set_sync_point(world, SyncCount_h, true);
+
+    /* Entities spawned in PreFrame are visible in OnFrame of the same frame */
+    ecs_progress(world, 0);
+    test_assertint(ctx.count, ENTITIES);
+
+    ctx.count = 0;
+    ecs_progress(world, 0);
+    test_assertint(ctx.count, ENTITIES * 2);
+
+    ecs_fini(world);
+}
+
+void test_EcsSync_tc_sync_point_in_phase(
+    test_EcsSync this)
+{
+    EcsWorld *world = ecs_init();
+    ECS_COMPONENT(world, Spawner);
+    ECS_COMPONENT(world, Foo);
+    ECS_SYSTEM(world, SyncSpawn, EcsOnFrame, Spawner);
+    ECS_SYSTEM(world, SyncCount, EcsOnFrame, Foo);
+
+    int i, ENTITIES = 10;
+    for (i = 0; i < ENTITIES; i ++) {
+        ecs_new(world, Spawner_h);
+    }
+
+    Context ctx = {.component = Foo_h};
+    ecs_set_context(world, &ctx);
+    ecs_set_sync_point(world, SyncCount_h, true);
+
+    ecs_progress(world, 0);
+    test_assertint(ctx.count, ENTITIES);
+
+    ecs_fini(world);
+}
+
+void test_EcsSync_tc_sync_point_not_needed(
+    test_EcsSync this)
+{
+    EcsWorld *world = ecs_init();
+    ECS_COMPONENT(world, Spawner);
+    ECS_COMPONENT(world, Foo);
+    ECS_COMPONENT(world, Bar);
+    ECS_SYSTEM(world, SyncSpawn, EcsOnFrame, Spawner);
+    ECS_SYSTEM(world, SyncCount, EcsOnFrame, Foo);
+    ECS_SYSTEM(world, SyncCountBar, EcsOnFrame, Bar);
+
+    int i, ENTITIES = 10;
+    for (i = 0; i < ENTITIES; i ++) {
+        ecs_new(world, Spawner_h);
+    }
+
+    /* Spawned entities have Bar, which is not read by SyncCount, so the sync
+     * point does not merge, and SyncCountBar does not see the entities */
+    Context ctx = {.component = Bar_h};
+    ecs_set_context(world, &ctx);
+    ecs_set_sync_point(world, SyncCount_h, true);
+
+    ecs_progress(world, 0);
+    test_assertint(ctx.count, 0);
+
+    ecs_progress(world, 0);
+    test_assertint(ctx.count, ENTITIES);
+
+    ecs_fini(world);
+}
+
+void test_EcsSync_tc_sync_point_w_threads(
+    test_EcsSync this)
+{
+    EcsWorld *world = ecs_init();
+    ECS_COMPONENT(world, Spawner);
+    ECS_COMPONENT(world, Foo);
+    ECS_SYSTEM(world, SyncSpawn, EcsPreFrame, Spawner);
+    ECS_SYSTEM(world, SyncCount, EcsOnFrame, Foo);
+
+    int i, ENTITIES = 100;
+    EcsHandle handles[ENTITIES];
+    for (i = 0; i < ENTITIES; i ++) {
+        handles[i] = ecs_new(world, Spawner_h);
+    }
+
+    Context ctx = {.component = Foo_h};
+    ecs_set_context(world, &ctx);
+    ecs_set_sync_point(world, SyncCount_h, true);
+    ecs_set_threads(world, 4);
+
+    ecs_progress(world, 0);
+    test_assertint(ctx.count, ENTITIES);
+
+    for (i = 0; i < ENTITIES; i ++) {
+        EcsHandle spawned = ecs_get(world, handles[i], Spawner).spawned;
+        test_assert(ecs_has(world, spawned, Foo_h));
+    }
+
+    ecs_fini(world);
+}
+
+void test_EcsSync_tc_phase_sync(
+    test_EcsSync this)
+{
+    EcsWorld *world = ecs_init();
+    ECS_COMPONENT(world, Spawner);
+    ECS_COMPONENT(world, Foo);
+    ECS_SYSTEM(world, SyncSpawn, EcsOnFrame, Spawner);
+    ECS_SYSTEM(world, SyncCount, EcsPostFrame, Foo);
+
+    int i, ENTITIES = 10;
+    for (i = 0; i < ENTITIES; i ++) {
+        ecs_new(world, Spawner_h);
+    }
+
+    Context ctx = {.component = Foo_h};
+    ecs_set_context(world, &ctx);
+
+    /* Without sync points, spawned entities are visible in the next frame */
+    ecs_progress(world, 0);
+    test_assertint(ctx.count, 0);
+
+    ecs_set_phase_sync(world, true);
+    ecs_progress(world, 0);
+    test_assertint(ctx.count, ENTITIES * 2);
+
+    ecs_fini(world);
+}
+
+void test_EcsSync_tc_pre_frame_merge(
+    test_EcsSync this)
+{
+    EcsWorld *world = ecs_init();
+    ECS_COMPONENT(world, Spawner);
+    ECS_COMPONENT(world, Foo);
+    ECS_SYSTEM(world, SyncSpawn, EcsPreFrame, Spawner);
+    ECS_SYSTEM(world, SyncCount, EcsOnFrame, Foo);
+
+    int i, ENTITIES = 10;
+    for (i = 0; i < ENTITIES; i ++) {
+        ecs_new(world, Spawner_h);
+    }
+
+    Context ctx = {.component = Foo_h};
+    ecs_set_context(world, &ctx);
+
+    /* Stages are merged between PreFrame and OnFrame without sync points */
+    ecs_progress(world, 0);
+    test_assertint(ctx.count, ENTITIES);
+
+    ctx.count = 0;
+    ecs_progress(world, 0);
+    test_assertint(ctx.count, ENTITIES * 2);
+
+    ecs_fini(world);
+}
+
+void test_EcsSync_tc_pre_frame_merge_w_threads(
+    test_EcsSync this)
+{
+    EcsWorld *world = ecs_init();
+    ECS_COMPONENT(world, Spawner);
+    ECS_COMPONENT(world, Foo);
+    ECS_SYSTEM(world, SyncSpawn, EcsPreFrame, Spawner);
+    ECS_SYSTEM(world, SyncCount, EcsOnFrame, Foo);
+
+    int i, ENTITIES = 100;
+    EcsHandle handles[ENTITIES];
+    for (i = 0; i < ENTITIES; i ++) {
+        handles[i] = ecs_new(world, Spawner_h);
+    }
+
+    Context ctx = {.component = Foo_h};
+    ecs_set_context(world, &ctx);
+    ecs_set_threads(world, 4);
+
+    ecs_progress(world, 0);
+    test_assertint(ctx.count, ENTITIES);
+
+    ctx.count = 0;
+    ecs_progress(world, 0);
+    test_assertint(ctx.count, ENTITIES * 2);
+
+    for (i = 0; i < ENTITIES; i ++) {
+        EcsHandle spawned = ecs_get(world, handles[i], Spawner).spawned;
+        test_assert(ecs_has(world, spawned, Foo_h));
+    }
+
+    ecs_fini(world);
+}
@@ -330,3 +330,74 @@ void test_Array_tc_add_resize(
     test_assert(ecs_array_get(array, &arr_params, 5) == NULL);
     ecs_array_free(array);
 }
+
+void test_Array_tc_huge_pages(
+    test_Array this)
+{
+    EcsArray *array = ecs_array_new(&arr_params, 4);
+    array = fill_array(array);
+    test_assert(ecs_array_huge_size(array) == 0);
+
+    ecs_array_use_huge_pages(&array, &arr_params);
+    test_assert(ecs_array_huge_size(array) == ECS_HUGE_PAGE_SIZE);
+    test_assert((uintptr_t)array % ECS_HUGE_PAGE_SIZE == 0);
+    test_assertint(ecs_array_count(array), 4);
+    test_assertint(ecs_array_size(array), 4);
+
+    /* Grow array past the first huge page */
+    int i, count = ECS_HUGE_PAGE_SIZE / sizeof(int) + 4;
+    for (i = 4; i < count; i ++) {
+        int *elem = ecs_array_add(&array, &arr_params);
+        *elem = i;
+    }
+
+    test_assert(ecs_array_huge_size(array) > ECS_HUGE_PAGE_SIZE);
+    test_assert((uintptr_t)array % ECS_HUGE_PAGE_SIZE == 0);
+    test_assertint(ecs_array_count(array), count);
+
+    for (i = 0; i < count; i ++) {
+        test_assertint(*(int*)ecs_array_get(array, &arr_params, i), i);
+    }
+
+    ecs_array_free(array);
+}
+
+void test_Array_tc_huge_pages_reclaim(
+    test_Array this)
+{
+    EcsArray *array = ecs_array_new(&arr_params, 0);
+    ecs_array_use_huge_pages(&array, &arr_params);
+
+    int i, count = ECS_HUGE_PAGE_SIZE / sizeof(int) * 2;
+    for (i = 0; i < count; i ++) {
+        int *elem = ecs_array_add(&array, &arr_params);
+        *elem = i;
+    }
+
+    size_t huge_size = ecs_array_huge_size(array);
+    EcsArray *ptr = array;
+
+    /* Shrinking keeps the region, unused pages are returned to the system */
+    ecs_array_set_count(&array, &arr_params, 4);
+    ecs_array_reclaim(&array, &arr_params);
+    test_assert(array == ptr);
+    test_assert(ecs_array_huge_size(array) == huge_size);
+    test_assertint(ecs_array_size(array), 4);
+
+    for (i = 0; i < 4; i ++) {
+        test_assertint(*(int*)ecs_array_get(array, &arr_params, i), i);
+    }
+
+    /* Growing within the region does not move the array */
+    for (i = 4; i < count; i ++) {
+        int *elem = ecs_array_add(&array, &arr_params);
+        *elem = i;
+    }
+
+    test_assert(array == ptr);
+    for (i = 0; i < count; i ++) {
+        test_assertint(*(int*)ecs_array_get(array, &arr_params, i), i);
+    }
+
+    ecs_array_free(array);
+}